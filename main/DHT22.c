@@ -6,18 +6,44 @@
 #define LOG_LOCAL_LEVEL ESP_LOG_VERBOSE
 
 #include <stdio.h>
+#include <stdlib.h>
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_system.h"
 #include "driver/gpio.h"
 #include "rom/ets_sys.h"
-#include "tasks_common.h"
+#include "esp_timer.h"
+#include "freertos/queue.h"
+#include "driver/rmt_rx.h"
+#include "sdkconfig.h"
+#include "sensor_store.h"
+#include "sensor_filter.h"
+#include "metrics.h"
 #include "DHT22.h"
 
 // == global defines =============================================
 static const char* TAG = "DHT22";
-static dht22_t dht_sensor = { .dht22_pin = DHT_GPIO, .temperature = 0.0, .humidity = 0.0 };
+
+// Read outcomes, one capture attempt per measurement, all instances together
+static metrics_counter_t dht_reads_ok = METRICS_COUNTER("dht22_reads_total", "DHT22 measurements by result", "result=\"ok\"");
+static metrics_counter_t dht_reads_checksum = METRICS_COUNTER("dht22_reads_total", "DHT22 measurements by result", "result=\"checksum_error\"");
+static metrics_counter_t dht_reads_timeout = METRICS_COUNTER("dht22_reads_total", "DHT22 measurements by result", "result=\"timeout\"");
+
+// Sensor registry instance, allocated by dht22_sensor_start()
+typedef struct
+{
+    dht22_t dht22;
+#if CONFIG_DHT22_CAPTURE_RMT
+    dht22_capture_t capture;
+#endif
+    bool publish;                       // holds the DHT22 store channel
+} dht22_instance_t;
+
+static const rmt_receive_config_t dht_rx_config = {
+    .signal_range_min_ns = 1000,        // ignore glitches shorter than 1 us
+    .signal_range_max_ns = 200000,      // line idle for 200 us ends the frame
+};
 
 int wait_for_state(dht22_t dht22, int state, int timeout)
 {
@@ -41,16 +67,167 @@ void hold_low(dht22_t dht22, int hold_time_us)
     gpio_set_level(dht22.dht22_pin, 1);
 }
 
+static bool IRAM_ATTR dht22_rx_done_callback(rmt_channel_handle_t channel, const rmt_rx_done_event_data_t *edata, void *user_data)
+{
+    BaseType_t high_task_wakeup = pdFALSE;
+    QueueHandle_t queue = (QueueHandle_t)user_data;
+    xQueueSendFromISR(queue, edata, &high_task_wakeup);
+    return high_task_wakeup == pdTRUE;
+}
+
+// Ends the host start pulse and arms the receiver for the sensor response
+static void dht22_start_timer_callback(void *arg)
+{
+    dht22_capture_t *capture = (dht22_capture_t *)arg;
+    gpio_set_level(capture->pin, 1);
+    rmt_receive(capture->rx_channel, capture->rx_symbols, sizeof(capture->rx_symbols), &dht_rx_config);
+}
+
+esp_err_t dht22_capture_init(dht22_capture_t *capture, int pin)
+{
+    rmt_rx_channel_config_t rx_channel_config = {
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz = DHT_RMT_RESOLUTION_HZ,
+        .mem_block_symbols = DHT_RMT_MEM_SYMBOLS,
+        .gpio_num = pin,
+    };
+    memset(capture, 0, sizeof(*capture));
+    capture->pin = pin;
+
+    esp_err_t err = rmt_new_rx_channel(&rx_channel_config, &capture->rx_channel);
+    if(err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to create RMT RX channel (%s)", esp_err_to_name(err));
+        return err;
+    }
+
+    capture->rx_queue = xQueueCreate(1, sizeof(rmt_rx_done_event_data_t));
+    if(capture->rx_queue == NULL)
+    {
+        dht22_capture_deinit(capture);
+        return ESP_ERR_NO_MEM;
+    }
+    rmt_rx_event_callbacks_t callbacks = {
+        .on_recv_done = dht22_rx_done_callback,
+    };
+    ESP_ERROR_CHECK(rmt_rx_register_event_callbacks(capture->rx_channel, &callbacks, capture->rx_queue));
+
+    const esp_timer_create_args_t start_timer_args = {
+        .callback = &dht22_start_timer_callback,
+        .arg = capture,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "dht22_start"
+    };
+    err = esp_timer_create(&start_timer_args, &capture->start_timer);
+    if(err != ESP_OK)
+    {
+        dht22_capture_deinit(capture);
+        return err;
+    }
+
+    // The RMT input stays routed through the GPIO matrix, open drain lets us pull the line for the start pulse
+    gpio_set_direction(pin, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_level(pin, 1);
+    return ESP_OK;
+}
+
+void dht22_capture_deinit(dht22_capture_t *capture)
+{
+    if(capture->start_timer != NULL)
+    {
+        esp_timer_stop(capture->start_timer);
+        esp_timer_delete(capture->start_timer);
+        capture->start_timer = NULL;
+    }
+    if(capture->rx_channel != NULL)
+    {
+        rmt_del_channel(capture->rx_channel);
+        capture->rx_channel = NULL;
+    }
+    if(capture->rx_queue != NULL)
+    {
+        vQueueDelete(capture->rx_queue);
+        capture->rx_queue = NULL;
+    }
+}
+
+int dht22_capture_read(dht22_capture_t *capture, dht22_t *dht22, int connection_timeout)
+{
+    rmt_rx_done_event_data_t rx_data;
+    uint8_t received_data[5];
+    int ret = DHT_TIMEOUT_ERROR;
+
+    // Enabled only for the read, an enabled channel holds a power management lock that keeps the chip out of light sleep
+    rmt_enable(capture->rx_channel);
+
+    for(int attempt = 0; attempt < connection_timeout && ret == DHT_TIMEOUT_ERROR; attempt++)
+    {
+        // Only wait between attempts, not after the last one
+        if(attempt > 0)
+        {
+            vTaskDelay(pdMS_TO_TICKS(DHT_RETRY_DELAY_MS));
+        }
+        xQueueReset(capture->rx_queue);
+
+        // Start pulse, the timer releases the line and starts the capture
+        gpio_set_level(capture->pin, 0);
+        esp_timer_start_once(capture->start_timer, DHT_START_SIGNAL_US);
+
+        if(xQueueReceive(capture->rx_queue, &rx_data, pdMS_TO_TICKS(DHT_CAPTURE_TIMEOUT_MS) + 1) != pdTRUE)
+        {
+            ESP_LOGE(TAG, "No response from sensor");
+            // Cancel the pending receive so the next attempt can re-arm the channel
+            esp_timer_stop(capture->start_timer);
+            gpio_set_level(capture->pin, 1);
+            rmt_disable(capture->rx_channel);
+            rmt_enable(capture->rx_channel);
+            continue;
+        }
+
+#if CONFIG_DHT22_CAPTURE_DUMP
+        for(size_t i = 0; i < rx_data.num_symbols; i++)
+        {
+            const rmt_symbol_word_t *s = &rx_data.received_symbols[i];
+            ESP_LOGI(TAG, "DHT22_SYMBOL(%d, %d, %d, %d),", s->level0, s->duration0, s->level1, s->duration1);
+        }
+#endif
+        if(dht22_decode_symbols(rx_data.received_symbols, rx_data.num_symbols, received_data) != DHT_OK)
+        {
+            ESP_LOGE(TAG, "Incomplete frame (%d symbols)", rx_data.num_symbols);
+            continue;
+        }
+
+        ESP_LOGD(TAG, "Raw data: %02x %02x %02x %02x %02x", 
+                 received_data[0], received_data[1], received_data[2], 
+                 received_data[3], received_data[4]);
+
+        ret = dht22_decode_frame(dht22, received_data);
+    }
+
+    rmt_disable(capture->rx_channel);
+    if(ret == DHT_TIMEOUT_ERROR)
+    {
+        ESP_LOGE(TAG, "Connection timeout");
+    }
+    return ret;
+}
+
 int dht22_read(dht22_t *dht22, int connection_timeout)
 {
     int waited = 0;
     int one_duration = 0;
     int zero_duration = 0;
     int timeout_counter = 0;
+    bool connected = false;
     uint8_t received_data[5] = {0x00, 0x00, 0x00, 0x00, 0x00};
     
-    while(timeout_counter < connection_timeout)
+    while(!connected && timeout_counter < connection_timeout)
     {
+        // Only wait between attempts, not after the last one
+        if(timeout_counter > 0)
+        {
+            vTaskDelay(pdMS_TO_TICKS(DHT_RETRY_DELAY_MS));
+        }
         timeout_counter++;
         gpio_set_direction(dht22->dht22_pin, GPIO_MODE_INPUT);
         hold_low(*dht22, 1000);  // Hold low for 1ms to trigger DHT22 (shorter than DHT11)
@@ -60,7 +237,6 @@ int dht22_read(dht22_t *dht22, int connection_timeout)
         if(waited == -1)
         {
             ESP_LOGE(TAG, "Failed at phase 1");
-            ets_delay_us(20000);
             continue;
         } 
         
@@ -69,7 +245,6 @@ int dht22_read(dht22_t *dht22, int connection_timeout)
         if(waited == -1)
         {
             ESP_LOGE(TAG, "Failed at phase 2");
-            ets_delay_us(20000);
             continue;
         } 
         
@@ -78,14 +253,13 @@ int dht22_read(dht22_t *dht22, int connection_timeout)
         if(waited == -1)
         {
             ESP_LOGE(TAG, "Failed at phase 3");
-            ets_delay_us(20000);
             continue;
         }
         
-        break;
+        connected = true;
     }
     
-    if(timeout_counter == connection_timeout) 
+    if(!connected) 
     {
         ESP_LOGE(TAG, "Connection timeout");
         return DHT_TIMEOUT_ERROR;
@@ -117,51 +291,41 @@ int dht22_read(dht22_t *dht22, int connection_timeout)
              received_data[0], received_data[1], received_data[2], 
              received_data[3], received_data[4]);
     
-    // Verify checksum
-    int crc = received_data[0] + received_data[1] + received_data[2] + received_data[3];
-    crc = crc & 0xff;
-    
-    if(crc == received_data[4]) 
-    {
-        // For DHT22 (different from DHT11):
-        // Byte 0 & 1: Humidity value = (byte0 * 256 + byte1) / 10.0
-        // Byte 2 & 3: Temperature value = (byte2 * 256 + byte3) / 10.0
-        // If the MSB of byte 2 is set, the temperature is negative
-        
-        // DHT22 provides 16-bit values with 1 decimal place precision
-        dht22->humidity = ((received_data[0] << 8) + received_data[1]) / 10.0;
-        
-        // For temperature, check if negative (MSB of byte 2)
-        uint16_t temp_raw = (received_data[2] << 8) + received_data[3];
-        if (received_data[2] & 0x80) {
-            // Negative temperature - clear the sign bit and negate
-            temp_raw &= 0x7FFF;
-            dht22->temperature = -1.0 * temp_raw / 10.0;
-        } else {
-            dht22->temperature = temp_raw / 10.0;
-        }
-        
-        // Check if the temperature or humidity readings are reasonable
-        if (dht22->temperature > 80 || dht22->temperature < -40 || 
-            dht22->humidity > 100 || dht22->humidity < 0) {
-            ESP_LOGW(TAG, "Suspicious readings: Temp=%0.1f, Humidity=%0.1f", 
-                    dht22->temperature, dht22->humidity);
-        }
-        
-        return DHT_OK;
-    }
-    else 
+    return dht22_decode_frame(dht22, received_data);
+}
+
+// Maps the driver result codes onto the registry's and counts them
+static esp_err_t dht22_sensor_result(int ret)
+{
+    switch (ret)
     {
-        ESP_LOGE(TAG, "Wrong checksum: calculated %d, received %d", crc, received_data[4]);
-        return DHT_CHECKSUM_ERROR;
+        case DHT_OK:
+            metrics_counter_inc(&dht_reads_ok);
+            return ESP_OK;
+        case DHT_CHECKSUM_ERROR:
+            metrics_counter_inc(&dht_reads_checksum);
+            return ESP_ERR_INVALID_CRC;
+        default:
+            metrics_counter_inc(&dht_reads_timeout);
+            return ESP_ERR_TIMEOUT;
     }
 }
 
-static void DHT22_task(void *pvParameter)
+// Sensor registry callbacks, each instance owns its pin and capture state
+static esp_err_t dht22_sensor_start(sensor_t *sensor)
 {
+    const dht22_sensor_config_t *config = (const dht22_sensor_config_t *)sensor->desc->config;
+    dht22_instance_t *instance = calloc(1, sizeof(*instance));
+
+    if (instance == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    instance->dht22.dht22_pin = config ? config->pin : DHT_GPIO;
+
     // Initialize GPIO with pull-up
     gpio_config_t io_conf = {
-        .pin_bit_mask = (1ULL << dht_sensor.dht22_pin),
+        .pin_bit_mask = (1ULL << instance->dht22.dht22_pin),
         .mode = GPIO_MODE_INPUT,
         .pull_up_en = GPIO_PULLUP_ENABLE,
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
@@ -169,44 +333,87 @@ static void DHT22_task(void *pvParameter)
     };
     gpio_config(&io_conf);
     
-    ESP_LOGI(TAG, "DHT22 task started on pin %d", dht_sensor.dht22_pin);
-    
-    for (;;)
+#if CONFIG_DHT22_CAPTURE_RMT
+    esp_err_t err = dht22_capture_init(&instance->capture, instance->dht22.dht22_pin);
+    if (err != ESP_OK)
     {
-        //ESP_LOGI(TAG, "Reading DHT22 sensor...");
-        int ret = dht22_read(&dht_sensor, 5);  // Try 5 times before giving up
-        
-        if (ret == DHT_OK)
-        {
-            //ESP_LOGI(TAG, "Temperature: %.1f C", dht_sensor.temperature);
-            //ESP_LOGI(TAG, "Humidity: %.1f%%", dht_sensor.humidity);
-        }
-        else if (ret == DHT_CHECKSUM_ERROR)
-        {
-            //ESP_LOGE(TAG, "Checksum error");
-        }
-        else if (ret == DHT_TIMEOUT_ERROR)
-        {
-            //ESP_LOGE(TAG, "Sensor timeout");
-        }
-        
-        // Wait at least 2 seconds before next reading
-        vTaskDelay(2000 / portTICK_PERIOD_MS);
+        ESP_LOGE(TAG, "RMT capture unavailable");
+        free(instance);
+        return err;
+    }
+#endif
+
+    instance->publish = !(config && config->registry_only);
+    if (instance->publish && !sensor_store_claim(SENSOR_SOURCE_DHT22, instance))
+    {
+        ESP_LOGE(TAG, "Another DHT22 feeds the sensor store, set registry_only on %s", sensor->desc->name);
+#if CONFIG_DHT22_CAPTURE_RMT
+        dht22_capture_deinit(&instance->capture);
+#endif
+        free(instance);
+        return ESP_ERR_INVALID_STATE;
     }
+
+    metrics_register_counter(&dht_reads_ok);
+    metrics_register_counter(&dht_reads_checksum);
+    metrics_register_counter(&dht_reads_timeout);
+    sensor->ctx = instance;
+    ESP_LOGI(TAG, "DHT22 started on pin %d", instance->dht22.dht22_pin);
+    return ESP_OK;
 }
 
-float DHT22_get_temperature(void)
+// A single attempt, so an unplugged sensor holds up the other jobs for one capture timeout only
+static esp_err_t dht22_sensor_measure(sensor_t *sensor)
 {
-    return dht_sensor.temperature;
+    dht22_instance_t *instance = (dht22_instance_t *)sensor->ctx;
+
+#if CONFIG_DHT22_CAPTURE_RMT
+    int ret = dht22_capture_read(&instance->capture, &instance->dht22, 1);
+#else
+    int ret = dht22_read(&instance->dht22, 1);
+#endif
+    return dht22_sensor_result(ret);
 }
 
-float DHT22_get_humidity(void)
+static bool dht22_sensor_decode(sensor_t *sensor, float *values)
 {
-    return dht_sensor.humidity;
+    dht22_instance_t *instance = (dht22_instance_t *)sensor->ctx;
+    float temperature = instance->dht22.temperature;
+    float humidity = instance->dht22.humidity;
+
+    if (instance->publish && !sensor_filter_submit_dht22(&temperature, &humidity))
+    {
+        return false;
+    }
+    values[0] = temperature;
+    values[1] = humidity;
+    return true;
 }
 
-void DHT22_task_start(void)
+static const sensor_field_t dht22_sensor_fields[] = {
+    { .name = "temperature", .unit = "C", .decimals = 1 },
+    { .name = "humidity", .unit = "%RH", .decimals = 1 },
+};
+
+const sensor_driver_t dht22_sensor_driver = {
+    .type = "dht22",
+    .fields = dht22_sensor_fields,
+    .field_count = sizeof(dht22_sensor_fields) / sizeof(dht22_sensor_fields[0]),
+    .start = dht22_sensor_start,
+    .measure = dht22_sensor_measure,
+    .decode = dht22_sensor_decode,
+};
+
+float DHT22_get_temperature(void)
+{
+    sensor_dht22_sample_t sample;
+    sensor_store_read_dht22(&sample);
+    return sample.temperature;
+}
+
+float DHT22_get_humidity(void)
 {
-    dht_sensor.dht22_pin = DHT_GPIO;
-    xTaskCreatePinnedToCore(&DHT22_task, "DHT22_task", DHT22_TASK_STACK_SIZE, NULL, DHT22_TASK_PRIORITY, NULL, DHT22_TASK_CORE_ID);
-}
\ No newline at end of file
+    sensor_dht22_sample_t sample;
+    sensor_store_read_dht22(&sample);
+    return sample.humidity;
+}
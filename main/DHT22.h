@@ -12,25 +12,21 @@
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "driver/rmt_rx.h"
+#include "sdkconfig.h"
+#include "sensor_registry.h"
+#include "dht22_frame.h"
 
-#define DHT_OK 0
-#define DHT_CHECKSUM_ERROR -1
-#define DHT_TIMEOUT_ERROR -2
+#define DHT_GPIO CONFIG_DHT22_GPIO
 
-#define DHT_GPIO 13
-
-/**
- * Structure containing readings and info about the dht22
- * @var dht22_pin the pin associated with the dht22
- * @var temperature last temperature reading
- * @var humidity last humidity reading 
-*/
-typedef struct
-{
-    int dht22_pin;
-    float temperature;
-    float humidity;
-} dht22_t;
+// RMT capture timing (microseconds)
+#define DHT_RMT_RESOLUTION_HZ       1000000     // 1 tick = 1 us
+#define DHT_RMT_MEM_SYMBOLS         64          // handshake + 40 bits + trailer fit in one block
+#define DHT_START_SIGNAL_US         1100        // host start pulse, datasheet asks for >= 1 ms
+#define DHT_CAPTURE_TIMEOUT_MS      10          // full frame is at most ~6.5 ms after the start pulse
+#define DHT_RETRY_DELAY_MS          20
 
 /**
  * @brief Wait on pin until it reaches the specified state
@@ -46,6 +42,45 @@ int wait_for_state(dht22_t dht22, int state, int timeout);
 */
 void hold_low(dht22_t dht22, int hold_time_us);
 
+/**
+ * @brief RMT capture state of one DHT22 data line
+ * @var pin data line
+ * @var rx_channel RMT receiver recording the pulse train
+ * @var rx_queue receive done events of rx_channel
+ * @var start_timer ends the host start pulse and arms the receiver
+ * @var rx_symbols capture buffer
+*/
+typedef struct
+{
+    int pin;
+    rmt_channel_handle_t rx_channel;
+    QueueHandle_t rx_queue;
+    esp_timer_handle_t start_timer;
+    rmt_symbol_word_t rx_symbols[DHT_RMT_MEM_SYMBOLS];
+} dht22_capture_t;
+
+/**
+ * @brief Set up the RMT receiver and start pulse timer used by dht22_capture_read()
+ * @return ESP_OK on success, nothing is left allocated otherwise
+ * @param capture state to set up, stays in use until dht22_capture_deinit()
+ * @param pin data line
+*/
+esp_err_t dht22_capture_init(dht22_capture_t *capture, int pin);
+
+/**
+ * @brief Release what dht22_capture_init() set up
+*/
+void dht22_capture_deinit(dht22_capture_t *capture);
+
+/**
+ * @brief Read the dht22 with the RMT receiver recording the pulse train in hardware
+ * @note  The calling task sleeps while the frame is captured, no busy waiting is involved.
+ *        Each attempt takes at most ~DHT_CAPTURE_TIMEOUT_MS plus one tick
+ * @note  Wait for atleast 2 seconds between reads
+ * @param connection_timeout the number of capture attempts before declaring a timeout
+*/
+int dht22_capture_read(dht22_capture_t *capture, dht22_t *dht22, int connection_timeout);
+
 /**
  * @brief The function for reading temperature and humidity values from the dht22
  * @note  This function is blocking, ie: it forces the cpu to busy wait for the duration necessary to finish comms with the sensor.
@@ -55,9 +90,24 @@ void hold_low(dht22_t dht22, int hold_time_us);
 int dht22_read(dht22_t *dht22, int connection_timeout);
 
 /**
- * @brief Start the DHT22 sensor task
+ * @brief Sensor registry configuration of a DHT22 instance
+ * @var pin data line, DHT_GPIO if no configuration is given
+ * @var registry_only values are only reported in /sensors.json, for instances next to the one
+ *      that feeds the sensor store
+*/
+typedef struct
+{
+    int pin;
+    bool registry_only;
+} dht22_sensor_config_t;
+
+/**
+ * @brief Sensor registry driver, publishes to the sensor store. Fields: temperature (C), humidity (%RH)
+ * @note  Any number of instances, one per pin. Only one of them may publish to the sensor store.
+ *        One capture attempt per run, a failed read is retried on the next run.
+ *        Read it at most every 2 seconds
  */
-void DHT22_task_start(void);
+extern const sensor_driver_t dht22_sensor_driver;
 
 /**
  * @brief Get the current temperature reading
@@ -23,6 +23,15 @@ static const char TAG[] = "nvs";
 // NVS namespace used for station mode credentials
 const char app_nvs_sta_creds_namespace[] = "stacreds";
 
+// NVS namespace used for sensor sampling periods, keyed by sensor name
+const char app_nvs_sensors_namespace[] = "sensors";
+
+// NVS namespace of the uplink, holds the next sample log row to send
+const char app_nvs_uplink_namespace[] = "uplink";
+
+// NVS namespace of the alert rule table
+const char app_nvs_alerts_namespace[] = "alerts";
+
 esp_err_t app_nvs_save_sta_creds(void)
 {
 	nvs_handle handle;
@@ -61,7 +70,7 @@ esp_err_t app_nvs_save_sta_creds(void)
 			return esp_err;
 		}
 		nvs_close(handle);
-		ESP_LOGI(TAG, "app_nvs_save_sta_creds: Wrote wifi_sta_config: Station SSID: %s Password: %s\n", wifi_sta_config->sta.ssid, wifi_sta_config->sta.password);
+		ESP_LOGI(TAG, "app_nvs_save_sta_creds: Wrote wifi_sta_config: Station SSID: %s\n", wifi_sta_config->sta.ssid);
 	}
 	
 	printf("app_nvs_save_sta_creds: returned ESP_OK\n");
@@ -98,7 +107,7 @@ bool app_nvs_load_sta_creds(void)
 			printf("app_nvs_load_sta_creds: (%s) no station SSID found in NVS\n", esp_err_to_name(esp_err));
 			return false;
 		}
-		memset(wifi_sta_config->sta.ssid, (int)wifi_config_buff, wifi_config_size);
+		memcpy(wifi_sta_config->sta.ssid, wifi_config_buff, wifi_config_size);
 		
 		// Load Password
 		wifi_config_size = sizeof(wifi_sta_config->sta.password);
@@ -109,12 +118,12 @@ bool app_nvs_load_sta_creds(void)
 			printf("app_nvs_load_sta_creds: (%s) retrieving password!\n", esp_err_to_name(esp_err));
 			return false;
 		}
-		memset(wifi_sta_config->sta.password, (int)wifi_config_buff, wifi_config_size);
+		memcpy(wifi_sta_config->sta.password, wifi_config_buff, wifi_config_size);
 		
 		free(wifi_config_buff);
 		nvs_close(handle);
 		
-		printf("app_nvs_load_sta_creds: SSID: %s Password: %s \n", wifi_sta_config->sta.ssid, wifi_sta_config->sta.password);
+		printf("app_nvs_load_sta_creds: SSID: %s\n", wifi_sta_config->sta.ssid);
 		return wifi_sta_config->sta.ssid[0] != '\0';
 	}
 	else 
@@ -156,4 +165,168 @@ esp_err_t app_nvs_clear_sta_creds(void)
 	
 	printf("app_nvs_clear_sta_creds: returned ESP_OK\n");
 	return ESP_OK;
+}
+
+esp_err_t app_nvs_save_sta_cache(const app_nvs_sta_cache_t *cache)
+{
+	nvs_handle handle;
+	esp_err_t esp_err;
+	
+	esp_err = nvs_open(app_nvs_sta_creds_namespace, NVS_READWRITE, &handle);
+	if (esp_err != ESP_OK)
+	{
+		ESP_LOGE(TAG, "app_nvs_save_sta_cache: Error (%s) opening NVS handle", esp_err_to_name(esp_err));
+		return esp_err;
+	}
+	
+	esp_err = nvs_set_blob(handle, "cache", cache, sizeof(*cache));
+	if (esp_err == ESP_OK)
+	{
+		esp_err = nvs_commit(handle);
+	}
+	nvs_close(handle);
+	
+	if (esp_err != ESP_OK)
+	{
+		ESP_LOGE(TAG, "app_nvs_save_sta_cache: Error (%s) saving the association", esp_err_to_name(esp_err));
+	}
+	return esp_err;
+}
+
+bool app_nvs_load_sta_cache(app_nvs_sta_cache_t *cache)
+{
+	nvs_handle handle;
+	size_t size = sizeof(*cache);
+	
+	if (nvs_open(app_nvs_sta_creds_namespace, NVS_READONLY, &handle) != ESP_OK)
+	{
+		return false;
+	}
+	
+	// A blob of another size is from an older layout
+	bool found = nvs_get_blob(handle, "cache", cache, &size) == ESP_OK && size == sizeof(*cache);
+	nvs_close(handle);
+	return found;
+}
+
+esp_err_t app_nvs_save_sensor_period(const char *name, uint32_t period_ms)
+{
+	nvs_handle handle;
+	esp_err_t esp_err;
+	
+	esp_err = nvs_open(app_nvs_sensors_namespace, NVS_READWRITE, &handle);
+	if (esp_err != ESP_OK)
+	{
+		ESP_LOGE(TAG, "app_nvs_save_sensor_period: Error (%s) opening NVS handle", esp_err_to_name(esp_err));
+		return esp_err;
+	}
+	
+	esp_err = nvs_set_u32(handle, name, period_ms);
+	if (esp_err == ESP_OK)
+	{
+		esp_err = nvs_commit(handle);
+	}
+	nvs_close(handle);
+	
+	if (esp_err != ESP_OK)
+	{
+		ESP_LOGE(TAG, "app_nvs_save_sensor_period: Error (%s) saving period of %s", esp_err_to_name(esp_err), name);
+	}
+	return esp_err;
+}
+
+bool app_nvs_load_sensor_period(const char *name, uint32_t *period_ms)
+{
+	nvs_handle handle;
+	
+	if (nvs_open(app_nvs_sensors_namespace, NVS_READONLY, &handle) != ESP_OK)
+	{
+		return false;
+	}
+	
+	bool found = nvs_get_u32(handle, name, period_ms) == ESP_OK;
+	nvs_close(handle);
+	return found;
+}
+
+esp_err_t app_nvs_save_uplink_cursor(uint32_t seq)
+{
+	nvs_handle handle;
+	esp_err_t esp_err;
+	
+	esp_err = nvs_open(app_nvs_uplink_namespace, NVS_READWRITE, &handle);
+	if (esp_err != ESP_OK)
+	{
+		ESP_LOGE(TAG, "app_nvs_save_uplink_cursor: Error (%s) opening NVS handle", esp_err_to_name(esp_err));
+		return esp_err;
+	}
+	
+	esp_err = nvs_set_u32(handle, "cursor", seq);
+	if (esp_err == ESP_OK)
+	{
+		esp_err = nvs_commit(handle);
+	}
+	nvs_close(handle);
+	
+	if (esp_err != ESP_OK)
+	{
+		ESP_LOGE(TAG, "app_nvs_save_uplink_cursor: Error (%s) saving cursor", esp_err_to_name(esp_err));
+	}
+	return esp_err;
+}
+
+bool app_nvs_load_uplink_cursor(uint32_t *seq)
+{
+	nvs_handle handle;
+	
+	if (nvs_open(app_nvs_uplink_namespace, NVS_READONLY, &handle) != ESP_OK)
+	{
+		return false;
+	}
+	
+	bool found = nvs_get_u32(handle, "cursor", seq) == ESP_OK;
+	nvs_close(handle);
+	return found;
+}
+
+esp_err_t app_nvs_save_alert_rules(const void *rules, size_t size)
+{
+	nvs_handle handle;
+	esp_err_t esp_err;
+	
+	esp_err = nvs_open(app_nvs_alerts_namespace, NVS_READWRITE, &handle);
+	if (esp_err != ESP_OK)
+	{
+		ESP_LOGE(TAG, "app_nvs_save_alert_rules: Error (%s) opening NVS handle", esp_err_to_name(esp_err));
+		return esp_err;
+	}
+	
+	esp_err = nvs_set_blob(handle, "rules", rules, size);
+	if (esp_err == ESP_OK)
+	{
+		esp_err = nvs_commit(handle);
+	}
+	nvs_close(handle);
+	
+	if (esp_err != ESP_OK)
+	{
+		ESP_LOGE(TAG, "app_nvs_save_alert_rules: Error (%s) saving rules", esp_err_to_name(esp_err));
+	}
+	return esp_err;
+}
+
+bool app_nvs_load_alert_rules(void *rules, size_t size)
+{
+	nvs_handle handle;
+	size_t stored = size;
+	
+	if (nvs_open(app_nvs_alerts_namespace, NVS_READONLY, &handle) != ESP_OK)
+	{
+		return false;
+	}
+	
+	// A table of another size is from an older layout
+	bool found = nvs_get_blob(handle, "rules", rules, &stored) == ESP_OK && stored == size;
+	nvs_close(handle);
+	return found;
 }
\ No newline at end of file
@@ -10,6 +10,23 @@
 
 #include "esp_err.h"
 #include "stdbool.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+* Where the station was last associated and the lease it got, kept next to the credentials
+* so a reboot can connect without a full scan. Addresses in network byte order
+*/
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t reserved;
+    uint32_t ip;
+    uint32_t netmask;
+    uint32_t gateway;
+    uint32_t dns;
+} app_nvs_sta_cache_t;
+
 /*
 * Saves station mode Wifi credentials to NVS
 @return ESP_OK if successful
@@ -28,5 +45,53 @@ bool app_nvs_load_sta_creds(void);
 */
 esp_err_t app_nvs_clear_sta_creds(void);
 
+/*
+* Saves the last association, cleared along with the credentials
+@return ESP_OK if successful
+*/
+esp_err_t app_nvs_save_sta_cache(const app_nvs_sta_cache_t *cache);
+
+/*
+* Loads the association saved by app_nvs_save_sta_cache()
+@return true if one was found
+*/
+bool app_nvs_load_sta_cache(app_nvs_sta_cache_t *cache);
+
+/*
+* Saves the sampling period of a sensor, name is the NVS key
+@return ESP_OK if successful
+*/
+esp_err_t app_nvs_save_sensor_period(const char *name, uint32_t period_ms);
+
+/*
+* Loads a sampling period saved by app_nvs_save_sensor_period()
+@return true if a period was found, period_ms is left alone otherwise
+*/
+bool app_nvs_load_sensor_period(const char *name, uint32_t *period_ms);
+
+/*
+* Saves the sample log sequence number the uplink resumes from
+@return ESP_OK if successful
+*/
+esp_err_t app_nvs_save_uplink_cursor(uint32_t seq);
+
+/*
+* Loads the cursor saved by app_nvs_save_uplink_cursor()
+@return true if a cursor was found
+*/
+bool app_nvs_load_uplink_cursor(uint32_t *seq);
+
+/*
+* Saves the alert rule table (see sensor_alert.h) as one blob
+@return ESP_OK if successful
+*/
+esp_err_t app_nvs_save_alert_rules(const void *rules, size_t size);
+
+/*
+* Loads the table saved by app_nvs_save_alert_rules()
+@return true if a table of exactly size bytes was found
+*/
+bool app_nvs_load_alert_rules(void *rules, size_t size);
+
 
 #endif /* MAIN_APP_NVS_H_ */
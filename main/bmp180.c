@@ -4,25 +4,29 @@
  * Enhanced version with altitude, sea level pressure, dew point, and air density calculations
  */
 #include <malloc.h>
+#include <stdio.h>
 #include <string.h>
 #include <inttypes.h>
 #include <math.h>
+#include <sys/param.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "driver/i2c_master.h"
 #include "esp_timer.h"
 #include "esp_log.h"
-#include "rom/ets_sys.h"
 #include "bmp180.h"
-#include "tasks_common.h"
-#include "DHT22.h"
+#include "i2c_bus.h"
+#include "sensor_store.h"
+#include "sensor_filter.h"
+#include "metrics.h"
+#include "sdkconfig.h"
 
 #define TAG "BMP180"
 
 // Internal constants
-#define I2C_TRANSFER_TIMEOUT  50
 #define I2C_SPEED             400000
 #define BMP180_DELAY_BUFFER   500
+#define BMP180_TEMP_CONVERSION_US 4500
+#define BMP180_WAIT_TIMEOUT_MS    100
 
 // Register definitions (keep internal)
 #define BMP180_VERSION_REG        0xD0
@@ -43,221 +47,206 @@
 
 #define ARRAY_SIZE(x) (sizeof(x)/sizeof(x[0]))
 
-// Internal calibration data structure
-#pragma pack(push, 2)
-typedef struct s_bmp180_calibration_data
-{
-   union
-   {
-      uint16_t raw[11];
-      struct
-      {
-         int16_t AC1;
-         int16_t AC2;
-         int16_t AC3;
-         uint16_t AC4;
-         uint16_t AC5;
-         uint16_t AC6;
-         int16_t B1;
-         int16_t B2;
-         int16_t MB;
-         int16_t MC;
-         int16_t MD;
-      };
-   };
-} t_bmp180_calibration_data;
-#pragma pack(pop)
-
 // Internal context structure
 typedef struct
 {
-   i2c_master_bus_handle_t bus;
-   bool bus_created;
-   i2c_master_dev_handle_t device;
+   i2c_bus_device_t *device;
    uint32_t measurement_delay;
    bmp180_mode_t mode;
    t_bmp180_calibration_data cal;
+   // Asynchronous conversion state
+   esp_timer_handle_t conversion_timer;
+   TaskHandle_t waiter;
+   bmp180_ready_cb_t ready_cb;
+   void *ready_arg;
+   bmp180_conversion_t pending;
+   bool busy;
+   bool ut_valid;
+   int32_t ut;
+   uint32_t up;
 } bmp180_context_t;
 
-// Global sensor readings
-static bmp180_readings_t sensor_readings = {0};
+// Station altitude of the instance feeding the sensor store, used by bmp180_derive()
 static float known_altitude_m = 0.0f;
 
-// I2C helper functions
-static bool i2c_write_reg(i2c_master_dev_handle_t device, uint8_t reg, uint8_t *data, uint8_t length)
+// Fraction bits of the burst pressure filter
+#define BMP180_PRESSURE_FRAC_BITS 4
+
+// I2C helper functions, transfers go through the shared bus manager
+static bool i2c_write_reg(i2c_bus_device_t *device, uint8_t reg, uint8_t *data, uint8_t length)
 {
-   uint8_t *buffer = malloc(length + 1);
-   if (buffer == NULL) {
-      return false;
-   }
-   
-   buffer[0] = reg;
-   memcpy(&buffer[1], data, length);
-   esp_err_t result = i2c_master_transmit(device, buffer, length + 1, -1);
-   free(buffer);
-   
-   return (result == ESP_OK);
+   return (i2c_bus_write(device, reg, data, length) == ESP_OK);
 }
 
-static bool i2c_read_reg(i2c_master_dev_handle_t device, uint8_t reg, uint8_t *data, uint8_t length)
+static bool i2c_read_reg(i2c_bus_device_t *device, uint8_t reg, uint8_t *data, uint8_t length)
 {
-   return (i2c_master_transmit_receive(device, &reg, 1, data, length, -1) == ESP_OK);
+   return (i2c_bus_read(device, reg, data, length) == ESP_OK);
 }
 
-// Temperature and pressure compensation algorithm
-static int bmp180_compensate(t_bmp180_calibration_data *cal, uint8_t oss,
-    int32_t uncompensatedTemperature, int32_t uncompensatedPressure,
-   int32_t *temperature, int32_t *pressure)
+// Conversion timer expired, the result registers can be read
+static void bmp180_conversion_timer_callback(void *arg)
 {
-   int32_t X1, X2, B5;
-   int32_t X3, B3, B6;
-   int32_t T, P;
-   uint32_t B4, B7;
+   bmp180_context_t *ctx = (bmp180_context_t *) arg;
 
-   X1 = ((uncompensatedTemperature - (int32_t)cal->AC6) * (int32_t)cal->AC5) >> 15;
-   X2 = (((int32_t)cal->MC) << 11) / (X1 + (int32_t)cal->MD);
-   B5 = X1 + X2;
-   T = (B5 + 8) >> 4;
-   
-   if(temperature != NULL)
-      *temperature = T;
+   if(ctx->ready_cb != NULL)
+      ctx->ready_cb(ctx, ctx->ready_arg);
+   else if(ctx->waiter != NULL)
+      xTaskNotifyGive(ctx->waiter);
+}
 
-   if(pressure != NULL)
-   {
-      B6 = B5 - 4000;
-      X1 = ((int32_t)cal->B2 * ((B6 * B6) >> 12)) >> 11;
-      X2 = ((int32_t)cal->AC2 * B6) >> 11;
-      X3 = X1 + X2;
-      B3 = ((((int32_t)cal->AC1 * 4 + X3) << oss) + 2) >> 2;
-      X1 = ((int32_t)cal->AC3 * B6) >> 13;
-      X2 = ((int32_t)cal->B1 * ((B6 * B6) >> 12)) >> 16;
-      X3 = ((X1 + X2) + 2) >> 2;
-      B4 = ((uint32_t)cal->AC4 * (uint32_t)(X3 + 32768)) >> 15;
-      B7 = ((uint32_t)uncompensatedPressure - B3) * (uint32_t)(50000UL >> oss);
-      
-      if(B7 < 0x80000000UL)
-         P = (B7 * 2) / B4;
-      else
-         P = (B7 / B4) * 2;
-         
-      X1 = (P >> 8) * (P >> 8);
-      X1 = (X1 * 3038) >> 16;
-      X2 = (-7357 * P) >> 16;
-      P += (X1 + X2 + (int32_t)3791) >> 4;
-      *pressure = P;
-   }
-   return 0; 
+uint32_t bmp180_get_conversion_time_us(bmp180_t bmp, bmp180_conversion_t conversion)
+{
+   bmp180_context_t *ctx = (bmp180_context_t *) bmp;
+   uint32_t delay = (conversion == BMP180_CONVERSION_TEMPERATURE) ? BMP180_TEMP_CONVERSION_US : ctx->measurement_delay;
+   return delay + BMP180_DELAY_BUFFER;
+}
+
+void bmp180_set_ready_callback(bmp180_t bmp, bmp180_ready_cb_t cb, void *arg)
+{
+   bmp180_context_t *ctx = (bmp180_context_t *) bmp;
+   if(NULL == ctx)
+      return;
+   ctx->ready_cb = cb;
+   ctx->ready_arg = arg;
 }
 
-// Get raw temperature reading
-static bool bmp180_get_uncompensated_temperature(bmp180_context_t *ctx, int32_t *ut)
+// Kick off a conversion and arm the timer, returns immediately
+bool bmp180_start_conversion(bmp180_t bmp, bmp180_conversion_t conversion)
 {
-   uint8_t d[2] = { BMP180_MEASURE_TEMP };
-   if(!i2c_write_reg(ctx->device, BMP180_CONTROL_REG, d, sizeof(uint8_t)))
+   bmp180_context_t *ctx = (bmp180_context_t *) bmp;
+   if(NULL == ctx || ctx->busy)
+      return false;
+
+   uint8_t cmd = (conversion == BMP180_CONVERSION_TEMPERATURE)
+      ? BMP180_MEASURE_TEMP
+      : (uint8_t)(BMP180_MEASURE_PRESS | (ctx->mode << 6));
+   if(!i2c_write_reg(ctx->device, BMP180_CONTROL_REG, &cmd, sizeof(cmd)))
       return false;
 
-   ets_delay_us(4500 + BMP180_DELAY_BUFFER);
-   if(!i2c_read_reg(ctx->device, BMP180_OUT_MSB_REG, d, sizeof(d)))
+   ctx->waiter = xTaskGetCurrentTaskHandle();
+   ulTaskNotifyTake(pdTRUE, 0);   // drop a stale notification from an abandoned conversion
+   ctx->pending = conversion;
+   ctx->busy = true;
+
+   if(esp_timer_start_once(ctx->conversion_timer, bmp180_get_conversion_time_us(ctx, conversion)) != ESP_OK)
+   {
+      ctx->busy = false;
       return false;
-   uint32_t r = ((uint32_t)d[0] << 8) | d[1];
-   *ut = r;
-   ESP_LOGD(TAG, "Temperature: %" PRIi32, *ut);
+   }
    return true;
 }
 
-// Get raw pressure reading
-static bool bmp180_get_uncompensated_pressure(bmp180_context_t *ctx, uint32_t *up)
+// Sleep until the started conversion is done (not used when a ready callback is set)
+bool bmp180_wait_conversion(bmp180_t bmp, uint32_t timeout_ms)
 {
-   uint8_t oss = ctx->mode;
-   uint8_t d[3] = { BMP180_MEASURE_PRESS | (oss << 6), 0 };
-   if(!i2c_write_reg(ctx->device, BMP180_CONTROL_REG, d, sizeof(uint8_t)))
-      return false;
-   
-   ets_delay_us(ctx->measurement_delay + BMP180_DELAY_BUFFER);
-   if(!i2c_read_reg(ctx->device, BMP180_OUT_MSB_REG, d, sizeof(d)))
+   bmp180_context_t *ctx = (bmp180_context_t *) bmp;
+   if(NULL == ctx || !ctx->busy)
       return false;
-
-   uint32_t r = ((uint32_t)d[0] << 16) | ((uint32_t)d[1] << 8) | d[2];
-   r >>= 8 - oss; 
-   *up = r;
-   ESP_LOGD(TAG, "Pressure: %" PRIu32, *up);
-   return true;
+   return ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms) + 1) > 0;
 }
 
-// Read calibration coefficients from sensor
-static bool bmp180_read_calibration(bmp180_context_t *ctx)
+// Fetch the raw result of the finished conversion
+bool bmp180_read_conversion(bmp180_t bmp)
 {
-   for(int i = 0; i < ARRAY_SIZE(ctx->cal.raw); ++i)
+   bmp180_context_t *ctx = (bmp180_context_t *) bmp;
+   uint8_t d[3] = { 0 };
+   if(NULL == ctx || !ctx->busy)
+      return false;
+
+   ctx->busy = false;
+   if(ctx->pending == BMP180_CONVERSION_TEMPERATURE)
    {
-      uint8_t d[] = { 0, 0 };
-      uint8_t reg = BMP180_CALIBRATION_REG + (i * 2);
-      if(!i2c_read_reg(ctx->device, reg, d, sizeof(d)))
+      if(!i2c_read_reg(ctx->device, BMP180_OUT_MSB_REG, d, 2))
          return false;
-      ctx->cal.raw[i] = ((uint16_t) d[0]) << 8 | (d[1]);
-      if(ctx->cal.raw[i] == 0)
-      {
-         ESP_LOGD(TAG, "Invalid read %u", i);
-         return false; 
-      }
-      ESP_LOGD(TAG, "Calibration value %u = %d", i, ctx->cal.raw[i]);
+      ctx->ut = ((int32_t)d[0] << 8) | d[1];
+      ctx->ut_valid = true;
+      ESP_LOGD(TAG, "Temperature: %" PRIi32, ctx->ut);
+   }
+   else
+   {
+      uint8_t oss = ctx->mode;
+      if(!i2c_read_reg(ctx->device, BMP180_OUT_MSB_REG, d, 3))
+         return false;
+      uint32_t r = ((uint32_t)d[0] << 16) | ((uint32_t)d[1] << 8) | d[2];
+      r >>= 8 - oss;
+      ctx->up = r;
+      ESP_LOGD(TAG, "Pressure: %" PRIu32, ctx->up);
    }
    return true;
 }
 
-// Calculate altitude using barometric formula
-float bmp180_calculate_altitude(uint32_t pressure_pa, float sea_level_pressure_pa)
+// Compensate the last raw readings, pressure needs a temperature reading first
+bool bmp180_get_result(bmp180_t bmp, float *temperature, uint32_t *pressure)
 {
-   if (sea_level_pressure_pa <= 0) {
-      sea_level_pressure_pa = SEA_LEVEL_PRESSURE_PA;
-   }
-   
-   float ratio = (float)pressure_pa / sea_level_pressure_pa;
-   return 44330.0f * (1.0f - powf(ratio, 0.1903f));
-}
+   bmp180_context_t *ctx = (bmp180_context_t *) bmp;
+   int32_t T, P;
 
-// Calculate sea level pressure from current conditions
-float bmp180_calculate_sea_level_pressure(uint32_t pressure_pa, float altitude_m, float temperature_c)
-{
-   float temp_k = temperature_c + 273.15f;
-   float exponent = (GRAVITY_ACCEL * MOLAR_MASS_DRY_AIR * altitude_m) / (UNIVERSAL_GAS_CONSTANT * temp_k);
-   return (float)pressure_pa * expf(exponent);
+   if(NULL == ctx || !ctx->ut_valid)
+      return false;
+
+   bmp180_compensate(&ctx->cal, ctx->mode, ctx->ut, ctx->up, &T, (NULL == pressure) ? NULL : &P);
+
+   if(NULL != temperature)
+      *temperature = (float)T/10.0;
+   if(NULL != pressure)
+      *pressure = P;
+   return true;
 }
 
-// Calculate dew point using Magnus formula
-float bmp180_calculate_dew_point(float temperature_c, float humidity_percent)
+// Conversion timings from start command to result read, by conversion type
+static const uint32_t bmp180_conversion_bounds_us[] = { 2000, 5000, 8000, 10000, 15000, 20000, 30000, 50000, 100000 };
+static metrics_histogram_t bmp180_conversion_time[] = {
+   [BMP180_CONVERSION_TEMPERATURE] = METRICS_HISTOGRAM("bmp180_conversion_duration_seconds", "BMP180 conversion time",
+                                                       "type=\"temperature\"", bmp180_conversion_bounds_us),
+   [BMP180_CONVERSION_PRESSURE] = METRICS_HISTOGRAM("bmp180_conversion_duration_seconds", "BMP180 conversion time",
+                                                    "type=\"pressure\"", bmp180_conversion_bounds_us),
+};
+static metrics_counter_t bmp180_conversion_errors[] = {
+   [BMP180_CONVERSION_TEMPERATURE] = METRICS_COUNTER("bmp180_conversion_errors_total", "BMP180 conversions that failed",
+                                                     "type=\"temperature\""),
+   [BMP180_CONVERSION_PRESSURE] = METRICS_COUNTER("bmp180_conversion_errors_total", "BMP180 conversions that failed",
+                                                  "type=\"pressure\""),
+};
+
+// Run one conversion end to end, sleeping instead of spinning while the sensor converts
+static bool bmp180_run_conversion(bmp180_context_t *ctx, bmp180_conversion_t conversion)
 {
-   if (humidity_percent <= 0 || humidity_percent > 100) {
-      return NAN;
+   int64_t start = esp_timer_get_time();
+   bool ok = bmp180_start_conversion(ctx, conversion);
+
+   if(ok && !bmp180_wait_conversion(ctx, BMP180_WAIT_TIMEOUT_MS))
+   {
+      esp_timer_stop(ctx->conversion_timer);
+      ctx->busy = false;
+      ok = false;
    }
-   
-   const float a = 17.27f;
-   const float b = 237.7f;
-   
-   float alpha = ((a * temperature_c) / (b + temperature_c)) + logf(humidity_percent / 100.0f);
-   return (b * alpha) / (a - alpha);
+   ok = ok && bmp180_read_conversion(ctx);
+
+   if(ok)
+      metrics_histogram_observe(&bmp180_conversion_time[conversion], (uint32_t)(esp_timer_get_time() - start));
+   else
+      metrics_counter_inc(&bmp180_conversion_errors[conversion]);
+   return ok;
 }
 
-// Calculate air density using ideal gas law
-float bmp180_calculate_air_density(uint32_t pressure_pa, float temperature_c, float humidity_percent)
+// Read calibration coefficients from sensor, the 22 EEPROM bytes in one transaction
+static bool bmp180_read_calibration(bmp180_context_t *ctx)
 {
-   float temp_k = temperature_c + 273.15f;
-   float pressure_kpa = (float)pressure_pa / 1000.0f;
-   
-   // Calculate saturation vapor pressure using Magnus formula
-   float es = 0.6108f * expf((17.27f * temperature_c) / (temperature_c + 237.3f));
-   
-   // Calculate actual vapor pressure
-   float e = (humidity_percent / 100.0f) * es;
-   
-   // Calculate dry air pressure
-   float pd = pressure_kpa - e;
-   
-   // Calculate air density using ideal gas law
-   const float Md = 28.9644f;  // Molar mass of dry air (g/mol)
-   const float Mv = 18.0153f;  // Molar mass of water vapor (g/mol)
-   const float R = 8.31432f;   // Universal gas constant (J/(mol·K))
-   
-   return ((pd * Md) + (e * Mv)) / (R * temp_k);
+   uint8_t d[2 * ARRAY_SIZE(ctx->cal.raw)];
+   if(!i2c_read_reg(ctx->device, BMP180_CALIBRATION_REG, d, sizeof(d)))
+      return false;
+
+   for(int i = 0; i < ARRAY_SIZE(ctx->cal.raw); ++i)
+   {
+      ctx->cal.raw[i] = ((uint16_t) d[2 * i]) << 8 | (d[2 * i + 1]);
+      if(ctx->cal.raw[i] == 0)
+      {
+         ESP_LOGD(TAG, "Invalid read %u", i);
+         return false; 
+      }
+      ESP_LOGD(TAG, "Calibration value %u = %d", i, ctx->cal.raw[i]);
+   }
+   return true;
 }
 
 // Initialize BMP180 sensor
@@ -273,41 +262,21 @@ bmp180_t bmp180_init(i2c_lowlevel_config *config, uint8_t i2c_address, bmp180_mo
 
    memset(ctx, 0, sizeof(*ctx));
 
-   i2c_device_config_t dev_cfg = {
-      .dev_addr_length = I2C_ADDR_BIT_LEN_7,
-      .device_address = (i2c_address == 0) ? BMP180_DEVICE_ADDRESS : i2c_address,
-      .scl_speed_hz = I2C_SPEED,
-   };
-
-   if(NULL == config->bus)
+   // The bus of the port is shared with any other sensor on it
+   esp_err_t err = (NULL == config->bus)
+      ? i2c_bus_init(config->port, config->pin_sda, config->pin_scl)
+      : i2c_bus_attach(config->port, *config->bus);
+   if(err != ESP_OK)
    {
-      i2c_master_bus_config_t bus_cfg = {
-         .clk_source = I2C_CLK_SRC_DEFAULT,
-         .i2c_port = config->port,
-         .sda_io_num = config->pin_sda,
-         .scl_io_num = config->pin_scl,
-         .glitch_ignore_cnt = 7,
-         .flags.enable_internal_pullup = true,      
-      };
-      if(i2c_new_master_bus(&bus_cfg, &ctx->bus) != ESP_OK)
-      {
-         ESP_LOGE(TAG, "Failed to initialize I2C bus");
-         free(ctx);
-         return NULL;
-      }
-      ctx->bus_created = true;
-   }
-   else
-   {
-      ctx->bus = *config->bus;
-      ctx->bus_created = false;
+      ESP_LOGE(TAG, "Failed to initialize I2C bus");
+      free(ctx);
+      return NULL;
    }
 
-   if(i2c_master_bus_add_device(ctx->bus, &dev_cfg, &ctx->device) != ESP_OK)
+   if(i2c_bus_add_device(config->port, (i2c_address == 0) ? BMP180_DEVICE_ADDRESS : i2c_address,
+      I2C_SPEED, &ctx->device) != ESP_OK)
    {
       ESP_LOGE(TAG, "I2C device initialization failed");
-      if(ctx->bus_created)
-         i2c_del_master_bus(ctx->bus);
       free(ctx);
       return NULL;
    }
@@ -321,13 +290,23 @@ bmp180_t bmp180_init(i2c_lowlevel_config *config, uint8_t i2c_address, bmp180_mo
       case BMP180_MODE_ULTRA_HIGH_RESOLUTION: ctx->measurement_delay = 25500; break;
       default:
          ESP_LOGE(TAG, "Invalid mode %d", mode);
-         if(ctx->bus_created)
-            i2c_del_master_bus(ctx->bus);
+         i2c_bus_remove_device(ctx->device);
          free(ctx);
          return NULL; 
    }
 
-   if(!i2c_read_reg(ctx->device, BMP180_VERSION_REG, &id, sizeof(id))
+   const esp_timer_create_args_t timer_args = {
+      .callback = &bmp180_conversion_timer_callback,
+      .arg = ctx,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "bmp180_conv"
+   };
+
+   if(esp_timer_create(&timer_args, &ctx->conversion_timer) != ESP_OK)
+   {
+      ESP_LOGE(TAG, "Failed to create conversion timer");
+   }
+   else if(!i2c_read_reg(ctx->device, BMP180_VERSION_REG, &id, sizeof(id))
    || id != BMP180_CHIP_ID)
    {
       ESP_LOGE(TAG, "Invalid device ID (0x%02x, expected 0x%02x)", id, BMP180_CHIP_ID);
@@ -344,8 +323,9 @@ bmp180_t bmp180_init(i2c_lowlevel_config *config, uint8_t i2c_address, bmp180_mo
 
    if(!success)
    {
-      if(ctx->bus_created)
-         i2c_del_master_bus(ctx->bus);
+      if(ctx->conversion_timer != NULL)
+         esp_timer_delete(ctx->conversion_timer);
+      i2c_bus_remove_device(ctx->device);
       free(ctx);
       ctx = NULL;
    }
@@ -359,8 +339,9 @@ bool bmp180_free(bmp180_t bmp)
    if(NULL == ctx)
       return false;
    
-   if(ctx->bus_created)
-      i2c_del_master_bus(ctx->bus);
+   esp_timer_stop(ctx->conversion_timer);
+   esp_timer_delete(ctx->conversion_timer);
+   i2c_bus_remove_device(ctx->device);
    free(ctx);
    return true;
 }
@@ -369,194 +350,334 @@ bool bmp180_free(bmp180_t bmp)
 bool bmp180_measure(bmp180_t bmp, float *temperature, uint32_t *pressure)
 {
    bmp180_context_t *ctx = (bmp180_context_t *) bmp;
-   int32_t UT = 0;
-   uint32_t UP = 0;
-   int32_t T, P;
 
    if(NULL == ctx)
       return false;
 
-   if(!bmp180_get_uncompensated_temperature(ctx, &UT))
+   if(!bmp180_run_conversion(ctx, BMP180_CONVERSION_TEMPERATURE))
       return false;
 
    if(NULL != pressure)
    {
-      if(!bmp180_get_uncompensated_pressure(ctx, &UP))
+      if(!bmp180_run_conversion(ctx, BMP180_CONVERSION_PRESSURE))
          return false;
    }
 
-   if(bmp180_compensate(&ctx->cal, ctx->mode, UT, UP, &T,
-      (NULL == pressure) ? NULL : &P) != 0)
-   {
-      return false;
-   }
-   
-   if(NULL != temperature)
-      *temperature = (float)T/10.0;
-   if(NULL != pressure)
-      *pressure = P;
-   return true;
+   return bmp180_get_result(ctx, temperature, pressure);
 }
 
-// BMP180 sensor task
-static void BMP180_task(void *pvParameter)
+// Sensor registry instance, allocated by bmp180_sensor_start()
+typedef struct
 {
-   bmp180_t bmp_ctx = (bmp180_t)pvParameter;
-   
-   ESP_LOGI(TAG, "BMP180 task started");
-   
-   for (;;)
+   bmp180_context_t *ctx;
+   bool publish;               // holds the BMP180 store channel
+   bmp180_readings_t readings; // being assembled for sensor_filter
+   float temperature;
+   uint32_t pressure;          // latest pressure, filtered in burst mode
+#if CONFIG_BMP180_BURST_SAMPLING
+   uint32_t raw_pressure;      // latest conversion before the filter
+   int64_t last_publish;
+   uint32_t conversions;
+   int32_t filtered;           // 1/16 Pa
+   bool primed;
+   bool valid;                 // a conversion succeeded since the last publication
+#endif
+} bmp180_sensor_state_t;
+
+// Publish one sample to the sensor store, if this instance feeds it
+static void BMP180_publish(bmp180_sensor_state_t *state, bool valid, float temperature, uint32_t pressure)
+{
+   bmp180_readings_t *readings = &state->readings;
+
+   if (!valid)
    {
-      float temperature;
-      uint32_t pressure;
+      ESP_LOGE(TAG, "BMP180 measurement failed");
+   }
+   if (!state->publish)
+   {
+      return;
+   }
+   if (valid)
+   {
+      // Update the readings, derived values are filled in once by the filter stage.
+      // The filter stage pairs them with the DHT22 humidity while that is current
+      readings->temperature = temperature;
+      readings->pressure = pressure;
+      readings->pressure_hPa = (float)pressure / 100.0f;
+      readings->humidity = NAN;
+      readings->altitude = 0.0f;
+      readings->sea_level_pressure = 0.0f;
+      readings->dew_point = NAN;
+      readings->air_density = 0.0f;
+      readings->derived = 0;
       
-      if (bmp180_measure(bmp_ctx, &temperature, &pressure))
-      {
-         float humidity = DHT22_get_humidity();
-         
-         // Update global readings
-         sensor_readings.temperature = temperature;
-         sensor_readings.pressure = pressure;
-         sensor_readings.pressure_hPa = (float)pressure / 100.0f;
-         
-         sensor_readings.altitude = bmp180_calculate_altitude(pressure, SEA_LEVEL_PRESSURE_PA);
-         
-         float altitude_for_calculation = (known_altitude_m > 0) ? known_altitude_m : sensor_readings.altitude;
-         sensor_readings.sea_level_pressure = bmp180_calculate_sea_level_pressure(pressure, altitude_for_calculation, temperature);
-         
-         if (humidity > 0 && humidity <= 100) {
-            sensor_readings.dew_point = bmp180_calculate_dew_point(temperature, humidity);
-            sensor_readings.air_density = bmp180_calculate_air_density(pressure, temperature, humidity);
-         } else {
-            sensor_readings.dew_point = NAN;
-            sensor_readings.air_density = bmp180_calculate_air_density(pressure, temperature, 0);
-         }
-         
-         sensor_readings.valid = true;
-         
-         ESP_LOGD(TAG, "Temperature: %.2f°C", sensor_readings.temperature);
-         ESP_LOGD(TAG, "Pressure: %.2f hPa", sensor_readings.pressure_hPa);
-         ESP_LOGD(TAG, "Altitude: %.2f m", sensor_readings.altitude);
-         ESP_LOGD(TAG, "Sea level pressure: %.2f Pa", sensor_readings.sea_level_pressure);
-         if (!isnan(sensor_readings.dew_point)) {
-            ESP_LOGD(TAG, "Dew point: %.2f°C", sensor_readings.dew_point);
-         }
-         ESP_LOGD(TAG, "Air density: %.3f kg/m³", sensor_readings.air_density);
-      }
-      else
-      {
-         ESP_LOGE(TAG, "BMP180 measurement failed");
-         sensor_readings.valid = false;
-      }
+      readings->valid = true;
+      sensor_filter_submit_bmp180(readings);
       
-      vTaskDelay(2000 / portTICK_PERIOD_MS);
+      ESP_LOGD(TAG, "Temperature: %.2f°C", readings->temperature);
+      ESP_LOGD(TAG, "Pressure: %.2f hPa", readings->pressure_hPa);
+   }
+   else
+   {
+      readings->valid = false;
+      sensor_filter_submit_bmp180(readings);
    }
 }
 
-// Start BMP180 task (simple version)
-bool BMP180_task_start(int sda_pin, int scl_pin, float altitude)
+static esp_err_t bmp180_sensor_start(sensor_t *sensor)
 {
-   known_altitude_m = altitude;
+   const bmp180_sensor_config_t *config = (const bmp180_sensor_config_t *)sensor->desc->config;
    
-   i2c_lowlevel_config config = {
-      .bus = NULL,
-      .port = I2C_NUM_0,
-      .pin_sda = sda_pin,
-      .pin_scl = scl_pin
-   };
+   if (config == NULL) {
+      return ESP_ERR_INVALID_ARG;
+   }
+   bmp180_sensor_state_t *state = calloc(1, sizeof(*state));
+   if (state == NULL) {
+      return ESP_ERR_NO_MEM;
+   }
    
-   bmp180_t bmp_ctx = bmp180_init(&config, BMP180_DEVICE_ADDRESS, BMP180_MODE_STANDARD);
+   i2c_lowlevel_config i2c = config->i2c;
+   bmp180_t bmp_ctx = bmp180_init(&i2c, config->i2c_address, config->mode);
    if (bmp_ctx == NULL) {
       ESP_LOGE(TAG, "Failed to initialize BMP180");
-      return false;
+      free(state);
+      return ESP_FAIL;
    }
    
-   BaseType_t result = xTaskCreatePinnedToCore(
-      &BMP180_task, 
-      "BMP180_task", 
-      BMP180_TASK_STACK_SIZE, 
-      bmp_ctx, 
-      BMP180_TASK_PRIORITY, 
-      NULL, 
-      BMP180_TASK_CORE_ID
-   );
-   
-   if (result != pdPASS) {
-      ESP_LOGE(TAG, "Failed to create BMP180 task");
+   state->publish = !config->registry_only;
+   if (state->publish && !sensor_store_claim(SENSOR_SOURCE_BMP180, state)) {
+      ESP_LOGE(TAG, "Another BMP180 feeds the sensor store, set registry_only on %s", sensor->desc->name);
       bmp180_free(bmp_ctx);
-      return false;
+      free(state);
+      return ESP_ERR_INVALID_STATE;
+   }
+   if (state->publish) {
+      // The derived metrics of the store samples refer to this station
+      known_altitude_m = config->altitude;
    }
+   state->ctx = (bmp180_context_t *)bmp_ctx;
+   for (int i = 0; i < ARRAY_SIZE(bmp180_conversion_time); i++) {
+      metrics_register_histogram(&bmp180_conversion_time[i]);
+      metrics_register_counter(&bmp180_conversion_errors[i]);
+   }
+   sensor->ctx = state;
    
-   return true;
+#if CONFIG_BMP180_BURST_SAMPLING
+   state->last_publish = esp_timer_get_time();
+   if (bmp180_get_conversion_time_us(bmp_ctx, BMP180_CONVERSION_PRESSURE) > BMP180_SENSOR_PERIOD_MS * 1000) {
+      ESP_LOGW(TAG, "Burst period shorter than the pressure conversion time, sampling as fast as possible");
+   }
+#endif
+   return ESP_OK;
 }
 
-// Start BMP180 task (advanced version)
-bool BMP180_task_start_advanced(i2c_lowlevel_config *config, uint8_t i2c_address, bmp180_mode_t mode, float altitude)
+#if CONFIG_BMP180_BURST_SAMPLING
+
+/*
+ * Burst sampling: the registry runs one pressure conversion every BMP180_SENSOR_PERIOD_MS,
+ * temperature only every CONFIG_BMP180_BURST_TEMP_EVERY conversions, pressure smoothed by a first
+ * order IIR with coefficient 2^-CONFIG_BMP180_IIR_SHIFT. The store still gets one sample per
+ * CONFIG_BMP180_SAMPLE_INTERVAL_MS. The registry fields follow every conversion: the raw pressure
+ * and the filtered one at full filter resolution, for high rate consumers of /sensors.json
+ */
+static void bmp180_sensor_publish_due(bmp180_sensor_state_t *state)
 {
-   known_altitude_m = altitude;
+   int64_t now = esp_timer_get_time();
    
-   bmp180_t bmp_ctx = bmp180_init(config, i2c_address, mode);
-   if (bmp_ctx == NULL) {
-      ESP_LOGE(TAG, "Failed to initialize BMP180");
-      return false;
+   if (now - state->last_publish >= (int64_t)CONFIG_BMP180_SAMPLE_INTERVAL_MS * 1000) {
+      BMP180_publish(state, state->valid, state->temperature, state->pressure);
+      state->last_publish = now;
+      state->valid = false;
+   }
+}
+
+static esp_err_t bmp180_sensor_measure(sensor_t *sensor)
+{
+   bmp180_sensor_state_t *state = (bmp180_sensor_state_t *)sensor->ctx;
+   bmp180_context_t *ctx = state->ctx;
+   uint32_t pressure;
+   bool ok = true;
+   
+   if (!ctx->ut_valid || state->conversions % CONFIG_BMP180_BURST_TEMP_EVERY == 0) {
+      ok = bmp180_run_conversion(ctx, BMP180_CONVERSION_TEMPERATURE);
    }
+   ok = ok && bmp180_run_conversion(ctx, BMP180_CONVERSION_PRESSURE)
+           && bmp180_get_result(ctx, &state->temperature, &pressure);
    
-   BaseType_t result = xTaskCreatePinnedToCore(
-      &BMP180_task, 
-      "BMP180_task", 
-      BMP180_TASK_STACK_SIZE, 
-      bmp_ctx, 
-      BMP180_TASK_PRIORITY, 
-      NULL, 
-      BMP180_TASK_CORE_ID
-   );
+   if (!ok) {
+      // Start over with a fresh temperature and filter
+      ctx->ut_valid = false;
+      state->primed = false;
+      bmp180_sensor_publish_due(state);
+      return ESP_FAIL;
+   }
    
-   if (result != pdPASS) {
-      ESP_LOGE(TAG, "Failed to create BMP180 task");
-      bmp180_free(bmp_ctx);
-      return false;
+   state->raw_pressure = pressure;
+   int32_t sample = (int32_t)(pressure << BMP180_PRESSURE_FRAC_BITS);
+   if (!state->primed) {
+      state->filtered = sample;
+      state->primed = true;
+   } else {
+#if CONFIG_BMP180_IIR_SHIFT > 0
+      state->filtered += (sample - state->filtered + (1 << (CONFIG_BMP180_IIR_SHIFT - 1))) >> CONFIG_BMP180_IIR_SHIFT;
+#else
+      state->filtered = sample;
+#endif
    }
+   state->pressure = (uint32_t)((state->filtered + (1 << (BMP180_PRESSURE_FRAC_BITS - 1))) >> BMP180_PRESSURE_FRAC_BITS);
+   state->conversions++;
+   state->valid = true;
+   return ESP_OK;
+}
+
+static bool bmp180_sensor_decode(sensor_t *sensor, float *values)
+{
+   bmp180_sensor_state_t *state = (bmp180_sensor_state_t *)sensor->ctx;
+   
+   bmp180_sensor_publish_due(state);
+   values[0] = state->temperature;
+   values[1] = (float)state->raw_pressure / 100.0f;
+   values[2] = (float)state->filtered / (100.0f * (1 << BMP180_PRESSURE_FRAC_BITS));
+   return true;
+}
+
+#else
+
+static esp_err_t bmp180_sensor_measure(sensor_t *sensor)
+{
+   bmp180_sensor_state_t *state = (bmp180_sensor_state_t *)sensor->ctx;
+   
+   if (!bmp180_measure(state->ctx, &state->temperature, &state->pressure)) {
+      BMP180_publish(state, false, 0.0f, 0);
+      return ESP_FAIL;
+   }
+   return ESP_OK;
+}
+
+static bool bmp180_sensor_decode(sensor_t *sensor, float *values)
+{
+   bmp180_sensor_state_t *state = (bmp180_sensor_state_t *)sensor->ctx;
    
+   BMP180_publish(state, true, state->temperature, state->pressure);
+   values[0] = state->temperature;
+   values[1] = (float)state->pressure / 100.0f;
+   values[2] = values[1];
    return true;
 }
 
+#endif /* CONFIG_BMP180_BURST_SAMPLING */
+
+static const sensor_field_t bmp180_sensor_fields[] = {
+   { .name = "temperature", .unit = "C", .decimals = 2 },
+   { .name = "pressure", .unit = "hPa", .decimals = 2 },
+   { .name = "pressure_filtered", .unit = "hPa", .decimals = 4 },
+};
+
+const sensor_driver_t bmp180_sensor_driver = {
+   .type = "bmp180",
+   .fields = bmp180_sensor_fields,
+   .field_count = ARRAY_SIZE(bmp180_sensor_fields),
+   .start = bmp180_sensor_start,
+   .measure = bmp180_sensor_measure,
+   .decode = bmp180_sensor_decode,
+};
+
+// Compute derived values on demand
+void bmp180_derive(bmp180_readings_t *readings, uint8_t fields)
+{
+   fields &= ~readings->derived;
+   if (!readings->valid || fields == 0) {
+      return;
+   }
+   
+   // Without a known altitude the sea level pressure is referred to the barometric one
+   if ((fields & BMP180_DERIVE_SEA_LEVEL_PRESSURE) && known_altitude_m <= 0) {
+      fields |= BMP180_DERIVE_ALTITUDE & ~readings->derived;
+   }
+   
+   bool humid = (readings->humidity > 0 && readings->humidity <= 100);
+   
+   if (fields & BMP180_DERIVE_ALTITUDE) {
+      readings->altitude = bmp180_calculate_altitude(readings->pressure, SEA_LEVEL_PRESSURE_PA);
+   }
+   if (fields & BMP180_DERIVE_SEA_LEVEL_PRESSURE) {
+      float altitude_for_calculation = (known_altitude_m > 0) ? known_altitude_m : readings->altitude;
+      readings->sea_level_pressure = bmp180_calculate_sea_level_pressure(readings->pressure, altitude_for_calculation, readings->temperature);
+   }
+   if (fields & BMP180_DERIVE_DEW_POINT) {
+      readings->dew_point = humid ? bmp180_calculate_dew_point(readings->temperature, readings->humidity) : NAN;
+   }
+   if (fields & BMP180_DERIVE_AIR_DENSITY) {
+      readings->air_density = bmp180_calculate_air_density(readings->pressure, readings->temperature, humid ? readings->humidity : 0);
+   }
+   readings->derived |= fields;
+}
+
+size_t bmp180_format_json(const bmp180_readings_t *readings, char *buf, size_t size)
+{
+   int len;
+   
+   if (readings->valid) {
+      len = snprintf(buf, size,
+         "{\"temperature\":\"%.1f\",\"pressure\":\"%.2f\",\"sea_level_pressure\":\"%.2f\",\"altitude\":\"%.1f\",\"dew_point\":\"%.1f\",\"air_density\":\"%.3f\"}",
+         readings->temperature,
+         readings->pressure_hPa,
+         readings->sea_level_pressure / 100.0f,  // Pa to hPa like the pressure
+         readings->altitude,
+         isnan(readings->dew_point) ? 0.0f : readings->dew_point,
+         readings->air_density);
+   } else {
+      len = snprintf(buf, size,
+         "{\"temperature\":\"Error\",\"pressure\":\"Error\",\"sea_level_pressure\":\"Error\",\"altitude\":\"Error\",\"dew_point\":\"Error\",\"air_density\":\"Error\"}");
+   }
+   return (len > 0 && (size_t)len < size) ? (size_t)len : 0;
+}
+
+static bmp180_readings_t bmp180_get_derived(uint8_t fields)
+{
+   sensor_bmp180_sample_t sample;
+   sensor_store_read_bmp180(&sample);
+   bmp180_derive(&sample.readings, fields);
+   return sample.readings;
+}
+
 // Data access functions
 bmp180_readings_t BMP180_get_readings(void)
 {
-   return sensor_readings;
+   return bmp180_get_derived(BMP180_DERIVE_ALL);
 }
 
 float BMP180_get_temperature(void)
 {
-   return sensor_readings.temperature;
+   return bmp180_get_derived(0).temperature;
 }
 
 uint32_t BMP180_get_pressure(void)
 {
-   return sensor_readings.pressure;
+   return bmp180_get_derived(0).pressure;
 }
 
 float BMP180_get_pressure_hPa(void)
 {
-   return sensor_readings.pressure_hPa;
+   return bmp180_get_derived(0).pressure_hPa;
 }
 
 float BMP180_get_altitude(void)
 {
-   return sensor_readings.altitude;
+   return bmp180_get_derived(BMP180_DERIVE_ALTITUDE).altitude;
 }
 
 float BMP180_get_sea_level_pressure(void)
 {
-   return sensor_readings.sea_level_pressure;
+   return bmp180_get_derived(BMP180_DERIVE_SEA_LEVEL_PRESSURE).sea_level_pressure;
 }
 
 float BMP180_get_dew_point(void)
 {
-   return sensor_readings.dew_point;
+   return bmp180_get_derived(BMP180_DERIVE_DEW_POINT).dew_point;
 }
 
 float BMP180_get_air_density(void)
 {
-   return sensor_readings.air_density;
-}
\ No newline at end of file
+   return bmp180_get_derived(BMP180_DERIVE_AIR_DENSITY).air_density;
+}
@@ -6,10 +6,14 @@
 #ifndef __BMP180_H__
 #define __BMP180_H__
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include "hal/i2c_types.h"
 #include "driver/i2c_master.h"
+#include "sdkconfig.h"
+#include "sensor_registry.h"
+#include "bmp180_math.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -17,13 +21,6 @@ extern "C" {
 
 #define BMP180_DEVICE_ADDRESS 0x77
 
-// Standard atmosphere constants (moved from .c)
-#define SEA_LEVEL_PRESSURE_PA 101325.0f
-#define TEMPERATURE_LAPSE_RATE 0.0065f
-#define MOLAR_MASS_DRY_AIR 0.0289644f
-#define UNIVERSAL_GAS_CONSTANT 8.31432f
-#define GRAVITY_ACCEL 9.80665f
-
 /**
  * Hardware accuracy mode
  */
@@ -35,46 +32,77 @@ typedef enum
     BMP180_MODE_ULTRA_HIGH_RESOLUTION // 8 samples, 25.5 ms
 } bmp180_mode_t;
 
+/**
+ * Conversion started by the asynchronous measurement API
+ */
+typedef enum
+{
+    BMP180_CONVERSION_TEMPERATURE = 0,
+    BMP180_CONVERSION_PRESSURE
+} bmp180_conversion_t;
+
 typedef struct i2c_lowlevel_s
 {
-   i2c_master_bus_handle_t *bus;  // If NULL, will create new bus using params below
+   i2c_master_bus_handle_t *bus;  // If NULL, the shared bus of the port (see i2c_bus.h) is created or reused
    i2c_port_t port;               // I2C port number
    int pin_sda;                   // SDA pin
    int pin_scl;                   // SCL pin
 } i2c_lowlevel_config;
 
+typedef void *bmp180_t;
+
 /**
- * BMP180 sensor readings
+ * Called from the esp_timer task once a started conversion has finished
  */
-typedef struct {
-    float temperature;        // Temperature in Celsius
-    uint32_t pressure;        // Pressure in Pa
-    float pressure_hPa;       // Pressure in hPa
-    float altitude;           // Altitude in meters
-    float sea_level_pressure; // Sea level pressure in Pa
-    float dew_point;          // Dew point in Celsius
-    float air_density;        // Air density in kg/m³
-    bool valid;               // True if readings are valid
-} bmp180_readings_t;
-
-typedef void *bmp180_t;
+typedef void (*bmp180_ready_cb_t)(bmp180_t bmp, void *arg);
 
 // Initialization and cleanup
 bmp180_t bmp180_init(i2c_lowlevel_config *config, uint8_t i2c_address, bmp180_mode_t mode);
 bool bmp180_free(bmp180_t bmp);
 
-// Basic measurement
+// Basic measurement (the calling task sleeps during conversions)
 bool bmp180_measure(bmp180_t bmp, float *temperature, uint32_t *pressure);
 
-// Calculation functions
-float bmp180_calculate_altitude(uint32_t pressure_pa, float sea_level_pressure_pa);
-float bmp180_calculate_sea_level_pressure(uint32_t pressure_pa, float altitude_m, float temperature_c);
-float bmp180_calculate_dew_point(float temperature_c, float humidity_percent);
-float bmp180_calculate_air_density(uint32_t pressure_pa, float temperature_c, float humidity_percent);
+// Asynchronous measurement
+// start -> (ready callback or bmp180_wait_conversion) -> bmp180_read_conversion -> bmp180_get_result
+bool bmp180_start_conversion(bmp180_t bmp, bmp180_conversion_t conversion);
+bool bmp180_wait_conversion(bmp180_t bmp, uint32_t timeout_ms);
+bool bmp180_read_conversion(bmp180_t bmp);
+bool bmp180_get_result(bmp180_t bmp, float *temperature, uint32_t *pressure);
+uint32_t bmp180_get_conversion_time_us(bmp180_t bmp, bmp180_conversion_t conversion);
+void bmp180_set_ready_callback(bmp180_t bmp, bmp180_ready_cb_t cb, void *arg);
+
+// Fills the requested derived fields of valid readings that are not computed yet
+void bmp180_derive(bmp180_readings_t *readings, uint8_t fields);
+
+// Size of the /bmp180Sensor.json body buffer
+#define BMP180_JSON_SIZE 300
+
+// Serializes readings as the /bmp180Sensor.json body, all fields are "Error" for invalid readings.
+// Returns the length written, or 0 if the body did not fit
+size_t bmp180_format_json(const bmp180_readings_t *readings, char *buf, size_t size);
+
+/**
+ * Sensor registry configuration of a BMP180 instance
+ */
+typedef struct {
+    i2c_lowlevel_config i2c;
+    uint8_t i2c_address;      // BMP180_DEVICE_ADDRESS
+    bmp180_mode_t mode;
+    float altitude;           // station altitude in meters for the sea level pressure, 0 if unknown
+    bool registry_only;       // only report in /sensors.json, another instance feeds the sensor store
+} bmp180_sensor_config_t;
+
+// Registry period: one burst conversion, or one sample per sample interval
+#if CONFIG_BMP180_BURST_SAMPLING
+#define BMP180_SENSOR_PERIOD_MS   (1000 / CONFIG_BMP180_BURST_RATE_HZ)
+#else
+#define BMP180_SENSOR_PERIOD_MS   CONFIG_BMP180_SAMPLE_INTERVAL_MS
+#endif
 
-// Task management
-bool BMP180_task_start(int sda_pin, int scl_pin, float altitude);
-bool BMP180_task_start_advanced(i2c_lowlevel_config *config, uint8_t i2c_address, bmp180_mode_t mode, float altitude);
+// Sensor registry driver, one instance per device, only one of them publishes to the sensor store.
+// Fields: temperature (C), pressure (hPa), pressure_filtered (hPa, the burst filter output at 1/16 Pa)
+extern const sensor_driver_t bmp180_sensor_driver;
 
 // Data access functions
 bmp180_readings_t BMP180_get_readings(void);
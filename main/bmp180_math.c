@@ -0,0 +1,204 @@
+/*
+ * bmp180_math.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+#include <stddef.h>
+#include <math.h>
+#include "sdkconfig.h"
+#include "fixed_point.h"
+#include "bmp180_math.h"
+
+// Temperature and pressure compensation algorithm
+void bmp180_compensate(const t_bmp180_calibration_data *cal, uint8_t oss,
+   int32_t uncompensatedTemperature, int32_t uncompensatedPressure,
+   int32_t *temperature, int32_t *pressure)
+{
+   int32_t X1, X2, B5;
+   int32_t X3, B3, B6;
+   int32_t T, P;
+   uint32_t B4, B7;
+
+   X1 = ((uncompensatedTemperature - (int32_t)cal->AC6) * (int32_t)cal->AC5) >> 15;
+   X2 = (((int32_t)cal->MC) << 11) / (X1 + (int32_t)cal->MD);
+   B5 = X1 + X2;
+   T = (B5 + 8) >> 4;
+   
+   if(temperature != NULL)
+      *temperature = T;
+
+   if(pressure != NULL)
+   {
+      B6 = B5 - 4000;
+      X1 = ((int32_t)cal->B2 * ((B6 * B6) >> 12)) >> 11;
+      X2 = ((int32_t)cal->AC2 * B6) >> 11;
+      X3 = X1 + X2;
+      B3 = ((((int32_t)cal->AC1 * 4 + X3) << oss) + 2) >> 2;
+      X1 = ((int32_t)cal->AC3 * B6) >> 13;
+      X2 = ((int32_t)cal->B1 * ((B6 * B6) >> 12)) >> 16;
+      X3 = ((X1 + X2) + 2) >> 2;
+      B4 = ((uint32_t)cal->AC4 * (uint32_t)(X3 + 32768)) >> 15;
+      B7 = ((uint32_t)uncompensatedPressure - B3) * (uint32_t)(50000UL >> oss);
+      
+      if(B7 < 0x80000000UL)
+         P = (B7 * 2) / B4;
+      else
+         P = (B7 / B4) * 2;
+         
+      X1 = (P >> 8) * (P >> 8);
+      X1 = (X1 * 3038) >> 16;
+      X2 = (-7357 * P) >> 16;
+      P += (X1 + X2 + (int32_t)3791) >> 4;
+      *pressure = P;
+   }
+}
+
+#if CONFIG_BMP180_DERIVATION_FIXED
+
+/*
+* Fixed point versions, only the final conversion to float touches the FPU. Largest difference
+* to double precision evaluation over 300..1100 hPa, -40..85 C, 1..100 %RH, -500..9000 m, as
+* measured by the sweep in test/main/test_bmp180.c: altitude 0.007 m, sea level pressure 0.34 Pa,
+* dew point 0.0011 C, air density 1.1e-6 kg/m3
+*/
+#define Q24_BARO_EXPONENT   FIXED_POINT_Q24(0.1903)
+#define Q24_HYPSOMETRIC     FIXED_POINT_Q24(GRAVITY_ACCEL * MOLAR_MASS_DRY_AIR / UNIVERSAL_GAS_CONSTANT)
+#define Q24_MAGNUS_A        FIXED_POINT_Q24(17.27)
+#define Q24_LN_10000        FIXED_POINT_Q24(9.21034037197618)
+#define Q24_TO_FLOAT        (1.0f / FIXED_POINT_Q24_ONE)
+#define MAGNUS_B_DEW_MC     237700      // 237.7 C in m°C
+#define MAGNUS_B_VAPOUR_MC  237300      // 237.3 C in m°C
+#define CELSIUS_TO_KELVIN_MK 273150
+
+// Calculate altitude using barometric formula, (p / p0)^0.1903 = e^(0.1903 (ln p - ln p0))
+float bmp180_calculate_altitude(uint32_t pressure_pa, float sea_level_pressure_pa)
+{
+   if (sea_level_pressure_pa <= 0) {
+      sea_level_pressure_pa = SEA_LEVEL_PRESSURE_PA;
+   }
+   if (pressure_pa == 0) {
+      return 44330.0f;
+   }
+   
+   int32_t ln_ratio = fixed_point_ln_q24(pressure_pa) - fixed_point_ln_q24((uint32_t)lroundf(sea_level_pressure_pa));
+   int32_t power = fixed_point_exp_q24((int32_t)(((int64_t)ln_ratio * Q24_BARO_EXPONENT) >> FIXED_POINT_Q24_SHIFT));
+   return 44330.0f * (float)(FIXED_POINT_Q24_ONE - power) * Q24_TO_FLOAT;
+}
+
+// Calculate sea level pressure from current conditions, h in mm over T in mK gives the exponent in Q24
+float bmp180_calculate_sea_level_pressure(uint32_t pressure_pa, float altitude_m, float temperature_c)
+{
+   int64_t h_mm = llroundf(altitude_m * 1000.0f);
+   int64_t t_mk = llroundf(temperature_c * 1000.0f) + CELSIUS_TO_KELVIN_MK;
+   if (t_mk <= 0) {
+      return NAN;
+   }
+   
+   int32_t exponent = (int32_t)((Q24_HYPSOMETRIC * h_mm) / t_mk);
+   return (float)((int64_t)pressure_pa * fixed_point_exp_q24(exponent)) * Q24_TO_FLOAT;
+}
+
+// Calculate dew point using Magnus formula
+float bmp180_calculate_dew_point(float temperature_c, float humidity_percent)
+{
+   if (humidity_percent <= 0 || humidity_percent > 100) {
+      return NAN;
+   }
+   
+   int32_t t_mc = lroundf(temperature_c * 1000.0f);
+   uint32_t rh = (uint32_t)lroundf(humidity_percent * 100.0f);    // 0.01 %RH
+   if (rh == 0) {
+      rh = 1;
+   }
+   
+   int32_t alpha = (int32_t)((int64_t)Q24_MAGNUS_A * t_mc / (MAGNUS_B_DEW_MC + t_mc))
+                 + fixed_point_ln_q24(rh) - Q24_LN_10000;
+   int64_t dew_mc = (int64_t)MAGNUS_B_DEW_MC * alpha / (Q24_MAGNUS_A - alpha);
+   return (float)dew_mc / 1000.0f;
+}
+
+// Calculate air density using ideal gas law, rho = (p Md - e (Md - Mv)) / (R T)
+float bmp180_calculate_air_density(uint32_t pressure_pa, float temperature_c, float humidity_percent)
+{
+   int32_t t_mc = lroundf(temperature_c * 1000.0f);
+   int64_t t_mk = (int64_t)t_mc + CELSIUS_TO_KELVIN_MK;
+   int64_t rh = llroundf(humidity_percent * 100.0f);               // 0.01 %RH
+   if (t_mk <= 0) {
+      return NAN;
+   }
+   
+   // Saturation and actual vapor pressure in mPa
+   int32_t growth = fixed_point_exp_q24((int32_t)((int64_t)Q24_MAGNUS_A * t_mc / (MAGNUS_B_VAPOUR_MC + t_mc)));
+   int64_t es_mpa = (610800LL * growth) >> FIXED_POINT_Q24_SHIFT;
+   int64_t e_mpa = es_mpa * rh / 10000;
+   
+   // Molar masses in 1e-7 kg/mol and R in 1e-5 J/(mol K), the quotient comes out in 1e-6 kg/m³
+   const int64_t Md = 289644;
+   const int64_t Mv = 180153;
+   const int64_t R = 831432;
+   int64_t num = (int64_t)pressure_pa * 1000 * Md - e_mpa * (Md - Mv);
+   return (float)(num * 10000 / (R * t_mk)) * 1e-6f;
+}
+
+#else
+
+// libm float reference versions
+
+// Calculate altitude using barometric formula
+float bmp180_calculate_altitude(uint32_t pressure_pa, float sea_level_pressure_pa)
+{
+   if (sea_level_pressure_pa <= 0) {
+      sea_level_pressure_pa = SEA_LEVEL_PRESSURE_PA;
+   }
+   
+   float ratio = (float)pressure_pa / sea_level_pressure_pa;
+   return 44330.0f * (1.0f - powf(ratio, 0.1903f));
+}
+
+// Calculate sea level pressure from current conditions
+float bmp180_calculate_sea_level_pressure(uint32_t pressure_pa, float altitude_m, float temperature_c)
+{
+   float temp_k = temperature_c + 273.15f;
+   float exponent = (GRAVITY_ACCEL * MOLAR_MASS_DRY_AIR * altitude_m) / (UNIVERSAL_GAS_CONSTANT * temp_k);
+   return (float)pressure_pa * expf(exponent);
+}
+
+// Calculate dew point using Magnus formula
+float bmp180_calculate_dew_point(float temperature_c, float humidity_percent)
+{
+   if (humidity_percent <= 0 || humidity_percent > 100) {
+      return NAN;
+   }
+   
+   const float a = 17.27f;
+   const float b = 237.7f;
+   
+   float alpha = ((a * temperature_c) / (b + temperature_c)) + logf(humidity_percent / 100.0f);
+   return (b * alpha) / (a - alpha);
+}
+
+// Calculate air density using ideal gas law
+float bmp180_calculate_air_density(uint32_t pressure_pa, float temperature_c, float humidity_percent)
+{
+   float temp_k = temperature_c + 273.15f;
+   float pressure_kpa = (float)pressure_pa / 1000.0f;
+   
+   // Calculate saturation vapor pressure using Magnus formula
+   float es = 0.6108f * expf((17.27f * temperature_c) / (temperature_c + 237.3f));
+   
+   // Calculate actual vapor pressure
+   float e = (humidity_percent / 100.0f) * es;
+   
+   // Calculate dry air pressure
+   float pd = pressure_kpa - e;
+   
+   // Calculate air density using ideal gas law
+   const float Md = 28.9644f;  // Molar mass of dry air (g/mol)
+   const float Mv = 18.0153f;  // Molar mass of water vapor (g/mol)
+   const float R = 8.31432f;   // Universal gas constant (J/(mol·K))
+   
+   return ((pd * Md) + (e * Mv)) / (R * temp_k);
+}
+
+#endif /* CONFIG_BMP180_DERIVATION_FIXED */
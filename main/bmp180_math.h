@@ -0,0 +1,90 @@
+/*
+ * bmp180_math.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef MAIN_BMP180_MATH_H_
+#define MAIN_BMP180_MATH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Compensation and derived metrics of the BMP180, free of hardware access so the host tests build them
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Standard atmosphere constants
+#define SEA_LEVEL_PRESSURE_PA 101325.0f
+#define TEMPERATURE_LAPSE_RATE 0.0065f
+#define MOLAR_MASS_DRY_AIR 0.0289644f
+#define UNIVERSAL_GAS_CONSTANT 8.31432f
+#define GRAVITY_ACCEL 9.80665f
+
+/**
+ * BMP180 sensor readings
+ */
+typedef struct {
+    float temperature;        // Temperature in Celsius
+    uint32_t pressure;        // Pressure in Pa
+    float pressure_hPa;       // Pressure in hPa
+    float altitude;           // Altitude in meters
+    float sea_level_pressure; // Sea level pressure in Pa
+    float dew_point;          // Dew point in Celsius
+    float air_density;        // Air density in kg/m³
+    float humidity;           // DHT22 humidity at sample time, input of dew point and air density
+    uint8_t derived;          // BMP180_DERIVE_* fields already computed
+    bool valid;               // True if readings are valid
+} bmp180_readings_t;
+
+/**
+ * Derived fields, computed on demand by bmp180_derive()
+ */
+#define BMP180_DERIVE_ALTITUDE            0x01
+#define BMP180_DERIVE_SEA_LEVEL_PRESSURE  0x02
+#define BMP180_DERIVE_DEW_POINT           0x04
+#define BMP180_DERIVE_AIR_DENSITY         0x08
+#define BMP180_DERIVE_ALL                 0x0F
+
+// Calibration EEPROM, raw holds the words AC1 to MD in host order
+#pragma pack(push, 2)
+typedef struct s_bmp180_calibration_data
+{
+   union
+   {
+      uint16_t raw[11];
+      struct
+      {
+         int16_t AC1;
+         int16_t AC2;
+         int16_t AC3;
+         uint16_t AC4;
+         uint16_t AC5;
+         uint16_t AC6;
+         int16_t B1;
+         int16_t B2;
+         int16_t MB;
+         int16_t MC;
+         int16_t MD;
+      };
+   };
+} t_bmp180_calibration_data;
+#pragma pack(pop)
+
+// Datasheet compensation of raw conversions, temperature in 0.1 C and pressure in Pa
+void bmp180_compensate(const t_bmp180_calibration_data *cal, uint8_t oss, int32_t ut, int32_t up, int32_t *temperature, int32_t *pressure);
+
+// Calculation functions, fixed point or libm float depending on CONFIG_BMP180_DERIVATION_*
+float bmp180_calculate_altitude(uint32_t pressure_pa, float sea_level_pressure_pa);
+float bmp180_calculate_sea_level_pressure(uint32_t pressure_pa, float altitude_m, float temperature_c);
+float bmp180_calculate_dew_point(float temperature_c, float humidity_percent);
+float bmp180_calculate_air_density(uint32_t pressure_pa, float temperature_c, float humidity_percent);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_BMP180_MATH_H_ */
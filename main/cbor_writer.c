@@ -0,0 +1,135 @@
+/*
+ * cbor_writer.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#include <string.h>
+#include "cbor_writer.h"
+
+// Major types, RFC 8949 section 3.1
+#define CBOR_MAJOR_UINT         0
+#define CBOR_MAJOR_NEGATIVE     1
+#define CBOR_MAJOR_BYTES        2
+#define CBOR_MAJOR_TEXT         3
+#define CBOR_MAJOR_ARRAY        4
+#define CBOR_MAJOR_MAP          5
+#define CBOR_MAJOR_SIMPLE       7
+
+#define CBOR_INDEFINITE         31
+#define CBOR_SIMPLE_NULL        22
+
+void cbor_writer_init(cbor_writer_t *w, uint8_t *buf, size_t size)
+{
+	w->buf = buf;
+	w->size = size;
+	w->len = 0;
+	w->ok = true;
+}
+
+static void cbor_put_raw(cbor_writer_t *w, const void *data, size_t len)
+{
+	if (!w->ok || len > w->size - w->len)
+	{
+		w->ok = false;
+		return;
+	}
+	memcpy(w->buf + w->len, data, len);
+	w->len += len;
+}
+
+// Initial byte plus the argument in 0, 1, 2 or 4 big endian bytes
+static void cbor_put_head(cbor_writer_t *w, uint8_t major, uint32_t value)
+{
+	uint8_t head[5];
+	size_t len;
+
+	if (value < 24)
+	{
+		head[0] = (major << 5) | value;
+		len = 1;
+	}
+	else if (value <= UINT8_MAX)
+	{
+		head[0] = (major << 5) | 24;
+		head[1] = value;
+		len = 2;
+	}
+	else if (value <= UINT16_MAX)
+	{
+		head[0] = (major << 5) | 25;
+		head[1] = value >> 8;
+		head[2] = value;
+		len = 3;
+	}
+	else
+	{
+		head[0] = (major << 5) | 26;
+		head[1] = value >> 24;
+		head[2] = value >> 16;
+		head[3] = value >> 8;
+		head[4] = value;
+		len = 5;
+	}
+	cbor_put_raw(w, head, len);
+}
+
+void cbor_put_uint(cbor_writer_t *w, uint32_t value)
+{
+	cbor_put_head(w, CBOR_MAJOR_UINT, value);
+}
+
+void cbor_put_int(cbor_writer_t *w, int32_t value)
+{
+	if (value >= 0)
+	{
+		cbor_put_head(w, CBOR_MAJOR_UINT, (uint32_t)value);
+	}
+	else
+	{
+		// -1 - n, written without overflowing for INT32_MIN
+		cbor_put_head(w, CBOR_MAJOR_NEGATIVE, (uint32_t)(-(value + 1)));
+	}
+}
+
+void cbor_put_null(cbor_writer_t *w)
+{
+	uint8_t b = (CBOR_MAJOR_SIMPLE << 5) | CBOR_SIMPLE_NULL;
+	cbor_put_raw(w, &b, 1);
+}
+
+void cbor_put_bytes(cbor_writer_t *w, const void *data, size_t len)
+{
+	cbor_put_head(w, CBOR_MAJOR_BYTES, len);
+	cbor_put_raw(w, data, len);
+}
+
+void cbor_put_text(cbor_writer_t *w, const char *text)
+{
+	size_t len = strlen(text);
+	cbor_put_head(w, CBOR_MAJOR_TEXT, len);
+	cbor_put_raw(w, text, len);
+}
+
+void cbor_put_array(cbor_writer_t *w, uint32_t count)
+{
+	cbor_put_head(w, CBOR_MAJOR_ARRAY, count);
+}
+
+void cbor_put_map(cbor_writer_t *w, uint32_t count)
+{
+	cbor_put_head(w, CBOR_MAJOR_MAP, count);
+}
+
+void cbor_put_array_indefinite(cbor_writer_t *w)
+{
+	uint8_t b = (CBOR_MAJOR_ARRAY << 5) | CBOR_INDEFINITE;
+	cbor_put_raw(w, &b, 1);
+}
+
+void cbor_put_break(cbor_writer_t *w)
+{
+	uint8_t b = 0xFF;
+	cbor_put_raw(w, &b, 1);
+}
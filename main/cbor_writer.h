@@ -0,0 +1,55 @@
+/*
+ * cbor_writer.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef MAIN_CBOR_WRITER_H_
+#define MAIN_CBOR_WRITER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// MIME type of CBOR bodies (RFC 8949)
+#define CBOR_MIME_TYPE  "application/cbor"
+
+/*
+* Minimal CBOR encoder into a caller supplied buffer, integers always take the shortest form.
+* Writes past the end are dropped and clear ok, so callers check once at the end
+*/
+typedef struct {
+    uint8_t *buf;
+    size_t size;
+    size_t len;
+    bool ok;
+} cbor_writer_t;
+
+void cbor_writer_init(cbor_writer_t *w, uint8_t *buf, size_t size);
+
+void cbor_put_uint(cbor_writer_t *w, uint32_t value);
+void cbor_put_int(cbor_writer_t *w, int32_t value);
+void cbor_put_null(cbor_writer_t *w);
+void cbor_put_bytes(cbor_writer_t *w, const void *data, size_t len);
+void cbor_put_text(cbor_writer_t *w, const char *text);
+
+/*
+* Containers, followed by count items (a map takes count key/value pairs). The indefinite
+* forms are closed with cbor_put_break(), for output whose length is not known up front
+*/
+void cbor_put_array(cbor_writer_t *w, uint32_t count);
+void cbor_put_map(cbor_writer_t *w, uint32_t count);
+void cbor_put_array_indefinite(cbor_writer_t *w);
+void cbor_put_break(cbor_writer_t *w);
+
+/*
+* Bytes written so far
+@return length, or 0 if something did not fit
+*/
+static inline size_t cbor_writer_length(const cbor_writer_t *w)
+{
+    return w->ok ? w->len : 0;
+}
+
+#endif /* MAIN_CBOR_WRITER_H_ */
@@ -0,0 +1,88 @@
+/*
+ * dht22_frame.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+#include <string.h>
+#include "esp_log.h"
+#include "dht22_frame.h"
+
+static const char* TAG = "DHT22";
+
+int dht22_decode_frame(dht22_t *dht22, const uint8_t data[5])
+{
+    // Verify checksum
+    int crc = data[0] + data[1] + data[2] + data[3];
+    crc = crc & 0xff;
+    
+    if(crc == data[4]) 
+    {
+        // For DHT22 (different from DHT11):
+        // Byte 0 & 1: Humidity value = (byte0 * 256 + byte1) / 10.0
+        // Byte 2 & 3: Temperature value = (byte2 * 256 + byte3) / 10.0
+        // If the MSB of byte 2 is set, the temperature is negative
+        
+        // DHT22 provides 16-bit values with 1 decimal place precision
+        dht22->humidity = ((data[0] << 8) + data[1]) / 10.0;
+        
+        // For temperature, check if negative (MSB of byte 2)
+        uint16_t temp_raw = (data[2] << 8) + data[3];
+        if (data[2] & 0x80) {
+            // Negative temperature - clear the sign bit and negate
+            temp_raw &= 0x7FFF;
+            dht22->temperature = -1.0 * temp_raw / 10.0;
+        } else {
+            dht22->temperature = temp_raw / 10.0;
+        }
+        
+        // Range checks and outlier rejection are done by sensor_filter
+        return DHT_OK;
+    }
+    else 
+    {
+        ESP_LOGE(TAG, "Wrong checksum: calculated %d, received %d", crc, data[4]);
+        return DHT_CHECKSUM_ERROR;
+    }
+}
+
+int dht22_decode_symbols(const rmt_symbol_word_t *symbols, size_t num_symbols, uint8_t data[5])
+{
+    int highs = 0;
+    int bit = 0;
+
+    // Count the high pulses terminated by a falling edge, the idle level at the end has a zero duration
+    for(size_t i = 0; i < num_symbols; i++)
+    {
+        if(symbols[i].level0 == 1 && symbols[i].duration0 > 0) highs++;
+        if(symbols[i].level1 == 1 && symbols[i].duration1 > 0) highs++;
+    }
+
+    if(highs < 40) return DHT_TIMEOUT_ERROR;
+
+    // Anything in front of the last 40 highs is the start/response handshake
+    int skip = highs - 40;
+    memset(data, 0, 5);
+
+    for(size_t i = 0; i < num_symbols; i++)
+    {
+        uint16_t durations[2] = { symbols[i].duration0, symbols[i].duration1 };
+        uint16_t levels[2] = { symbols[i].level0, symbols[i].level1 };
+
+        for(int k = 0; k < 2; k++)
+        {
+            if(levels[k] != 1 || durations[k] == 0) continue;
+            if(skip > 0)
+            {
+                skip--;
+                continue;
+            }
+            if(durations[k] > DHT_BIT_ONE_THRESHOLD_US)
+            {
+                data[bit / 8] |= (1 << (7 - (bit % 8)));
+            }
+            bit++;
+        }
+    }
+    return DHT_OK;
+}
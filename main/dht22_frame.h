@@ -0,0 +1,53 @@
+/*
+ * dht22_frame.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef MAIN_DHT22_FRAME_H_
+#define MAIN_DHT22_FRAME_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hal/rmt_types.h"
+
+// Frame decoding of the DHT22, free of hardware access so the host tests build it
+
+#define DHT_OK 0
+#define DHT_CHECKSUM_ERROR -1
+#define DHT_TIMEOUT_ERROR -2
+
+#define DHT_BIT_ONE_THRESHOLD_US    48          // '0' is ~26 us high, '1' is ~70 us high
+
+/**
+ * Structure containing readings and info about the dht22
+ * @var dht22_pin the pin associated with the dht22
+ * @var temperature last temperature reading
+ * @var humidity last humidity reading 
+*/
+typedef struct
+{
+    int dht22_pin;
+    float temperature;
+    float humidity;
+} dht22_t;
+
+/**
+ * @brief Decode a 5 byte DHT22 frame into temperature and humidity
+ * @return DHT_OK or DHT_CHECKSUM_ERROR
+ * @param data raw frame, 2 bytes humidity, 2 bytes temperature, 1 byte checksum
+*/
+int dht22_decode_frame(dht22_t *dht22, const uint8_t data[5]);
+
+/**
+ * @brief Recover the 5 byte frame from an RMT capture of the DHT22 pulse train
+ * @note  Only the last 40 high pulses are used, so the response preamble may or may not be in the capture
+ * @return DHT_OK or DHT_TIMEOUT_ERROR if the capture holds fewer than 40 bits
+ * @param symbols symbols reported by the RMT receiver
+ * @param num_symbols number of valid entries in symbols
+ * @param data output frame
+*/
+int dht22_decode_symbols(const rmt_symbol_word_t *symbols, size_t num_symbols, uint8_t data[5]);
+
+#endif /* MAIN_DHT22_FRAME_H_ */
@@ -0,0 +1,58 @@
+/*
+ * fixed_point.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+#include "fixed_point.h"
+
+#define Q24_LN2         FIXED_POINT_Q24(0.69314718055994531)
+#define Q24_SQRT2       FIXED_POINT_Q24(1.41421356237309505)
+
+static inline int32_t q24_mul(int32_t a, int32_t b)
+{
+	return (int32_t)(((int64_t)a * b) >> FIXED_POINT_Q24_SHIFT);
+}
+
+/*
+* x = m * 2^e with m in [sqrt(1/2), sqrt(2)), then ln(m) = 2 atanh(s), s = (m - 1) / (m + 1).
+* |s| < 0.172 so four terms of the atanh series leave an error below 3e-8
+*/
+int32_t fixed_point_ln_q24(uint32_t x)
+{
+	int e = 31 - __builtin_clz(x);
+	int32_t m = (e >= FIXED_POINT_Q24_SHIFT) ? (int32_t)(x >> (e - FIXED_POINT_Q24_SHIFT))
+	                                         : (int32_t)(x << (FIXED_POINT_Q24_SHIFT - e));
+	if (m > Q24_SQRT2)
+	{
+		m >>= 1;
+		e++;
+	}
+
+	int32_t s = (int32_t)(((int64_t)(m - FIXED_POINT_Q24_ONE) << FIXED_POINT_Q24_SHIFT) / (m + FIXED_POINT_Q24_ONE));
+	int32_t s2 = q24_mul(s, s);
+	int32_t series = FIXED_POINT_Q24(2.0 / 7);
+	series = FIXED_POINT_Q24(2.0 / 5) + q24_mul(series, s2);
+	series = FIXED_POINT_Q24(2.0 / 3) + q24_mul(series, s2);
+	series = FIXED_POINT_Q24(2.0) + q24_mul(series, s2);
+
+	return e * Q24_LN2 + q24_mul(series, s);
+}
+
+/*
+* x = k ln2 + r with |r| <= ln2 / 2, e^r from its Taylor series up to r^6 (error below 1.2e-7),
+* then scaled by 2^k
+*/
+int32_t fixed_point_exp_q24(int32_t x)
+{
+	int32_t k = (x >= 0 ? x + Q24_LN2 / 2 : x - Q24_LN2 / 2) / Q24_LN2;
+	int32_t r = x - k * Q24_LN2;
+
+	int32_t p = FIXED_POINT_Q24_ONE;
+	for (int n = 6; n >= 1; n--)
+	{
+		p = FIXED_POINT_Q24_ONE + q24_mul(p, r) / n;
+	}
+
+	return (k >= 0) ? (p << k) : (p >> -k);
+}
@@ -0,0 +1,32 @@
+/*
+ * fixed_point.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef MAIN_FIXED_POINT_H_
+#define MAIN_FIXED_POINT_H_
+
+#include <stdint.h>
+
+// Q8.24: 24 fraction bits, 1.0 = 1 << 24
+#define FIXED_POINT_Q24_SHIFT       24
+#define FIXED_POINT_Q24_ONE         (1 << FIXED_POINT_Q24_SHIFT)
+#define FIXED_POINT_Q24(x)          ((int32_t)((x) * FIXED_POINT_Q24_ONE + ((x) < 0 ? -0.5 : 0.5)))
+
+/*
+* Natural logarithm of an integer, x must be > 0
+* Absolute error below 2e-7 over the whole uint32 range
+@return ln(x) in Q24
+*/
+int32_t fixed_point_ln_q24(uint32_t x);
+
+/*
+* e^x for x in Q24, valid for -16 <= x <= 4.8
+* Relative error below 2e-7 for x >= -1, absolute error below 2e-7 for x <= 0
+@return e^x in Q24
+*/
+int32_t fixed_point_exp_q24(int32_t x);
+
+#endif /* MAIN_FIXED_POINT_H_ */
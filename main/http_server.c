@@ -25,17 +25,88 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
 #include "esp_ota_ops.h"
 #include "sys/param.h"
 #include <inttypes.h>
 #include "bmp180.h"
 #include "DHT22.h"
+#include "sensor_store.h"
+#include "sensor_registry.h"
+#include "system_report.h"
+#include "sensor_history.h"
+#include "sensor_rollup.h"
+#include "sensor_alert.h"
+#include "sample_log.h"
+#include "mesh.h"
+#include "telemetry_cache.h"
+#include "web_assets.h"
+#include "ota_update.h"
+#include "metrics.h"
+#include "cbor_writer.h"
+#include "mbedtls/base64.h"
+#include "sdkconfig.h"
 #include "esp_wifi.h"
 #include <math.h>
+#include <ctype.h>
+#include <stdatomic.h>
+#include <unistd.h>
 
 // Tag used for ESP Serial console messages
 static const char TAG[] = "http_server";
 
+// History endpoint limits
+#define HISTORY_MAX_ROWS_PER_REQUEST    2000
+#define HISTORY_CHUNK_SIZE              1024
+#define ROLLUP_MAX_BUCKETS_PER_REQUEST  500
+
+// Consecutive receive timeouts tolerated during an upload, about 30 s of stalled transfer
+#define OTA_MAX_RECV_TIMEOUTS           ((30 + CONFIG_HTTP_SERVER_SOCKET_TIMEOUT_S - 1) / CONFIG_HTTP_SERVER_SOCKET_TIMEOUT_S)
+
+// Push stream limits, each subscriber holds one of the server's sockets
+#define SSE_MAX_SUBSCRIBERS             4
+#define SSE_EVENT_SIZE                  (TELEMETRY_CACHE_SIZE + 64)
+
+// Body format a subscriber asked for, SSE_FORMAT_ANY addresses all of them
+#define SSE_FORMAT_JSON                 0
+#define SSE_FORMAT_CBOR                 1
+#define SSE_FORMAT_ANY                  2
+
+// URI handlers, every one is counted and timed through http_server_route_handler()
+#define HTTP_SERVER_MAX_URI_HANDLERS    28
+#define HTTP_SERVER_ROUTE_LABELS_SIZE   64
+
+// Sockets the server takes: lwIP's total less the listening and control sockets of httpd
+// and the ones left to the uplink and SNTP
+#define HTTP_SERVER_MAX_OPEN_SOCKETS    (CONFIG_LWIP_MAX_SOCKETS - 3 - CONFIG_HTTP_SERVER_RESERVED_SOCKETS)
+
+// TCP keep-alive probes after CONFIG_HTTP_SERVER_KEEP_ALIVE_IDLE_S of silence
+#define HTTP_SERVER_KEEP_ALIVE_INTERVAL 5
+#define HTTP_SERVER_KEEP_ALIVE_COUNT    3
+
+#if HTTP_SERVER_MAX_OPEN_SOCKETS <= SSE_MAX_SUBSCRIBERS
+#error "CONFIG_LWIP_MAX_SOCKETS leaves no sockets for requests next to the push stream subscribers"
+#endif
+
+// Latency buckets from a cached asset to a full OTA upload
+static const uint32_t http_server_latency_bounds_us[] = {
+    1000, 5000, 10000, 25000, 50000, 100000, 250000, 1000000, 5000000, 30000000
+};
+
+typedef struct {
+    const char *uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *r);
+    char labels[HTTP_SERVER_ROUTE_LABELS_SIZE];
+    metrics_counter_t requests;
+    metrics_counter_t errors;
+    metrics_histogram_t latency;
+} http_server_route_t;
+
+static http_server_route_t http_server_routes[HTTP_SERVER_MAX_URI_HANDLERS];
+static int http_server_route_count = 0;
+
 // Global state variables
 static int g_wifi_connect_status = NONE;
 static int g_fw_update_status = OTA_UPDATE_PENDING;
@@ -44,6 +115,16 @@ static httpd_handle_t http_server_handle = NULL;
 static TaskHandle_t task_http_server_monitor = NULL;
 static QueueHandle_t http_server_monitor_queue_handle;
 
+// Push stream subscribers
+static int sse_fds[SSE_MAX_SUBSCRIBERS];
+static uint8_t sse_format[SSE_MAX_SUBSCRIBERS];
+static atomic_int sse_subscriber_count;
+static atomic_bool sse_sensors_queued;
+static metrics_counter_t sse_events = METRICS_COUNTER("http_sse_events_total", "Push stream events sent, per subscriber", NULL);
+static metrics_counter_t sse_coalesced = METRICS_COUNTER("http_sse_coalesced_total", "Telemetry updates folded into a push still queued", NULL);
+static void http_server_sse_push_status(void);
+static int http_server_format_wifi_info(char *buf, size_t size);
+
 // Timer configuration and handle
 const esp_timer_create_args_t fw_update_reset_args = {
     .callback = &http_server_fw_update_reset_callback,
@@ -53,26 +134,67 @@ const esp_timer_create_args_t fw_update_reset_args = {
 };
 esp_timer_handle_t fw_update_reset;
 
-// Embedded file declarations
-extern const uint8_t jquery_3_3_1_min_js_start[] asm("_binary_jquery_3_3_1_min_js_start");
-extern const uint8_t jquery_3_3_1_min_js_end[] asm("_binary_jquery_3_3_1_min_js_end");
-extern const uint8_t index_html_start[] asm("_binary_index_html_start");
-extern const uint8_t index_html_end[] asm("_binary_index_html_end");
-extern const uint8_t app_css_start[] asm("_binary_app_css_start");
-extern const uint8_t app_css_end[] asm("_binary_app_css_end");
-extern const uint8_t app_js_start[] asm("_binary_app_js_start");
-extern const uint8_t app_js_end[] asm("_binary_app_js_end");
-extern const uint8_t favicon_ico_start[] asm("_binary_favicon_ico_start");
-extern const uint8_t favicon_ico_end[] asm("_binary_favicon_ico_end");
-
-// Helper function for serving static files
+// Embedded file declarations, gzip compressed by main/CMakeLists.txt
+extern const uint8_t jquery_3_3_1_min_js_start[] asm("_binary_jquery_3_3_1_min_js_gz_start");
+extern const uint8_t jquery_3_3_1_min_js_end[] asm("_binary_jquery_3_3_1_min_js_gz_end");
+extern const uint8_t index_html_start[] asm("_binary_index_html_gz_start");
+extern const uint8_t index_html_end[] asm("_binary_index_html_gz_end");
+extern const uint8_t app_css_start[] asm("_binary_app_css_gz_start");
+extern const uint8_t app_css_end[] asm("_binary_app_css_gz_end");
+extern const uint8_t app_js_start[] asm("_binary_app_js_gz_start");
+extern const uint8_t app_js_end[] asm("_binary_app_js_gz_end");
+extern const uint8_t favicon_ico_start[] asm("_binary_favicon_ico_gz_start");
+extern const uint8_t favicon_ico_end[] asm("_binary_favicon_ico_gz_end");
+
+// Cache policies. app.css and app.js are requested with a ?v=<hash> suffix from index.html
+#define CACHE_CONTROL_IMMUTABLE     "public, max-age=31536000, immutable"
+#define CACHE_CONTROL_DAY           "public, max-age=86400"
+#define CACHE_CONTROL_REVALIDATE    "no-cache"
+
+// True if the request's If-None-Match lists the given ETag
+static bool request_etag_matches(httpd_req_t *req, const char *etag)
+{
+    char value[96];
+    size_t len = httpd_req_get_hdr_value_len(req, "If-None-Match");
+    
+    if (len == 0 || len >= sizeof(value)) return false;
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", value, sizeof(value)) != ESP_OK) return false;
+    return strstr(value, etag) != NULL || strcmp(value, "*") == 0;
+}
+
+// Helper function for serving static files, answers 304 when the client's copy is current
 static esp_err_t serve_static_file(httpd_req_t *req, const char *content_type, 
-                                   const uint8_t *start, const uint8_t *end, const char *filename)
+                                   const uint8_t *start, const uint8_t *end, const char *etag, const char *cache_control)
 {
-    ESP_LOGI(TAG, "%s requested", filename);
+    ESP_LOGD(TAG, "%s requested", req->uri);
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", cache_control);
+    
+    if (request_etag_matches(req, etag)) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+    
     httpd_resp_set_type(req, content_type);
-    httpd_resp_send(req, (const char *)start, end - start);
-    return ESP_OK;
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    
+    size_t remaining = end - start;
+    if (remaining <= CONFIG_HTTP_SERVER_STATIC_CHUNK_SIZE) {
+        return httpd_resp_send(req, (const char *)start, remaining);
+    }
+    
+    // Stream straight from the mapped rodata, lwIP copies one chunk at a time
+    const char *data = (const char *)start;
+    while (remaining > 0) {
+        size_t len = MIN(remaining, CONFIG_HTTP_SERVER_STATIC_CHUNK_SIZE);
+        if (httpd_resp_send_chunk(req, data, len) != ESP_OK) {
+            ESP_LOGW(TAG, "%s aborted with %u bytes left", req->uri, (unsigned)remaining);
+            return ESP_FAIL;
+        }
+        data += len;
+        remaining -= len;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
 }
 
 // Helper function for sending JSON responses
@@ -83,6 +205,54 @@ static esp_err_t send_json_response(httpd_req_t *req, const char *json_data)
     return ESP_OK;
 }
 
+// Sends a formatted body and frees it, a length of 0 means the body did not fit its buffer
+static esp_err_t send_json_body(httpd_req_t *req, char *body, size_t len)
+{
+    esp_err_t err;
+    
+    if (len == 0) {
+        ESP_LOGE(TAG, "%s: response too large", req->uri);
+        err = httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Response too large");
+    } else {
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+        err = httpd_resp_send(req, body, len);
+    }
+    free(body);
+    return err;
+}
+
+static esp_err_t send_cbor_response(httpd_req_t *req, const uint8_t *body, size_t len)
+{
+    httpd_resp_set_type(req, CBOR_MIME_TYPE);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    return httpd_resp_send(req, (const char *)body, len);
+}
+
+/*
+* Content negotiation for endpoints that also speak CBOR: true if the Accept header lists it.
+* Sets Vary so caches keep the two bodies apart
+*/
+static bool http_server_accepts_cbor(httpd_req_t *req)
+{
+    char accept[96];
+    
+    httpd_resp_set_hdr(req, "Vary", "Accept");
+    esp_err_t err = httpd_req_get_hdr_value_str(req, "Accept", accept, sizeof(accept));
+    if (err != ESP_OK && err != ESP_ERR_HTTPD_RESULT_TRUNC) return false;
+    return strstr(accept, CBOR_MIME_TYPE) != NULL;
+}
+
+// Encodes the given sources of the current snapshot, see TELEMETRY_CBOR_* for the keys
+static esp_err_t send_snapshot_cbor_response(httpd_req_t *req, uint8_t sources)
+{
+    uint8_t body[TELEMETRY_CACHE_CBOR_SIZE];
+    sensor_snapshot_t snapshot;
+    
+    sensor_store_read(&snapshot);
+    return send_cbor_response(req, body, telemetry_cache_encode_cbor(&snapshot, sources, body, sizeof(body)));
+}
+
 static void http_server_fw_update_reset_timer(void)
 {
     if(g_fw_update_status == OTA_UPDATE_SUCCESSFUL) {
@@ -133,6 +303,12 @@ static void http_server_monitor(void *parameter)
                     if (msg_handlers[i].trigger_reset_timer) {
                         http_server_fw_update_reset_timer();
                     }
+                    if (msg_handlers[i].status_var == &g_wifi_connect_status) {
+                        char wifi_info[160];
+                        bool connected = http_server_format_wifi_info(wifi_info, sizeof(wifi_info)) > 0;
+                        telemetry_cache_set_wifi(connected ? wifi_info : NULL);
+                    }
+                    http_server_sse_push_status();
                     break;
                 }
             }
@@ -142,135 +318,624 @@ static void http_server_monitor(void *parameter)
 
 // Static file handlers using the helper function
 static esp_err_t http_server_jquery_handler(httpd_req_t *req) {
-    return serve_static_file(req, "application/javascript", jquery_3_3_1_min_js_start, jquery_3_3_1_min_js_end, "JQuery");
+    return serve_static_file(req, "application/javascript", jquery_3_3_1_min_js_start, jquery_3_3_1_min_js_end,
+                             WEB_ASSET_JQUERY_3_3_1_MIN_JS_ETAG, CACHE_CONTROL_DAY);
 }
 
 static esp_err_t http_server_index_html_handler(httpd_req_t *req) {
-    return serve_static_file(req, "text/html", index_html_start, index_html_end, "index.html");
+    return serve_static_file(req, "text/html", index_html_start, index_html_end,
+                             WEB_ASSET_INDEX_HTML_ETAG, CACHE_CONTROL_REVALIDATE);
 }
 
 static esp_err_t http_server_app_css_handler(httpd_req_t *req) {
-    return serve_static_file(req, "text/css", app_css_start, app_css_end, "app.css");
+    return serve_static_file(req, "text/css", app_css_start, app_css_end,
+                             WEB_ASSET_APP_CSS_ETAG, CACHE_CONTROL_IMMUTABLE);
 }
 
 static esp_err_t http_server_app_js_handler(httpd_req_t *req) {
-    return serve_static_file(req, "application/javascript", app_js_start, app_js_end, "app.js");
+    return serve_static_file(req, "application/javascript", app_js_start, app_js_end,
+                             WEB_ASSET_APP_JS_ETAG, CACHE_CONTROL_IMMUTABLE);
 }
 
 static esp_err_t http_server_favicon_ico_handler(httpd_req_t *req) {
-    return serve_static_file(req, "image/x-icon", favicon_ico_start, favicon_ico_end, "favicon.ico");
+    return serve_static_file(req, "image/x-icon", favicon_ico_start, favicon_ico_end,
+                             WEB_ASSET_FAVICON_ICO_ETAG, CACHE_CONTROL_DAY);
 }
 
+/*
+* /OTAupdate: receives the upload straight into the OTA buffer pool. Parsing, hashing and
+* flashing run in the OTA writer task, overlapped with the next receive
+*/
 esp_err_t http_server_OTA_update_handler(httpd_req_t *req)
 {
-    esp_ota_handle_t ota_handle;
-    char ota_buff[1024];
-    int content_length = req->content_len;
-    int content_received = 0;
-    int recv_len;
-    bool is_req_body_started = false;
-    bool flash_successful = false;
+    char content_type[128] = {0};
+    char sha256_hex[72] = {0};
+    size_t remaining = req->content_len;
+    int timeouts = 0;
+    bool has_sha256;
+    esp_err_t err;
     
-    const esp_partition_t *update_partition = esp_ota_get_next_update_partition(NULL);
+    httpd_req_get_hdr_value_str(req, "Content-Type", content_type, sizeof(content_type));
+    has_sha256 = httpd_req_get_hdr_value_str(req, OTA_UPDATE_SHA256_HEADER, sha256_hex, sizeof(sha256_hex)) == ESP_OK;
+    ESP_LOGI(TAG, "OTA upload of %u bytes", (unsigned)remaining);
     
-    do {
-        if ((recv_len = httpd_req_recv(req, ota_buff, MIN(content_length, sizeof(ota_buff)))) < 0) {
-            if (recv_len == HTTPD_SOCK_ERR_TIMEOUT) {
-                ESP_LOGI(TAG, "Socket Timeout");
-                continue;
-            }
-            ESP_LOGI(TAG, "OTA other error %d", recv_len);
-            return ESP_FAIL;
-        }
-        printf("OTA RX: %d of %d\r", content_received, content_length);
+    err = ota_update_begin(content_type, has_sha256 ? sha256_hex : NULL);
+    
+    while (err == ESP_OK && remaining > 0) {
+        ota_update_buffer_t buffer;
+        if ((err = ota_update_acquire(&buffer)) != ESP_OK) break;
         
-        if(!is_req_body_started) {
-            is_req_body_started = true;
-            char *body_start_p = strstr(ota_buff, "\r\n\r\n") + 4;
-            int body_part_len = recv_len - (body_start_p - ota_buff);
-            printf("OTA file size: %d\r\n", content_length);
-            
-            esp_err_t err = esp_ota_begin(update_partition, OTA_SIZE_UNKNOWN, &ota_handle);
-            if (err != ESP_OK) {
-                printf("Error with OTA begin, cancelling OTA\r\n");
-                return ESP_FAIL;
-            } else {
-                printf("Writing to partition subtype %d at offset 0x%"PRIx32"\r\n", 
-                       update_partition->subtype, update_partition->address);
-            }
-            esp_ota_write(ota_handle, body_start_p, body_part_len);
-            content_received += body_part_len;
-        } else {
-            esp_ota_write(ota_handle, ota_buff, recv_len);
-            content_received += recv_len;
+        int recv_len = httpd_req_recv(req, (char *)buffer.data, MIN(remaining, buffer.size));
+        if (recv_len == HTTPD_SOCK_ERR_TIMEOUT && ++timeouts <= OTA_MAX_RECV_TIMEOUTS) {
+            ota_update_submit(&buffer, 0);
+            continue;
         }
-    } while (recv_len > 0 && content_received < content_length);
-    
-    if (esp_ota_end(ota_handle) == ESP_OK) {
-        if (esp_ota_set_boot_partition(update_partition) == ESP_OK) {
-            const esp_partition_t *boot_partition = esp_ota_get_boot_partition();
-            ESP_LOGI(TAG, "Next boot partition subtype %d at offset 0x%"PRIx32, 
-                     boot_partition->subtype, boot_partition->address);
-            flash_successful = true;
-        } else {
-            ESP_LOGI(TAG, "FLASHED ERROR!!");
+        if (recv_len <= 0) {
+            ESP_LOGE(TAG, "OTA receive error %d with %u bytes left", recv_len, (unsigned)remaining);
+            ota_update_submit(&buffer, 0);
+            err = ESP_FAIL;
+            break;
         }
+        
+        timeouts = 0;
+        ota_update_submit(&buffer, recv_len);
+        remaining -= recv_len;
+    }
+    
+    if (err == ESP_OK) {
+        err = ota_update_finish();
     } else {
-        ESP_LOGI(TAG, "esp_ota_end ERROR!!");
+        ota_update_abort();
     }
     
-    http_server_monitor_send_message(flash_successful ? HTTP_MSG_OTA_UPDATE_SUCCESSFUL : HTTP_MSG_OTA_UPDATE_FAILED);
-    return ESP_OK;
+    http_server_monitor_send_message(err == ESP_OK ? HTTP_MSG_OTA_UPDATE_SUCCESSFUL : HTTP_MSG_OTA_UPDATE_FAILED);
+    if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, esp_err_to_name(err));
+        return ESP_FAIL;
+    }
+    return send_json_response(req, "{\"ota_update_status\":1}");
 }
 
 esp_err_t http_server_OTA_status_handler(httpd_req_t *req)
 {
     char otaJSON[100];
-    ESP_LOGI(TAG, "OTAstatus requested, current status: %d", g_fw_update_status);
+    ESP_LOGD(TAG, "OTAstatus requested, current status: %d", g_fw_update_status);
     
     sprintf(otaJSON, "{\"ota_update_status\":%d, \"compile_time\":\"%s\",\"compile_date\":\"%s\"}", 
             g_fw_update_status, __TIME__, __DATE__);
-    ESP_LOGI(TAG, "Sending OTA JSON: %s", otaJSON);
+    ESP_LOGD(TAG, "Sending OTA JSON: %s", otaJSON);
     
     return send_json_response(req, otaJSON);
 }
 
 static esp_err_t http_server_get_dht_sensor_readings_json_handler(httpd_req_t *req)
 {
-    ESP_LOGI(TAG, "/dhtSensor.json requested");
+    ESP_LOGD(TAG, "/dhtSensor.json requested");
     char dhtSensorJSON[100];
+    sensor_dht22_sample_t sample;
     
+    if (http_server_accepts_cbor(req)) {
+        return send_snapshot_cbor_response(req, TELEMETRY_CBOR_SOURCE_DHT22);
+    }
+    
+    // Both fields come from the same publication
+    sensor_store_read_dht22(&sample);
     sprintf(dhtSensorJSON, "{\"temperature\":\"%.1f\",\"humidity\":\"%.1f\"}", 
-            DHT22_get_temperature(), DHT22_get_humidity());
+            sample.temperature, sample.humidity);
     
     return send_json_response(req, dhtSensorJSON);
 }
 
 static esp_err_t http_server_get_bmp180_sensor_readings_json_handler(httpd_req_t *req)
 {
-    ESP_LOGI(TAG, "/bmp180Sensor.json requested");
-    char bmp180SensorJSON[300];
+    ESP_LOGD(TAG, "/bmp180Sensor.json requested");
+    char bmp180SensorJSON[BMP180_JSON_SIZE];
+    
+    if (http_server_accepts_cbor(req)) {
+        return send_snapshot_cbor_response(req, TELEMETRY_CBOR_SOURCE_BMP180);
+    }
     
     // Get current readings from BMP180 (similar to DHT22 pattern)
     bmp180_readings_t readings = BMP180_get_readings();
     
-    if (readings.valid) {
-        sprintf(bmp180SensorJSON, 
-            "{\"temperature\":\"%.1f\",\"pressure\":\"%.2f\",\"sea_level_pressure\":\"%.2f\",\"altitude\":\"%.1f\",\"dew_point\":\"%.1f\",\"air_density\":\"%.3f\"}", 
-            readings.temperature, 
-            readings.pressure_hPa,  // Already in hPa
-            readings.sea_level_pressure / 100.0f,  // Convert Pa to hPa for consistency
-            readings.altitude,
-            isnan(readings.dew_point) ? 0.0f : readings.dew_point,  // Handle NaN values
-            readings.air_density);
-    } else {
-        sprintf(bmp180SensorJSON, 
-            "{\"temperature\":\"Error\",\"pressure\":\"Error\",\"sea_level_pressure\":\"Error\",\"altitude\":\"Error\",\"dew_point\":\"Error\",\"air_density\":\"Error\"}");
+    if (bmp180_format_json(&readings, bmp180SensorJSON, sizeof(bmp180SensorJSON)) == 0) {
+        ESP_LOGE(TAG, "%s: response too large", req->uri);
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Response too large");
     }
     
     return send_json_response(req, bmp180SensorJSON);
 }
 
+// Reads an unsigned integer query parameter, returns def if absent or malformed
+static uint32_t get_query_uint(const char *query, const char *key, uint32_t def)
+{
+    char value[12];
+    if (httpd_query_key_value(query, key, value, sizeof(value)) != ESP_OK) return def;
+    
+    char *end = NULL;
+    unsigned long v = strtoul(value, &end, 10);
+    return (end == value) ? def : (uint32_t)v;
+}
+
+// Reads a decimal query parameter, returns def if absent or malformed
+static float get_query_float(const char *query, const char *key, float def)
+{
+    char value[16];
+    if (httpd_query_key_value(query, key, value, sizeof(value)) != ESP_OK) return def;
+    
+    char *end = NULL;
+    float v = strtof(value, &end);
+    return (end == value) ? def : v;
+}
+
+/*
+* /sensors.json: every registered sensor with its latest values, laid out by the driver descriptors
+*/
+static esp_err_t http_server_get_sensors_json_handler(httpd_req_t *req)
+{
+    char *body = malloc(SENSOR_REGISTRY_JSON_SIZE);
+    if (body == NULL) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+    }
+    
+    size_t len = sensor_registry_format_json(body, SENSOR_REGISTRY_JSON_SIZE);
+    return send_json_body(req, body, len);
+}
+
+/*
+* /system.json: heap, stack high water marks and periodic work jobs, for sizing stacks and buffers
+*/
+static esp_err_t http_server_get_system_json_handler(httpd_req_t *req)
+{
+    char *body = malloc(SYSTEM_REPORT_JSON_SIZE);
+    if (body == NULL) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+    }
+    
+    size_t len = system_report_format_json(body, SYSTEM_REPORT_JSON_SIZE);
+    return send_json_body(req, body, len);
+}
+
+// metrics_write() sink, each piece goes out as one chunk
+static bool http_server_metrics_chunk(const char *data, size_t len, void *ctx)
+{
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len) == ESP_OK;
+}
+
+/*
+* /metrics: Prometheus text format, streamed so the size is not bounded by a buffer
+*/
+static esp_err_t http_server_get_metrics_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    
+    esp_err_t err = metrics_write(&http_server_metrics_chunk, req);
+    if (err == ESP_ERR_NO_MEM) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+    }
+    if (err != ESP_OK) {
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/*
+* /sensorPeriod.json?name=<sensor>&period_ms=<ms>
+* Changes the sampling period of a sensor, the new period is kept in NVS
+*/
+static esp_err_t http_server_sensor_period_json_handler(httpd_req_t *req)
+{
+    char query[64];
+    char name[16];
+    
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "name", name, sizeof(name)) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "name and period_ms required");
+    }
+    
+    esp_err_t err = sensor_registry_set_period(name, get_query_uint(query, "period_ms", 0));
+    if (err == ESP_ERR_NOT_FOUND) {
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown sensor");
+    }
+    if (err == ESP_ERR_INVALID_ARG) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "period_ms out of range");
+    }
+    return send_json_response(req, err == ESP_OK ? "{\"status\":\"ok\"}" : "{\"status\":\"not_saved\"}");
+}
+
+/*
+* /alerts.json: the alert rules in use and whether each one is raised
+*/
+static esp_err_t http_server_get_alerts_json_handler(httpd_req_t *req)
+{
+    char *body = malloc(SENSOR_ALERT_JSON_SIZE);
+    if (body == NULL) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+    }
+    
+    size_t len = sensor_alert_format_json(body, SENSOR_ALERT_JSON_SIZE);
+    return send_json_body(req, body, len);
+}
+
+/*
+* /alertRule.json?id=<slot>&metric=<name>&kind=<above|below|rise|drop|off>&threshold=<v>[&hysteresis=<v>][&window_s=<s>]
+* Sets one alert rule, e.g. metric=pressure&kind=drop&threshold=3&window_s=3600. The table is kept in NVS
+*/
+static esp_err_t http_server_alert_rule_json_handler(httpd_req_t *req)
+{
+    char query[160];
+    char metric[16];
+    char kind[8];
+    sensor_alert_rule_t rule = {0};
+    
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "kind", kind, sizeof(kind)) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "id and kind required");
+    }
+    
+    int k = sensor_alert_parse_kind(kind);
+    int m = 0;
+    if (k < 0) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown kind");
+    }
+    if (k != SENSOR_ALERT_OFF &&
+        (httpd_query_key_value(query, "metric", metric, sizeof(metric)) != ESP_OK ||
+         (m = sensor_alert_parse_metric(metric)) < 0)) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown metric");
+    }
+    rule.kind = k;
+    rule.metric = m;
+    rule.threshold = get_query_float(query, "threshold", NAN);
+    rule.hysteresis = get_query_float(query, "hysteresis", 0.0f);
+    rule.window_s = MIN(get_query_uint(query, "window_s", 3600), UINT16_MAX);
+    
+    esp_err_t err = sensor_alert_set_rule(get_query_uint(query, "id", UINT32_MAX), &rule);
+    if (err == ESP_ERR_INVALID_ARG) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad id, threshold, hysteresis or window_s");
+    }
+    return send_json_response(req, err == ESP_OK ? "{\"status\":\"ok\"}" : "{\"status\":\"not_saved\"}");
+}
+
+// One output row of /history.json, the sums of up to step stored rows
+typedef struct {
+    uint32_t seq;
+    uint32_t time;
+    int32_t sum[4];
+    uint32_t count[4];
+    uint32_t group;
+} history_group_t;
+
+// Adds one stored row to a group
+static void history_group_add(history_group_t *g, uint32_t seq, const sensor_history_row_t *row)
+{
+    g->group++;
+    g->seq = seq;
+    g->time = row->timestamp;
+    if (row->flags & SENSOR_HISTORY_FLAG_DHT22) {
+        g->sum[0] += row->dht_temperature; g->count[0]++;
+        g->sum[1] += row->humidity; g->count[1]++;
+    }
+    if (row->flags & SENSOR_HISTORY_FLAG_BMP180) {
+        g->sum[2] += row->bmp_temperature; g->count[2]++;
+        g->sum[3] += (int32_t)sensor_history_decode_pressure(row->pressure); g->count[3]++;
+    }
+}
+
+// Reads the next group starting at *seq, returns false if none of its rows was readable
+static bool history_read_group(uint32_t *seq, uint32_t head, uint32_t step, history_group_t *g)
+{
+    sensor_history_row_t row;
+    
+    memset(g, 0, sizeof(*g));
+    g->seq = *seq;
+    for (; *seq < head && g->group < step; (*seq)++) {
+        if (!sensor_history_read(*seq, &row)) continue;
+        history_group_add(g, *seq, &row);
+    }
+    return g->group > 0;
+}
+
+// A group field is null if fewer than half the group had it
+static bool history_field_present(const history_group_t *g, int i)
+{
+    return g->count[i] != 0 && g->count[i] * 2 >= g->group;
+}
+
+// Appends one history field, or null if the group did not have it
+static int history_format_field(char *buf, size_t size, const history_group_t *g, int i)
+{
+    if (!history_field_present(g, i)) return snprintf(buf, size, ",null");
+    return snprintf(buf, size, ",%"PRIi32, g->sum[i] / (int32_t)g->count[i]);
+}
+
+/*
+* CBOR form of /history.json: {"head","tail","step","time","rows","next"} where rows is an
+* indefinite array of [seq, time, dht_temperature, humidity, bmp_temperature, pressure]
+* in the JSON units. About a third of the JSON size at step=1
+*/
+static esp_err_t http_server_send_history_cbor(httpd_req_t *req, uint8_t *buf, size_t size,
+                                               uint32_t seq, uint32_t head, uint32_t step, uint32_t limit)
+{
+    cbor_writer_t w;
+    history_group_t g;
+    uint32_t emitted = 0;
+    
+    httpd_resp_set_type(req, CBOR_MIME_TYPE);
+    cbor_writer_init(&w, buf, size);
+    cbor_put_map(&w, 6);
+    cbor_put_text(&w, "head");
+    cbor_put_uint(&w, head);
+    cbor_put_text(&w, "tail");
+    cbor_put_uint(&w, sensor_history_tail());
+    cbor_put_text(&w, "step");
+    cbor_put_uint(&w, step);
+    cbor_put_text(&w, "time");
+    cbor_put_uint(&w, (uint32_t)time(NULL));
+    cbor_put_text(&w, "rows");
+    cbor_put_array_indefinite(&w);
+    
+    while (seq < head && emitted < limit) {
+        if (!history_read_group(&seq, head, step, &g)) continue;
+        
+        cbor_put_array(&w, 6);
+        cbor_put_uint(&w, g.seq);
+        cbor_put_uint(&w, g.time);
+        for (int i = 0; i < 4; i++) {
+            if (history_field_present(&g, i)) {
+                cbor_put_int(&w, g.sum[i] / (int32_t)g.count[i]);
+            } else {
+                cbor_put_null(&w);
+            }
+        }
+        emitted++;
+        
+        // A row takes at most 31 bytes
+        if (w.len > size - 48) {
+            if (httpd_resp_send_chunk(req, (const char *)buf, w.len) != ESP_OK) return ESP_FAIL;
+            cbor_writer_init(&w, buf, size);
+        }
+    }
+    
+    cbor_put_break(&w);
+    cbor_put_text(&w, "next");
+    cbor_put_uint(&w, seq);
+    if (httpd_resp_send_chunk(req, (const char *)buf, w.len) != ESP_OK) return ESP_FAIL;
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/*
+* /history.json?since=<seq>&step=<n>&limit=<rows>
+* Streams history rows with seq >= since. step > 1 averages groups of n consecutive rows.
+* Temperatures and humidity are in 1/100 units, pressure in Pa. Resume with since=next.
+* Sent as CBOR when the client accepts application/cbor
+*/
+static esp_err_t http_server_get_history_json_handler(httpd_req_t *req)
+{
+    char query[64];
+    char buf[HISTORY_CHUNK_SIZE];
+    uint32_t since = 0, step = 1, limit = HISTORY_MAX_ROWS_PER_REQUEST;
+    history_group_t g;
+    
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        since = get_query_uint(query, "since", since);
+        step = get_query_uint(query, "step", step);
+        limit = get_query_uint(query, "limit", limit);
+    }
+    if (step == 0) step = 1;
+    if (limit == 0 || limit > HISTORY_MAX_ROWS_PER_REQUEST) limit = HISTORY_MAX_ROWS_PER_REQUEST;
+    
+    uint32_t head = sensor_history_head();
+    uint32_t seq = MAX(since, sensor_history_tail());
+    uint32_t emitted = 0;
+    
+    if (http_server_accepts_cbor(req)) {
+        return http_server_send_history_cbor(req, (uint8_t *)buf, sizeof(buf), seq, head, step, limit);
+    }
+    
+    httpd_resp_set_type(req, "application/json");
+    int len = snprintf(buf, sizeof(buf),
+        "{\"head\":%"PRIu32",\"tail\":%"PRIu32",\"step\":%"PRIu32",\"time\":%"PRIu32","
+        "\"fields\":[\"seq\",\"time\",\"dht_temperature\",\"humidity\",\"bmp_temperature\",\"pressure\"],"
+        "\"rows\":[",
+        head, sensor_history_tail(), step, (uint32_t)time(NULL));
+    
+    while (seq < head && emitted < limit) {
+        if (!history_read_group(&seq, head, step, &g)) continue;
+        
+        len += snprintf(buf + len, sizeof(buf) - len, "%s[%"PRIu32",%"PRIu32, emitted ? "," : "", g.seq, g.time);
+        for (int i = 0; i < 4; i++) {
+            len += history_format_field(buf + len, sizeof(buf) - len, &g, i);
+        }
+        len += snprintf(buf + len, sizeof(buf) - len, "]");
+        emitted++;
+        
+        // Flush before the next row could overflow the chunk buffer
+        if (len > sizeof(buf) - 96) {
+            if (httpd_resp_send_chunk(req, buf, len) != ESP_OK) return ESP_FAIL;
+            len = 0;
+        }
+    }
+    
+    len += snprintf(buf + len, sizeof(buf) - len, "],\"next\":%"PRIu32"}", seq);
+    if (httpd_resp_send_chunk(req, buf, len) != ESP_OK) return ESP_FAIL;
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+// Appends one rollup bucket as [start,[min,max,mean,count],...] in the units of /history.json
+static int rollup_format_bucket(char *buf, size_t size, const sensor_rollup_bucket_t *bucket, bool first)
+{
+    int len = snprintf(buf, size, "%s[%"PRIu32, first ? "" : ",", bucket->start);
+    for (int m = 0; m < SENSOR_ROLLUP_METRIC_COUNT; m++) {
+        const sensor_rollup_stat_t *st = &bucket->stat[m];
+        if (st->count == 0) {
+            len += snprintf(buf + len, size - len, ",null");
+        } else if (m == SENSOR_ROLLUP_PRESSURE) {
+            len += snprintf(buf + len, size - len, ",[%"PRIu32",%"PRIu32",%"PRIu32",%u]",
+                            sensor_history_decode_pressure(st->min), sensor_history_decode_pressure(st->max),
+                            sensor_history_decode_pressure(st->mean), st->count);
+        } else {
+            len += snprintf(buf + len, size - len, ",[%d,%d,%d,%u]", st->min, st->max, st->mean, st->count);
+        }
+    }
+    return len + snprintf(buf + len, size - len, "]");
+}
+
+/*
+* /rollup.json?tier=<60|900|3600>&since=<time>&limit=<buckets>
+* Streams the closed min/max/mean/count buckets of a tier starting at or after since,
+* followed by the bucket still being filled as "open"
+*/
+static esp_err_t http_server_get_rollup_json_handler(httpd_req_t *req)
+{
+    char query[64];
+    char buf[HISTORY_CHUNK_SIZE];
+    uint32_t period = 60, since = 0, limit = ROLLUP_MAX_BUCKETS_PER_REQUEST;
+    sensor_rollup_tier_e tier = SENSOR_ROLLUP_TIER_1MIN;
+    sensor_rollup_bucket_t bucket;
+    
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        period = get_query_uint(query, "tier", period);
+        since = get_query_uint(query, "since", since);
+        limit = get_query_uint(query, "limit", limit);
+    }
+    if (limit == 0 || limit > ROLLUP_MAX_BUCKETS_PER_REQUEST) limit = ROLLUP_MAX_BUCKETS_PER_REQUEST;
+    
+    for (int t = 0; t < SENSOR_ROLLUP_TIER_COUNT; t++) {
+        if (sensor_rollup_period(t) == period) tier = t;
+    }
+    
+    uint32_t head = sensor_rollup_head(tier);
+    uint32_t index = sensor_rollup_tail(tier);
+    uint32_t emitted = 0;
+    
+    // Buckets are in time order, skip the ones before since
+    while (index < head && sensor_rollup_read(tier, index, &bucket) && bucket.start < since) index++;
+    
+    httpd_resp_set_type(req, "application/json");
+    int len = snprintf(buf, sizeof(buf),
+        "{\"tier\":%"PRIu32",\"fields\":[\"temperature\",\"humidity\",\"pressure\",\"dew_point\",\"air_density\"],"
+        "\"buckets\":[", sensor_rollup_period(tier));
+    
+    for (; index < head && emitted < limit; index++) {
+        if (!sensor_rollup_read(tier, index, &bucket)) continue;
+        len += rollup_format_bucket(buf + len, sizeof(buf) - len, &bucket, emitted == 0);
+        emitted++;
+        
+        if (len > sizeof(buf) - 200) {
+            if (httpd_resp_send_chunk(req, buf, len) != ESP_OK) return ESP_FAIL;
+            len = 0;
+        }
+    }
+    
+    len += snprintf(buf + len, sizeof(buf) - len, "],\"open\":");
+    if (sensor_rollup_read_open(tier, &bucket)) {
+        len += rollup_format_bucket(buf + len, sizeof(buf) - len, &bucket, true);
+    } else {
+        len += snprintf(buf + len, sizeof(buf) - len, "null");
+    }
+    len += snprintf(buf + len, sizeof(buf) - len, "}");
+    
+    if (httpd_resp_send_chunk(req, buf, len) != ESP_OK) return ESP_FAIL;
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+#if CONFIG_MESH_ROLE_GATEWAY
+/*
+* /nodes.json: the leaves heard by the gateway with signal, row counters and latest row
+*/
+static esp_err_t http_server_get_nodes_json_handler(httpd_req_t *req)
+{
+    char *body = malloc(MESH_NODES_JSON_SIZE);
+    if (body == NULL) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+    }
+    
+    size_t len = mesh_gateway_format_nodes_json(body, MESH_NODES_JSON_SIZE);
+    return send_json_body(req, body, len);
+}
+
+// Parses a station MAC of 12 hex digits, with or without colons
+static bool parse_mac(const char *s, uint8_t mac[6])
+{
+    for (int i = 0; i < 6; i++) {
+        unsigned int byte;
+        if (sscanf(s, "%2x", &byte) != 1 || !isxdigit((unsigned char)s[0]) || !isxdigit((unsigned char)s[1])) return false;
+        mac[i] = (uint8_t)byte;
+        s += 2;
+        if (*s == ':' && i < 5) s++;
+    }
+    return *s == '\0';
+}
+
+/*
+* /nodeHistory.json?node=<mac>&since=<seq>&limit=<rows>
+* Streams the leaf rows held by the gateway with seq >= since, of one leaf or of all of them.
+* seq numbers the gateway ring, leaf_seq the row on its leaf. Units as in /history.json.
+* Resume with since=next
+*/
+static esp_err_t http_server_get_node_history_json_handler(httpd_req_t *req)
+{
+    char query[80];
+    char mac_str[20];
+    char buf[HISTORY_CHUNK_SIZE];
+    uint32_t since = 0, limit = HISTORY_MAX_ROWS_PER_REQUEST;
+    int node = -1;
+    uint8_t mac[6];
+    mesh_row_t row;
+    history_group_t g;
+    
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        since = get_query_uint(query, "since", since);
+        limit = get_query_uint(query, "limit", limit);
+        if (httpd_query_key_value(query, "node", mac_str, sizeof(mac_str)) == ESP_OK) {
+            if (!parse_mac(mac_str, mac)) {
+                return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "node must be a MAC address");
+            }
+            node = mesh_gateway_find_node(mac);
+            if (node < 0) {
+                return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown node");
+            }
+        }
+    }
+    if (limit == 0 || limit > HISTORY_MAX_ROWS_PER_REQUEST) limit = HISTORY_MAX_ROWS_PER_REQUEST;
+    
+    uint32_t head = mesh_gateway_head();
+    uint32_t seq = MAX(since, mesh_gateway_tail());
+    uint32_t emitted = 0;
+    
+    httpd_resp_set_type(req, "application/json");
+    int len = snprintf(buf, sizeof(buf),
+        "{\"head\":%"PRIu32",\"tail\":%"PRIu32",\"time\":%"PRIu32","
+        "\"fields\":[\"seq\",\"node\",\"leaf_seq\",\"time\",\"dht_temperature\",\"humidity\",\"bmp_temperature\",\"pressure\"],"
+        "\"rows\":[",
+        head, mesh_gateway_tail(), (uint32_t)time(NULL));
+    
+    for (; seq < head && emitted < limit; seq++) {
+        if (!mesh_gateway_read_row(seq, &row) || (node >= 0 && row.node != node)) continue;
+        
+        memset(&g, 0, sizeof(g));
+        history_group_add(&g, seq, &row.row);
+        len += snprintf(buf + len, sizeof(buf) - len, "%s[%"PRIu32",%u,%"PRIu32",%"PRIu32,
+                        emitted ? "," : "", seq, row.node, row.seq, g.time);
+        for (int i = 0; i < 4; i++) {
+            len += history_format_field(buf + len, sizeof(buf) - len, &g, i);
+        }
+        len += snprintf(buf + len, sizeof(buf) - len, "]");
+        emitted++;
+        
+        if (len > sizeof(buf) - 128) {
+            if (httpd_resp_send_chunk(req, buf, len) != ESP_OK) return ESP_FAIL;
+            len = 0;
+        }
+    }
+    
+    len += snprintf(buf + len, sizeof(buf) - len, "],\"next\":%"PRIu32"}", seq);
+    if (httpd_resp_send_chunk(req, buf, len) != ESP_OK) return ESP_FAIL;
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+#endif
+
 // Helper function to get header value
 static char* get_header_value(httpd_req_t *req, const char *header_name)
 {
@@ -279,7 +944,7 @@ static char* get_header_value(httpd_req_t *req, const char *header_name)
     
     char *value = malloc(len);
     if (httpd_req_get_hdr_value_str(req, header_name, value, len) == ESP_OK) {
-        ESP_LOGI(TAG, "Found header => %s: %s", header_name, value);
+        ESP_LOGD(TAG, "Found header %s", header_name);
         return value;
     }
     
@@ -289,7 +954,7 @@ static char* get_header_value(httpd_req_t *req, const char *header_name)
 
 static esp_err_t http_server_wifi_connect_json_handler(httpd_req_t *req)
 {
-    ESP_LOGI(TAG, "/wifiConnect.json requested");
+    ESP_LOGD(TAG, "/wifiConnect.json requested");
     
     char *ssid_str = get_header_value(req, "my-connect-ssid");
     char *pass_str = get_header_value(req, "my-connect-pwd");
@@ -309,33 +974,42 @@ static esp_err_t http_server_wifi_connect_json_handler(httpd_req_t *req)
 
 static esp_err_t http_server_wifi_connect_status_json_handler(httpd_req_t *req)
 {
-    ESP_LOGI(TAG, "/wifiConnectStatus requested");
+    ESP_LOGD(TAG, "/wifiConnectStatus requested");
     char statusJSON[100];
     
     sprintf(statusJSON, "{\"wifi_connect_status\":%d}", g_wifi_connect_status);
     return send_json_response(req, statusJSON);
 }
 
+// Formats the station connection info, returns 0 (empty string) while not connected
+static int http_server_format_wifi_info(char *buf, size_t size)
+{
+    buf[0] = '\0';
+    if (g_wifi_connect_status != HTTP_WIFI_STATUS_CONNECT_SUCCESS) return 0;
+    
+    wifi_ap_record_t wifi_data;
+    esp_netif_ip_info_t ip_info;
+    
+    if (esp_wifi_sta_get_ap_info(&wifi_data) != ESP_OK || esp_netif_get_ip_info(esp_netif_sta, &ip_info) != ESP_OK) {
+        return 0;
+    }
+    
+    char ip[IP4ADDR_STRLEN_MAX], netmask[IP4ADDR_STRLEN_MAX], gw[IP4ADDR_STRLEN_MAX];
+    esp_ip4addr_ntoa(&ip_info.ip, ip, IP4ADDR_STRLEN_MAX);
+    esp_ip4addr_ntoa(&ip_info.netmask, netmask, IP4ADDR_STRLEN_MAX);
+    esp_ip4addr_ntoa(&ip_info.gw, gw, IP4ADDR_STRLEN_MAX);
+    
+    return snprintf(buf, size, "{\"ip\":\"%s\",\"netmask\":\"%s\",\"gw\":\"%s\",\"ap\":\"%s\"}", 
+                    ip, netmask, gw, (char*)wifi_data.ssid);
+}
+
 static esp_err_t http_server_get_wifi_connect_info_json_handler(httpd_req_t *req)
 {
-    ESP_LOGI(TAG, "/wifiConnectInfo.json requested");
-    char ipInfoJSON[200] = {0};
+    ESP_LOGD(TAG, "/wifiConnectInfo.json requested");
+    char ipInfoJSON[200];
     
-    if (g_wifi_connect_status == HTTP_WIFI_STATUS_CONNECT_SUCCESS) {
-        wifi_ap_record_t wifi_data;
-        esp_netif_ip_info_t ip_info;
-        
-        ESP_ERROR_CHECK(esp_wifi_sta_get_ap_info(&wifi_data));
-        ESP_ERROR_CHECK(esp_netif_get_ip_info(esp_netif_sta, &ip_info));
-        
-        char ip[IP4ADDR_STRLEN_MAX], netmask[IP4ADDR_STRLEN_MAX], gw[IP4ADDR_STRLEN_MAX];
-        esp_ip4addr_ntoa(&ip_info.ip, ip, IP4ADDR_STRLEN_MAX);
-        esp_ip4addr_ntoa(&ip_info.netmask, netmask, IP4ADDR_STRLEN_MAX);
-        esp_ip4addr_ntoa(&ip_info.gw, gw, IP4ADDR_STRLEN_MAX);
-        
-        sprintf(ipInfoJSON, "{\"ip\":\"%s\",\"netmask\":\"%s\",\"gw\":\"%s\",\"ap\":\"%s\"}", 
-                ip, netmask, gw, (char*)wifi_data.ssid);
-        ESP_LOGI(TAG, "Sending connection info JSON: %s", ipInfoJSON);
+    if (http_server_format_wifi_info(ipInfoJSON, sizeof(ipInfoJSON)) > 0) {
+        ESP_LOGD(TAG, "Sending connection info JSON: %s", ipInfoJSON);
     }
     
     return send_json_response(req, ipInfoJSON);
@@ -343,23 +1017,20 @@ static esp_err_t http_server_get_wifi_connect_info_json_handler(httpd_req_t *req
 
 static esp_err_t http_server_wifi_disconnect_json_handler(httpd_req_t *req)
 {
-    ESP_LOGI(TAG, "wifiDisconnect.json requested");
+    ESP_LOGD(TAG, "wifiDisconnect.json requested");
     wifi_app_send_message(WIFI_APP_MSG_USER_REQUESTED_STA_DISCONNECT);
     return send_json_response(req, "{\"status\":\"disconnecting\"}");
 }
 
 static esp_err_t http_server_get_local_time_json_handler(httpd_req_t *req)
 {
-    ESP_LOGI(TAG, "/localTime.json requested");
+    ESP_LOGD(TAG, "/localTime.json requested");
     char localTimeJSON[150] = {0};
     
-    ESP_LOGI(TAG, "g_is_local_time_set: %s", g_is_local_time_set ? "true" : "false");
-    
     if (g_is_local_time_set) {
-        char* time_str = sntp_time_sync_get_time();
-        ESP_LOGI(TAG, "Time string from SNTP: %s", time_str);
+        char time_str[SNTP_TIME_SYNC_TIME_LEN];
         
-        if (time_str != NULL && strlen(time_str) > 0) {
+        if (sntp_time_sync_get_time(time_str, sizeof(time_str)) > 0) {
             sprintf(localTimeJSON, "{\"time\":\"%s\",\"status\":\"synchronized\"}", time_str);
         } else {
             sprintf(localTimeJSON, "{\"time\":\"Synchronizing...\",\"status\":\"pending\"}");
@@ -368,13 +1039,33 @@ static esp_err_t http_server_get_local_time_json_handler(httpd_req_t *req)
         sprintf(localTimeJSON, "{\"time\":\"Time service not initialized\",\"status\":\"not_initialized\"}");
     }
     
-    ESP_LOGI(TAG, "Sending JSON: %s", localTimeJSON);
     return send_json_response(req, localTimeJSON);
 }
 
+/*
+* /telemetry.json: sensors, time and connection info in one body. The body is serialized by
+* the telemetry cache once per publication, a request only copies it. CBOR clients get the
+* cached sensor map instead
+*/
+static esp_err_t http_server_get_telemetry_json_handler(httpd_req_t *req)
+{
+    char body[TELEMETRY_CACHE_SIZE];
+    
+    if (http_server_accepts_cbor(req)) {
+        size_t cbor_len = telemetry_cache_get_cbor((uint8_t *)body, sizeof(body), NULL);
+        return send_cbor_response(req, (const uint8_t *)body, cbor_len);
+    }
+    
+    size_t len = telemetry_cache_get(body, sizeof(body), NULL);
+    
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    return httpd_resp_send(req, body, len);
+}
+
 static esp_err_t http_server_get_ap_ssid_json_handler(httpd_req_t *req)
 {
-    ESP_LOGI(TAG, "/apSSID.json requested");
+    ESP_LOGD(TAG, "/apSSID.json requested");
     char ssidJSON[50];
     
     wifi_config_t *wifi_config = wifi_app_get_wifi_config();
@@ -384,14 +1075,263 @@ static esp_err_t http_server_get_ap_ssid_json_handler(httpd_req_t *req)
     return send_json_response(req, ssidJSON);
 }
 
+/*
+* Server-Sent Events push stream. Subscribers are socket descriptors that stay open after
+* the /events handler returns; they are only touched from the httpd task (handler, queued
+* work and close_fn) so no locking is needed
+*/
+static void http_server_sse_remove(int fd)
+{
+    for (int i = 0; i < SSE_MAX_SUBSCRIBERS; i++) {
+        if (sse_fds[i] == fd) {
+            sse_fds[i] = -1;
+            atomic_fetch_sub(&sse_subscriber_count, 1);
+        }
+    }
+}
+
+// Sends one formatted event to every subscriber of the format, dropping the ones that fail
+static void http_server_sse_broadcast(const char *event, int len, int format)
+{
+    for (int i = 0; i < SSE_MAX_SUBSCRIBERS; i++) {
+        int fd = sse_fds[i];
+        if (fd < 0 || (format != SSE_FORMAT_ANY && sse_format[i] != format)) continue;
+        if (httpd_socket_send(http_server_handle, fd, event, len, 0) < 0) {
+            ESP_LOGW(TAG, "SSE subscriber %d dropped", fd);
+            http_server_sse_remove(fd);
+            httpd_sess_trigger_close(http_server_handle, fd);
+        } else {
+            metrics_counter_inc(&sse_events);
+        }
+    }
+}
+
+// Wraps the cached telemetry body into an event, no sensor formatting per send
+static int http_server_sse_format_sensors(char *buf, size_t size)
+{
+    uint32_t seq;
+    int len = snprintf(buf, size, "event: sensors\ndata: ");
+    
+    len += telemetry_cache_get(buf + len, size - len, &seq);
+    return len + snprintf(buf + len, size - len, "\n\n");
+}
+
+// Same event carrying the cached CBOR map base64 encoded, event data has to be text
+static int http_server_sse_format_sensors_cbor(char *buf, size_t size)
+{
+    uint8_t cbor[TELEMETRY_CACHE_CBOR_SIZE];
+    size_t cbor_len = telemetry_cache_get_cbor(cbor, sizeof(cbor), NULL);
+    size_t encoded = 0;
+    int len = snprintf(buf, size, "event: sensors\ndata: ");
+    
+    mbedtls_base64_encode((unsigned char *)buf + len, size - len, &encoded, cbor, cbor_len);
+    len += encoded;
+    return len + snprintf(buf + len, size - len, "\n\n");
+}
+
+static bool http_server_sse_has_format(int format)
+{
+    for (int i = 0; i < SSE_MAX_SUBSCRIBERS; i++) {
+        if (sse_fds[i] >= 0 && sse_format[i] == format) return true;
+    }
+    return false;
+}
+
+static int http_server_sse_format_status(char *buf, size_t size)
+{
+    return snprintf(buf, size, "event: status\ndata: {\"wifi_connect_status\":%d,\"ota_update_status\":%d}\n\n",
+                    g_wifi_connect_status, g_fw_update_status);
+}
+
+// Queued work, runs in the httpd task. One format pass serves all subscribers
+static void http_server_sse_sensors_work(void *arg)
+{
+    char event[SSE_EVENT_SIZE];
+    atomic_store(&sse_sensors_queued, false);
+    if (http_server_sse_has_format(SSE_FORMAT_JSON)) {
+        http_server_sse_broadcast(event, http_server_sse_format_sensors(event, sizeof(event)), SSE_FORMAT_JSON);
+    }
+    if (http_server_sse_has_format(SSE_FORMAT_CBOR)) {
+        http_server_sse_broadcast(event, http_server_sse_format_sensors_cbor(event, sizeof(event)), SSE_FORMAT_CBOR);
+    }
+}
+
+static void http_server_sse_status_work(void *arg)
+{
+    char event[SSE_EVENT_SIZE];
+    http_server_sse_broadcast(event, http_server_sse_format_status(event, sizeof(event)), SSE_FORMAT_ANY);
+}
+
+/*
+* Telemetry cache listener. Updates arriving while a broadcast is still queued are
+* coalesced into it, so a client never sees the same body twice
+*/
+static void http_server_sse_on_telemetry(uint32_t seq)
+{
+    httpd_handle_t server = http_server_handle;
+    if (server == NULL || atomic_load(&sse_subscriber_count) == 0) return;
+    
+    if (!atomic_exchange(&sse_sensors_queued, true)) {
+        if (httpd_queue_work(server, http_server_sse_sensors_work, NULL) != ESP_OK) {
+            atomic_store(&sse_sensors_queued, false);
+        }
+    } else {
+        metrics_counter_inc(&sse_coalesced);
+    }
+}
+
+// Queued work carrying one alert event, the listener allocated it
+static void http_server_sse_alert_work(void *arg)
+{
+    sensor_alert_event_t *alert = (sensor_alert_event_t *)arg;
+    char event[SSE_EVENT_SIZE];
+    int len = snprintf(event, sizeof(event), "event: alert\ndata: ");
+    size_t data_len = sensor_alert_format_event(alert, event + len, sizeof(event) - len);
+    
+    free(alert);
+    if (data_len == 0) return;
+    len += data_len;
+    http_server_sse_broadcast(event, len + snprintf(event + len, sizeof(event) - len, "\n\n"), SSE_FORMAT_ANY);
+}
+
+// Alert listener, runs in the periodic work task. Every transition is pushed once
+static void http_server_sse_on_alert(const sensor_alert_event_t *event, void *arg)
+{
+    httpd_handle_t server = http_server_handle;
+    if (server == NULL || atomic_load(&sse_subscriber_count) == 0) return;
+    
+    sensor_alert_event_t *copy = malloc(sizeof(*copy));
+    if (copy == NULL) return;
+    *copy = *event;
+    if (httpd_queue_work(server, http_server_sse_alert_work, copy) != ESP_OK) {
+        free(copy);
+    }
+}
+
+static void http_server_sse_push_status(void)
+{
+    if (http_server_handle != NULL && atomic_load(&sse_subscriber_count) > 0) {
+        httpd_queue_work(http_server_handle, http_server_sse_status_work, NULL);
+    }
+}
+
+/*
+* /events: text/event-stream of "sensors", "status" and "alert" events, replaces the dashboard pollers.
+* Sensors events carry base64 CBOR for clients that accept application/cbor or ask for
+* ?format=cbor, EventSource in browsers cannot set the Accept header
+*/
+static esp_err_t http_server_events_handler(httpd_req_t *req)
+{
+    static const char sse_headers[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/event-stream\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Connection: keep-alive\r\n\r\n"
+        "retry: 5000\n\n";
+    char event[SSE_EVENT_SIZE];
+    char query[32];
+    char format[8];
+    int fd = httpd_req_to_sockfd(req);
+    int slot = -1;
+    bool cbor = http_server_accepts_cbor(req);
+    
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "format", format, sizeof(format)) == ESP_OK) {
+        cbor = strcmp(format, "cbor") == 0;
+    }
+    
+    for (int i = 0; i < SSE_MAX_SUBSCRIBERS; i++) {
+        if (sse_fds[i] < 0) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        // Keep sockets free for regular requests, the client falls back to polling
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "30");
+        return httpd_resp_send(req, NULL, 0);
+    }
+    
+    // Raw headers, the response never completes so the socket stays with the stream
+    if (httpd_send(req, sse_headers, sizeof(sse_headers) - 1) < 0) return ESP_FAIL;
+    
+    int len = http_server_sse_format_status(event, sizeof(event));
+    if (httpd_send(req, event, len) < 0) return ESP_FAIL;
+    len = cbor ? http_server_sse_format_sensors_cbor(event, sizeof(event)) : http_server_sse_format_sensors(event, sizeof(event));
+    if (httpd_send(req, event, len) < 0) return ESP_FAIL;
+    
+    sse_format[slot] = cbor ? SSE_FORMAT_CBOR : SSE_FORMAT_JSON;
+    sse_fds[slot] = fd;
+    atomic_fetch_add(&sse_subscriber_count, 1);
+    ESP_LOGD(TAG, "SSE subscriber %d added", fd);
+    return ESP_OK;
+}
+
+// Session close hook, httpd leaves closing the socket to us once this is set
+static void http_server_close_fn(httpd_handle_t hd, int sockfd)
+{
+    http_server_sse_remove(sockfd);
+    close(sockfd);
+}
+
+// Runs the route's handler and records it, the counters are per core so this costs next to nothing
+static esp_err_t http_server_route_handler(httpd_req_t *req)
+{
+    http_server_route_t *route = (http_server_route_t *)req->user_ctx;
+    int64_t start = esp_timer_get_time();
+    
+    esp_err_t err = route->handler(req);
+    
+    metrics_histogram_observe(&route->latency, (uint32_t)(esp_timer_get_time() - start));
+    metrics_counter_inc(&route->requests);
+    if (err != ESP_OK) {
+        metrics_counter_inc(&route->errors);
+    }
+    return err;
+}
+
+// Routes outlive server restarts so the counters keep counting
+static http_server_route_t *http_server_route(const char *uri, httpd_method_t method, esp_err_t (*handler)(httpd_req_t *r))
+{
+    for (int i = 0; i < http_server_route_count; i++) {
+        if (http_server_routes[i].method == method && strcmp(http_server_routes[i].uri, uri) == 0) {
+            return &http_server_routes[i];
+        }
+    }
+    if (http_server_route_count >= HTTP_SERVER_MAX_URI_HANDLERS) {
+        return NULL;
+    }
+    
+    http_server_route_t *route = &http_server_routes[http_server_route_count++];
+    route->uri = uri;
+    route->method = method;
+    route->handler = handler;
+    snprintf(route->labels, sizeof(route->labels), "uri=\"%s\",method=\"%s\"", uri, http_method_str(method));
+    route->requests = (metrics_counter_t)METRICS_COUNTER("http_requests_total", "Requests handled", route->labels);
+    route->errors = (metrics_counter_t)METRICS_COUNTER("http_request_errors_total", "Requests whose handler failed", route->labels);
+    route->latency = (metrics_histogram_t)METRICS_HISTOGRAM("http_request_duration_seconds", "Time spent in the handler",
+                                                            route->labels, http_server_latency_bounds_us);
+    metrics_register_counter(&route->requests);
+    metrics_register_counter(&route->errors);
+    metrics_register_histogram(&route->latency);
+    return route;
+}
+
 // URI handler registration helper
 static void register_uri_handler(httpd_handle_t server, const char *uri, httpd_method_t method, esp_err_t (*handler)(httpd_req_t *r))
 {
+    http_server_route_t *route = http_server_route(uri, method, handler);
+    if (route == NULL) {
+        ESP_LOGE(TAG, "No room for URI handler %s", uri);
+        return;
+    }
+    
     httpd_uri_t uri_handler = {
         .uri = uri,
         .method = method,
-        .handler = handler,
-        .user_ctx = NULL
+        .handler = http_server_route_handler,
+        .user_ctx = route
     };
     httpd_register_uri_handler(server, &uri_handler);
 }
@@ -401,7 +1341,7 @@ static httpd_handle_t http_server_configure(void)
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     
     // Create HTTP Server monitor task
-    xTaskCreatePinnedToCore(&http_server_monitor, "http_server_monitor", HTTP_SERVER_TASK_STACK_SIZE, 
+    xTaskCreatePinnedToCore(&http_server_monitor, "http_server_monitor", HTTP_SERVER_MONITOR_STACK_SIZE, 
                            NULL, HTTP_SERVER_MONITOR_PRIORITY, &task_http_server_monitor, HTTP_SERVER_MONITOR_CORE_ID);
     
     // Create message queue
@@ -411,9 +1351,33 @@ static httpd_handle_t http_server_configure(void)
     config.core_id = HTTP_SERVER_TASK_CORE_ID;
     config.task_priority = HTTP_SERVER_TASK_PRIORITY;
     config.stack_size = HTTP_SERVER_TASK_STACK_SIZE;
-    config.max_uri_handlers = 20;
-    config.recv_wait_timeout = 10;
-    config.send_wait_timeout = 10;
+    config.max_uri_handlers = HTTP_SERVER_MAX_URI_HANDLERS;
+    config.max_open_sockets = HTTP_SERVER_MAX_OPEN_SOCKETS;
+    config.recv_wait_timeout = CONFIG_HTTP_SERVER_SOCKET_TIMEOUT_S;
+    config.send_wait_timeout = CONFIG_HTTP_SERVER_SOCKET_TIMEOUT_S;
+    
+    // With every socket taken a new client closes the least recently used session instead of
+    // being refused. Push stream sockets are idle after the handshake and go first, the browser
+    // reconnects after the retry interval. Keep-alive reclaims sockets of clients that left the AP
+    config.lru_purge_enable = true;
+    config.keep_alive_enable = true;
+    config.keep_alive_idle = CONFIG_HTTP_SERVER_KEEP_ALIVE_IDLE_S;
+    config.keep_alive_interval = HTTP_SERVER_KEEP_ALIVE_INTERVAL;
+    config.keep_alive_count = HTTP_SERVER_KEEP_ALIVE_COUNT;
+    config.close_fn = http_server_close_fn;
+    
+    // Push stream subscribers
+    for (int i = 0; i < SSE_MAX_SUBSCRIBERS; i++) {
+        sse_fds[i] = -1;
+    }
+    atomic_store(&sse_subscriber_count, 0);
+    metrics_register_counter(&sse_events);
+    metrics_register_counter(&sse_coalesced);
+    telemetry_cache_set_listener(&http_server_sse_on_telemetry);
+    static bool alert_listener_added = false;
+    if (!alert_listener_added) {
+        alert_listener_added = sensor_alert_add_listener(&http_server_sse_on_alert, NULL);
+    }
     
     ESP_LOGI(TAG, "Starting server on port: '%d' with task priority: '%d'", 
              config.server_port, config.task_priority);
@@ -437,6 +1401,20 @@ static httpd_handle_t http_server_configure(void)
         register_uri_handler(http_server_handle, "/wifiDisconnect.json", HTTP_DELETE, http_server_wifi_disconnect_json_handler);
         register_uri_handler(http_server_handle, "/localTime.json", HTTP_GET, http_server_get_local_time_json_handler);
         register_uri_handler(http_server_handle, "/apSSID.json", HTTP_GET, http_server_get_ap_ssid_json_handler);
+        register_uri_handler(http_server_handle, "/history.json", HTTP_GET, http_server_get_history_json_handler);
+        register_uri_handler(http_server_handle, "/rollup.json", HTTP_GET, http_server_get_rollup_json_handler);
+        register_uri_handler(http_server_handle, "/events", HTTP_GET, http_server_events_handler);
+        register_uri_handler(http_server_handle, "/telemetry.json", HTTP_GET, http_server_get_telemetry_json_handler);
+        register_uri_handler(http_server_handle, "/sensors.json", HTTP_GET, http_server_get_sensors_json_handler);
+        register_uri_handler(http_server_handle, "/sensorPeriod.json", HTTP_POST, http_server_sensor_period_json_handler);
+        register_uri_handler(http_server_handle, "/alerts.json", HTTP_GET, http_server_get_alerts_json_handler);
+        register_uri_handler(http_server_handle, "/alertRule.json", HTTP_POST, http_server_alert_rule_json_handler);
+        register_uri_handler(http_server_handle, "/system.json", HTTP_GET, http_server_get_system_json_handler);
+        register_uri_handler(http_server_handle, "/metrics", HTTP_GET, http_server_get_metrics_handler);
+#if CONFIG_MESH_ROLE_GATEWAY
+        register_uri_handler(http_server_handle, "/nodes.json", HTTP_GET, http_server_get_nodes_json_handler);
+        register_uri_handler(http_server_handle, "/nodeHistory.json", HTTP_GET, http_server_get_node_history_json_handler);
+#endif
         
         return http_server_handle;
     }
@@ -475,5 +1453,6 @@ BaseType_t http_server_monitor_send_message(http_server_message_e msgID)
 void http_server_fw_update_reset_callback(void *arg)
 {
     ESP_LOGI(TAG, "Timer timed-out, restarting device");
+    sample_log_flush();
     esp_restart();
 }
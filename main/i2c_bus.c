@@ -0,0 +1,232 @@
+/*
+ * i2c_bus.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "i2c_bus.h"
+
+static const char TAG[] = "i2c_bus";
+
+#define I2C_BUS_GLITCH_IGNORE_CNT   7
+
+struct i2c_bus_device_s {
+	struct i2c_bus_s *bus;
+	i2c_master_dev_handle_t handle;
+	bool in_use;
+	// Given by the releasing owner when the bus is handed to this device
+	SemaphoreHandle_t wake;
+	StaticSemaphore_t wake_buffer;
+};
+
+/*
+* Bus ownership is handed over in request order: a releasing owner passes the bus straight
+* to the longest waiting device instead of letting all waiters race for it. One waiter per
+* device, so the queue never holds more than I2C_BUS_MAX_DEVICES entries
+*/
+typedef struct i2c_bus_s {
+	i2c_master_bus_handle_t handle;
+	int pin_sda;
+	int pin_scl;
+	portMUX_TYPE mux;
+	bool busy;
+	i2c_bus_device_t *waiters[I2C_BUS_MAX_DEVICES];
+	uint8_t wait_head;
+	uint8_t wait_count;
+} i2c_bus_t;
+
+static i2c_bus_t buses[I2C_NUM_MAX];
+static i2c_bus_device_t devices[I2C_BUS_MAX_DEVICES];
+
+static void i2c_bus_acquire(i2c_bus_device_t *device)
+{
+	i2c_bus_t *bus = device->bus;
+	bool wait;
+
+	taskENTER_CRITICAL(&bus->mux);
+	wait = bus->busy;
+	if (wait)
+	{
+		bus->waiters[(bus->wait_head + bus->wait_count) % I2C_BUS_MAX_DEVICES] = device;
+		bus->wait_count++;
+	}
+	else
+	{
+		bus->busy = true;
+	}
+	taskEXIT_CRITICAL(&bus->mux);
+
+	if (wait)
+	{
+		xSemaphoreTake(device->wake, portMAX_DELAY);
+	}
+}
+
+static void i2c_bus_release(i2c_bus_t *bus)
+{
+	i2c_bus_device_t *next = NULL;
+
+	taskENTER_CRITICAL(&bus->mux);
+	if (bus->wait_count > 0)
+	{
+		// busy stays set, the bus changes hands without being free in between
+		next = bus->waiters[bus->wait_head];
+		bus->wait_head = (bus->wait_head + 1) % I2C_BUS_MAX_DEVICES;
+		bus->wait_count--;
+	}
+	else
+	{
+		bus->busy = false;
+	}
+	taskEXIT_CRITICAL(&bus->mux);
+
+	if (next != NULL)
+	{
+		xSemaphoreGive(next->wake);
+	}
+}
+
+static void i2c_bus_setup(i2c_bus_t *bus, i2c_master_bus_handle_t handle, int pin_sda, int pin_scl)
+{
+	memset(bus, 0, sizeof(*bus));
+	bus->handle = handle;
+	bus->pin_sda = pin_sda;
+	bus->pin_scl = pin_scl;
+	portMUX_INITIALIZE(&bus->mux);
+}
+
+esp_err_t i2c_bus_init(i2c_port_t port, int pin_sda, int pin_scl)
+{
+	if (port < 0 || port >= I2C_NUM_MAX)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	i2c_bus_t *bus = &buses[port];
+	if (bus->handle != NULL)
+	{
+		return (bus->pin_sda == pin_sda && bus->pin_scl == pin_scl) ? ESP_OK : ESP_ERR_INVALID_STATE;
+	}
+
+	i2c_master_bus_config_t bus_cfg = {
+		.clk_source = I2C_CLK_SRC_DEFAULT,
+		.i2c_port = port,
+		.sda_io_num = pin_sda,
+		.scl_io_num = pin_scl,
+		.glitch_ignore_cnt = I2C_BUS_GLITCH_IGNORE_CNT,
+		.flags.enable_internal_pullup = true,
+	};
+	i2c_master_bus_handle_t handle;
+	esp_err_t err = i2c_new_master_bus(&bus_cfg, &handle);
+	if (err != ESP_OK)
+	{
+		ESP_LOGE(TAG, "Failed to create bus on port %d (%s)", port, esp_err_to_name(err));
+		return err;
+	}
+
+	i2c_bus_setup(bus, handle, pin_sda, pin_scl);
+	ESP_LOGI(TAG, "Bus %d on SDA %d SCL %d", port, pin_sda, pin_scl);
+	return ESP_OK;
+}
+
+esp_err_t i2c_bus_attach(i2c_port_t port, i2c_master_bus_handle_t handle)
+{
+	if (port < 0 || port >= I2C_NUM_MAX || handle == NULL)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	i2c_bus_t *bus = &buses[port];
+	if (bus->handle != NULL)
+	{
+		return (bus->handle == handle) ? ESP_OK : ESP_ERR_INVALID_STATE;
+	}
+
+	i2c_bus_setup(bus, handle, -1, -1);
+	return ESP_OK;
+}
+
+esp_err_t i2c_bus_add_device(i2c_port_t port, uint16_t address, uint32_t scl_speed_hz, i2c_bus_device_t **device)
+{
+	if (port < 0 || port >= I2C_NUM_MAX || buses[port].handle == NULL)
+	{
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	i2c_bus_device_t *dev = NULL;
+	for (int i = 0; i < I2C_BUS_MAX_DEVICES && dev == NULL; i++)
+	{
+		if (!devices[i].in_use)
+		{
+			dev = &devices[i];
+		}
+	}
+	if (dev == NULL)
+	{
+		ESP_LOGE(TAG, "No free device slot for 0x%02x", address);
+		return ESP_ERR_NO_MEM;
+	}
+
+	i2c_device_config_t dev_cfg = {
+		.dev_addr_length = I2C_ADDR_BIT_LEN_7,
+		.device_address = address,
+		.scl_speed_hz = scl_speed_hz,
+	};
+	esp_err_t err = i2c_master_bus_add_device(buses[port].handle, &dev_cfg, &dev->handle);
+	if (err != ESP_OK)
+	{
+		return err;
+	}
+
+	dev->bus = &buses[port];
+	dev->wake = xSemaphoreCreateBinaryStatic(&dev->wake_buffer);
+	dev->in_use = true;
+	*device = dev;
+	return ESP_OK;
+}
+
+void i2c_bus_remove_device(i2c_bus_device_t *device)
+{
+	if (device == NULL || !device->in_use)
+	{
+		return;
+	}
+
+	i2c_master_bus_rm_device(device->handle);
+	vSemaphoreDelete(device->wake);
+	memset(device, 0, sizeof(*device));
+}
+
+esp_err_t i2c_bus_read(i2c_bus_device_t *device, uint8_t reg, uint8_t *data, size_t len)
+{
+	if (len == 0 || len > I2C_BUS_MAX_TRANSFER || data == NULL)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	i2c_bus_acquire(device);
+	esp_err_t err = i2c_master_transmit_receive(device->handle, &reg, 1, data, len, I2C_BUS_TIMEOUT_MS);
+	i2c_bus_release(device->bus);
+	return err;
+}
+
+esp_err_t i2c_bus_write(i2c_bus_device_t *device, uint8_t reg, const uint8_t *data, size_t len)
+{
+	uint8_t buf[1 + I2C_BUS_MAX_TRANSFER];
+
+	if (len == 0 || len > I2C_BUS_MAX_TRANSFER || data == NULL)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	buf[0] = reg;
+	memcpy(buf + 1, data, len);
+	i2c_bus_acquire(device);
+	esp_err_t err = i2c_master_transmit(device->handle, buf, 1 + len, I2C_BUS_TIMEOUT_MS);
+	i2c_bus_release(device->bus);
+	return err;
+}
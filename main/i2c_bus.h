@@ -0,0 +1,58 @@
+/*
+ * i2c_bus.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef MAIN_I2C_BUS_H_
+#define MAIN_I2C_BUS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "hal/i2c_types.h"
+#include "driver/i2c_master.h"
+
+// Devices over all buses, the pool is static
+#define I2C_BUS_MAX_DEVICES         8
+// Largest register run moved in one transaction
+#define I2C_BUS_MAX_TRANSFER        32
+#define I2C_BUS_TIMEOUT_MS          50
+
+typedef struct i2c_bus_device_s i2c_bus_device_t;
+
+/*
+* Creates the shared bus of a port, later calls for the same port reuse it
+* Bus and device registration is meant for start-up and is not thread safe
+@return ESP_OK if the bus exists, ESP_ERR_INVALID_STATE if it runs on other pins
+*/
+esp_err_t i2c_bus_init(i2c_port_t port, int pin_sda, int pin_scl);
+
+/*
+* Adopts a bus created elsewhere as the shared bus of the port
+@return ESP_OK if successful, ESP_ERR_INVALID_STATE if the port already has another bus
+*/
+esp_err_t i2c_bus_attach(i2c_port_t port, i2c_master_bus_handle_t handle);
+
+/*
+* Registers a 7 bit device on the shared bus of the port. Each device is expected to be
+* driven by one task at a time
+@return ESP_OK if successful, ESP_ERR_NO_MEM if the device pool is full
+*/
+esp_err_t i2c_bus_add_device(i2c_port_t port, uint16_t address, uint32_t scl_speed_hz, i2c_bus_device_t **device);
+
+/*
+* Unregisters a device and returns it to the pool
+*/
+void i2c_bus_remove_device(i2c_bus_device_t *device);
+
+/*
+* Reads or writes a run of len consecutive registers starting at reg in one transaction.
+* Callers get the bus in the order they asked for it, whatever their priority. Never allocates
+@return ESP_OK if the access completed, ESP_ERR_INVALID_ARG if len is 0 or above I2C_BUS_MAX_TRANSFER
+*/
+esp_err_t i2c_bus_read(i2c_bus_device_t *device, uint8_t reg, uint8_t *data, size_t len);
+esp_err_t i2c_bus_write(i2c_bus_device_t *device, uint8_t reg, const uint8_t *data, size_t len);
+
+#endif /* MAIN_I2C_BUS_H_ */
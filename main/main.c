@@ -17,13 +17,95 @@
 #include "esp_log.h"
 #include "sntp_time_sync.h"
 #include "bmp180.h"
+#include "sensor_history.h"
+#include "sensor_rollup.h"
+#include "sensor_filter.h"
+#include "sensor_sim.h"
+#include "sensor_alert.h"
+#include "sample_log.h"
+#include "telemetry_cache.h"
+#include "sensor_registry.h"
+#include "periodic_work.h"
+#include "system_report.h"
+#include "uplink.h"
+#include "mesh.h"
+#include "power.h"
 
 static const char TAG[] = "main";
 
+#if CONFIG_SENSOR_SIM_ENABLED
+// Load generators in place of the hardware, see sensor_sim.h
+static const sensor_sim_config_t sim_dht22_config = {
+	.rate_hz = CONFIG_SENSOR_SIM_DHT22_RATE_HZ,
+};
+
+static const sensor_sim_config_t sim_bmp180_config = {
+	.rate_hz = CONFIG_SENSOR_SIM_BMP180_RATE_HZ,
+};
+
+static const sensor_descriptor_t sensors[] = {
+	{ .name = "sim_dht22", .driver = &sensor_sim_dht22_driver, .period_ms = SENSOR_SIM_PERIOD_MS(CONFIG_SENSOR_SIM_DHT22_RATE_HZ), .config = &sim_dht22_config },
+	{ .name = "sim_bmp180", .driver = &sensor_sim_bmp180_driver, .period_ms = SENSOR_SIM_PERIOD_MS(CONFIG_SENSOR_SIM_BMP180_RATE_HZ), .config = &sim_bmp180_config },
+};
+#else
+// Sensors of this node, all run as jobs of the periodic work task
+static const dht22_sensor_config_t dht22_config = {
+	.pin = CONFIG_DHT22_GPIO,
+};
+
+static const bmp180_sensor_config_t bmp180_config = {
+	.i2c = {
+		.bus = NULL,
+		.port = I2C_NUM_0,
+		.pin_sda = CONFIG_BMP180_SDA_GPIO,
+		.pin_scl = CONFIG_BMP180_SCL_GPIO,
+	},
+	.i2c_address = BMP180_DEVICE_ADDRESS,
+	.mode = (bmp180_mode_t)CONFIG_BMP180_OVERSAMPLING,
+	.altitude = CONFIG_BMP180_ALTITUDE_M,
+};
+
+static const sensor_descriptor_t sensors[] = {
+	{ .name = "dht22", .driver = &dht22_sensor_driver, .period_ms = CONFIG_DHT22_SAMPLE_INTERVAL_MS, .config = &dht22_config },
+	{ .name = "bmp180", .driver = &bmp180_sensor_driver, .period_ms = BMP180_SENSOR_PERIOD_MS, .config = &bmp180_config },
+};
+#endif
+
 void wifi_application_connected_events(void)
 {
 	ESP_LOGI(TAG, "Wifi Application Connected!");
-	sntp_time_sync_task_start();
+	sntp_time_sync_start();
+#if CONFIG_UPLINK_ENABLED
+	uplink_start();
+#endif
+}
+
+void wifi_application_disconnected_events(void)
+{
+	ESP_LOGI(TAG, "Wifi Application Disconnected!");
+#if CONFIG_UPLINK_ENABLED
+	uplink_link_down();
+#endif
+}
+
+// Registers every sensor and starts the schedule, the first samples are taken right away
+static void app_start_sensors(void)
+{
+	static bool started = false;
+	
+	if (started)
+	{
+		return;
+	}
+	started = true;
+	for (int i = 0; i < sizeof(sensors) / sizeof(sensors[0]); i++)
+	{
+		if (sensor_registry_add(&sensors[i]) != ESP_OK)
+		{
+			ESP_LOGE(TAG, "Sensor %s not registered", sensors[i].name);
+		}
+	}
+	sensor_registry_start();
 }
 
 void app_main(void)
@@ -37,15 +119,65 @@ void app_main(void)
 	}
 	ESP_ERROR_CHECK(ret);
 	
-	// Set connected event callback
+	// Periodic work task, runs the sensors, time checks, the reset button and reports
+	ESP_ERROR_CHECK(periodic_work_start());
+	system_report_init();
+	power_init();
+	
+	// Filter stage and sample history, must be in place before the sensors publish
+	sensor_filter_init();
+	sensor_history_init();
+	sensor_rollup_init();
+	telemetry_cache_init();
+	sensor_alert_init();
+	
+#if CONFIG_POWER_PROFILE_DEEP_SLEEP
+	// Timer wake of the sleep cycle: nothing but the sensors until the row is taken. Every few
+	// samples the boot goes on to bring up the log and Wi-Fi and flush the rows
+	bool timer_wake = power_cycle_timer_wake();
+	if (timer_wake)
+	{
+		app_start_sensors();
+		if (!power_cycle_collect())
+		{
+			power_cycle_sleep();
+		}
+	}
+#else
+	bool timer_wake = false;
+#endif
+	
+#if !CONFIG_MESH_ROLE_LEAF
+	// Set connected and disconnected event callbacks
 	wifi_app_set_callback(&wifi_application_connected_events);
+	wifi_app_set_disconnected_callback(&wifi_application_disconnected_events);
 	
 	// Start WiFi
 	wifi_app_start();
+#endif
+	
+	// Flash sample log, refill the history with the rows saved before the reboot. A wake of the
+	// sleep cycle has been sampling already, restored rows would land after its own
+	if (sample_log_init() == ESP_OK)
+	{
+#if CONFIG_POWER_PROFILE_DEEP_SLEEP
+		power_cycle_store_rows();
+#endif
+		if (!timer_wake)
+		{
+			sample_log_restore_history(sensor_history_capacity() - 1);
+		}
+	}
+	
+	// Start the sensors, each one is a periodic work job
+	app_start_sensors();
 	
-	// Start DHT22 sensor task
-	DHT22_task_start();
+#if CONFIG_MESH_ROLE_LEAF
+	// Rows go to the gateway over ESP-NOW instead of the soft AP, the station and the uplink
+	ESP_ERROR_CHECK(mesh_leaf_start());
+#endif
 	
-	// Start BMP180 sensor task (SDA=21, SCL=22, altitude=920m)
-	BMP180_task_start(21, 22, 920.0f);
+#if CONFIG_POWER_PROFILE_DEEP_SLEEP
+	power_cycle_finish(timer_wake);
+#endif
 }
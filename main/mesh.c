@@ -0,0 +1,731 @@
+/*
+ * mesh.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#include "sdkconfig.h"
+
+#if CONFIG_MESH_ROLE_GATEWAY || CONFIG_MESH_ROLE_LEAF
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "esp_event.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_now.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "metrics.h"
+#include "tasks_common.h"
+#include "mesh.h"
+
+static const char TAG[] = "mesh";
+
+static const uint8_t mesh_broadcast[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+// Checks a received frame of the given type against this network
+static bool mesh_frame_valid(const uint8_t *data, int len, uint8_t type)
+{
+	const mesh_frame_header_t *h = (const mesh_frame_header_t *)data;
+
+	return len >= (int)sizeof(mesh_frame_header_t) &&
+		h->magic == MESH_FRAME_MAGIC && h->version == MESH_FRAME_VERSION && h->type == type &&
+		h->network_id == CONFIG_MESH_NETWORK_ID && h->count <= MESH_FRAME_MAX_ROWS &&
+		len == (int)(sizeof(mesh_frame_header_t) + h->count * sizeof(sensor_history_row_t));
+}
+
+static void mesh_frame_init(mesh_frame_header_t *h, uint8_t type)
+{
+	memset(h, 0, sizeof(*h));
+	h->magic = MESH_FRAME_MAGIC;
+	h->version = MESH_FRAME_VERSION;
+	h->type = type;
+	h->network_id = CONFIG_MESH_NETWORK_ID;
+}
+
+static esp_err_t mesh_add_broadcast_peer(uint8_t channel, wifi_interface_t ifidx)
+{
+	esp_now_peer_info_t peer = {
+		.channel = channel,
+		.ifidx = ifidx,
+		.encrypt = false,
+	};
+
+	memcpy(peer.peer_addr, mesh_broadcast, sizeof(mesh_broadcast));
+	return esp_now_add_peer(&peer);
+}
+
+#if CONFIG_MESH_ROLE_GATEWAY
+
+// Frames waiting between the Wi-Fi task and the mesh task
+#define MESH_RX_QUEUE_LENGTH        16
+
+// Leaf clocks further off than this are taken as not synced, their rows move to the gateway's clock
+#define MESH_CLOCK_SKEW_MAX_S       120
+
+typedef struct {
+	uint8_t src[6];
+	int8_t rssi;
+	uint8_t len;
+	uint8_t data[MESH_FRAME_MAX_SIZE];
+} mesh_rx_t;
+
+typedef struct {
+	bool used;
+	uint8_t mac[6];
+	int8_t rssi;
+	uint32_t boot_id;
+	uint32_t next_seq;			// next row expected from the leaf
+	uint32_t last_seen;			// time() of the last frame
+	uint32_t rows;				// rows taken
+	uint32_t lost;				// rows skipped by the leaf's numbering
+	uint32_t duplicates;		// rows received again
+	bool has_latest;
+	sensor_history_row_t latest;
+} mesh_node_t;
+
+typedef struct {
+	mesh_rows_listener_t listener;
+	void *arg;
+} mesh_listener_t;
+
+static QueueHandle_t mesh_rx_queue = NULL;
+
+// Node table, written by the mesh task and read by the HTTP server
+static mesh_node_t nodes[MESH_MAX_NODES];
+static portMUX_TYPE mesh_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Ring of leaf rows, row seq lives in ring[seq % MESH_HISTORY_CAPACITY], only the mesh task writes
+static mesh_row_t *ring = NULL;
+static atomic_uint ring_head;
+
+// Published with release, listeners may be added while the mesh task already runs
+static mesh_listener_t listeners[MESH_MAX_LISTENERS];
+static atomic_int listener_count;
+
+static metrics_counter_t mesh_frames = METRICS_COUNTER("mesh_frames_total", "ESP-NOW frames received from leaves", "result=\"ok\"");
+static metrics_counter_t mesh_frames_invalid = METRICS_COUNTER("mesh_frames_total", "ESP-NOW frames received from leaves", "result=\"invalid\"");
+static metrics_counter_t mesh_frames_queue_full = METRICS_COUNTER("mesh_frames_total", "ESP-NOW frames received from leaves", "result=\"queue_full\"");
+static metrics_counter_t mesh_frames_table_full = METRICS_COUNTER("mesh_frames_total", "ESP-NOW frames received from leaves", "result=\"table_full\"");
+static metrics_counter_t mesh_rows = METRICS_COUNTER("mesh_rows_total", "Leaf rows added to the gateway ring", NULL);
+static metrics_counter_t mesh_rows_lost = METRICS_COUNTER("mesh_rows_lost_total", "Leaf rows that never arrived", NULL);
+static metrics_counter_t mesh_rows_duplicate = METRICS_COUNTER("mesh_rows_duplicate_total", "Leaf rows received more than once", NULL);
+static metrics_gauge_t mesh_nodes = METRICS_GAUGE("mesh_nodes", "Leaves in the node table", NULL);
+
+bool mesh_gateway_add_listener(mesh_rows_listener_t listener, void *arg)
+{
+	int count = atomic_load_explicit(&listener_count, memory_order_relaxed);
+	if (listener == NULL || count >= MESH_MAX_LISTENERS)
+	{
+		return false;
+	}
+	listeners[count].listener = listener;
+	listeners[count].arg = arg;
+	atomic_store_explicit(&listener_count, count + 1, memory_order_release);
+	return true;
+}
+
+/*
+* ESP-NOW receive callback, runs in the Wi-Fi task. Only checks and copies, the mesh task does
+* the rest
+*/
+static void mesh_gateway_recv_cb(const esp_now_recv_info_t *info, const uint8_t *data, int len)
+{
+	mesh_rx_t rx;
+
+	if (!mesh_frame_valid(data, len, MESH_FRAME_SAMPLES))
+	{
+		metrics_counter_inc(&mesh_frames_invalid);
+		return;
+	}
+	memcpy(rx.src, info->src_addr, sizeof(rx.src));
+	rx.rssi = info->rx_ctrl->rssi;
+	rx.len = (uint8_t)len;
+	memcpy(rx.data, data, len);
+	if (xQueueSend(mesh_rx_queue, &rx, 0) != pdTRUE)
+	{
+		metrics_counter_inc(&mesh_frames_queue_full);
+	}
+}
+
+// Node of a leaf, a free slot is taken for a new one. Call inside mesh_mux
+static int mesh_gateway_node_slot(const uint8_t mac[6])
+{
+	int free_slot = -1;
+
+	for (int i = 0; i < MESH_MAX_NODES; i++)
+	{
+		if (!nodes[i].used)
+		{
+			if (free_slot < 0)
+			{
+				free_slot = i;
+			}
+		}
+		else if (memcmp(nodes[i].mac, mac, 6) == 0)
+		{
+			return i;
+		}
+	}
+	return free_slot;
+}
+
+static void mesh_gateway_append(uint8_t node, uint32_t seq, const sensor_history_row_t *row)
+{
+	uint32_t h = atomic_load_explicit(&ring_head, memory_order_relaxed);
+
+	ring[h % MESH_HISTORY_CAPACITY] = (mesh_row_t){ .node = node, .seq = seq, .row = *row };
+	atomic_store_explicit(&ring_head, h + 1, memory_order_release);
+}
+
+// Tells the leaf the next row expected, on the interface the gateway is currently running
+static void mesh_gateway_send_ack(const uint8_t leaf[6], uint32_t boot_id, uint32_t next_seq)
+{
+	mesh_frame_header_t ack;
+	wifi_mode_t mode = WIFI_MODE_NULL;
+	esp_now_peer_info_t peer;
+
+	esp_wifi_get_mode(&mode);
+	if (esp_now_get_peer(mesh_broadcast, &peer) == ESP_OK)
+	{
+		wifi_interface_t ifidx = (mode == WIFI_MODE_AP) ? WIFI_IF_AP : WIFI_IF_STA;
+		if (peer.ifidx != ifidx)
+		{
+			peer.ifidx = ifidx;
+			esp_now_mod_peer(&peer);
+		}
+	}
+
+	mesh_frame_init(&ack, MESH_FRAME_ACK);
+	ack.boot_id = boot_id;
+	ack.seq = next_seq;
+	memcpy(ack.leaf, leaf, sizeof(ack.leaf));
+	esp_now_send(mesh_broadcast, (const uint8_t *)&ack, sizeof(ack));
+}
+
+static void mesh_gateway_handle(mesh_rx_t *rx)
+{
+	const mesh_frame_header_t *h = (const mesh_frame_header_t *)rx->data;
+	sensor_history_row_t *rows = (sensor_history_row_t *)(rx->data + sizeof(mesh_frame_header_t));
+	uint32_t now = (uint32_t)time(NULL);
+	uint32_t lost = 0, skip = 0, next_seq;
+	bool fresh_node = false;
+	int count;
+
+	// Rows of a leaf that has not synced its clock carry uptime seconds
+	int32_t skew = (int32_t)(now - h->time);
+	if (skew > MESH_CLOCK_SKEW_MAX_S || skew < -MESH_CLOCK_SKEW_MAX_S)
+	{
+		for (int i = 0; i < h->count; i++)
+		{
+			rows[i].timestamp += skew;
+		}
+	}
+
+	taskENTER_CRITICAL(&mesh_mux);
+	int index = mesh_gateway_node_slot(rx->src);
+	if (index < 0)
+	{
+		taskEXIT_CRITICAL(&mesh_mux);
+		metrics_counter_inc(&mesh_frames_table_full);
+		return;
+	}
+
+	mesh_node_t *node = &nodes[index];
+	if (!node->used || node->boot_id != h->boot_id)
+	{
+		// New leaf or a reboot, its numbering starts over
+		fresh_node = !node->used;
+		memset(node, 0, sizeof(*node));
+		node->used = true;
+		memcpy(node->mac, rx->src, sizeof(node->mac));
+		node->boot_id = h->boot_id;
+		node->next_seq = h->seq;
+	}
+	if ((int32_t)(h->seq - node->next_seq) > 0)
+	{
+		lost = h->seq - node->next_seq;
+	}
+	else
+	{
+		skip = MIN(node->next_seq - h->seq, h->count);
+	}
+	count = h->count - skip;
+	for (int i = skip; i < h->count; i++)
+	{
+		mesh_gateway_append((uint8_t)index, h->seq + i, &rows[i]);
+	}
+	if (count > 0)
+	{
+		node->next_seq = h->seq + h->count;
+		node->latest = rows[h->count - 1];
+		node->has_latest = true;
+	}
+	node->rssi = rx->rssi;
+	node->last_seen = now;
+	node->rows += count;
+	node->lost += lost;
+	node->duplicates += skip;
+	next_seq = node->next_seq;
+	taskEXIT_CRITICAL(&mesh_mux);
+
+	// Acknowledged even when everything was a repeat, the leaf's last ack got lost
+	mesh_gateway_send_ack(rx->src, h->boot_id, next_seq);
+
+	if (fresh_node)
+	{
+		ESP_LOGI(TAG, "Leaf %02x%02x%02x%02x%02x%02x joined as node %d, rssi %d",
+			rx->src[0], rx->src[1], rx->src[2], rx->src[3], rx->src[4], rx->src[5], index, rx->rssi);
+		metrics_gauge_set(&mesh_nodes, index + 1);
+	}
+	metrics_counter_inc(&mesh_frames);
+	metrics_counter_add(&mesh_rows, count);
+	metrics_counter_add(&mesh_rows_lost, lost);
+	metrics_counter_add(&mesh_rows_duplicate, skip);
+
+	if (count > 0)
+	{
+		int listener_total = atomic_load_explicit(&listener_count, memory_order_acquire);
+		for (int i = 0; i < listener_total; i++)
+		{
+			listeners[i].listener(rx->src, h->seq + skip, &rows[skip], count, listeners[i].arg);
+		}
+	}
+}
+
+static void mesh_gateway_task(void *pvParameters)
+{
+	mesh_rx_t rx;
+
+	for (;;)
+	{
+		if (xQueueReceive(mesh_rx_queue, &rx, portMAX_DELAY) == pdTRUE)
+		{
+			mesh_gateway_handle(&rx);
+		}
+	}
+}
+
+esp_err_t mesh_gateway_start(void)
+{
+	if (mesh_rx_queue != NULL)
+	{
+		return ESP_OK;
+	}
+
+	ring = heap_caps_calloc(MESH_HISTORY_CAPACITY, sizeof(mesh_row_t), MALLOC_CAP_SPIRAM);
+	if (ring == NULL)
+	{
+		ring = heap_caps_calloc(MESH_HISTORY_CAPACITY, sizeof(mesh_row_t), MALLOC_CAP_8BIT);
+	}
+	mesh_rx_queue = xQueueCreate(MESH_RX_QUEUE_LENGTH, sizeof(mesh_rx_t));
+	if (ring == NULL || mesh_rx_queue == NULL)
+	{
+		ESP_LOGE(TAG, "No memory for the gateway");
+		return ESP_ERR_NO_MEM;
+	}
+
+	metrics_register_counter(&mesh_frames);
+	metrics_register_counter(&mesh_frames_invalid);
+	metrics_register_counter(&mesh_frames_queue_full);
+	metrics_register_counter(&mesh_frames_table_full);
+	metrics_register_counter(&mesh_rows);
+	metrics_register_counter(&mesh_rows_lost);
+	metrics_register_counter(&mesh_rows_duplicate);
+	metrics_register_gauge(&mesh_nodes);
+
+	esp_err_t err = esp_now_init();
+	if (err != ESP_OK)
+	{
+		ESP_LOGE(TAG, "ESP-NOW init failed: %s", esp_err_to_name(err));
+		return err;
+	}
+	esp_now_register_recv_cb(&mesh_gateway_recv_cb);
+
+	// Channel 0 follows whatever channel the gateway's Wi-Fi is on
+	err = mesh_add_broadcast_peer(0, WIFI_IF_STA);
+	if (err != ESP_OK)
+	{
+		return err;
+	}
+
+	if (xTaskCreatePinnedToCore(&mesh_gateway_task, "mesh", MESH_TASK_STACK_SIZE, NULL,
+								MESH_TASK_PRIORITY, NULL, MESH_TASK_CORE_ID) != pdPASS)
+	{
+		ESP_LOGE(TAG, "Failed to create the task");
+		return ESP_ERR_NO_MEM;
+	}
+
+	ESP_LOGI(TAG, "Gateway of network %08"PRIx32", %d nodes, %d rows (%u bytes)", (uint32_t)CONFIG_MESH_NETWORK_ID,
+		MESH_MAX_NODES, MESH_HISTORY_CAPACITY, (unsigned)(MESH_HISTORY_CAPACITY * sizeof(mesh_row_t)));
+	return ESP_OK;
+}
+
+// Appends a row field in history units, or null if its source flag is clear
+static int mesh_format_field(char *buf, size_t size, const sensor_history_row_t *row, int i)
+{
+	uint8_t flag = (i == 2 || i == 3) ? SENSOR_HISTORY_FLAG_BMP180 : SENSOR_HISTORY_FLAG_DHT22;
+
+	if (!(row->flags & flag))
+	{
+		return snprintf(buf, size, ",null");
+	}
+	switch (i)
+	{
+		case 0:  return snprintf(buf, size, ",%d", row->dht_temperature);
+		case 1:  return snprintf(buf, size, ",%d", row->humidity);
+		case 2:  return snprintf(buf, size, ",%d", row->bmp_temperature);
+		default: return snprintf(buf, size, ",%"PRIu32, sensor_history_decode_pressure(row->pressure));
+	}
+}
+
+size_t mesh_gateway_format_nodes_json(char *buf, size_t size)
+{
+	size_t len = 0;
+	int written = 0;
+	int n;
+
+	n = snprintf(buf, size, "{\"time\":%"PRIu32",\"nodes\":[", (uint32_t)time(NULL));
+	if (n < 0 || n >= size)
+	{
+		return 0;
+	}
+	len = n;
+
+	for (int i = 0; i < MESH_MAX_NODES; i++)
+	{
+		mesh_node_t node;
+
+		// One node at a time, no formatting inside the critical section
+		taskENTER_CRITICAL(&mesh_mux);
+		node = nodes[i];
+		taskEXIT_CRITICAL(&mesh_mux);
+		if (!node.used)
+		{
+			continue;
+		}
+
+		n = snprintf(buf + len, size - len,
+			"%s{\"node\":%d,\"mac\":\"%02x%02x%02x%02x%02x%02x\",\"rssi\":%d,\"last_seen\":%"PRIu32","
+			"\"next\":%"PRIu32",\"rows\":%"PRIu32",\"lost\":%"PRIu32",\"duplicates\":%"PRIu32",\"latest\":",
+			written ? "," : "", i, node.mac[0], node.mac[1], node.mac[2], node.mac[3], node.mac[4], node.mac[5],
+			node.rssi, node.last_seen, node.next_seq, node.rows, node.lost, node.duplicates);
+		if (n < 0 || n >= size - len)
+		{
+			return 0;
+		}
+		len += n;
+
+		if (node.has_latest)
+		{
+			n = snprintf(buf + len, size - len, "[%"PRIu32, node.latest.timestamp);
+			for (int f = 0; f < 4 && n >= 0 && n < size - len; f++)
+			{
+				len += n;
+				n = mesh_format_field(buf + len, size - len, &node.latest, f);
+			}
+			if (n < 0 || n >= size - len)
+			{
+				return 0;
+			}
+			len += n;
+			n = snprintf(buf + len, size - len, "]}");
+		}
+		else
+		{
+			n = snprintf(buf + len, size - len, "null}");
+		}
+		if (n < 0 || n >= size - len)
+		{
+			return 0;
+		}
+		len += n;
+		written++;
+	}
+
+	n = snprintf(buf + len, size - len, "]}");
+	if (n < 0 || n >= size - len)
+	{
+		return 0;
+	}
+	return len + n;
+}
+
+int mesh_gateway_find_node(const uint8_t leaf[6])
+{
+	int index = -1;
+
+	taskENTER_CRITICAL(&mesh_mux);
+	for (int i = 0; i < MESH_MAX_NODES; i++)
+	{
+		if (nodes[i].used && memcmp(nodes[i].mac, leaf, 6) == 0)
+		{
+			index = i;
+			break;
+		}
+	}
+	taskEXIT_CRITICAL(&mesh_mux);
+	return index;
+}
+
+bool mesh_gateway_read_row(uint32_t seq, mesh_row_t *row)
+{
+	uint32_t h = atomic_load_explicit(&ring_head, memory_order_acquire);
+	if (ring == NULL || seq >= h || h - seq >= MESH_HISTORY_CAPACITY)
+	{
+		return false;
+	}
+
+	memcpy(row, &ring[seq % MESH_HISTORY_CAPACITY], sizeof(*row));
+
+	// The mesh task may have lapped the reader while copying, see sensor_history_read()
+	atomic_thread_fence(memory_order_acquire);
+	h = atomic_load_explicit(&ring_head, memory_order_relaxed);
+	return h - seq < MESH_HISTORY_CAPACITY;
+}
+
+uint32_t mesh_gateway_head(void)
+{
+	return atomic_load_explicit(&ring_head, memory_order_acquire);
+}
+
+uint32_t mesh_gateway_tail(void)
+{
+	uint32_t h = mesh_gateway_head();
+	return (h >= MESH_HISTORY_CAPACITY) ? h - MESH_HISTORY_CAPACITY + 1 : 0;
+}
+
+#endif /* CONFIG_MESH_ROLE_GATEWAY */
+
+#if CONFIG_MESH_ROLE_LEAF
+
+// Wait for the gateway's acknowledgement of one frame
+#define MESH_LEAF_ACK_TIMEOUT_MS    50
+
+// Unanswered frames in a row before the next channel is tried
+#define MESH_LEAF_MAX_TRIES         3
+
+#define MESH_CHANNEL_COUNT          13
+
+static TaskHandle_t mesh_leaf_task_handle = NULL;
+static uint8_t leaf_mac[6];
+static uint32_t leaf_boot_id;
+static uint8_t leaf_channel = CONFIG_MESH_CHANNEL;
+
+// Next history row to send, only touched by the mesh task
+static uint32_t leaf_cursor;
+
+// Next row the gateway expects, from the last acknowledgement
+static atomic_uint leaf_acked_seq;
+
+static struct {
+	mesh_frame_header_t header;
+	sensor_history_row_t rows[MESH_FRAME_MAX_ROWS];
+} __attribute__((packed)) leaf_frame;
+
+static metrics_counter_t mesh_leaf_frames = METRICS_COUNTER("mesh_leaf_frames_total", "Frames sent to the gateway", "result=\"acked\"");
+static metrics_counter_t mesh_leaf_frames_unacked = METRICS_COUNTER("mesh_leaf_frames_total", "Frames sent to the gateway", "result=\"unacked\"");
+static metrics_counter_t mesh_leaf_rows_dropped = METRICS_COUNTER("mesh_leaf_rows_dropped_total", "Rows not sent, overwritten in the history or restored at boot", NULL);
+static metrics_gauge_t mesh_leaf_radio_ms = METRICS_GAUGE("mesh_leaf_radio_on_ms", "Radio on time of the last send cycle", NULL);
+
+/*
+* ESP-NOW receive callback, runs in the Wi-Fi task. Acknowledgements are broadcast, only the
+* ones addressed to this leaf and boot count
+*/
+static void mesh_leaf_recv_cb(const esp_now_recv_info_t *info, const uint8_t *data, int len)
+{
+	const mesh_frame_header_t *h = (const mesh_frame_header_t *)data;
+
+	if (!mesh_frame_valid(data, len, MESH_FRAME_ACK) || h->boot_id != leaf_boot_id ||
+		memcmp(h->leaf, leaf_mac, sizeof(leaf_mac)) != 0)
+	{
+		return;
+	}
+	atomic_store(&leaf_acked_seq, h->seq);
+	xTaskNotifyGive(mesh_leaf_task_handle);
+}
+
+// Sends one frame from the cursor and waits for the acknowledgement
+static bool mesh_leaf_send_frame(uint32_t head)
+{
+	uint32_t first = leaf_cursor;
+	uint8_t count = 0;
+
+	// Rows overwritten in the meantime are skipped, the numbering tells the gateway
+	while (first + count < head && count < MESH_FRAME_MAX_ROWS)
+	{
+		if (sensor_history_read(first + count, &leaf_frame.rows[count]))
+		{
+			count++;
+		}
+		else if (count == 0)
+		{
+			first++;
+			metrics_counter_inc(&mesh_leaf_rows_dropped);
+		}
+		else
+		{
+			break;
+		}
+	}
+	leaf_cursor = first;
+	if (count == 0)
+	{
+		return true;
+	}
+
+	leaf_frame.header.count = count;
+	leaf_frame.header.seq = first;
+	leaf_frame.header.time = (uint32_t)time(NULL);
+
+	ulTaskNotifyTake(pdTRUE, 0);
+	if (esp_now_send(mesh_broadcast, (const uint8_t *)&leaf_frame,
+			sizeof(leaf_frame.header) + count * sizeof(sensor_history_row_t)) != ESP_OK)
+	{
+		return false;
+	}
+
+	TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(MESH_LEAF_ACK_TIMEOUT_MS) + 1;
+	for (;;)
+	{
+		TickType_t now = xTaskGetTickCount();
+		if ((int32_t)(deadline - now) <= 0 || ulTaskNotifyTake(pdTRUE, deadline - now) == 0)
+		{
+			metrics_counter_inc(&mesh_leaf_frames_unacked);
+			return false;
+		}
+
+		// A later ack than the rows sent would be from a gateway that lost its table
+		uint32_t acked = atomic_load(&leaf_acked_seq);
+		if ((int32_t)(acked - first) > 0 && (int32_t)(acked - (first + count)) <= 0)
+		{
+			leaf_cursor = acked;
+			metrics_counter_inc(&mesh_leaf_frames);
+			return true;
+		}
+	}
+}
+
+/*
+* One send cycle: radio on, everything from the cursor, radio off. Without an answer on the
+* current channel the other channels are tried in turn, the gateway follows its access point
+*/
+static void mesh_leaf_cycle(void)
+{
+	uint32_t head = sensor_history_head();
+	uint32_t tail = sensor_history_tail();
+
+	if (leaf_cursor < tail)
+	{
+		metrics_counter_add(&mesh_leaf_rows_dropped, tail - leaf_cursor);
+		leaf_cursor = tail;
+	}
+	if (leaf_cursor >= head)
+	{
+		return;
+	}
+
+	int64_t start = esp_timer_get_time();
+	if (esp_wifi_start() != ESP_OK || esp_now_init() != ESP_OK)
+	{
+		ESP_LOGE(TAG, "Radio did not start");
+		esp_wifi_stop();
+		return;
+	}
+	esp_now_register_recv_cb(&mesh_leaf_recv_cb);
+
+	for (int scanned = 0; scanned < MESH_CHANNEL_COUNT && leaf_cursor < head; scanned++)
+	{
+		int failures = 0;
+
+		esp_wifi_set_channel(leaf_channel, WIFI_SECOND_CHAN_NONE);
+		esp_now_del_peer(mesh_broadcast);
+		mesh_add_broadcast_peer(leaf_channel, WIFI_IF_STA);
+
+		while (leaf_cursor < head && failures < MESH_LEAF_MAX_TRIES)
+		{
+			failures = mesh_leaf_send_frame(head) ? 0 : failures + 1;
+		}
+		if (failures < MESH_LEAF_MAX_TRIES)
+		{
+			break;
+		}
+
+		uint8_t next = leaf_channel % MESH_CHANNEL_COUNT + 1;
+		ESP_LOGW(TAG, "No gateway on channel %u, trying %u", leaf_channel, next);
+		leaf_channel = next;
+	}
+
+	esp_now_deinit();
+	esp_wifi_stop();
+	metrics_gauge_set(&mesh_leaf_radio_ms, (uint32_t)((esp_timer_get_time() - start) / 1000));
+}
+
+static void mesh_leaf_task(void *pvParameters)
+{
+	for (;;)
+	{
+		mesh_leaf_cycle();
+		vTaskDelay(pdMS_TO_TICKS(CONFIG_MESH_SEND_INTERVAL_S * 1000));
+	}
+}
+
+esp_err_t mesh_leaf_start(void)
+{
+	if (mesh_leaf_task_handle != NULL)
+	{
+		return ESP_OK;
+	}
+
+	// ESP-NOW only, no netif, no association and no soft AP
+	ESP_ERROR_CHECK(esp_event_loop_create_default());
+	wifi_init_config_t config = WIFI_INIT_CONFIG_DEFAULT();
+	ESP_ERROR_CHECK(esp_wifi_init(&config));
+	ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
+	ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+	ESP_ERROR_CHECK(esp_read_mac(leaf_mac, ESP_MAC_WIFI_STA));
+
+	metrics_register_counter(&mesh_leaf_frames);
+	metrics_register_counter(&mesh_leaf_frames_unacked);
+	metrics_register_counter(&mesh_leaf_rows_dropped);
+	metrics_register_gauge(&mesh_leaf_radio_ms);
+
+	/*
+	* Rows restored from the sample log are not sent again. The history numbering starts over every
+	* boot, so there is no cursor to resume from and which of them the gateway acknowledged before
+	* the reboot is unknown. All of them count as dropped
+	*/
+	leaf_boot_id = esp_random();
+	leaf_cursor = sensor_history_head();
+	metrics_counter_add(&mesh_leaf_rows_dropped, leaf_cursor - sensor_history_tail());
+	mesh_frame_init(&leaf_frame.header, MESH_FRAME_SAMPLES);
+	leaf_frame.header.boot_id = leaf_boot_id;
+
+	if (xTaskCreatePinnedToCore(&mesh_leaf_task, "mesh", MESH_TASK_STACK_SIZE, NULL,
+								MESH_TASK_PRIORITY, &mesh_leaf_task_handle, MESH_TASK_CORE_ID) != pdPASS)
+	{
+		ESP_LOGE(TAG, "Failed to create the task");
+		return ESP_ERR_NO_MEM;
+	}
+
+	ESP_LOGI(TAG, "Leaf %02x%02x%02x%02x%02x%02x of network %08"PRIx32", sending every %d s from channel %d",
+		leaf_mac[0], leaf_mac[1], leaf_mac[2], leaf_mac[3], leaf_mac[4], leaf_mac[5],
+		(uint32_t)CONFIG_MESH_NETWORK_ID, CONFIG_MESH_SEND_INTERVAL_S, CONFIG_MESH_CHANNEL);
+	return ESP_OK;
+}
+
+#endif /* CONFIG_MESH_ROLE_LEAF */
+
+#endif /* CONFIG_MESH_ROLE_GATEWAY || CONFIG_MESH_ROLE_LEAF */
@@ -0,0 +1,116 @@
+/*
+ * mesh.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef MAIN_MESH_H_
+#define MAIN_MESH_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include "sensor_history.h"
+
+#define MESH_FRAME_MAGIC            0xA5
+#define MESH_FRAME_VERSION          1
+
+// Frame types
+#define MESH_FRAME_SAMPLES          1       // leaf to gateway, history rows
+#define MESH_FRAME_ACK              2       // gateway to leaf, broadcast
+
+// ESP-NOW payload limit and the rows that fit behind the header
+#define MESH_FRAME_MAX_SIZE         250
+#define MESH_FRAME_MAX_ROWS         ((MESH_FRAME_MAX_SIZE - sizeof(mesh_frame_header_t)) / sizeof(sensor_history_row_t))
+
+// Listeners told about the rows received from the leaves
+#define MESH_MAX_LISTENERS          2
+
+/*
+* Frame header, little endian. Leaves send consecutive rows of their own history, acknowledged
+* by the gateway with the next row it expects. Frames are neither encrypted nor authenticated,
+* network_id only keeps neighbouring installations apart
+*/
+typedef struct __attribute__((packed)) {
+    uint8_t magic;              // MESH_FRAME_MAGIC
+    uint8_t version;            // MESH_FRAME_VERSION
+    uint8_t type;               // MESH_FRAME_*
+    uint8_t count;              // rows following the header
+    uint32_t network_id;        // CONFIG_MESH_NETWORK_ID
+    uint32_t boot_id;           // random per leaf boot, the row numbers restart with it
+    uint32_t seq;               // samples: number of the first row, ack: next row expected
+    uint32_t time;              // samples: time() on the leaf when sent, ack: unused
+    uint8_t leaf[6];            // ack: station MAC of the leaf addressed, samples: unused
+} mesh_frame_header_t;
+
+#if CONFIG_MESH_ROLE_GATEWAY
+
+// Leaves tracked by the gateway and rows kept for /nodeHistory.json
+#define MESH_MAX_NODES              CONFIG_MESH_MAX_NODES
+#define MESH_HISTORY_CAPACITY       CONFIG_MESH_GATEWAY_HISTORY_ROWS
+
+// Buffer size that fits mesh_gateway_format_nodes_json() for a full table
+#define MESH_NODES_JSON_SIZE        (16 + MESH_MAX_NODES * 256)
+
+// One leaf row in the gateway ring
+typedef struct {
+    uint8_t node;               // index in the node table
+    uint32_t seq;               // row number on the leaf
+    sensor_history_row_t row;
+} mesh_row_t;
+
+/*
+* Called with every run of new rows from one leaf, in the mesh task. Must be short
+*/
+typedef void (*mesh_rows_listener_t)(const uint8_t leaf[6], uint32_t first_seq, const sensor_history_row_t *rows, size_t count, void *arg);
+
+/*
+* Registers a listener, during start up
+@return false if the listener table is full
+*/
+bool mesh_gateway_add_listener(mesh_rows_listener_t listener, void *arg);
+
+/*
+* Receives leaf frames next to the gateway's own Wi-Fi, call once Wi-Fi has started
+@return ESP_OK if ESP-NOW and the mesh task run
+*/
+esp_err_t mesh_gateway_start(void);
+
+/*
+* Writes {"nodes":[...]} with the latest row, signal and counters of every leaf heard of
+@return length written, or 0 if the buffer is too small
+*/
+size_t mesh_gateway_format_nodes_json(char *buf, size_t size);
+
+/*
+* Index of a leaf in the node table
+@return index, -1 if the leaf is unknown
+*/
+int mesh_gateway_find_node(const uint8_t leaf[6]);
+
+/*
+* Copies one row of the gateway ring, see sensor_history_read() for the numbering
+@return false if the row is not in the ring (anymore)
+*/
+bool mesh_gateway_read_row(uint32_t seq, mesh_row_t *row);
+uint32_t mesh_gateway_head(void);
+uint32_t mesh_gateway_tail(void);
+
+#endif /* CONFIG_MESH_ROLE_GATEWAY */
+
+#if CONFIG_MESH_ROLE_LEAF
+
+/*
+* Brings up Wi-Fi for ESP-NOW only and starts the mesh task. Every CONFIG_MESH_SEND_INTERVAL_S
+* the radio comes on, the history rows not acknowledged yet go to the gateway and the radio is
+* switched off again. The gateway's channel is searched for when it stops answering
+@return ESP_OK if the mesh task runs
+*/
+esp_err_t mesh_leaf_start(void);
+
+#endif /* CONFIG_MESH_ROLE_LEAF */
+
+#endif /* MAIN_MESH_H_ */
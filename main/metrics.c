@@ -0,0 +1,369 @@
+/*
+ * metrics.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "sdkconfig.h"
+#include "metrics.h"
+
+// Output is staged here and handed to the sink whenever the next line does not fit
+#define METRICS_WRITE_BUFFER_SIZE	384
+
+/*
+* Registered metrics, appended at the tail so the output order is the registration order.
+* The lock only guards the appends, a walk started from the head never sees a half linked entry
+*/
+static metrics_counter_t *counters = NULL;
+static metrics_counter_t **counters_tail = &counters;
+static metrics_gauge_t *gauges = NULL;
+static metrics_gauge_t **gauges_tail = &gauges;
+static metrics_histogram_t *histograms = NULL;
+static metrics_histogram_t **histograms_tail = &histograms;
+static portMUX_TYPE metrics_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void metrics_register_counter(metrics_counter_t *counter)
+{
+	taskENTER_CRITICAL(&metrics_lock);
+	if (!counter->registered)
+	{
+		counter->registered = true;
+		counter->next = NULL;
+		*counters_tail = counter;
+		counters_tail = &counter->next;
+	}
+	taskEXIT_CRITICAL(&metrics_lock);
+}
+
+void metrics_register_gauge(metrics_gauge_t *gauge)
+{
+	taskENTER_CRITICAL(&metrics_lock);
+	if (!gauge->registered)
+	{
+		gauge->registered = true;
+		gauge->next = NULL;
+		*gauges_tail = gauge;
+		gauges_tail = &gauge->next;
+	}
+	taskEXIT_CRITICAL(&metrics_lock);
+}
+
+void metrics_register_histogram(metrics_histogram_t *histogram)
+{
+	if (histogram->bound_count > METRICS_MAX_BOUNDS)
+	{
+		histogram->bound_count = METRICS_MAX_BOUNDS;
+	}
+
+	taskENTER_CRITICAL(&metrics_lock);
+	if (!histogram->registered)
+	{
+		histogram->registered = true;
+		histogram->next = NULL;
+		*histograms_tail = histogram;
+		histograms_tail = &histogram->next;
+	}
+	taskEXIT_CRITICAL(&metrics_lock);
+}
+
+void metrics_histogram_observe(metrics_histogram_t *histogram, uint32_t value_us)
+{
+	int core = xPortGetCoreID();
+	uint8_t bucket = 0;
+
+	// Bounds are few and short, a linear scan beats a binary search here
+	while (bucket < histogram->bound_count && value_us > histogram->bounds_us[bucket])
+	{
+		bucket++;
+	}
+	atomic_fetch_add_explicit(&histogram->buckets[core][bucket], 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&histogram->sum_us[core], value_us, memory_order_relaxed);
+}
+
+static uint32_t metrics_sum(const atomic_uint *slots, size_t stride)
+{
+	uint32_t sum = 0;
+	for (int core = 0; core < portNUM_PROCESSORS; core++)
+	{
+		sum += atomic_load_explicit(&slots[core * stride], memory_order_relaxed);
+	}
+	return sum;
+}
+
+uint32_t metrics_counter_value(const metrics_counter_t *counter)
+{
+	return metrics_sum(counter->value, 1);
+}
+
+// Buffered output towards the sink
+typedef struct
+{
+	metrics_write_fn_t write;
+	void *ctx;
+	bool ok;
+	size_t len;
+	char buf[METRICS_WRITE_BUFFER_SIZE];
+} metrics_out_t;
+
+static void metrics_flush(metrics_out_t *out)
+{
+	if (out->ok && out->len > 0)
+	{
+		out->ok = out->write(out->buf, out->len, out->ctx);
+	}
+	out->len = 0;
+}
+
+static void metrics_printf(metrics_out_t *out, const char *fmt, ...)
+{
+	va_list args;
+
+	for (int attempt = 0; out->ok && attempt < 2; attempt++)
+	{
+		size_t room = sizeof(out->buf) - out->len;
+		va_start(args, fmt);
+		int n = vsnprintf(out->buf + out->len, room, fmt, args);
+		va_end(args);
+
+		if (n < 0)
+		{
+			return;
+		}
+		if ((size_t)n < room)
+		{
+			out->len += n;
+			return;
+		}
+		// Did not fit, drop the partial line and retry on an empty buffer. Longer lines are cut
+		if (out->len == 0)
+		{
+			out->len = sizeof(out->buf) - 1;
+			return;
+		}
+		metrics_flush(out);
+	}
+}
+
+static void metrics_header(metrics_out_t *out, const char *name, const char *help, const char *type)
+{
+	metrics_printf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// "{labels}" or nothing, extra is appended inside the braces (e.g. the le label of a bucket)
+static void metrics_labels(metrics_out_t *out, const char *labels, const char *extra)
+{
+	bool has_labels = labels != NULL && labels[0] != '\0';
+
+	if (has_labels || extra != NULL)
+	{
+		metrics_printf(out, "{%s%s%s}", has_labels ? labels : "", (has_labels && extra) ? "," : "", extra ? extra : "");
+	}
+}
+
+/*
+* Series of one family may be registered anywhere in the list, the family is written once
+* where its first series is, followed by every series of that name
+*/
+#define METRICS_FIRST_OF_FAMILY(type, head, item) ({ \
+	const type *_p = (head); \
+	while (_p != (item) && strcmp(_p->name, (item)->name) != 0) _p = _p->next; \
+	_p == (item); })
+
+static void metrics_write_counters(metrics_out_t *out)
+{
+	for (const metrics_counter_t *c = counters; c != NULL && out->ok; c = c->next)
+	{
+		if (!METRICS_FIRST_OF_FAMILY(metrics_counter_t, counters, c))
+		{
+			continue;
+		}
+		metrics_header(out, c->name, c->help, "counter");
+		for (const metrics_counter_t *s = c; s != NULL; s = s->next)
+		{
+			if (strcmp(s->name, c->name) == 0)
+			{
+				metrics_printf(out, "%s", s->name);
+				metrics_labels(out, s->labels, NULL);
+				metrics_printf(out, " %"PRIu32"\n", metrics_counter_value(s));
+			}
+		}
+	}
+}
+
+static void metrics_write_gauges(metrics_out_t *out)
+{
+	for (const metrics_gauge_t *g = gauges; g != NULL && out->ok; g = g->next)
+	{
+		if (!METRICS_FIRST_OF_FAMILY(metrics_gauge_t, gauges, g))
+		{
+			continue;
+		}
+		metrics_header(out, g->name, g->help, "gauge");
+		for (const metrics_gauge_t *s = g; s != NULL; s = s->next)
+		{
+			if (strcmp(s->name, g->name) == 0)
+			{
+				metrics_printf(out, "%s", s->name);
+				metrics_labels(out, s->labels, NULL);
+				metrics_printf(out, " %"PRIu32"\n", (uint32_t)atomic_load_explicit(&s->value, memory_order_relaxed));
+			}
+		}
+	}
+}
+
+static void metrics_write_histogram(metrics_out_t *out, const metrics_histogram_t *h)
+{
+	char le[24];
+	uint32_t cumulative = 0;
+
+	for (int b = 0; b <= h->bound_count; b++)
+	{
+		cumulative += metrics_sum(&h->buckets[0][b], METRICS_MAX_BOUNDS + 1);
+		if (b < h->bound_count)
+		{
+			snprintf(le, sizeof(le), "le=\"%g\"", h->bounds_us[b] / 1e6);
+		}
+		else
+		{
+			snprintf(le, sizeof(le), "le=\"+Inf\"");
+		}
+		metrics_printf(out, "%s_bucket", h->name);
+		metrics_labels(out, h->labels, le);
+		metrics_printf(out, " %"PRIu32"\n", cumulative);
+	}
+
+	metrics_printf(out, "%s_sum", h->name);
+	metrics_labels(out, h->labels, NULL);
+	metrics_printf(out, " %.6f\n", metrics_sum(h->sum_us, 1) / 1e6);
+	metrics_printf(out, "%s_count", h->name);
+	metrics_labels(out, h->labels, NULL);
+	metrics_printf(out, " %"PRIu32"\n", cumulative);
+}
+
+static void metrics_write_histograms(metrics_out_t *out)
+{
+	for (const metrics_histogram_t *h = histograms; h != NULL && out->ok; h = h->next)
+	{
+		if (!METRICS_FIRST_OF_FAMILY(metrics_histogram_t, histograms, h))
+		{
+			continue;
+		}
+		metrics_header(out, h->name, h->help, "histogram");
+		for (const metrics_histogram_t *s = h; s != NULL; s = s->next)
+		{
+			if (strcmp(s->name, h->name) == 0)
+			{
+				metrics_write_histogram(out, s);
+			}
+		}
+	}
+}
+
+static void metrics_write_system(metrics_out_t *out)
+{
+	static const struct {
+		const char *label;
+		uint32_t caps;
+	} heaps[] = {
+		{ "caps=\"8bit\"", MALLOC_CAP_8BIT },
+		{ "caps=\"internal\"", MALLOC_CAP_INTERNAL },
+	};
+	const int heap_count = sizeof(heaps) / sizeof(heaps[0]);
+
+	metrics_header(out, "heap_free_bytes", "Free heap", "gauge");
+	for (int i = 0; i < heap_count; i++)
+	{
+		metrics_printf(out, "heap_free_bytes{%s} %u\n", heaps[i].label, (unsigned)heap_caps_get_free_size(heaps[i].caps));
+	}
+	metrics_header(out, "heap_min_free_bytes", "Lowest free heap since boot", "gauge");
+	for (int i = 0; i < heap_count; i++)
+	{
+		metrics_printf(out, "heap_min_free_bytes{%s} %u\n", heaps[i].label, (unsigned)heap_caps_get_minimum_free_size(heaps[i].caps));
+	}
+	metrics_header(out, "heap_largest_free_block_bytes", "Largest allocatable block", "gauge");
+	for (int i = 0; i < heap_count; i++)
+	{
+		metrics_printf(out, "heap_largest_free_block_bytes{%s} %u\n", heaps[i].label, (unsigned)heap_caps_get_largest_free_block(heaps[i].caps));
+	}
+
+	metrics_header(out, "uptime_seconds", "Time since boot", "gauge");
+	metrics_printf(out, "uptime_seconds %.3f\n", esp_timer_get_time() / 1e6);
+
+	// Only while associated, a missing series beats a made up value
+	wifi_ap_record_t ap;
+	if (esp_wifi_sta_get_ap_info(&ap) == ESP_OK)
+	{
+		metrics_header(out, "wifi_rssi_dbm", "Signal strength of the access point", "gauge");
+		metrics_printf(out, "wifi_rssi_dbm %d\n", ap.rssi);
+	}
+}
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+// One snapshot for both task families so the series agree with each other
+static void metrics_write_tasks(metrics_out_t *out)
+{
+	UBaseType_t capacity = uxTaskGetNumberOfTasks() + 2;
+	TaskStatus_t *tasks = malloc(capacity * sizeof(TaskStatus_t));
+	if (tasks == NULL)
+	{
+		return;
+	}
+	UBaseType_t count = uxTaskGetSystemState(tasks, capacity, NULL);
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS && CONFIG_FREERTOS_RUN_TIME_STATS_USING_ESP_TIMER
+	// The run time counter ticks in esp_timer microseconds, rate() of it is the CPU share
+	metrics_header(out, "freertos_task_runtime_seconds_total", "CPU time spent in the task", "counter");
+	for (UBaseType_t i = 0; i < count; i++)
+	{
+		metrics_printf(out, "freertos_task_runtime_seconds_total{task=\"%s\"} %.6f\n",
+			tasks[i].pcTaskName, (uint64_t)tasks[i].ulRunTimeCounter / 1e6);
+	}
+#endif
+
+	metrics_header(out, "freertos_task_stack_min_free_bytes", "Stack high water mark, the least stack the task ever had left", "gauge");
+	for (UBaseType_t i = 0; i < count; i++)
+	{
+		metrics_printf(out, "freertos_task_stack_min_free_bytes{task=\"%s\"} %u\n",
+			tasks[i].pcTaskName, (unsigned)(tasks[i].usStackHighWaterMark * sizeof(StackType_t)));
+	}
+
+	free(tasks);
+}
+#endif
+
+esp_err_t metrics_write(metrics_write_fn_t write, void *ctx)
+{
+	metrics_out_t *out = malloc(sizeof(metrics_out_t));
+	if (out == NULL)
+	{
+		return ESP_ERR_NO_MEM;
+	}
+	out->write = write;
+	out->ctx = ctx;
+	out->ok = true;
+	out->len = 0;
+
+	metrics_write_counters(out);
+	metrics_write_gauges(out);
+	metrics_write_histograms(out);
+	metrics_write_system(out);
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+	metrics_write_tasks(out);
+#endif
+	metrics_flush(out);
+
+	esp_err_t err = out->ok ? ESP_OK : ESP_FAIL;
+	free(out);
+	return err;
+}
@@ -0,0 +1,117 @@
+/*
+ * metrics.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef MAIN_METRICS_H_
+#define MAIN_METRICS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+// Most bucket bounds a histogram may have, the +Inf bucket comes on top
+#define METRICS_MAX_BOUNDS          10
+
+/*
+* Monotonic counter, one slot per core so both cores count without contending for a line.
+* Allocate statically with METRICS_COUNTER() and register once. Series of one family share the
+* name and help text and differ in labels, e.g. "result=\"ok\""
+*/
+typedef struct metrics_counter_s {
+    const char *name;
+    const char *help;
+    const char *labels;         // NULL for none
+    atomic_uint value[portNUM_PROCESSORS];
+    struct metrics_counter_s *next;
+    bool registered;
+} metrics_counter_t;
+
+// Last value wins, for figures that only make sense as a snapshot (e.g. last OTA throughput)
+typedef struct metrics_gauge_s {
+    const char *name;
+    const char *help;
+    const char *labels;
+    atomic_uint value;
+    struct metrics_gauge_s *next;
+    bool registered;
+} metrics_gauge_t;
+
+/*
+* Duration histogram. Observations are in microseconds, the bounds are ascending microsecond
+* values and are exported in seconds. The sum is 32 bit, it wraps after 71 minutes of observed
+* time, which Prometheus treats as a counter reset
+*/
+typedef struct metrics_histogram_s {
+    const char *name;
+    const char *help;
+    const char *labels;
+    const uint32_t *bounds_us;
+    uint8_t bound_count;        // at most METRICS_MAX_BOUNDS
+    atomic_uint buckets[portNUM_PROCESSORS][METRICS_MAX_BOUNDS + 1];
+    atomic_uint sum_us[portNUM_PROCESSORS];
+    struct metrics_histogram_s *next;
+    bool registered;
+} metrics_histogram_t;
+
+#define METRICS_COUNTER(m_name, m_help, m_labels) \
+    { .name = (m_name), .help = (m_help), .labels = (m_labels) }
+#define METRICS_GAUGE(m_name, m_help, m_labels) \
+    { .name = (m_name), .help = (m_help), .labels = (m_labels) }
+#define METRICS_HISTOGRAM(m_name, m_help, m_labels, m_bounds) \
+    { .name = (m_name), .help = (m_help), .labels = (m_labels), \
+      .bounds_us = (m_bounds), .bound_count = sizeof(m_bounds) / sizeof((m_bounds)[0]) }
+
+/*
+* Adds the metric to the /metrics output. Registering twice is harmless, the metric must
+* stay valid for good
+*/
+void metrics_register_counter(metrics_counter_t *counter);
+void metrics_register_gauge(metrics_gauge_t *gauge);
+void metrics_register_histogram(metrics_histogram_t *histogram);
+
+/*
+* Hot path updates, a relaxed atomic add on the slot of the calling core. Safe from any task
+* and from interrupt handlers
+*/
+static inline void metrics_counter_add(metrics_counter_t *counter, uint32_t n)
+{
+    atomic_fetch_add_explicit(&counter->value[xPortGetCoreID()], n, memory_order_relaxed);
+}
+
+static inline void metrics_counter_inc(metrics_counter_t *counter)
+{
+    metrics_counter_add(counter, 1);
+}
+
+static inline void metrics_gauge_set(metrics_gauge_t *gauge, uint32_t value)
+{
+    atomic_store_explicit(&gauge->value, value, memory_order_relaxed);
+}
+
+void metrics_histogram_observe(metrics_histogram_t *histogram, uint32_t value_us);
+
+/*
+* Sum of the per core slots
+*/
+uint32_t metrics_counter_value(const metrics_counter_t *counter);
+
+/*
+* Output sink for metrics_write(), called with at most a few hundred bytes at a time
+@return false to stop the output
+*/
+typedef bool (*metrics_write_fn_t)(const char *data, size_t len, void *ctx);
+
+/*
+* Writes every registered metric plus heap, Wi-Fi RSSI, uptime and per task run time and stack
+* figures in the Prometheus text format (version 0.0.4)
+@return ESP_OK, ESP_FAIL if the sink stopped the output, ESP_ERR_NO_MEM
+*/
+esp_err_t metrics_write(metrics_write_fn_t write, void *ctx);
+
+#endif /* MAIN_METRICS_H_ */
@@ -0,0 +1,917 @@
+/*
+ * ota_update.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "mbedtls/sha256.h"
+#include "rom/miniz.h"
+#include "sdkconfig.h"
+#include "tasks_common.h"
+#include "metrics.h"
+#include "ota_update.h"
+
+static const char TAG[] = "ota_update";
+
+#define OTA_BOUNDARY_MAX_LEN        70          // RFC 2046
+#define OTA_DELIMITER_MAX_LEN       (4 + OTA_BOUNDARY_MAX_LEN)
+#define OTA_IMAGE_MAGIC             0xE9
+#define OTA_IMAGE_HASH_APPENDED_OFS 23          // esp_image_header_t.hash_appended
+#define OTA_DIGEST_LEN              32
+#define OTA_WRITER_TIMEOUT_MS       30000
+
+// gzip framing (RFC 1952), the deflate stream itself is inflated by the ROM's tinfl
+#define OTA_GZIP_ID1                0x1F
+#define OTA_GZIP_ID2                0x8B
+#define OTA_GZIP_CM_DEFLATE         8
+#define OTA_GZIP_HEADER_LEN         10
+#define OTA_GZIP_FHCRC              0x02
+#define OTA_GZIP_FEXTRA             0x04
+#define OTA_GZIP_FNAME              0x08
+#define OTA_GZIP_FCOMMENT           0x10
+
+/*
+* Delta against the running image, made by tools/ota_image.py. All fields little endian
+*   header: "ESPD", version, 3 reserved, source size (u32), SHA-256 of the source bytes
+*   ops:    0x01 COPY src_offset(u32) len(u32) | 0x02 INSERT len(u32) + bytes | 0x00 END
+*/
+#define OTA_DELTA_MAGIC             "ESPD"
+#define OTA_DELTA_VERSION           1
+#define OTA_DELTA_HEADER_LEN        (8 + 4 + OTA_DIGEST_LEN)
+#define OTA_DELTA_OP_END            0x00
+#define OTA_DELTA_OP_COPY           0x01
+#define OTA_DELTA_OP_INSERT         0x02
+#define OTA_DELTA_OP_MAX_LEN        9
+#define OTA_DELTA_COPY_CHUNK        1024
+
+/*
+* Streaming multipart/form-data parser, only the first part (the file) is kept.
+* The delimiter is "\r\n--boundary"; the opening one may lack the CRLF, so parsing starts
+* as if it had just been seen. '\r' only occurs at the start of the delimiter, so after a
+* partial match fails the matched bytes are plain payload and can be replayed from the
+* delimiter itself, no lookbehind buffer is needed across receive buffers
+*/
+typedef enum {
+	MULTIPART_PREAMBLE = 0,
+	MULTIPART_HEADERS,
+	MULTIPART_BODY,
+	MULTIPART_DONE,
+} multipart_state_e;
+
+typedef struct {
+	char delimiter[OTA_DELIMITER_MAX_LEN + 1];
+	size_t delimiter_len;
+	multipart_state_e state;
+	size_t match;
+} multipart_parser_t;
+
+// gzip member parser, states in the order the optional header fields appear
+typedef enum {
+	GZIP_HEADER = 0,
+	GZIP_EXTRA_LEN,
+	GZIP_EXTRA,
+	GZIP_NAME,
+	GZIP_COMMENT,
+	GZIP_HCRC,
+	GZIP_DEFLATE,
+	GZIP_DONE,
+} gzip_state_e;
+
+typedef struct {
+	gzip_state_e state;
+	uint8_t flags;
+	size_t count;
+	size_t extra_len;
+	tinfl_decompressor inflator;
+	size_t dict_ofs;
+	uint8_t dict[TINFL_LZ_DICT_SIZE];           // inflate output doubles as the back reference window
+} gzip_stream_t;
+
+typedef struct {
+	const esp_partition_t *source;
+	uint32_t source_size;
+	uint8_t header[OTA_DELTA_HEADER_LEN];
+	size_t header_len;
+	uint8_t op[OTA_DELTA_OP_MAX_LEN];
+	size_t op_len;
+	size_t op_need;
+	uint32_t insert_left;
+	bool done;
+	uint8_t copy_buf[OTA_DELTA_COPY_CHUNK];
+} delta_stream_t;
+
+typedef struct {
+	uint8_t *data;
+	size_t len;
+} ota_chunk_t;
+
+static struct {
+	bool active;
+	esp_err_t err;
+	const esp_partition_t *partition;
+	esp_ota_handle_t handle;
+	uint8_t *pool;
+	QueueHandle_t free_queue;
+	QueueHandle_t full_queue;
+	SemaphoreHandle_t writer_done;
+
+	bool multipart;
+	multipart_parser_t parser;
+
+	// Payload decoding, both stages are picked from the first byte they see
+	size_t payload_len;
+	size_t decoded_len;
+	gzip_stream_t *gzip;
+	delta_stream_t *delta;
+
+	// Image header bytes seen so far, the appended digest trails the image
+	uint8_t header[OTA_IMAGE_HASH_APPENDED_OFS + 1];
+	size_t image_len;
+	mbedtls_sha256_context image_sha;
+	uint8_t tail[OTA_DIGEST_LEN];
+	size_t tail_len;
+
+	// Whole upload digest, only checked if the client sent one
+	bool check_upload;
+	uint8_t expected_upload[OTA_DIGEST_LEN];
+	mbedtls_sha256_context upload_sha;
+
+	int64_t started_us;
+} ota;
+
+// Upload throughput: bytes off the socket, bytes into flash after decoding, outcome per update
+static metrics_counter_t ota_received_bytes = METRICS_COUNTER("ota_received_bytes_total", "Upload bytes received", NULL);
+static metrics_counter_t ota_written_bytes = METRICS_COUNTER("ota_written_bytes_total", "Image bytes written to flash", NULL);
+static metrics_counter_t ota_updates_ok = METRICS_COUNTER("ota_updates_total", "Finished updates by result", "result=\"ok\"");
+static metrics_counter_t ota_updates_failed = METRICS_COUNTER("ota_updates_total", "Finished updates by result", "result=\"failed\"");
+static metrics_gauge_t ota_last_throughput = METRICS_GAUGE("ota_last_throughput_bytes_per_second", "Image bytes per second of the last good update", NULL);
+
+static bool ota_update_parse_hex(const char *hex, uint8_t *out, size_t len)
+{
+	if (strlen(hex) != len * 2)
+	{
+		return false;
+	}
+	for (size_t i = 0; i < len; i++)
+	{
+		char byte[3] = { hex[2 * i], hex[2 * i + 1], '\0' };
+		if (!isxdigit((unsigned char)byte[0]) || !isxdigit((unsigned char)byte[1]))
+		{
+			return false;
+		}
+		out[i] = (uint8_t)strtoul(byte, NULL, 16);
+	}
+	return true;
+}
+
+// Extracts the boundary parameter of a multipart Content-Type, quoted or not
+static bool ota_update_parse_boundary(const char *content_type, multipart_parser_t *parser)
+{
+	const char *p = strstr(content_type, "boundary=");
+	if (p == NULL)
+	{
+		return false;
+	}
+	p += strlen("boundary=");
+
+	bool quoted = (*p == '"');
+	if (quoted) p++;
+
+	size_t len = 0;
+	while (p[len] != '\0' && (quoted ? p[len] != '"' : (p[len] != ';' && p[len] != ' ')))
+	{
+		len++;
+	}
+	if (len == 0 || len > OTA_BOUNDARY_MAX_LEN)
+	{
+		return false;
+	}
+
+	memcpy(parser->delimiter, "\r\n--", 4);
+	memcpy(parser->delimiter + 4, p, len);
+	parser->delimiter_len = 4 + len;
+	parser->delimiter[parser->delimiter_len] = '\0';
+	parser->state = MULTIPART_PREAMBLE;
+	parser->match = 2;
+	return true;
+}
+
+/*
+* Verifies and flashes one slice of the image. The image digest covers everything but the
+* last 32 bytes, which are only known at the end, so they are held back in a small tail
+*/
+static esp_err_t ota_update_write_image(const uint8_t *data, size_t len)
+{
+	if (len == 0)
+	{
+		return ESP_OK;
+	}
+
+	for (size_t i = 0; ota.image_len + i < sizeof(ota.header) && i < len; i++)
+	{
+		ota.header[ota.image_len + i] = data[i];
+	}
+	if (ota.image_len == 0 && data[0] != OTA_IMAGE_MAGIC)
+	{
+		ESP_LOGE(TAG, "Not an application image (magic 0x%02x)", data[0]);
+		return ESP_ERR_OTA_VALIDATE_FAILED;
+	}
+	ota.image_len += len;
+
+	if (len >= OTA_DIGEST_LEN)
+	{
+		mbedtls_sha256_update(&ota.image_sha, ota.tail, ota.tail_len);
+		mbedtls_sha256_update(&ota.image_sha, data, len - OTA_DIGEST_LEN);
+		memcpy(ota.tail, data + len - OTA_DIGEST_LEN, OTA_DIGEST_LEN);
+		ota.tail_len = OTA_DIGEST_LEN;
+	}
+	else
+	{
+		size_t excess = (ota.tail_len + len > OTA_DIGEST_LEN) ? ota.tail_len + len - OTA_DIGEST_LEN : 0;
+		mbedtls_sha256_update(&ota.image_sha, ota.tail, excess);
+		memmove(ota.tail, ota.tail + excess, ota.tail_len - excess);
+		memcpy(ota.tail + ota.tail_len - excess, data, len);
+		ota.tail_len += len - excess;
+	}
+
+	esp_err_t err = esp_ota_write(ota.handle, data, len);
+	if (err == ESP_OK)
+	{
+		metrics_counter_add(&ota_written_bytes, len);
+	}
+	return err;
+}
+
+static uint32_t ota_update_le32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Checks the delta header and that it was built against the image we are running
+static esp_err_t ota_update_check_delta_source(delta_stream_t *d)
+{
+	uint8_t digest[OTA_DIGEST_LEN];
+
+	if (memcmp(d->header, OTA_DELTA_MAGIC, 4) != 0 || d->header[4] != OTA_DELTA_VERSION)
+	{
+		ESP_LOGE(TAG, "Unsupported delta format");
+		return ESP_ERR_OTA_VALIDATE_FAILED;
+	}
+	d->source_size = ota_update_le32(d->header + 8);
+	if (d->source_size == 0 || d->source_size > d->source->size)
+	{
+		ESP_LOGE(TAG, "Delta source size %"PRIu32" does not fit the running partition", d->source_size);
+		return ESP_ERR_OTA_VALIDATE_FAILED;
+	}
+
+	mbedtls_sha256_context sha;
+	esp_err_t err = ESP_OK;
+	mbedtls_sha256_init(&sha);
+	mbedtls_sha256_starts(&sha, 0);
+	for (uint32_t offset = 0; offset < d->source_size && err == ESP_OK; offset += OTA_DELTA_COPY_CHUNK)
+	{
+		size_t n = MIN(OTA_DELTA_COPY_CHUNK, d->source_size - offset);
+		err = esp_partition_read(d->source, offset, d->copy_buf, n);
+		mbedtls_sha256_update(&sha, d->copy_buf, n);
+	}
+	mbedtls_sha256_finish(&sha, digest);
+	mbedtls_sha256_free(&sha);
+
+	if (err == ESP_OK && memcmp(digest, d->header + 12, OTA_DIGEST_LEN) != 0)
+	{
+		ESP_LOGE(TAG, "Delta was made for a different base image");
+		err = ESP_ERR_OTA_VALIDATE_FAILED;
+	}
+	return err;
+}
+
+static esp_err_t ota_update_run_delta_op(delta_stream_t *d)
+{
+	switch (d->op[0])
+	{
+		case OTA_DELTA_OP_END:
+			d->done = true;
+			return ESP_OK;
+
+		case OTA_DELTA_OP_INSERT:
+			d->insert_left = ota_update_le32(d->op + 1);
+			return ESP_OK;
+
+		case OTA_DELTA_OP_COPY:
+		{
+			uint32_t offset = ota_update_le32(d->op + 1);
+			uint32_t len = ota_update_le32(d->op + 5);
+			esp_err_t err = ESP_OK;
+
+			if (offset > d->source_size || len > d->source_size - offset)
+			{
+				ESP_LOGE(TAG, "Delta copies outside the source image");
+				return ESP_ERR_OTA_VALIDATE_FAILED;
+			}
+			while (len > 0 && err == ESP_OK)
+			{
+				size_t n = MIN(len, OTA_DELTA_COPY_CHUNK);
+				err = esp_partition_read(d->source, offset, d->copy_buf, n);
+				if (err == ESP_OK)
+				{
+					err = ota_update_write_image(d->copy_buf, n);
+				}
+				offset += n;
+				len -= n;
+			}
+			return err;
+		}
+	}
+	ESP_LOGE(TAG, "Unknown delta op 0x%02x", d->op[0]);
+	return ESP_ERR_OTA_VALIDATE_FAILED;
+}
+
+// Applies one slice of a delta, literals go straight through and copies are read from the running partition
+static esp_err_t ota_update_patch(const uint8_t *data, size_t len)
+{
+	delta_stream_t *d = ota.delta;
+	esp_err_t err = ESP_OK;
+
+	while (len > 0 && err == ESP_OK)
+	{
+		size_t n;
+
+		if (d->header_len < OTA_DELTA_HEADER_LEN)
+		{
+			n = MIN(len, OTA_DELTA_HEADER_LEN - d->header_len);
+			memcpy(d->header + d->header_len, data, n);
+			d->header_len += n;
+			if (d->header_len == OTA_DELTA_HEADER_LEN)
+			{
+				err = ota_update_check_delta_source(d);
+			}
+		}
+		else if (d->done)
+		{
+			ESP_LOGE(TAG, "Data after the end of the delta");
+			return ESP_ERR_INVALID_SIZE;
+		}
+		else if (d->insert_left > 0)
+		{
+			n = MIN(len, d->insert_left);
+			err = ota_update_write_image(data, n);
+			d->insert_left -= n;
+		}
+		else
+		{
+			if (d->op_len == 0)
+			{
+				d->op_need = (data[0] == OTA_DELTA_OP_COPY) ? 9 : (data[0] == OTA_DELTA_OP_INSERT) ? 5 : 1;
+			}
+			n = MIN(len, d->op_need - d->op_len);
+			memcpy(d->op + d->op_len, data, n);
+			d->op_len += n;
+			if (d->op_len == d->op_need)
+			{
+				err = ota_update_run_delta_op(d);
+				d->op_len = 0;
+			}
+		}
+		data += n;
+		len -= n;
+	}
+	return err;
+}
+
+// Decoded (or plain) payload: either an image or a delta against the running one
+static esp_err_t ota_update_write_decoded(const uint8_t *data, size_t len)
+{
+	if (len == 0)
+	{
+		return ESP_OK;
+	}
+
+	if (ota.decoded_len == 0 && data[0] == (uint8_t)OTA_DELTA_MAGIC[0])
+	{
+		ota.delta = calloc(1, sizeof(delta_stream_t));
+		if (ota.delta == NULL)
+		{
+			return ESP_ERR_NO_MEM;
+		}
+		ota.delta->source = esp_ota_get_running_partition();
+		ESP_LOGI(TAG, "Delta update against partition at offset 0x%"PRIx32, ota.delta->source->address);
+	}
+	ota.decoded_len += len;
+
+	return ota.delta ? ota_update_patch(data, len) : ota_update_write_image(data, len);
+}
+
+// Next gzip header state, skipping the optional fields the flags leave out
+static gzip_state_e ota_update_gzip_next(uint8_t flags, gzip_state_e state)
+{
+	for (state++; state < GZIP_DEFLATE; state++)
+	{
+		if ((state == GZIP_EXTRA_LEN && (flags & OTA_GZIP_FEXTRA)) ||
+			(state == GZIP_NAME && (flags & OTA_GZIP_FNAME)) ||
+			(state == GZIP_COMMENT && (flags & OTA_GZIP_FCOMMENT)) ||
+			(state == GZIP_HCRC && (flags & OTA_GZIP_FHCRC)))
+		{
+			break;
+		}
+	}
+	return state;
+}
+
+/*
+* Inflates one slice of a gzip upload. The output window is a ring of TINFL_LZ_DICT_SIZE, each
+* run tinfl produces is passed on before the window wraps. The trailer is not checked, the image
+* digest covers the decoded bytes
+*/
+static esp_err_t ota_update_inflate(const uint8_t *data, size_t len)
+{
+	gzip_stream_t *gz = ota.gzip;
+
+	while (len > 0 && gz->state < GZIP_DEFLATE)
+	{
+		uint8_t c = *data++;
+		len--;
+
+		switch (gz->state)
+		{
+			case GZIP_HEADER:
+				if ((gz->count == 1 && c != OTA_GZIP_ID2) || (gz->count == 2 && c != OTA_GZIP_CM_DEFLATE))
+				{
+					ESP_LOGE(TAG, "Not a gzip deflate stream");
+					return ESP_ERR_OTA_VALIDATE_FAILED;
+				}
+				if (gz->count == 3)
+				{
+					gz->flags = c;
+				}
+				if (++gz->count == OTA_GZIP_HEADER_LEN)
+				{
+					gz->count = 0;
+					gz->state = ota_update_gzip_next(gz->flags, GZIP_HEADER);
+				}
+				break;
+
+			case GZIP_EXTRA_LEN:
+				gz->extra_len |= (size_t)c << (8 * gz->count);
+				if (++gz->count == 2)
+				{
+					gz->count = 0;
+					gz->state = (gz->extra_len > 0) ? GZIP_EXTRA : ota_update_gzip_next(gz->flags, GZIP_EXTRA);
+				}
+				break;
+
+			case GZIP_EXTRA:
+				if (--gz->extra_len == 0)
+				{
+					gz->state = ota_update_gzip_next(gz->flags, GZIP_EXTRA);
+				}
+				break;
+
+			case GZIP_NAME:
+			case GZIP_COMMENT:
+				if (c == '\0')
+				{
+					gz->state = ota_update_gzip_next(gz->flags, gz->state);
+				}
+				break;
+
+			case GZIP_HCRC:
+				if (++gz->count == 2)
+				{
+					gz->state = ota_update_gzip_next(gz->flags, GZIP_HCRC);
+				}
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	while (gz->state == GZIP_DEFLATE)
+	{
+		size_t in_bytes = len;
+		size_t out_bytes = TINFL_LZ_DICT_SIZE - gz->dict_ofs;
+		tinfl_status status = tinfl_decompress(&gz->inflator, data, &in_bytes, gz->dict, gz->dict + gz->dict_ofs,
+			&out_bytes, TINFL_FLAG_HAS_MORE_INPUT);
+		data += in_bytes;
+		len -= in_bytes;
+
+		if (out_bytes > 0)
+		{
+			esp_err_t err = ota_update_write_decoded(gz->dict + gz->dict_ofs, out_bytes);
+			if (err != ESP_OK)
+			{
+				return err;
+			}
+			gz->dict_ofs = (gz->dict_ofs + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
+		}
+
+		if (status == TINFL_STATUS_DONE)
+		{
+			gz->state = GZIP_DONE;
+		}
+		else if (status < TINFL_STATUS_DONE)
+		{
+			ESP_LOGE(TAG, "Corrupt deflate stream (%d)", (int)status);
+			return ESP_ERR_OTA_VALIDATE_FAILED;
+		}
+		else if (status == TINFL_STATUS_NEEDS_MORE_INPUT)
+		{
+			break;
+		}
+	}
+	return ESP_OK;
+}
+
+// File payload as uploaded, gzip compressed or not
+static esp_err_t ota_update_write_payload(const uint8_t *data, size_t len)
+{
+	if (len == 0)
+	{
+		return ESP_OK;
+	}
+
+	if (ota.check_upload)
+	{
+		mbedtls_sha256_update(&ota.upload_sha, data, len);
+	}
+
+	if (ota.payload_len == 0 && data[0] == OTA_GZIP_ID1)
+	{
+		ota.gzip = calloc(1, sizeof(gzip_stream_t));
+		if (ota.gzip == NULL)
+		{
+			return ESP_ERR_NO_MEM;
+		}
+		tinfl_init(&ota.gzip->inflator);
+		ESP_LOGI(TAG, "Compressed upload");
+	}
+	ota.payload_len += len;
+
+	return ota.gzip ? ota_update_inflate(data, len) : ota_update_write_decoded(data, len);
+}
+
+// Runs the parser over one receive buffer and writes the file payload it finds
+static esp_err_t ota_update_parse_multipart(const uint8_t *data, size_t len)
+{
+	multipart_parser_t *mp = &ota.parser;
+	size_t run_start = 0;
+	esp_err_t err = ESP_OK;
+
+	for (size_t i = 0; i < len && err == ESP_OK && mp->state != MULTIPART_DONE; i++)
+	{
+		char c = (char)data[i];
+
+		switch (mp->state)
+		{
+			case MULTIPART_PREAMBLE:
+				if (c == mp->delimiter[mp->match])
+				{
+					if (++mp->match == mp->delimiter_len)
+					{
+						mp->state = MULTIPART_HEADERS;
+						mp->match = 0;
+					}
+				}
+				else
+				{
+					mp->match = (c == mp->delimiter[0]) ? 1 : 0;
+				}
+				break;
+
+			case MULTIPART_HEADERS:
+				// Rest of the delimiter line and the part headers end with an empty line
+				if (c == "\r\n\r\n"[mp->match])
+				{
+					if (++mp->match == 4)
+					{
+						mp->state = MULTIPART_BODY;
+						mp->match = 0;
+						run_start = i + 1;
+					}
+				}
+				else
+				{
+					mp->match = (c == '\r') ? 1 : 0;
+				}
+				break;
+
+			case MULTIPART_BODY:
+				if (c == mp->delimiter[mp->match])
+				{
+					if (mp->match == 0)
+					{
+						// Payload up to here is final, flush it before the candidate
+						err = ota_update_write_payload(data + run_start, i - run_start);
+					}
+					if (++mp->match == mp->delimiter_len)
+					{
+						mp->state = MULTIPART_DONE;
+					}
+					run_start = i + 1;
+				}
+				else if (mp->match > 0)
+				{
+					// False alarm, the matched bytes were payload
+					err = ota_update_write_payload((const uint8_t *)mp->delimiter, mp->match);
+					mp->match = 0;
+					if (c == mp->delimiter[0])
+					{
+						mp->match = 1;
+						run_start = i + 1;
+					}
+					else
+					{
+						run_start = i;
+					}
+				}
+				break;
+
+			case MULTIPART_DONE:
+				break;
+		}
+	}
+
+	if (err == ESP_OK && mp->state == MULTIPART_BODY && mp->match == 0 && run_start < len)
+	{
+		err = ota_update_write_payload(data + run_start, len - run_start);
+	}
+	return err;
+}
+
+/*
+* Flash writer task. Erase and write happen here while the HTTP task receives the next buffer
+*/
+static void ota_update_writer_task(void *pvParameters)
+{
+	ota_chunk_t chunk;
+
+	for (;;)
+	{
+		xQueueReceive(ota.full_queue, &chunk, portMAX_DELAY);
+		if (chunk.data == NULL)
+		{
+			break;
+		}
+
+		if (ota.err == ESP_OK && chunk.len > 0)
+		{
+			ota.err = ota.multipart ? ota_update_parse_multipart(chunk.data, chunk.len)
+			                        : ota_update_write_payload(chunk.data, chunk.len);
+			if (ota.err != ESP_OK)
+			{
+				ESP_LOGE(TAG, "Write failed after %u bytes (%s)", (unsigned)ota.image_len, esp_err_to_name(ota.err));
+			}
+		}
+
+		chunk.len = 0;
+		xQueueSend(ota.free_queue, &chunk, portMAX_DELAY);
+	}
+
+	xSemaphoreGive(ota.writer_done);
+	vTaskDelete(NULL);
+}
+
+static void ota_update_release(void)
+{
+	mbedtls_sha256_free(&ota.image_sha);
+	mbedtls_sha256_free(&ota.upload_sha);
+	if (ota.free_queue) vQueueDelete(ota.free_queue);
+	if (ota.full_queue) vQueueDelete(ota.full_queue);
+	if (ota.writer_done) vSemaphoreDelete(ota.writer_done);
+	free(ota.pool);
+	free(ota.gzip);
+	free(ota.delta);
+	ota.gzip = NULL;
+	ota.delta = NULL;
+	ota.free_queue = NULL;
+	ota.full_queue = NULL;
+	ota.writer_done = NULL;
+	ota.pool = NULL;
+	ota.active = false;
+}
+
+// Sends the stop marker and waits until the writer has drained the queue
+static void ota_update_stop_writer(void)
+{
+	ota_chunk_t stop = { .data = NULL, .len = 0 };
+	xQueueSend(ota.full_queue, &stop, portMAX_DELAY);
+	xSemaphoreTake(ota.writer_done, portMAX_DELAY);
+}
+
+esp_err_t ota_update_begin(const char *content_type, const char *expected_sha256)
+{
+	if (ota.active)
+	{
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	metrics_register_counter(&ota_received_bytes);
+	metrics_register_counter(&ota_written_bytes);
+	metrics_register_counter(&ota_updates_ok);
+	metrics_register_counter(&ota_updates_failed);
+	metrics_register_gauge(&ota_last_throughput);
+
+	memset(&ota, 0, sizeof(ota));
+	ota.started_us = esp_timer_get_time();
+	ota.multipart = (content_type != NULL && strncmp(content_type, "multipart/", 10) == 0);
+	if (ota.multipart && !ota_update_parse_boundary(content_type, &ota.parser))
+	{
+		ESP_LOGE(TAG, "No usable multipart boundary in '%s'", content_type);
+		return ESP_ERR_INVALID_ARG;
+	}
+	if (expected_sha256 != NULL)
+	{
+		if (!ota_update_parse_hex(expected_sha256, ota.expected_upload, OTA_DIGEST_LEN))
+		{
+			ESP_LOGE(TAG, "Malformed %s header", OTA_UPDATE_SHA256_HEADER);
+			return ESP_ERR_INVALID_ARG;
+		}
+		ota.check_upload = true;
+	}
+
+	ota.partition = esp_ota_get_next_update_partition(NULL);
+	if (ota.partition == NULL)
+	{
+		return ESP_ERR_NOT_FOUND;
+	}
+
+	ota.pool = malloc(CONFIG_OTA_UPDATE_BUFFER_COUNT * CONFIG_OTA_UPDATE_BUFFER_SIZE);
+	ota.free_queue = xQueueCreate(CONFIG_OTA_UPDATE_BUFFER_COUNT, sizeof(ota_chunk_t));
+	ota.full_queue = xQueueCreate(CONFIG_OTA_UPDATE_BUFFER_COUNT + 1, sizeof(ota_chunk_t));
+	ota.writer_done = xSemaphoreCreateBinary();
+	mbedtls_sha256_init(&ota.image_sha);
+	mbedtls_sha256_init(&ota.upload_sha);
+	ota.active = true;
+
+	if (ota.pool == NULL || ota.free_queue == NULL || ota.full_queue == NULL || ota.writer_done == NULL)
+	{
+		ota_update_release();
+		return ESP_ERR_NO_MEM;
+	}
+
+	for (int i = 0; i < CONFIG_OTA_UPDATE_BUFFER_COUNT; i++)
+	{
+		ota_chunk_t chunk = { .data = ota.pool + i * CONFIG_OTA_UPDATE_BUFFER_SIZE, .len = 0 };
+		xQueueSend(ota.free_queue, &chunk, 0);
+	}
+	mbedtls_sha256_starts(&ota.image_sha, 0);
+	mbedtls_sha256_starts(&ota.upload_sha, 0);
+
+	// Sequential writes erase sector by sector in the writer instead of the whole slot up front
+	esp_err_t err = esp_ota_begin(ota.partition, OTA_WITH_SEQUENTIAL_WRITES, &ota.handle);
+	if (err != ESP_OK)
+	{
+		ESP_LOGE(TAG, "esp_ota_begin failed (%s)", esp_err_to_name(err));
+		ota_update_release();
+		return err;
+	}
+
+	if (xTaskCreatePinnedToCore(&ota_update_writer_task, "ota_writer", OTA_WRITER_TASK_STACK_SIZE, NULL,
+		OTA_WRITER_TASK_PRIORITY, NULL, OTA_WRITER_TASK_CORE_ID) != pdPASS)
+	{
+		esp_ota_abort(ota.handle);
+		ota_update_release();
+		return ESP_ERR_NO_MEM;
+	}
+
+	ESP_LOGI(TAG, "Writing to partition subtype %d at offset 0x%"PRIx32" (%s)",
+		ota.partition->subtype, ota.partition->address, ota.multipart ? "multipart" : "raw");
+	return ESP_OK;
+}
+
+esp_err_t ota_update_acquire(ota_update_buffer_t *buffer)
+{
+	ota_chunk_t chunk;
+
+	if (!ota.active)
+	{
+		return ESP_ERR_INVALID_STATE;
+	}
+	if (ota.err != ESP_OK)
+	{
+		return ota.err;
+	}
+	if (xQueueReceive(ota.free_queue, &chunk, pdMS_TO_TICKS(OTA_WRITER_TIMEOUT_MS)) != pdTRUE)
+	{
+		return ESP_ERR_TIMEOUT;
+	}
+
+	buffer->data = chunk.data;
+	buffer->size = CONFIG_OTA_UPDATE_BUFFER_SIZE;
+	return ESP_OK;
+}
+
+void ota_update_submit(const ota_update_buffer_t *buffer, size_t len)
+{
+	ota_chunk_t chunk = { .data = buffer->data, .len = len };
+	metrics_counter_add(&ota_received_bytes, len);
+	xQueueSend(ota.full_queue, &chunk, portMAX_DELAY);
+}
+
+esp_err_t ota_update_finish(void)
+{
+	uint8_t digest[OTA_DIGEST_LEN];
+
+	if (!ota.active)
+	{
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	ota_update_stop_writer();
+	esp_err_t err = ota.err;
+
+	if (err == ESP_OK && ota.multipart && ota.parser.state != MULTIPART_DONE)
+	{
+		ESP_LOGE(TAG, "Upload ended before the closing boundary");
+		err = ESP_ERR_INVALID_SIZE;
+	}
+	if (err == ESP_OK && ota.gzip != NULL && ota.gzip->state != GZIP_DONE)
+	{
+		ESP_LOGE(TAG, "Compressed stream ended early");
+		err = ESP_ERR_INVALID_SIZE;
+	}
+	if (err == ESP_OK && ota.delta != NULL && !ota.delta->done)
+	{
+		ESP_LOGE(TAG, "Delta ended early");
+		err = ESP_ERR_INVALID_SIZE;
+	}
+	if (err == ESP_OK && ota.image_len <= sizeof(ota.header))
+	{
+		ESP_LOGE(TAG, "Image too short (%u bytes)", (unsigned)ota.image_len);
+		err = ESP_ERR_INVALID_SIZE;
+	}
+	if (err == ESP_OK && ota.header[OTA_IMAGE_HASH_APPENDED_OFS])
+	{
+		mbedtls_sha256_finish(&ota.image_sha, digest);
+		if (ota.tail_len != OTA_DIGEST_LEN || memcmp(digest, ota.tail, OTA_DIGEST_LEN) != 0)
+		{
+			ESP_LOGE(TAG, "Image SHA-256 mismatch, upload truncated or corrupted");
+			err = ESP_ERR_INVALID_CRC;
+		}
+	}
+	if (err == ESP_OK && ota.check_upload)
+	{
+		mbedtls_sha256_finish(&ota.upload_sha, digest);
+		if (memcmp(digest, ota.expected_upload, OTA_DIGEST_LEN) != 0)
+		{
+			ESP_LOGE(TAG, "Upload does not match %s", OTA_UPDATE_SHA256_HEADER);
+			err = ESP_ERR_INVALID_CRC;
+		}
+	}
+
+	if (err == ESP_OK)
+	{
+		err = esp_ota_end(ota.handle);
+		if (err == ESP_OK)
+		{
+			err = esp_ota_set_boot_partition(ota.partition);
+		}
+		if (err == ESP_OK)
+		{
+			int64_t elapsed_us = esp_timer_get_time() - ota.started_us;
+			metrics_gauge_set(&ota_last_throughput, elapsed_us > 0 ? (uint32_t)(ota.image_len * 1000000LL / elapsed_us) : 0);
+			ESP_LOGI(TAG, "%u byte image verified, next boot partition subtype %d at offset 0x%"PRIx32,
+				(unsigned)ota.image_len, ota.partition->subtype, ota.partition->address);
+		}
+		else
+		{
+			ESP_LOGE(TAG, "Image rejected (%s)", esp_err_to_name(err));
+		}
+	}
+	else
+	{
+		esp_ota_abort(ota.handle);
+	}
+
+	metrics_counter_inc(err == ESP_OK ? &ota_updates_ok : &ota_updates_failed);
+	ota_update_release();
+	return err;
+}
+
+void ota_update_abort(void)
+{
+	if (!ota.active)
+	{
+		return;
+	}
+
+	ota_update_stop_writer();
+	esp_ota_abort(ota.handle);
+	metrics_counter_inc(&ota_updates_failed);
+	ota_update_release();
+	ESP_LOGW(TAG, "Update aborted");
+}
@@ -0,0 +1,57 @@
+/*
+ * ota_update.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef MAIN_OTA_UPDATE_H_
+#define MAIN_OTA_UPDATE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// Request header carrying the optional SHA-256 (hex) of the uploaded file
+#define OTA_UPDATE_SHA256_HEADER    "X-OTA-SHA256"
+
+// One receive buffer from the pool
+typedef struct {
+    uint8_t *data;
+    size_t size;
+} ota_update_buffer_t;
+
+/*
+* Starts an update into the next OTA partition and the flash writer task.
+* content_type selects the framing: multipart/form-data (boundary taken from it) or a raw file
+* The file may be an image, a gzip compressed image or a delta against the running image
+* (see tools/ota_image.py), told apart by its first bytes
+* expected_sha256 is the optional hex digest of the uploaded file, NULL to skip
+@return ESP_OK if successful, ESP_ERR_INVALID_STATE if an update is already running
+*/
+esp_err_t ota_update_begin(const char *content_type, const char *expected_sha256);
+
+/*
+* Takes a free receive buffer, waits while the writer still holds all of them
+@return ESP_OK, or the writer's error once flashing has failed
+*/
+esp_err_t ota_update_acquire(ota_update_buffer_t *buffer);
+
+/*
+* Hands len received bytes of an acquired buffer to the writer task, len may be 0
+*/
+void ota_update_submit(const ota_update_buffer_t *buffer, size_t len);
+
+/*
+* Waits for the writer, checks the multipart framing and the digests, then makes the new
+* image bootable
+@return ESP_OK if the image was verified and selected for the next boot
+*/
+esp_err_t ota_update_finish(void);
+
+/*
+* Stops the writer and discards the partially written image
+*/
+void ota_update_abort(void);
+
+#endif /* MAIN_OTA_UPDATE_H_ */
@@ -0,0 +1,267 @@
+/*
+ * periodic_work.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "tasks_common.h"
+#include "periodic_work.h"
+
+static const char TAG[] = "periodic_work";
+
+#define PERIODIC_WORK_WHEEL_MASK    (PERIODIC_WORK_WHEEL_SLOTS - 1)
+
+/*
+* Hashed timer wheel: a job sits in the slot of its expiry tick, jobs further out than one
+* revolution share the slot and are skipped until their tick comes round. Everything below is
+* guarded by wheel_lock, the callbacks run outside of it
+*/
+static periodic_work_job_t *wheel[PERIODIC_WORK_WHEEL_SLOTS];
+static TickType_t wheel_tick = 0;           // next tick to process, once running
+static bool wheel_running = false;
+static periodic_work_job_t *all_jobs = NULL;
+static portMUX_TYPE wheel_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Wakes the task early when a job was armed, task notifications are left to the jobs
+static StaticSemaphore_t wheel_wake_buffer;
+static SemaphoreHandle_t wheel_wake = NULL;
+static TaskHandle_t periodic_work_task_handle = NULL;
+
+// True if tick a is before tick b, across the counter wrap
+static inline bool periodic_work_before(TickType_t a, TickType_t b)
+{
+	return (int32_t)(a - b) < 0;
+}
+
+static void IRAM_ATTR periodic_work_link(periodic_work_job_t *job, TickType_t expiry)
+{
+	if (wheel_running && periodic_work_before(expiry, wheel_tick))
+	{
+		expiry = wheel_tick;
+	}
+	periodic_work_job_t **slot = &wheel[expiry & PERIODIC_WORK_WHEEL_MASK];
+	job->expiry = expiry;
+	job->next = *slot;
+	*slot = job;
+	job->linked = true;
+
+	if (!job->known)
+	{
+		job->known = true;
+		job->all_next = all_jobs;
+		all_jobs = job;
+	}
+}
+
+static void IRAM_ATTR periodic_work_unlink(periodic_work_job_t *job)
+{
+	if (!job->linked)
+	{
+		return;
+	}
+	for (periodic_work_job_t **p = &wheel[job->expiry & PERIODIC_WORK_WHEEL_MASK]; *p != NULL; p = &(*p)->next)
+	{
+		if (*p == job)
+		{
+			*p = job->next;
+			break;
+		}
+	}
+	job->next = NULL;
+	job->linked = false;
+}
+
+static void periodic_work_wake(void)
+{
+	if (wheel_wake != NULL)
+	{
+		xSemaphoreGive(wheel_wake);
+	}
+}
+
+void periodic_work_schedule(periodic_work_job_t *job, uint32_t delay_ms, uint32_t period_ms)
+{
+	TickType_t now = xTaskGetTickCount();
+
+	taskENTER_CRITICAL(&wheel_lock);
+	periodic_work_unlink(job);
+	job->period = period_ms ? periodic_work_ms_to_ticks(period_ms) : 0;
+	if (period_ms && job->period == 0)
+	{
+		job->period = 1;
+	}
+	periodic_work_link(job, now + periodic_work_ms_to_ticks(delay_ms));
+	taskEXIT_CRITICAL(&wheel_lock);
+
+	if (xTaskGetCurrentTaskHandle() != periodic_work_task_handle)
+	{
+		periodic_work_wake();
+	}
+}
+
+void periodic_work_cancel(periodic_work_job_t *job)
+{
+	taskENTER_CRITICAL(&wheel_lock);
+	periodic_work_unlink(job);
+	job->period = 0;
+	taskEXIT_CRITICAL(&wheel_lock);
+}
+
+void IRAM_ATTR periodic_work_trigger_from_isr(periodic_work_job_t *job)
+{
+	BaseType_t high_task_wakeup = pdFALSE;
+
+	taskENTER_CRITICAL_ISR(&wheel_lock);
+	periodic_work_unlink(job);
+	periodic_work_link(job, wheel_running ? wheel_tick : xTaskGetTickCountFromISR());
+	taskEXIT_CRITICAL_ISR(&wheel_lock);
+
+	if (wheel_wake != NULL)
+	{
+		xSemaphoreGiveFromISR(wheel_wake, &high_task_wakeup);
+	}
+	if (high_task_wakeup == pdTRUE)
+	{
+		portYIELD_FROM_ISR();
+	}
+}
+
+void periodic_work_for_each(void (*fn)(const periodic_work_job_t *job, void *arg), void *arg)
+{
+	// Jobs are only ever prepended, a walk started from a snapshot of the head stays valid
+	taskENTER_CRITICAL(&wheel_lock);
+	periodic_work_job_t *job = all_jobs;
+	taskEXIT_CRITICAL(&wheel_lock);
+
+	for (; job != NULL; job = job->all_next)
+	{
+		fn(job, arg);
+	}
+}
+
+static void periodic_work_run(periodic_work_job_t *job)
+{
+	int64_t start = esp_timer_get_time();
+	job->fn(job->arg);
+	uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+
+	job->runs++;
+	if (elapsed > job->max_run_us)
+	{
+		job->max_run_us = elapsed;
+	}
+
+	// Re-arm on the original phase unless the job was rescheduled or cancelled meanwhile
+	TickType_t now = xTaskGetTickCount();
+	taskENTER_CRITICAL(&wheel_lock);
+	if (!job->linked && job->period != 0)
+	{
+		// First multiple of the period that is not in the past, anything before it was missed
+		uint32_t periods = ((TickType_t)(now - job->expiry) + job->period - 1) / job->period;
+		if (periods == 0)
+		{
+			periods = 1;
+		}
+		job->overruns += periods - 1;
+		periodic_work_link(job, job->expiry + periods * job->period);
+	}
+	taskEXIT_CRITICAL(&wheel_lock);
+}
+
+static void periodic_work_task(void *pvParameters)
+{
+	for (;;)
+	{
+		// Process every tick up to now, late wake ups catch up slot by slot
+		while (!periodic_work_before(xTaskGetTickCount(), wheel_tick))
+		{
+			periodic_work_job_t *due = NULL;
+
+			taskENTER_CRITICAL(&wheel_lock);
+			periodic_work_job_t **p = &wheel[wheel_tick & PERIODIC_WORK_WHEEL_MASK];
+			while (*p != NULL)
+			{
+				periodic_work_job_t *job = *p;
+				if (!periodic_work_before(wheel_tick, job->expiry))
+				{
+					*p = job->next;
+					job->next = NULL;
+					job->linked = false;
+					job->due_next = due;
+					due = job;
+				}
+				else
+				{
+					p = &job->next;
+				}
+			}
+			wheel_tick++;
+			taskEXIT_CRITICAL(&wheel_lock);
+
+			while (due != NULL)
+			{
+				periodic_work_job_t *job = due;
+				due = job->due_next;
+				periodic_work_run(job);
+			}
+		}
+
+		// Sleep until the next occupied slot, at most one revolution
+		TickType_t distance = PERIODIC_WORK_WHEEL_SLOTS;
+		taskENTER_CRITICAL(&wheel_lock);
+		for (TickType_t d = 0; d < PERIODIC_WORK_WHEEL_SLOTS; d++)
+		{
+			if (wheel[(wheel_tick + d) & PERIODIC_WORK_WHEEL_MASK] != NULL)
+			{
+				distance = d;
+				break;
+			}
+		}
+		TickType_t target = wheel_tick + distance;
+		taskEXIT_CRITICAL(&wheel_lock);
+
+		TickType_t now = xTaskGetTickCount();
+		if (periodic_work_before(now, target))
+		{
+			xSemaphoreTake(wheel_wake, target - now);
+		}
+	}
+}
+
+esp_err_t periodic_work_start(void)
+{
+	if (periodic_work_task_handle != NULL)
+	{
+		return ESP_OK;
+	}
+
+	taskENTER_CRITICAL(&wheel_lock);
+	wheel_tick = xTaskGetTickCount();
+	// Jobs armed before the start keep their ticks, anything already due runs first
+	for (periodic_work_job_t *job = all_jobs; job != NULL; job = job->all_next)
+	{
+		if (job->linked && periodic_work_before(job->expiry, wheel_tick))
+		{
+			wheel_tick = job->expiry;
+		}
+	}
+	wheel_running = true;
+	taskEXIT_CRITICAL(&wheel_lock);
+
+	wheel_wake = xSemaphoreCreateBinaryStatic(&wheel_wake_buffer);
+	if (xTaskCreatePinnedToCore(&periodic_work_task, "periodic_work", PERIODIC_WORK_TASK_STACK_SIZE, NULL,
+								PERIODIC_WORK_TASK_PRIORITY, &periodic_work_task_handle, PERIODIC_WORK_TASK_CORE_ID) != pdPASS)
+	{
+		ESP_LOGE(TAG, "Failed to create the task");
+		return ESP_ERR_NO_MEM;
+	}
+	return ESP_OK;
+}
@@ -0,0 +1,81 @@
+/*
+ * periodic_work.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef MAIN_PERIODIC_WORK_H_
+#define MAIN_PERIODIC_WORK_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+// Timer wheel slots, one FreeRTOS tick each. Power of two
+#define PERIODIC_WORK_WHEEL_SLOTS   64
+
+typedef void (*periodic_work_fn_t)(void *arg);
+
+/*
+* One job. Allocate statically and initialize with PERIODIC_WORK_JOB(), the scheduler links it
+* into the wheel so no memory is allocated per job. The counters may be read at any time
+*/
+typedef struct periodic_work_job_s {
+    const char *name;
+    periodic_work_fn_t fn;
+    void *arg;
+    uint32_t runs;
+    uint32_t overruns;          // periods skipped because the job or the ones before it ran late
+    uint32_t max_run_us;
+    // Owned by the scheduler
+    struct periodic_work_job_s *next;
+    struct periodic_work_job_s *due_next;
+    struct periodic_work_job_s *all_next;
+    TickType_t expiry;
+    TickType_t period;          // 0 = one shot
+    bool linked;
+    bool known;
+} periodic_work_job_t;
+
+#define PERIODIC_WORK_JOB(job_name, job_fn, job_arg)    { .name = (job_name), .fn = (job_fn), .arg = (job_arg) }
+
+/*
+* Creates the task running every job. Jobs run one at a time and should return quickly, sensor
+* drivers sleeping through a conversion delay the jobs due after them by that much
+@return ESP_OK, or ESP_ERR_NO_MEM if the task could not be created
+*/
+esp_err_t periodic_work_start(void);
+
+/*
+* Runs the job after delay_ms, then every period_ms if it is not 0. Reschedules a job that is
+* already armed. Times are rounded up to whole ticks. Safe from any task, including from a job
+*/
+void periodic_work_schedule(periodic_work_job_t *job, uint32_t delay_ms, uint32_t period_ms);
+
+/*
+* Disarms the job, it is not run again until scheduled. A job that is already due still runs once
+*/
+void periodic_work_cancel(periodic_work_job_t *job);
+
+/*
+* Runs the job on the next tick, keeping its period. Safe from interrupt handlers
+*/
+void periodic_work_trigger_from_isr(periodic_work_job_t *job);
+
+/*
+* Calls fn for every job scheduled so far, e.g. for reports
+*/
+void periodic_work_for_each(void (*fn)(const periodic_work_job_t *job, void *arg), void *arg);
+
+/*
+* Converts milliseconds to scheduler ticks, rounding up
+*/
+static inline TickType_t periodic_work_ms_to_ticks(uint32_t ms)
+{
+    return (TickType_t)((ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+}
+
+#endif /* MAIN_PERIODIC_WORK_H_ */
@@ -0,0 +1,159 @@
+/*
+ * power.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#include <inttypes.h>
+#include <string.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include "sensor_history.h"
+#include "sample_log.h"
+#include "uplink.h"
+#include "wifi_app.h"
+#include "power.h"
+
+static const char TAG[] = "power";
+
+#if CONFIG_POWER_PROFILE_DEEP_SLEEP
+#define POWER_SAMPLE_POLL_MS        10
+#define POWER_MIN_SLEEP_US          (1000 * 1000LL)
+
+// Rows taken since the last flush, kept in RTC slow memory through deep sleep
+static RTC_DATA_ATTR uint32_t rtc_row_count;
+static RTC_DATA_ATTR uint32_t rtc_rows_dropped;
+static RTC_DATA_ATTR sensor_history_row_t rtc_rows[CONFIG_POWER_DEEP_SLEEP_FLUSH_SAMPLES];
+#endif
+
+esp_err_t power_init(void)
+{
+#if CONFIG_PM_ENABLE
+	const esp_pm_config_t pm_config = {
+		.max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+		.min_freq_mhz = CONFIG_XTAL_FREQ,
+		.light_sleep_enable = true,
+	};
+	esp_err_t err = esp_pm_configure(&pm_config);
+	if (err != ESP_OK)
+	{
+		ESP_LOGE(TAG, "Power management not configured (%s)", esp_err_to_name(err));
+		return err;
+	}
+	ESP_LOGI(TAG, "Light sleep between jobs, CPU %d..%d MHz", CONFIG_XTAL_FREQ, CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+#else
+	ESP_LOGD(TAG, "Always on");
+#endif
+	return ESP_OK;
+}
+
+#if CONFIG_POWER_PROFILE_DEEP_SLEEP
+bool power_cycle_timer_wake(void)
+{
+	return esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER;
+}
+
+bool power_cycle_collect(void)
+{
+	int64_t deadline = esp_timer_get_time() + POWER_SAMPLE_TIMEOUT_MS * 1000LL;
+	sensor_history_row_t row;
+
+	while (sensor_history_head() == 0 && esp_timer_get_time() < deadline)
+	{
+		vTaskDelay(pdMS_TO_TICKS(POWER_SAMPLE_POLL_MS));
+	}
+	// A sensor that did not answer leaves its fields unflagged
+	if (sensor_history_head() == 0 && !sensor_history_commit_pending())
+	{
+		ESP_LOGW(TAG, "No sample this wake");
+	}
+	else if (sensor_history_read(0, &row))
+	{
+		// A flush that could not reach the log keeps the newest rows
+		if (rtc_row_count == CONFIG_POWER_DEEP_SLEEP_FLUSH_SAMPLES)
+		{
+			memmove(&rtc_rows[0], &rtc_rows[1], (rtc_row_count - 1) * sizeof(rtc_rows[0]));
+			rtc_row_count--;
+			rtc_rows_dropped++;
+		}
+		rtc_rows[rtc_row_count++] = row;
+	}
+
+	ESP_LOGI(TAG, "Sample %"PRIu32" of %d after %lld ms", rtc_row_count, CONFIG_POWER_DEEP_SLEEP_FLUSH_SAMPLES,
+		(long long)(esp_timer_get_time() / 1000));
+	return rtc_row_count >= CONFIG_POWER_DEEP_SLEEP_FLUSH_SAMPLES;
+}
+
+void power_cycle_store_rows(void)
+{
+	uint32_t stored = 0;
+
+	while (stored < rtc_row_count && sample_log_append(&rtc_rows[stored]))
+	{
+		stored++;
+	}
+	if (stored < rtc_row_count)
+	{
+		ESP_LOGW(TAG, "Sample log took %"PRIu32" of %"PRIu32" rows", stored, rtc_row_count);
+	}
+
+	memmove(&rtc_rows[0], &rtc_rows[stored], (rtc_row_count - stored) * sizeof(rtc_rows[0]));
+	rtc_row_count -= stored;
+	if (rtc_rows_dropped > 0)
+	{
+		ESP_LOGW(TAG, "%"PRIu32" rows dropped while the log was unavailable", rtc_rows_dropped);
+		rtc_rows_dropped = 0;
+	}
+}
+
+void power_cycle_finish(bool timer_wake)
+{
+	uint32_t window_s = timer_wake ? CONFIG_POWER_DEEP_SLEEP_FLUSH_WINDOW_S : CONFIG_POWER_DEEP_SLEEP_AWAKE_S;
+
+#if CONFIG_UPLINK_ENABLED
+	if (timer_wake)
+	{
+		// Nothing else to do once the broker has the rows
+		if (uplink_flush(window_s * 1000) != ESP_OK)
+		{
+			ESP_LOGW(TAG, "Uplink not flushed, rows stay in the sample log");
+		}
+		power_cycle_sleep();
+	}
+#endif
+
+	ESP_LOGI(TAG, "Awake for %"PRIu32" s", window_s);
+	vTaskDelay(pdMS_TO_TICKS(window_s * 1000));
+#if CONFIG_UPLINK_ENABLED
+	uplink_flush(CONFIG_POWER_DEEP_SLEEP_FLUSH_WINDOW_S * 1000);
+#endif
+	power_cycle_sleep();
+}
+
+void power_cycle_sleep(void)
+{
+	int64_t sleep_us = CONFIG_POWER_DEEP_SLEEP_INTERVAL_S * 1000000LL - esp_timer_get_time();
+
+	// Rows still queued for flash would be lost with the RAM
+	sample_log_flush();
+	esp_wifi_stop();
+
+	if (sleep_us < POWER_MIN_SLEEP_US)
+	{
+		sleep_us = POWER_MIN_SLEEP_US;
+	}
+	esp_sleep_enable_timer_wakeup(sleep_us);
+	esp_sleep_enable_ext0_wakeup(WIFI_RESET_BUTTON, 0);
+
+	ESP_LOGI(TAG, "Deep sleep for %lld ms", (long long)(sleep_us / 1000));
+	esp_deep_sleep_start();
+}
+#endif /* CONFIG_POWER_PROFILE_DEEP_SLEEP */
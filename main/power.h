@@ -0,0 +1,59 @@
+/*
+ * power.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef MAIN_POWER_H_
+#define MAIN_POWER_H_
+
+#include <stdbool.h>
+#include "esp_err.h"
+
+// Longest wait for the first history row after a wake from the sleep cycle
+#define POWER_SAMPLE_TIMEOUT_MS     3000
+
+/*
+* Applies the power profile (CONFIG_POWER_PROFILE_*). The low power profiles scale the CPU
+* clock and enter light sleep whenever every task is blocked, the reset button wakes the chip.
+* Wi-Fi modem sleep is set up by wifi_app
+@return ESP_OK if successful
+*/
+esp_err_t power_init(void);
+
+/*
+* Deep sleep cycle (CONFIG_POWER_PROFILE_DEEP_SLEEP). Each timer wake only starts the sensors,
+* keeps the row in RTC memory and sleeps again. Every CONFIG_POWER_DEEP_SLEEP_FLUSH_SAMPLES
+* samples, and after power on, the full firmware comes up to move the rows to the sample log
+* and send them
+*/
+
+/*
+* True if this boot is a timer wake of the sleep cycle
+*/
+bool power_cycle_timer_wake(void);
+
+/*
+* Waits for the history row of this wake and keeps it in RTC memory
+@return true if enough rows piled up to bring up Wi-Fi
+*/
+bool power_cycle_collect(void);
+
+/*
+* Appends the rows kept in RTC memory to the sample log, call once the log runs
+*/
+void power_cycle_store_rows(void);
+
+/*
+* Stays up for the flush window (CONFIG_POWER_DEEP_SLEEP_AWAKE_S after power on), sends the
+* sample log through the uplink when it is enabled, then powers down until the next sample
+*/
+void power_cycle_finish(bool timer_wake);
+
+/*
+* Enters deep sleep until the next sample is due, does not return
+*/
+void power_cycle_sleep(void) __attribute__((noreturn));
+
+#endif /* MAIN_POWER_H_ */
@@ -6,7 +6,7 @@
  */
 #include <stdbool.h>
 #include "driver/ledc.h"
-#include "hal/ledc_types.h"
+#include "hal/ledc_types.h"
 #include "rgb_led.h"
 
 // RGB LED Configuration Array
@@ -14,6 +14,10 @@ ledc_info_t ledc_ch[RGB_LED_CHANNEL_NUM];
 // Handle for rgb_led_pwm_init
 bool g_pwm_init_handle = false;
 
+// Last status color and whether an alert covers it
+static uint8_t g_status_color[3];
+static bool g_alert_active = false;
+
 /*
 	Initializes the RGB LED settings per channel, including
 	the GPIO for each color, mode and timer configuration
@@ -65,7 +69,7 @@ static void rgb_led_pwm_init(void)
 		};
 		ledc_channel_config(&ledc_channel);
 	}
-	bool g_pwm_init_handle = true;
+	g_pwm_init_handle = true;
 }
 
 /*
@@ -83,16 +87,30 @@ static void rgb_led_set_color(uint8_t red, uint8_t green, uint8_t blue)
 	ledc_set_duty(ledc_ch[2].mode, ledc_ch[2].channel, blue);
 	ledc_update_duty(ledc_ch[2].mode, ledc_ch[2].channel);
 }
+
 /*
-	Color to indicate WiFi application has started
+	Sets a status color, shown once no alert is active
 */
-void rgb_led_wifi_app_started(void)
+static void rgb_led_set_status(uint8_t red, uint8_t green, uint8_t blue)
 {
 	if (g_pwm_init_handle == false)
 	{
 	rgb_led_pwm_init();
 	}
-	rgb_led_set_color(255,102,255);
+	g_status_color[0] = red;
+	g_status_color[1] = green;
+	g_status_color[2] = blue;
+	if (!g_alert_active)
+	{
+		rgb_led_set_color(red, green, blue);
+	}
+}
+/*
+	Color to indicate WiFi application has started
+*/
+void rgb_led_wifi_app_started(void)
+{
+	rgb_led_set_status(255,102,255);
 }
 
 
@@ -101,21 +119,33 @@ void rgb_led_wifi_app_started(void)
 */
 void rgb_led_http_server_started(void)
 {
-	if (g_pwm_init_handle == false)
-	{
-	rgb_led_pwm_init();
-	}
-	rgb_led_set_color(204,255,51);
+	rgb_led_set_status(204,255,51);
 }
 
 /*
 	Color to indicate that the ESP32 is connected to an access point
 */
 void rgb_led_wifi_connected(void)
+{
+	rgb_led_set_status(0,255,153);
+}
+
+/*
+	Color to indicate an active alert
+*/
+void rgb_led_alert(bool active)
 {
 	if (g_pwm_init_handle == false)
 	{
 	rgb_led_pwm_init();
 	}
-	rgb_led_set_color(0,255,153);
+	g_alert_active = active;
+	if (active)
+	{
+		rgb_led_set_color(255,0,0);
+	}
+	else
+	{
+		rgb_led_set_color(g_status_color[0], g_status_color[1], g_status_color[2]);
+	}
 }
\ No newline at end of file
@@ -8,6 +8,8 @@
 #ifndef MAIN_RGB_LED_H_
 #define MAIN_RGB_LED_H_
 
+#include <stdbool.h>
+
 // RGB LED GPIOs
 #define RGB_LED_RED_GPIO		21
 #define RGB_LED_GREEN_GPIO		22
@@ -42,4 +44,9 @@ void rgb_led_http_server_started(void);
 */
 void rgb_led_wifi_connected(void);
 
+/*
+	Alert color while an alert is active, the status color comes back once it is cleared
+*/
+void rgb_led_alert(bool active);
+
 #endif /* MAIN_RGB_LED_H_ */
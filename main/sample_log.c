@@ -0,0 +1,429 @@
+/*
+ * sample_log.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include "tasks_common.h"
+#include "sample_log.h"
+#include "metrics.h"
+
+static const char TAG[] = "sample_log";
+
+/*
+* Layout: the partition is a ring of 4 KB sectors. Slot 0 of each sector is a CRC
+* protected header carrying a monotonically increasing sector number and the log
+* sequence number of the sector's first record. Slots 1..255 hold 16 byte records
+* (history row + CRC16) appended in order, so a sector is written front to back and
+* erased only when the ring wraps onto it, which spreads wear evenly.
+*/
+#define SAMPLE_LOG_MAGIC                0x474F4C53      // "SLOG"
+#define SAMPLE_LOG_SECTOR_SIZE          4096
+#define SAMPLE_LOG_RECORD_SIZE          16
+#define SAMPLE_LOG_SLOTS_PER_SECTOR     (SAMPLE_LOG_SECTOR_SIZE / SAMPLE_LOG_RECORD_SIZE)
+#define SAMPLE_LOG_RECORDS_PER_SECTOR   (SAMPLE_LOG_SLOTS_PER_SECTOR - 1)
+#define SAMPLE_LOG_PAGE_SIZE            256
+#define SAMPLE_LOG_RECORDS_PER_PAGE     (SAMPLE_LOG_PAGE_SIZE / SAMPLE_LOG_RECORD_SIZE)
+#define SAMPLE_LOG_QUEUE_LENGTH         32
+#define SAMPLE_LOG_FLUSH_TIMEOUT_MS     1000
+
+typedef struct __attribute__((packed)) {
+	uint32_t magic;
+	uint32_t sector_seq;
+	uint32_t first_record;
+	uint32_t crc;
+} sample_log_header_t;
+
+typedef struct __attribute__((packed)) {
+	sensor_history_row_t row;
+	uint16_t crc;
+} sample_log_record_t;
+
+_Static_assert(sizeof(sample_log_header_t) == SAMPLE_LOG_RECORD_SIZE, "header must fill one slot");
+_Static_assert(sizeof(sample_log_record_t) == SAMPLE_LOG_RECORD_SIZE, "record must fill one slot");
+
+typedef enum {
+	SAMPLE_LOG_MSG_APPEND = 0,
+	SAMPLE_LOG_MSG_FLUSH,
+} sample_log_msg_e;
+
+typedef struct {
+	sample_log_msg_e msgID;
+	sensor_history_row_t row;
+} sample_log_queue_message_t;
+
+static const esp_partition_t *log_partition = NULL;
+static QueueHandle_t sample_log_queue_handle = NULL;
+static SemaphoreHandle_t log_mutex = NULL;
+static SemaphoreHandle_t flush_done = NULL;
+
+// Write position, guarded by log_mutex
+static uint32_t sector_count;
+static uint32_t cur_sector;
+static uint32_t cur_sector_seq;
+static uint32_t cur_first;
+static uint32_t write_slot;
+static uint32_t flushed_slot;
+
+// Newest record and first record of the write sector, republished whenever the write position moves
+// so readers outside log_mutex never see cur_first and write_slot from different sectors
+static atomic_uint published_head;
+static atomic_uint published_first;
+
+// Records not yet on flash, all inside the page being filled
+static sample_log_record_t page_buffer[SAMPLE_LOG_RECORDS_PER_PAGE];
+
+static metrics_counter_t log_appends_queued = METRICS_COUNTER("sample_log_appends_total", "Rows handed to the log writer", "result=\"queued\"");
+static metrics_counter_t log_appends_dropped = METRICS_COUNTER("sample_log_appends_total", "Rows handed to the log writer", "result=\"queue_full\"");
+
+static uint32_t sample_log_header_crc(const sample_log_header_t *header)
+{
+	return esp_rom_crc32_le(0, (const uint8_t *)header, offsetof(sample_log_header_t, crc));
+}
+
+static uint16_t sample_log_record_crc(const sensor_history_row_t *row)
+{
+	return esp_rom_crc16_le(0, (const uint8_t *)row, sizeof(*row));
+}
+
+static size_t sample_log_slot_address(uint32_t sector, uint32_t slot)
+{
+	return sector * SAMPLE_LOG_SECTOR_SIZE + slot * SAMPLE_LOG_RECORD_SIZE;
+}
+
+static bool sample_log_read_header(uint32_t sector, sample_log_header_t *header)
+{
+	if (esp_partition_read(log_partition, sample_log_slot_address(sector, 0), header, sizeof(*header)) != ESP_OK)
+	{
+		return false;
+	}
+	return header->magic == SAMPLE_LOG_MAGIC && header->crc == sample_log_header_crc(header);
+}
+
+static bool sample_log_slot_is_erased(uint32_t sector, uint32_t slot)
+{
+	uint32_t words[SAMPLE_LOG_RECORD_SIZE / sizeof(uint32_t)];
+	if (esp_partition_read(log_partition, sample_log_slot_address(sector, slot), words, sizeof(words)) != ESP_OK)
+	{
+		return false;
+	}
+	for (int i = 0; i < sizeof(words) / sizeof(words[0]); i++)
+	{
+		if (words[i] != 0xFFFFFFFF) return false;
+	}
+	return true;
+}
+
+// Called with log_mutex held after cur_first or write_slot changed
+static void sample_log_publish_locked(void)
+{
+	atomic_store_explicit(&published_first, cur_first, memory_order_relaxed);
+	atomic_store_explicit(&published_head, cur_first + write_slot - 1, memory_order_release);
+}
+
+// Erases a sector and makes it the write sector, called with log_mutex held
+static esp_err_t sample_log_start_sector(uint32_t sector, uint32_t sector_seq, uint32_t first_record)
+{
+	sample_log_header_t header = {
+		.magic = SAMPLE_LOG_MAGIC,
+		.sector_seq = sector_seq,
+		.first_record = first_record,
+	};
+	header.crc = sample_log_header_crc(&header);
+
+	esp_err_t err = esp_partition_erase_range(log_partition, sector * SAMPLE_LOG_SECTOR_SIZE, SAMPLE_LOG_SECTOR_SIZE);
+	if (err == ESP_OK)
+	{
+		err = esp_partition_write(log_partition, sample_log_slot_address(sector, 0), &header, sizeof(header));
+	}
+	if (err != ESP_OK)
+	{
+		ESP_LOGE(TAG, "Failed to start sector %"PRIu32" (%s)", sector, esp_err_to_name(err));
+		return err;
+	}
+
+	cur_sector = sector;
+	cur_sector_seq = sector_seq;
+	cur_first = first_record;
+	write_slot = 1;
+	flushed_slot = 1;
+	sample_log_publish_locked();
+	return ESP_OK;
+}
+
+// Programs the buffered records of the current page, called with log_mutex held
+static esp_err_t sample_log_flush_locked(void)
+{
+	if (flushed_slot == write_slot)
+	{
+		return ESP_OK;
+	}
+
+	uint32_t count = write_slot - flushed_slot;
+	esp_err_t err = esp_partition_write(log_partition, sample_log_slot_address(cur_sector, flushed_slot),
+		&page_buffer[flushed_slot % SAMPLE_LOG_RECORDS_PER_PAGE], count * SAMPLE_LOG_RECORD_SIZE);
+	if (err != ESP_OK)
+	{
+		ESP_LOGE(TAG, "Page write failed (%s)", esp_err_to_name(err));
+		return err;
+	}
+	flushed_slot = write_slot;
+	return ESP_OK;
+}
+
+static void sample_log_append_locked(const sensor_history_row_t *row)
+{
+	sample_log_record_t *record = &page_buffer[write_slot % SAMPLE_LOG_RECORDS_PER_PAGE];
+	record->row = *row;
+	record->crc = sample_log_record_crc(row);
+	write_slot++;
+	sample_log_publish_locked();
+
+	// One flash write per completed page
+	if (write_slot % SAMPLE_LOG_RECORDS_PER_PAGE == 0)
+	{
+		sample_log_flush_locked();
+	}
+	if (write_slot == SAMPLE_LOG_SLOTS_PER_SECTOR)
+	{
+		sample_log_start_sector((cur_sector + 1) % sector_count, cur_sector_seq + 1, cur_first + SAMPLE_LOG_RECORDS_PER_SECTOR);
+	}
+}
+
+/*
+* Recovers the write position: one header read per sector to find the newest one,
+* then a binary search for the first erased slot inside it
+*/
+static esp_err_t sample_log_recover(void)
+{
+	sample_log_header_t header;
+	bool found = false;
+	uint32_t newest = 0, newest_seq = 0, newest_first = 0;
+
+	for (uint32_t s = 0; s < sector_count; s++)
+	{
+		if (!sample_log_read_header(s, &header)) continue;
+		if (!found || (int32_t)(header.sector_seq - newest_seq) > 0)
+		{
+			found = true;
+			newest = s;
+			newest_seq = header.sector_seq;
+			newest_first = header.first_record;
+		}
+	}
+
+	if (!found)
+	{
+		ESP_LOGI(TAG, "No log found, formatting");
+		return sample_log_start_sector(0, 1, 0);
+	}
+
+	uint32_t lo = 1, hi = SAMPLE_LOG_SLOTS_PER_SECTOR;
+	while (lo < hi)
+	{
+		uint32_t mid = (lo + hi) / 2;
+		if (sample_log_slot_is_erased(newest, mid)) hi = mid;
+		else lo = mid + 1;
+	}
+
+	cur_sector = newest;
+	cur_sector_seq = newest_seq;
+	cur_first = newest_first;
+	write_slot = lo;
+	flushed_slot = lo;
+	sample_log_publish_locked();
+
+	if (write_slot == SAMPLE_LOG_SLOTS_PER_SECTOR)
+	{
+		return sample_log_start_sector((cur_sector + 1) % sector_count, cur_sector_seq + 1, cur_first + SAMPLE_LOG_RECORDS_PER_SECTOR);
+	}
+	return ESP_OK;
+}
+
+static void sample_log_task(void *pvParameters)
+{
+	sample_log_queue_message_t msg;
+
+	for (;;)
+	{
+		// Partial pages are also written after a quiet period
+		if (xQueueReceive(sample_log_queue_handle, &msg, pdMS_TO_TICKS(CONFIG_SAMPLE_LOG_FLUSH_INTERVAL_S * 1000)))
+		{
+			xSemaphoreTake(log_mutex, portMAX_DELAY);
+			switch (msg.msgID)
+			{
+				case SAMPLE_LOG_MSG_APPEND:
+					sample_log_append_locked(&msg.row);
+					break;
+
+				case SAMPLE_LOG_MSG_FLUSH:
+					sample_log_flush_locked();
+					xSemaphoreGive(flush_done);
+					break;
+			}
+			xSemaphoreGive(log_mutex);
+		}
+		else
+		{
+			xSemaphoreTake(log_mutex, portMAX_DELAY);
+			sample_log_flush_locked();
+			xSemaphoreGive(log_mutex);
+		}
+	}
+}
+
+esp_err_t sample_log_init(void)
+{
+	log_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, SAMPLE_LOG_PARTITION_SUBTYPE, SAMPLE_LOG_PARTITION_LABEL);
+	if (log_partition == NULL)
+	{
+		ESP_LOGE(TAG, "Partition '%s' not found", SAMPLE_LOG_PARTITION_LABEL);
+		return ESP_ERR_NOT_FOUND;
+	}
+
+	sector_count = log_partition->size / SAMPLE_LOG_SECTOR_SIZE;
+	if (sector_count < 2)
+	{
+		ESP_LOGE(TAG, "Partition too small");
+		return ESP_ERR_INVALID_SIZE;
+	}
+
+	metrics_register_counter(&log_appends_queued);
+	metrics_register_counter(&log_appends_dropped);
+	log_mutex = xSemaphoreCreateMutex();
+	flush_done = xSemaphoreCreateBinary();
+	sample_log_queue_handle = xQueueCreate(SAMPLE_LOG_QUEUE_LENGTH, sizeof(sample_log_queue_message_t));
+
+	esp_err_t err = sample_log_recover();
+	if (err != ESP_OK)
+	{
+		return err;
+	}
+
+	ESP_LOGI(TAG, "Log: %"PRIu32" sectors, next record %"PRIu32" (sector %"PRIu32" slot %"PRIu32")",
+		sector_count, sample_log_head(), cur_sector, write_slot);
+
+	xTaskCreatePinnedToCore(&sample_log_task, "sample_log", SAMPLE_LOG_TASK_STACK_SIZE, NULL, SAMPLE_LOG_TASK_PRIORITY, NULL, SAMPLE_LOG_TASK_CORE_ID);
+	return ESP_OK;
+}
+
+bool sample_log_append(const sensor_history_row_t *row)
+{
+	if (sample_log_queue_handle == NULL)
+	{
+		return false;
+	}
+
+	sample_log_queue_message_t msg = { .msgID = SAMPLE_LOG_MSG_APPEND, .row = *row };
+	bool queued = xQueueSend(sample_log_queue_handle, &msg, 0) == pdTRUE;
+	metrics_counter_inc(queued ? &log_appends_queued : &log_appends_dropped);
+	return queued;
+}
+
+esp_err_t sample_log_flush(void)
+{
+	if (sample_log_queue_handle == NULL)
+	{
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	sample_log_queue_message_t msg = { .msgID = SAMPLE_LOG_MSG_FLUSH };
+	xSemaphoreTake(flush_done, 0);
+	if (xQueueSend(sample_log_queue_handle, &msg, pdMS_TO_TICKS(SAMPLE_LOG_FLUSH_TIMEOUT_MS)) != pdTRUE
+		|| xSemaphoreTake(flush_done, pdMS_TO_TICKS(SAMPLE_LOG_FLUSH_TIMEOUT_MS)) != pdTRUE)
+	{
+		return ESP_ERR_TIMEOUT;
+	}
+	return ESP_OK;
+}
+
+bool sample_log_read(uint32_t seq, sensor_history_row_t *row)
+{
+	sample_log_header_t header;
+	sample_log_record_t record;
+	bool ok = false;
+
+	if (log_mutex == NULL)
+	{
+		return false;
+	}
+
+	xSemaphoreTake(log_mutex, portMAX_DELAY);
+	uint32_t head = cur_first + write_slot - 1;
+	uint32_t back = (seq >= cur_first) ? 0 : (cur_first - seq - 1) / SAMPLE_LOG_RECORDS_PER_SECTOR + 1;
+
+	if (seq < head && back < sector_count)
+	{
+		uint32_t sector = (cur_sector + sector_count - back) % sector_count;
+		uint32_t first = cur_first - back * SAMPLE_LOG_RECORDS_PER_SECTOR;
+		uint32_t slot = seq - first + 1;
+
+		if (back == 0 && slot >= flushed_slot)
+		{
+			// Still waiting in the page buffer
+			record = page_buffer[slot % SAMPLE_LOG_RECORDS_PER_PAGE];
+			ok = true;
+		}
+		else if (sample_log_read_header(sector, &header) && header.first_record == first)
+		{
+			ok = esp_partition_read(log_partition, sample_log_slot_address(sector, slot), &record, sizeof(record)) == ESP_OK;
+		}
+	}
+	xSemaphoreGive(log_mutex);
+
+	if (!ok || record.crc != sample_log_record_crc(&record.row))
+	{
+		return false;
+	}
+	*row = record.row;
+	return true;
+}
+
+uint32_t sample_log_head(void)
+{
+	return atomic_load_explicit(&published_head, memory_order_acquire);
+}
+
+uint32_t sample_log_tail(void)
+{
+	uint32_t span = (sector_count - 1) * SAMPLE_LOG_RECORDS_PER_SECTOR;
+	uint32_t first = atomic_load_explicit(&published_first, memory_order_acquire);
+	return (first > span) ? first - span : 0;
+}
+
+uint32_t sample_log_restore_history(uint32_t max_rows)
+{
+	sensor_history_row_t row;
+	uint32_t restored = 0;
+	uint32_t head = sample_log_head();
+	uint32_t seq = (head > max_rows) ? head - max_rows : 0;
+
+	if (seq < sample_log_tail())
+	{
+		seq = sample_log_tail();
+	}
+
+	for (; seq < head; seq++)
+	{
+		if (sample_log_read(seq, &row))
+		{
+			sensor_history_append(&row);
+			restored++;
+		}
+	}
+
+	ESP_LOGI(TAG, "Restored %"PRIu32" history rows", restored);
+	return restored;
+}
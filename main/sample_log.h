@@ -0,0 +1,61 @@
+/*
+ * sample_log.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef MAIN_SAMPLE_LOG_H_
+#define MAIN_SAMPLE_LOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sensor_history.h"
+
+// Data partition holding the log, see partitions.csv
+#define SAMPLE_LOG_PARTITION_LABEL      "samplelog"
+#define SAMPLE_LOG_PARTITION_SUBTYPE    0x40
+
+/*
+* Finds the newest sector and the write position without scanning the records
+* and starts the log writer task
+@return ESP_OK if successful
+*/
+esp_err_t sample_log_init(void);
+
+/*
+* Queues a history row for the log, never blocks. Rows are written a flash page at a time
+@return false if the log is not running or the queue is full
+*/
+bool sample_log_append(const sensor_history_row_t *row);
+
+/*
+* Writes the rows still held in RAM, used before a planned restart
+@return ESP_OK if the pending rows reached flash
+*/
+esp_err_t sample_log_flush(void);
+
+/*
+* Copies the record with the given log sequence number
+@return false if it is not held by the log or its CRC does not match
+*/
+bool sample_log_read(uint32_t seq, sensor_history_row_t *row);
+
+/*
+* Returns the sequence number the next record will get
+*/
+uint32_t sample_log_head(void);
+
+/*
+* Returns the oldest sequence number the log may still hold
+*/
+uint32_t sample_log_tail(void);
+
+/*
+* Copies the newest rows (up to max_rows) from the log into the history ring
+@return number of rows restored
+*/
+uint32_t sample_log_restore_history(uint32_t max_rows);
+
+#endif /* MAIN_SAMPLE_LOG_H_ */
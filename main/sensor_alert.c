@@ -0,0 +1,383 @@
+/*
+ * sensor_alert.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "app_nvs.h"
+#include "bmp180.h"
+#include "metrics.h"
+#include "rgb_led.h"
+#include "sensor_filter.h"
+#include "sensor_store.h"
+#include "sntp_time_sync.h"
+#include "sensor_alert.h"
+
+static const char TAG[] = "sensor_alert";
+
+static const char *const metric_names[SENSOR_ALERT_METRIC_COUNT] = {
+	"temperature", "humidity", "pressure", "dew_point",
+};
+
+static const char *const kind_names[SENSOR_ALERT_KIND_COUNT] = {
+	"off", "above", "below", "rise", "drop",
+};
+
+// Rule table, written by the HTTP handler and copied by the evaluator under rules_lock
+static portMUX_TYPE rules_lock = portMUX_INITIALIZER_UNLOCKED;
+static sensor_alert_rule_t rules[SENSOR_ALERT_MAX_RULES];
+static uint8_t rules_generation[SENSOR_ALERT_MAX_RULES];	// bumped on every change, restarts the evaluation
+static atomic_bool rule_active[SENSOR_ALERT_MAX_RULES];
+
+// Evaluation state, only touched by the periodic work task
+typedef struct {
+	uint8_t generation;
+	uint8_t count;							// rate samples held
+	uint8_t next;
+	float value[SENSOR_ALERT_RATE_SLOTS];
+	int64_t time_us[SENSOR_ALERT_RATE_SLOTS];
+	sensor_alert_rule_t rule;				// rule and value of the last evaluation, for the cleared event
+	float last_value;						// when the slot is replaced while the alert is active
+} rule_state_t;
+
+static rule_state_t rule_state[SENSOR_ALERT_MAX_RULES];
+static int active_count = 0;
+
+static struct {
+	sensor_alert_listener_t cb;
+	void *arg;
+} listeners[SENSOR_ALERT_MAX_LISTENERS];
+static atomic_int listener_count;
+
+static metrics_counter_t alerts_raised = METRICS_COUNTER("sensor_alerts_total", "Alerts raised by the rule engine", NULL);
+
+int sensor_alert_parse_metric(const char *name)
+{
+	for (int i = 0; i < SENSOR_ALERT_METRIC_COUNT; i++)
+	{
+		if (strcmp(name, metric_names[i]) == 0)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+int sensor_alert_parse_kind(const char *name)
+{
+	for (int i = 0; i < SENSOR_ALERT_KIND_COUNT; i++)
+	{
+		if (strcmp(name, kind_names[i]) == 0)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+static bool sensor_alert_is_rate(uint8_t kind)
+{
+	return kind == SENSOR_ALERT_RISE || kind == SENSOR_ALERT_DROP;
+}
+
+static bool sensor_alert_rule_valid(const sensor_alert_rule_t *rule)
+{
+	if (rule->kind == SENSOR_ALERT_OFF)
+	{
+		return true;
+	}
+	if (rule->kind >= SENSOR_ALERT_KIND_COUNT || rule->metric >= SENSOR_ALERT_METRIC_COUNT ||
+		!isfinite(rule->threshold) || !isfinite(rule->hysteresis) || rule->hysteresis < 0)
+	{
+		return false;
+	}
+	if (sensor_alert_is_rate(rule->kind))
+	{
+		return rule->threshold > 0 && rule->window_s >= SENSOR_ALERT_MIN_WINDOW_S && rule->window_s <= SENSOR_ALERT_MAX_WINDOW_S;
+	}
+	return true;
+}
+
+// Current value of every metric published by source, NAN for the ones not available
+static void sensor_alert_read_metrics(sensor_source_e source, float *values)
+{
+	sensor_snapshot_t snapshot;
+	uint8_t stale;
+
+	for (int i = 0; i < SENSOR_ALERT_METRIC_COUNT; i++)
+	{
+		values[i] = NAN;
+	}
+
+	sensor_store_read(&snapshot);
+	stale = sensor_filter_stale_sources(&snapshot);
+	values[SENSOR_ALERT_TEMPERATURE] = snapshot.temperature;
+	if (source == SENSOR_SOURCE_DHT22 && !(stale & (1 << SENSOR_SOURCE_DHT22)))
+	{
+		values[SENSOR_ALERT_HUMIDITY] = snapshot.dht22.humidity;
+	}
+	if (source == SENSOR_SOURCE_BMP180 && snapshot.bmp180.readings.valid)
+	{
+		values[SENSOR_ALERT_PRESSURE] = snapshot.bmp180.readings.pressure_hPa;
+		values[SENSOR_ALERT_DEW_POINT] = snapshot.bmp180.readings.dew_point;
+	}
+}
+
+/*
+* Change over the rule window. The ring keeps SENSOR_ALERT_RATE_SLOTS samples spread over the
+* window, so each sample costs the same however long the window is
+@return false until the ring spans the window
+*/
+static bool sensor_alert_rate(const sensor_alert_rule_t *rule, rule_state_t *state, float value, int64_t now, float *change)
+{
+	int64_t spacing_us = (int64_t)rule->window_s * 1000000 / SENSOR_ALERT_RATE_SLOTS;
+	int newest = (state->next + SENSOR_ALERT_RATE_SLOTS - 1) % SENSOR_ALERT_RATE_SLOTS;
+
+	if (state->count == 0 || now - state->time_us[newest] >= spacing_us)
+	{
+		state->value[state->next] = value;
+		state->time_us[state->next] = now;
+		state->next = (state->next + 1) % SENSOR_ALERT_RATE_SLOTS;
+		if (state->count < SENSOR_ALERT_RATE_SLOTS)
+		{
+			state->count++;
+		}
+	}
+	if (state->count < SENSOR_ALERT_RATE_SLOTS)
+	{
+		return false;
+	}
+
+	// The oldest sample is between window - spacing and window old, scale to the window
+	int oldest = state->next;
+	int64_t span_us = now - state->time_us[oldest];
+	if (span_us <= 0)
+	{
+		return false;
+	}
+	*change = (value - state->value[oldest]) * (float)((int64_t)rule->window_s * 1000000) / (float)span_us;
+	return true;
+}
+
+static void sensor_alert_notify(int id, const sensor_alert_rule_t *rule, bool active, float value)
+{
+	sensor_alert_event_t event = {
+		.id = id,
+		.rule = *rule,
+		.active = active,
+		.value = value,
+		.time = (uint32_t)time(NULL),
+	};
+
+	ESP_LOGI(TAG, "Rule %d %s %s %.2f: %s (%.2f)", id, metric_names[rule->metric], kind_names[rule->kind],
+		rule->threshold, active ? "raised" : "cleared", value);
+
+	// The LED shows the alert colour while any alert is active
+	active_count += active ? 1 : -1;
+	if (active_count == (active ? 1 : 0))
+	{
+		rgb_led_alert(active);
+	}
+
+	int count = atomic_load_explicit(&listener_count, memory_order_acquire);
+	for (int i = 0; i < count; i++)
+	{
+		listeners[i].cb(&event, listeners[i].arg);
+	}
+}
+
+static void sensor_alert_evaluate(int id, const float *values, int64_t now)
+{
+	sensor_alert_rule_t rule;
+	rule_state_t *state = &rule_state[id];
+	uint8_t generation;
+	float value;
+	float excess;
+
+	taskENTER_CRITICAL(&rules_lock);
+	rule = rules[id];
+	generation = rules_generation[id];
+	taskEXIT_CRITICAL(&rules_lock);
+
+	if (state->generation != generation)
+	{
+		// New rule in the slot, an active alert of the old one is cleared with its last value
+		if (atomic_exchange(&rule_active[id], false))
+		{
+			sensor_alert_notify(id, &state->rule, false, state->last_value);
+		}
+		memset(state, 0, sizeof(*state));
+		state->generation = generation;
+	}
+	if (rule.kind == SENSOR_ALERT_OFF || isnan(values[rule.metric]))
+	{
+		return;
+	}
+
+	value = values[rule.metric];
+	switch (rule.kind)
+	{
+		case SENSOR_ALERT_ABOVE:
+			excess = value - rule.threshold;
+			break;
+		case SENSOR_ALERT_BELOW:
+			excess = rule.threshold - value;
+			break;
+		default:
+			if (!sensor_alert_rate(&rule, state, value, now, &value))
+			{
+				return;
+			}
+			excess = (rule.kind == SENSOR_ALERT_RISE ? value : -value) - rule.threshold;
+			break;
+	}
+	state->rule = rule;
+	state->last_value = value;
+
+	// Raised once past the threshold, cleared once back inside it by the hysteresis
+	bool active = atomic_load(&rule_active[id]);
+	if (!active && excess > 0)
+	{
+		atomic_store(&rule_active[id], true);
+		metrics_counter_inc(&alerts_raised);
+		sensor_alert_notify(id, &rule, true, value);
+	}
+	else if (active && excess < -rule.hysteresis)
+	{
+		atomic_store(&rule_active[id], false);
+		sensor_alert_notify(id, &rule, false, value);
+	}
+}
+
+static void sensor_alert_on_publish(sensor_source_e source, void *arg)
+{
+	float values[SENSOR_ALERT_METRIC_COUNT];
+	int64_t now = sntp_time_sync_monotonic_us();
+	bool any = false;
+
+	for (int i = 0; i < SENSOR_ALERT_MAX_RULES && !any; i++)
+	{
+		any = rules[i].kind != SENSOR_ALERT_OFF || rule_state[i].generation != rules_generation[i];
+	}
+	if (!any)
+	{
+		return;
+	}
+
+	sensor_alert_read_metrics(source, values);
+	for (int i = 0; i < SENSOR_ALERT_MAX_RULES; i++)
+	{
+		sensor_alert_evaluate(i, values, now);
+	}
+}
+
+esp_err_t sensor_alert_init(void)
+{
+	sensor_alert_rule_t saved[SENSOR_ALERT_MAX_RULES];
+
+	if (app_nvs_load_alert_rules(saved, sizeof(saved)))
+	{
+		int count = 0;
+		for (int i = 0; i < SENSOR_ALERT_MAX_RULES; i++)
+		{
+			if (sensor_alert_rule_valid(&saved[i]))
+			{
+				rules[i] = saved[i];
+				count += rules[i].kind != SENSOR_ALERT_OFF;
+			}
+		}
+		ESP_LOGI(TAG, "%d alert rules loaded", count);
+	}
+
+	metrics_register_counter(&alerts_raised);
+	if (!sensor_store_add_listener(&sensor_alert_on_publish, NULL))
+	{
+		ESP_LOGE(TAG, "No free sensor store listener");
+		return ESP_FAIL;
+	}
+	return ESP_OK;
+}
+
+esp_err_t sensor_alert_set_rule(int id, const sensor_alert_rule_t *rule)
+{
+	sensor_alert_rule_t table[SENSOR_ALERT_MAX_RULES];
+
+	if (id < 0 || id >= SENSOR_ALERT_MAX_RULES || !sensor_alert_rule_valid(rule))
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	taskENTER_CRITICAL(&rules_lock);
+	rules[id] = *rule;
+	if (!sensor_alert_is_rate(rule->kind))
+	{
+		rules[id].window_s = 0;
+	}
+	rules_generation[id]++;
+	memcpy(table, rules, sizeof(table));
+	taskEXIT_CRITICAL(&rules_lock);
+
+	return app_nvs_save_alert_rules(table, sizeof(table));
+}
+
+bool sensor_alert_add_listener(sensor_alert_listener_t listener, void *arg)
+{
+	int count = atomic_load_explicit(&listener_count, memory_order_relaxed);
+	if (listener == NULL || count >= SENSOR_ALERT_MAX_LISTENERS)
+	{
+		return false;
+	}
+	listeners[count].cb = listener;
+	listeners[count].arg = arg;
+	atomic_store_explicit(&listener_count, count + 1, memory_order_release);
+	return true;
+}
+
+size_t sensor_alert_format_json(char *buf, size_t size)
+{
+	sensor_alert_rule_t table[SENSOR_ALERT_MAX_RULES];
+	size_t len;
+	bool first = true;
+
+	taskENTER_CRITICAL(&rules_lock);
+	memcpy(table, rules, sizeof(table));
+	taskEXIT_CRITICAL(&rules_lock);
+
+	len = snprintf(buf, size, "{\"rules\":[");
+	for (int i = 0; i < SENSOR_ALERT_MAX_RULES && len < size; i++)
+	{
+		const sensor_alert_rule_t *r = &table[i];
+		if (r->kind == SENSOR_ALERT_OFF)
+		{
+			continue;
+		}
+		len += snprintf(buf + len, size - len,
+			"%s{\"id\":%d,\"metric\":\"%s\",\"kind\":\"%s\",\"threshold\":%.2f,\"hysteresis\":%.2f,\"window_s\":%u,\"active\":%s}",
+			first ? "" : ",", i, metric_names[r->metric], kind_names[r->kind], r->threshold, r->hysteresis,
+			r->window_s, atomic_load(&rule_active[i]) ? "true" : "false");
+		first = false;
+	}
+	if (len < size)
+	{
+		len += snprintf(buf + len, size - len, "]}");
+	}
+	return len < size ? len : 0;
+}
+
+size_t sensor_alert_format_event(const sensor_alert_event_t *event, char *buf, size_t size)
+{
+	int len = snprintf(buf, size,
+		"{\"id\":%u,\"metric\":\"%s\",\"kind\":\"%s\",\"threshold\":%.2f,\"window_s\":%u,\"value\":%.2f,\"active\":%s,\"time\":%"PRIu32"}",
+		event->id, metric_names[event->rule.metric], kind_names[event->rule.kind], event->rule.threshold,
+		event->rule.window_s, event->value, event->active ? "true" : "false", event->time);
+	return (len > 0 && (size_t)len < size) ? (size_t)len : 0;
+}
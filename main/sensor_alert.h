@@ -0,0 +1,113 @@
+/*
+ * sensor_alert.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef MAIN_SENSOR_ALERT_H_
+#define MAIN_SENSOR_ALERT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+// Rule slots, kept in NVS as one blob
+#define SENSOR_ALERT_MAX_RULES          8
+
+// Samples a rate rule keeps, spaced window_s / SENSOR_ALERT_RATE_SLOTS apart
+#define SENSOR_ALERT_RATE_SLOTS         12
+
+// Shortest and longest rate window
+#define SENSOR_ALERT_MIN_WINDOW_S       60
+#define SENSOR_ALERT_MAX_WINDOW_S       (6 * 3600)
+
+// Buffer sizes that fit sensor_alert_format_json() for a full table and one formatted event
+#define SENSOR_ALERT_JSON_SIZE          (16 + SENSOR_ALERT_MAX_RULES * 144)
+#define SENSOR_ALERT_EVENT_JSON_SIZE    160
+
+// Listeners told about every alert raised or cleared
+#define SENSOR_ALERT_MAX_LISTENERS      2
+
+// Metrics a rule can watch and their units
+typedef enum {
+    SENSOR_ALERT_TEMPERATURE = 0,       // C, fused DHT22/BMP180 estimate
+    SENSOR_ALERT_HUMIDITY,              // %RH
+    SENSOR_ALERT_PRESSURE,              // hPa
+    SENSOR_ALERT_DEW_POINT,             // C
+    SENSOR_ALERT_METRIC_COUNT,
+} sensor_alert_metric_e;
+
+typedef enum {
+    SENSOR_ALERT_OFF = 0,               // unused slot
+    SENSOR_ALERT_ABOVE,                 // value > threshold
+    SENSOR_ALERT_BELOW,                 // value < threshold
+    SENSOR_ALERT_RISE,                  // value rose by more than threshold within window_s
+    SENSOR_ALERT_DROP,                  // value fell by more than threshold within window_s
+    SENSOR_ALERT_KIND_COUNT,
+} sensor_alert_kind_e;
+
+// One rule as saved in NVS, e.g. pressure drop 3 hPa over 3600 s or humidity above 80 %RH
+typedef struct {
+    uint8_t kind;                       // sensor_alert_kind_e
+    uint8_t metric;                     // sensor_alert_metric_e
+    uint16_t window_s;                  // rate rules only
+    float threshold;                    // metric units, a positive change for rate rules
+    float hysteresis;                   // the alert clears once the value is this far back inside the threshold
+} sensor_alert_rule_t;
+
+// An alert being raised or cleared
+typedef struct {
+    uint8_t id;                         // rule slot
+    sensor_alert_rule_t rule;
+    bool active;
+    float value;                        // metric value, or the change over the window for rate rules
+    uint32_t time;                      // time()
+} sensor_alert_event_t;
+
+/*
+* Called once per transition, in the periodic work task. Must be short
+*/
+typedef void (*sensor_alert_listener_t)(const sensor_alert_event_t *event, void *arg);
+
+/*
+* Loads the rules from NVS and subscribes to the sensor store, rules are evaluated on every
+* publication. Call before the sensors start
+@return ESP_OK if successful
+*/
+esp_err_t sensor_alert_init(void);
+
+/*
+* Replaces rule slot id and saves the table, the rule starts over without an active alert.
+* A rule of kind SENSOR_ALERT_OFF clears the slot
+@return ESP_OK, ESP_ERR_INVALID_ARG for a bad slot or rule, or the NVS error (the rule is applied anyway)
+*/
+esp_err_t sensor_alert_set_rule(int id, const sensor_alert_rule_t *rule);
+
+/*
+* Registers a listener, during start up
+@return false if the listener table is full
+*/
+bool sensor_alert_add_listener(sensor_alert_listener_t listener, void *arg);
+
+/*
+* Writes {"rules":[...]} with every rule in use and whether its alert is active
+@return length written, or 0 if the buffer is too small
+*/
+size_t sensor_alert_format_json(char *buf, size_t size);
+
+/*
+* Writes one event as a JSON object
+@return length written, or 0 if the buffer is too small
+*/
+size_t sensor_alert_format_event(const sensor_alert_event_t *event, char *buf, size_t size);
+
+/*
+* Names used in the JSON, the HTTP parameters take the same names
+@return metric or kind, -1 for an unknown name
+*/
+int sensor_alert_parse_metric(const char *name);
+int sensor_alert_parse_kind(const char *name);
+
+#endif /* MAIN_SENSOR_ALERT_H_ */
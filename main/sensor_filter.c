@@ -0,0 +1,259 @@
+/*
+ * sensor_filter.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#include <inttypes.h>
+#include <math.h>
+#include <string.h>
+#include "esp_log.h"
+#include "metrics.h"
+#include "sntp_time_sync.h"
+#include "sensor_filter.h"
+
+static const char TAG[] = "sensor_filter";
+
+// MAD to standard deviation for normally distributed noise
+#define SENSOR_FILTER_MAD_SCALE         1.4826f
+
+// Kalman filter: temperature random walk (C^2 per second) and measurement variances (C^2)
+#define SENSOR_FILTER_PROCESS_NOISE     0.0025f
+#define SENSOR_FILTER_DHT22_VARIANCE    0.25f
+#define SENSOR_FILTER_BMP180_VARIANCE   0.04f
+
+// The BMP180 sits on the board and reads warm, its offset to the DHT22 is learned at 2^-6
+#define SENSOR_FILTER_OFFSET_SHIFT      6
+
+// Sensor ranges from the data sheets
+#define DHT22_TEMPERATURE_MIN           -40.0f
+#define DHT22_TEMPERATURE_MAX           80.0f
+#define BMP180_TEMPERATURE_MIN          -40.0f
+#define BMP180_TEMPERATURE_MAX          85.0f
+#define BMP180_PRESSURE_MIN             30000
+#define BMP180_PRESSURE_MAX             110000
+
+/*
+* Hampel filter over a ring of raw samples. The window is a handful of values, sorting a copy
+* costs the same on every sample
+*/
+typedef struct {
+	float window[SENSOR_FILTER_WINDOW];
+	uint8_t count;
+	uint8_t next;
+	float min_scale;			// floor of the scale estimate, keeps quantized readings from all looking like outliers
+} hampel_t;
+
+static hampel_t dht22_temperature = { .min_scale = 0.3f };
+static hampel_t dht22_humidity = { .min_scale = 1.5f };
+static hampel_t bmp180_temperature = { .min_scale = 0.2f };
+static hampel_t bmp180_pressure = { .min_scale = 30.0f };
+
+// Fused temperature, only touched by the periodic work task
+static struct {
+	float estimate;				// C, NAN until the first sample
+	float variance;
+	int64_t updated_us;
+	float bmp180_offset;		// BMP180 minus DHT22
+	bool offset_valid;
+	float dht22_temperature;	// last accepted DHT22 temperature and when
+	int64_t dht22_us;
+} fusion = { .estimate = NAN };
+
+static metrics_counter_t dht22_outliers = METRICS_COUNTER("sensor_filter_rejected_total", "Samples replaced or dropped by the filter stage", "source=\"dht22\",reason=\"outlier\"");
+static metrics_counter_t dht22_implausible = METRICS_COUNTER("sensor_filter_rejected_total", "Samples replaced or dropped by the filter stage", "source=\"dht22\",reason=\"range\"");
+static metrics_counter_t bmp180_outliers = METRICS_COUNTER("sensor_filter_rejected_total", "Samples replaced or dropped by the filter stage", "source=\"bmp180\",reason=\"outlier\"");
+static metrics_counter_t bmp180_implausible = METRICS_COUNTER("sensor_filter_rejected_total", "Samples replaced or dropped by the filter stage", "source=\"bmp180\",reason=\"range\"");
+static metrics_counter_t dht22_published = METRICS_COUNTER("sensor_filter_published_total", "Samples passed on to the sensor store", "source=\"dht22\"");
+static metrics_counter_t bmp180_published = METRICS_COUNTER("sensor_filter_published_total", "Samples passed on to the sensor store", "source=\"bmp180\"");
+
+static void sensor_filter_sort(float *v, int n)
+{
+	for (int i = 1; i < n; i++)
+	{
+		float x = v[i];
+		int j = i - 1;
+		while (j >= 0 && v[j] > x)
+		{
+			v[j + 1] = v[j];
+			j--;
+		}
+		v[j + 1] = x;
+	}
+}
+
+static float sensor_filter_median(float *v, int n)
+{
+	sensor_filter_sort(v, n);
+	return (n & 1) ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2.0f;
+}
+
+/*
+* Adds a sample to the window and replaces it by the window median if it is an outlier.
+* Nothing is rejected until the window is full
+@return true if the value was replaced
+*/
+static bool hampel_apply(hampel_t *h, float *value)
+{
+	float sorted[SENSOR_FILTER_WINDOW];
+	float deviation[SENSOR_FILTER_WINDOW];
+
+	h->window[h->next] = *value;
+	h->next = (h->next + 1) % SENSOR_FILTER_WINDOW;
+	if (h->count < SENSOR_FILTER_WINDOW)
+	{
+		h->count++;
+		return false;
+	}
+
+	memcpy(sorted, h->window, sizeof(sorted));
+	float median = sensor_filter_median(sorted, SENSOR_FILTER_WINDOW);
+	for (int i = 0; i < SENSOR_FILTER_WINDOW; i++)
+	{
+		deviation[i] = fabsf(h->window[i] - median);
+	}
+	float scale = SENSOR_FILTER_MAD_SCALE * sensor_filter_median(deviation, SENSOR_FILTER_WINDOW);
+	if (scale < h->min_scale)
+	{
+		scale = h->min_scale;
+	}
+
+	if (fabsf(*value - median) > CONFIG_SENSOR_FILTER_THRESHOLD * scale)
+	{
+		*value = median;
+		return true;
+	}
+	return false;
+}
+
+// Folds one measurement into the fused temperature
+static void sensor_filter_fuse(float temperature, float variance, int64_t now)
+{
+	if (isnan(fusion.estimate))
+	{
+		fusion.estimate = temperature;
+		fusion.variance = variance;
+	}
+	else
+	{
+		fusion.variance += SENSOR_FILTER_PROCESS_NOISE * (float)(now - fusion.updated_us) / 1e6f;
+		float gain = fusion.variance / (fusion.variance + variance);
+		fusion.estimate += gain * (temperature - fusion.estimate);
+		fusion.variance *= 1.0f - gain;
+	}
+	fusion.updated_us = now;
+}
+
+void sensor_filter_init(void)
+{
+	metrics_register_counter(&dht22_outliers);
+	metrics_register_counter(&dht22_implausible);
+	metrics_register_counter(&bmp180_outliers);
+	metrics_register_counter(&bmp180_implausible);
+	metrics_register_counter(&dht22_published);
+	metrics_register_counter(&bmp180_published);
+}
+
+bool sensor_filter_submit_dht22(float *temperature, float *humidity)
+{
+	int64_t now = sntp_time_sync_monotonic_us();
+
+	if (!(*temperature >= DHT22_TEMPERATURE_MIN && *temperature <= DHT22_TEMPERATURE_MAX &&
+		*humidity >= 0.0f && *humidity <= 100.0f))
+	{
+		ESP_LOGW(TAG, "DHT22 reading out of range: Temp=%0.1f, Humidity=%0.1f", *temperature, *humidity);
+		metrics_counter_inc(&dht22_implausible);
+		return false;
+	}
+
+	bool replaced = hampel_apply(&dht22_temperature, temperature);
+	replaced |= hampel_apply(&dht22_humidity, humidity);
+	if (replaced)
+	{
+		ESP_LOGD(TAG, "DHT22 outlier replaced: Temp=%0.1f, Humidity=%0.1f", *temperature, *humidity);
+		metrics_counter_inc(&dht22_outliers);
+	}
+
+	sensor_filter_fuse(*temperature, SENSOR_FILTER_DHT22_VARIANCE, now);
+	fusion.dht22_temperature = *temperature;
+	fusion.dht22_us = now;
+
+	sensor_store_publish_dht22(*temperature, *humidity, fusion.estimate);
+	metrics_counter_inc(&dht22_published);
+	return true;
+}
+
+void sensor_filter_submit_bmp180(bmp180_readings_t *readings)
+{
+	int64_t now = sntp_time_sync_monotonic_us();
+	sensor_dht22_sample_t dht22;
+
+	if (readings->valid && !(readings->temperature >= BMP180_TEMPERATURE_MIN && readings->temperature <= BMP180_TEMPERATURE_MAX &&
+		readings->pressure >= BMP180_PRESSURE_MIN && readings->pressure <= BMP180_PRESSURE_MAX))
+	{
+		ESP_LOGW(TAG, "BMP180 reading out of range: Temp=%0.1f, Pressure=%"PRIu32, readings->temperature, readings->pressure);
+		metrics_counter_inc(&bmp180_implausible);
+		readings->valid = false;
+	}
+
+	if (readings->valid)
+	{
+		float pressure = (float)readings->pressure;
+		bool replaced = hampel_apply(&bmp180_temperature, &readings->temperature);
+		replaced |= hampel_apply(&bmp180_pressure, &pressure);
+		if (replaced)
+		{
+			metrics_counter_inc(&bmp180_outliers);
+		}
+		readings->pressure = (uint32_t)(pressure + 0.5f);
+		readings->pressure_hPa = pressure / 100.0f;
+
+		// Derived metrics only pair the pressure with a humidity of about the same time
+		sensor_store_read_dht22(&dht22);
+		readings->humidity = NAN;
+		if (dht22.seq != 0 && now - dht22.timestamp_us <= SENSOR_FILTER_MAX_AGE_US)
+		{
+			readings->humidity = dht22.humidity;
+		}
+
+		// The offset is learned while both sensors are current, before that the readings are taken as they are
+		bool dht22_fresh = fusion.dht22_us != 0 && now - fusion.dht22_us <= SENSOR_FILTER_MAX_AGE_US;
+		if (dht22_fresh)
+		{
+			float offset = readings->temperature - fusion.dht22_temperature;
+			if (fusion.offset_valid)
+			{
+				fusion.bmp180_offset += (offset - fusion.bmp180_offset) / (1 << SENSOR_FILTER_OFFSET_SHIFT);
+			}
+			else
+			{
+				fusion.bmp180_offset = offset;
+				fusion.offset_valid = true;
+			}
+		}
+		sensor_filter_fuse(readings->temperature - fusion.bmp180_offset, SENSOR_FILTER_BMP180_VARIANCE, now);
+
+		// Derived once per sample, the store listeners and encoders read them from the stored sample
+		bmp180_derive(readings, BMP180_DERIVE_ALL);
+	}
+
+	sensor_store_publish_bmp180(readings, fusion.estimate);
+	metrics_counter_inc(&bmp180_published);
+}
+
+uint8_t sensor_filter_stale_sources(const sensor_snapshot_t *snapshot)
+{
+	int64_t now = sntp_time_sync_monotonic_us();
+	uint8_t stale = 0;
+
+	if (snapshot->dht22.seq != 0 && now - snapshot->dht22.timestamp_us > SENSOR_FILTER_MAX_AGE_US)
+	{
+		stale |= 1 << SENSOR_SOURCE_DHT22;
+	}
+	if (snapshot->bmp180.seq != 0 && now - snapshot->bmp180.timestamp_us > SENSOR_FILTER_MAX_AGE_US)
+	{
+		stale |= 1 << SENSOR_SOURCE_BMP180;
+	}
+	return stale;
+}
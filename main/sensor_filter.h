@@ -0,0 +1,55 @@
+/*
+ * sensor_filter.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef MAIN_SENSOR_FILTER_H_
+#define MAIN_SENSOR_FILTER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "bmp180.h"
+#include "sensor_store.h"
+
+// Samples in the Hampel window of each filtered value
+#define SENSOR_FILTER_WINDOW        CONFIG_SENSOR_FILTER_WINDOW
+
+// A sample older than this is stale, derived metrics stop using it
+#define SENSOR_FILTER_MAX_AGE_US    ((int64_t)CONFIG_SENSOR_FILTER_MAX_AGE_S * 1000000)
+
+/*
+* Processing stage between the drivers and the sensor store, run in the periodic work task.
+* Every value goes through a Hampel filter over the last SENSOR_FILTER_WINDOW samples: a sample
+* more than CONFIG_SENSOR_FILTER_THRESHOLD scaled MADs away from the window median is replaced
+* by the median. Readings outside the sensor's range are dropped. Accepted DHT22 and BMP180
+* temperatures feed a one state Kalman filter, the fused estimate is published with each sample
+*/
+
+/*
+* Registers the filter metrics, call before the sensors start
+*/
+void sensor_filter_init(void);
+
+/*
+* Filters a DHT22 reading in place and publishes it
+@return false if the reading was dropped, the store keeps the previous sample
+*/
+bool sensor_filter_submit_dht22(float *temperature, float *humidity);
+
+/*
+* Filters a BMP180 reading in place, takes the humidity from the DHT22 sample if it is not stale
+* (NAN otherwise) and publishes it. Readings that are not valid are published as they are,
+* readings out of range are published as not valid
+*/
+void sensor_filter_submit_bmp180(bmp180_readings_t *readings);
+
+/*
+* Sources of the snapshot that have published but not within SENSOR_FILTER_MAX_AGE_US
+@return bit mask of 1 << sensor_source_e
+*/
+uint8_t sensor_filter_stale_sources(const sensor_snapshot_t *snapshot);
+
+#endif /* MAIN_SENSOR_FILTER_H_ */
@@ -0,0 +1,241 @@
+/*
+ * sensor_history.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+#include "sensor_store.h"
+#include "sensor_history.h"
+#include "sample_log.h"
+#include "metrics.h"
+
+static const char TAG[] = "sensor_history";
+
+#if CONFIG_SPIRAM
+#define SENSOR_HISTORY_CAPACITY_PSRAM	CONFIG_SENSOR_HISTORY_PSRAM_CAPACITY
+#endif
+#define SENSOR_HISTORY_CAPACITY_INTERNAL	CONFIG_SENSOR_HISTORY_CAPACITY
+
+// Ring storage, row seq lives in rows[seq % capacity]
+static sensor_history_row_t *rows = NULL;
+static uint32_t capacity = 0;
+static atomic_uint head;
+
+// Row being assembled from the two sensor tasks
+static sensor_history_row_t pending;
+static portMUX_TYPE history_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static metrics_counter_t history_rows = METRICS_COUNTER("sensor_history_rows_total", "Rows committed to the history ring", NULL);
+
+// Writes one row into the ring, called with history_mux held
+static void sensor_history_commit_locked(const sensor_history_row_t *row)
+{
+	uint32_t seq = atomic_load_explicit(&head, memory_order_relaxed);
+	rows[seq % capacity] = *row;
+	atomic_store_explicit(&head, seq + 1, memory_order_release);
+}
+
+/*
+* Store listener: merges the DHT22 and BMP180 publications of one period into a row.
+* A row is committed once both sources reported, or when a source reports again
+* before the other one did (sensor missing or failing)
+*/
+static void sensor_history_on_publish(sensor_source_e source, void *arg)
+{
+	uint8_t flag = (source == SENSOR_SOURCE_DHT22) ? SENSOR_HISTORY_FLAG_DHT22 : SENSOR_HISTORY_FLAG_BMP180;
+	sensor_dht22_sample_t dht;
+	sensor_bmp180_sample_t bmp;
+	uint32_t now = (uint32_t)time(NULL);
+	sensor_history_row_t committed[2];
+	int n_committed = 0;
+
+	if (source == SENSOR_SOURCE_DHT22)
+	{
+		sensor_store_read_dht22(&dht);
+	}
+	else
+	{
+		sensor_store_read_bmp180(&bmp);
+		if (!bmp.readings.valid)
+		{
+			return;
+		}
+	}
+
+	taskENTER_CRITICAL(&history_mux);
+	if (pending.flags & flag)
+	{
+		sensor_history_commit_locked(&pending);
+		committed[n_committed++] = pending;
+		memset(&pending, 0, sizeof(pending));
+	}
+
+	if (source == SENSOR_SOURCE_DHT22)
+	{
+		pending.dht_temperature = sensor_history_encode_centi(dht.temperature);
+		pending.humidity = sensor_history_encode_centi(dht.humidity);
+	}
+	else
+	{
+		pending.bmp_temperature = sensor_history_encode_centi(bmp.readings.temperature);
+		pending.pressure = sensor_history_encode_pressure(bmp.readings.pressure);
+	}
+	pending.timestamp = now;
+	pending.flags |= flag;
+
+	if (pending.flags == (SENSOR_HISTORY_FLAG_DHT22 | SENSOR_HISTORY_FLAG_BMP180))
+	{
+		sensor_history_commit_locked(&pending);
+		committed[n_committed++] = pending;
+		memset(&pending, 0, sizeof(pending));
+	}
+	taskEXIT_CRITICAL(&history_mux);
+
+	// Persist outside the critical section, the log only queues the rows
+	metrics_counter_add(&history_rows, n_committed);
+	for (int i = 0; i < n_committed; i++)
+	{
+		sample_log_append(&committed[i]);
+	}
+}
+
+esp_err_t sensor_history_init(void)
+{
+	if (rows != NULL)
+	{
+		return ESP_OK;
+	}
+
+#if CONFIG_SPIRAM
+	rows = heap_caps_calloc(SENSOR_HISTORY_CAPACITY_PSRAM, sizeof(sensor_history_row_t), MALLOC_CAP_SPIRAM);
+	if (rows != NULL)
+	{
+		capacity = SENSOR_HISTORY_CAPACITY_PSRAM;
+	}
+#endif
+	if (rows == NULL)
+	{
+		rows = heap_caps_calloc(SENSOR_HISTORY_CAPACITY_INTERNAL, sizeof(sensor_history_row_t), MALLOC_CAP_8BIT);
+		capacity = SENSOR_HISTORY_CAPACITY_INTERNAL;
+	}
+	if (rows == NULL)
+	{
+		ESP_LOGE(TAG, "Failed to allocate history ring");
+		capacity = 0;
+		return ESP_ERR_NO_MEM;
+	}
+
+	ESP_LOGI(TAG, "History ring: %"PRIu32" rows, %u bytes", capacity, (unsigned)(capacity * sizeof(sensor_history_row_t)));
+
+	if (!sensor_store_add_listener(&sensor_history_on_publish, NULL))
+	{
+		ESP_LOGE(TAG, "No free sensor store listener");
+		return ESP_FAIL;
+	}
+	return ESP_OK;
+}
+
+void sensor_history_append(const sensor_history_row_t *row)
+{
+	if (rows == NULL)
+	{
+		return;
+	}
+	taskENTER_CRITICAL(&history_mux);
+	sensor_history_commit_locked(row);
+	taskEXIT_CRITICAL(&history_mux);
+}
+
+bool sensor_history_commit_pending(void)
+{
+	sensor_history_row_t row;
+
+	if (rows == NULL)
+	{
+		return false;
+	}
+	taskENTER_CRITICAL(&history_mux);
+	row = pending;
+	if (row.flags != 0)
+	{
+		sensor_history_commit_locked(&row);
+		memset(&pending, 0, sizeof(pending));
+	}
+	taskEXIT_CRITICAL(&history_mux);
+
+	if (row.flags == 0)
+	{
+		return false;
+	}
+	metrics_counter_inc(&history_rows);
+	sample_log_append(&row);
+	return true;
+}
+
+bool sensor_history_read(uint32_t seq, sensor_history_row_t *row)
+{
+	uint32_t h = atomic_load_explicit(&head, memory_order_acquire);
+	if (rows == NULL || seq >= h || h - seq >= capacity)
+	{
+		return false;
+	}
+
+	memcpy(row, &rows[seq % capacity], sizeof(*row));
+
+	// The writer may have lapped the reader while copying, while head == seq + capacity
+	// the slot is being rewritten
+	atomic_thread_fence(memory_order_acquire);
+	h = atomic_load_explicit(&head, memory_order_relaxed);
+	return h - seq < capacity;
+}
+
+uint32_t sensor_history_head(void)
+{
+	return atomic_load_explicit(&head, memory_order_acquire);
+}
+
+uint32_t sensor_history_tail(void)
+{
+	uint32_t h = sensor_history_head();
+	return (h >= capacity) ? h - capacity + 1 : 0;
+}
+
+uint32_t sensor_history_capacity(void)
+{
+	return capacity;
+}
+
+void sensor_history_put_cbor_row(cbor_writer_t *w, uint32_t seq, const sensor_history_row_t *row)
+{
+	cbor_put_array(w, 6);
+	cbor_put_uint(w, seq);
+	cbor_put_uint(w, row->timestamp);
+	if (row->flags & SENSOR_HISTORY_FLAG_DHT22)
+	{
+		cbor_put_int(w, row->dht_temperature);
+		cbor_put_int(w, row->humidity);
+	}
+	else
+	{
+		cbor_put_null(w);
+		cbor_put_null(w);
+	}
+	if (row->flags & SENSOR_HISTORY_FLAG_BMP180)
+	{
+		cbor_put_int(w, row->bmp_temperature);
+		cbor_put_uint(w, sensor_history_decode_pressure(row->pressure));
+	}
+	else
+	{
+		cbor_put_null(w);
+		cbor_put_null(w);
+	}
+}
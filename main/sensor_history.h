@@ -0,0 +1,103 @@
+/*
+ * sensor_history.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef MAIN_SENSOR_HISTORY_H_
+#define MAIN_SENSOR_HISTORY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "cbor_writer.h"
+
+// Row flags, a field is only meaningful if its source flag is set
+#define SENSOR_HISTORY_FLAG_DHT22       0x01
+#define SENSOR_HISTORY_FLAG_BMP180      0x02
+
+// Fixed point encoding
+#define SENSOR_HISTORY_TEMP_SCALE       100         // 0.01 C
+#define SENSOR_HISTORY_HUMIDITY_SCALE   100         // 0.01 %RH
+#define SENSOR_HISTORY_PRESSURE_OFFSET  100000      // Pa
+#define SENSOR_HISTORY_PRESSURE_STEP    2           // Pa per LSB, covers 345 - 1655 hPa
+
+// One packed history row, filled from one DHT22 and one BMP180 publication
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp;         // time() seconds, uptime based until SNTP has synced
+    int16_t dht_temperature;
+    int16_t humidity;
+    int16_t bmp_temperature;
+    int16_t pressure;
+    uint8_t flags;
+    uint8_t reserved;
+} sensor_history_row_t;
+
+/*
+* Allocates the ring (PSRAM when available) and subscribes to the sensor store
+@return ESP_OK if successful
+*/
+esp_err_t sensor_history_init(void);
+
+/*
+* Appends a complete row, used when restoring rows saved before a reboot
+*/
+void sensor_history_append(const sensor_history_row_t *row);
+
+/*
+* Commits the row still waiting for its second source, used before powering down
+@return true if there was one
+*/
+bool sensor_history_commit_pending(void);
+
+/*
+* Copies the row with the given sequence number
+@return false if the row has not been written yet or was overwritten
+*/
+bool sensor_history_read(uint32_t seq, sensor_history_row_t *row);
+
+/*
+* Returns the sequence number the next committed row will get
+*/
+uint32_t sensor_history_head(void);
+
+/*
+* Returns the oldest sequence number still held in the ring
+*/
+uint32_t sensor_history_tail(void);
+
+/*
+* Returns the number of rows the ring can hold
+*/
+uint32_t sensor_history_capacity(void);
+
+/*
+* Writes a row as the CBOR array [seq, timestamp, dht_temperature, humidity, bmp_temperature,
+* pressure], the fields in row units except pressure in Pa, null where the source flag is clear
+*/
+void sensor_history_put_cbor_row(cbor_writer_t *w, uint32_t seq, const sensor_history_row_t *row);
+
+/*
+* Converts between fixed point row fields and engineering units
+*/
+static inline int16_t sensor_history_encode_pressure(uint32_t pressure_pa)
+{
+    int32_t v = ((int32_t)pressure_pa - SENSOR_HISTORY_PRESSURE_OFFSET) / SENSOR_HISTORY_PRESSURE_STEP;
+    return (int16_t)(v > INT16_MAX ? INT16_MAX : (v < INT16_MIN ? INT16_MIN : v));
+}
+
+static inline uint32_t sensor_history_decode_pressure(int16_t pressure)
+{
+    return (uint32_t)(SENSOR_HISTORY_PRESSURE_OFFSET + (int32_t)pressure * SENSOR_HISTORY_PRESSURE_STEP);
+}
+
+static inline int16_t sensor_history_encode_centi(float value)
+{
+    float v = value * 100.0f;
+    if (v > INT16_MAX) return INT16_MAX;
+    if (v < INT16_MIN) return INT16_MIN;
+    return (int16_t)(v < 0 ? v - 0.5f : v + 0.5f);
+}
+
+#endif /* MAIN_SENSOR_HISTORY_H_ */
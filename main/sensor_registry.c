@@ -0,0 +1,265 @@
+/*
+ * sensor_registry.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "app_nvs.h"
+#include "sntp_time_sync.h"
+#include "periodic_work.h"
+#include "sensor_registry.h"
+
+static const char TAG[] = "sensor_registry";
+
+// Registry entry of one sensor instance
+typedef struct
+{
+	sensor_t sensor;					// handed to the driver callbacks
+	periodic_work_job_t job;			// runs start once, then measure and decode every period
+	esp_err_t status;					// start result, then the last measure result
+	bool started;
+	// Guarded by sensor_lock, the job writes and the HTTP task reads
+	uint32_t period_ms;
+	int64_t timestamp_us;				// time of the latest values, 0 = none yet
+	float values[SENSOR_REGISTRY_MAX_FIELDS];
+	uint32_t samples;
+	uint32_t errors;
+} sensor_slot_t;
+
+static sensor_slot_t sensor_slots[SENSOR_REGISTRY_MAX_SENSORS];
+static int sensor_count = 0;
+static bool sensors_scheduled = false;
+static portMUX_TYPE sensor_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static sensor_slot_t *sensor_registry_find(const char *name)
+{
+	for (int i = 0; i < sensor_count; i++)
+	{
+		if (strcmp(sensor_slots[i].sensor.desc->name, name) == 0)
+		{
+			return &sensor_slots[i];
+		}
+	}
+	return NULL;
+}
+
+static bool sensor_registry_period_valid(uint32_t period_ms)
+{
+	return period_ms >= SENSOR_REGISTRY_MIN_PERIOD_MS && period_ms <= SENSOR_REGISTRY_MAX_PERIOD_MS;
+}
+
+esp_err_t sensor_registry_add(const sensor_descriptor_t *desc)
+{
+	const sensor_driver_t *driver = desc ? desc->driver : NULL;
+
+	if (driver == NULL || desc->name == NULL || strlen(desc->name) > 15 ||
+		driver->measure == NULL || driver->decode == NULL ||
+		driver->field_count > SENSOR_REGISTRY_MAX_FIELDS || !sensor_registry_period_valid(desc->period_ms))
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+	if (sensors_scheduled || sensor_registry_find(desc->name) != NULL)
+	{
+		return ESP_ERR_INVALID_STATE;
+	}
+	if (sensor_count >= SENSOR_REGISTRY_MAX_SENSORS)
+	{
+		ESP_LOGE(TAG, "No room for sensor %s", desc->name);
+		return ESP_ERR_NO_MEM;
+	}
+
+	sensor_slot_t *slot = &sensor_slots[sensor_count++];
+	memset(slot, 0, sizeof(*slot));
+	slot->sensor.desc = desc;
+	slot->period_ms = desc->period_ms;
+	slot->status = ESP_ERR_INVALID_STATE;
+	return ESP_OK;
+}
+
+// Periodic work job of one sensor, the first run starts the driver
+static void sensor_registry_job(void *arg)
+{
+	sensor_slot_t *slot = (sensor_slot_t *)arg;
+	const sensor_descriptor_t *desc = slot->sensor.desc;
+	const sensor_driver_t *driver = desc->driver;
+	float values[SENSOR_REGISTRY_MAX_FIELDS];
+
+	if (!slot->started)
+	{
+		slot->status = driver->start ? driver->start(&slot->sensor) : ESP_OK;
+		if (slot->status != ESP_OK)
+		{
+			ESP_LOGE(TAG, "%s (%s) failed to start (%s)", desc->name, driver->type, esp_err_to_name(slot->status));
+			periodic_work_cancel(&slot->job);
+			return;
+		}
+		slot->started = true;
+		ESP_LOGI(TAG, "%s (%s) every %"PRIu32" ms", desc->name, driver->type, slot->period_ms);
+	}
+
+	esp_err_t err = driver->measure(&slot->sensor);
+	bool fresh = (err == ESP_OK) && driver->decode(&slot->sensor, values);
+	int64_t now = sntp_time_sync_monotonic_us();
+	slot->status = err;
+
+	taskENTER_CRITICAL(&sensor_lock);
+	if (fresh)
+	{
+		memcpy(slot->values, values, driver->field_count * sizeof(float));
+		slot->timestamp_us = now;
+		slot->samples++;
+	}
+	if (err != ESP_OK)
+	{
+		slot->errors++;
+	}
+	taskEXIT_CRITICAL(&sensor_lock);
+}
+
+esp_err_t sensor_registry_start(void)
+{
+	if (sensors_scheduled)
+	{
+		return ESP_ERR_INVALID_STATE;
+	}
+	sensors_scheduled = true;
+
+	// Periods saved in NVS override the descriptor defaults
+	for (int i = 0; i < sensor_count; i++)
+	{
+		sensor_slot_t *slot = &sensor_slots[i];
+		uint32_t period_ms;
+
+		if (app_nvs_load_sensor_period(slot->sensor.desc->name, &period_ms) && sensor_registry_period_valid(period_ms))
+		{
+			slot->period_ms = period_ms;
+		}
+		slot->job = (periodic_work_job_t)PERIODIC_WORK_JOB(slot->sensor.desc->name, &sensor_registry_job, slot);
+		periodic_work_schedule(&slot->job, 0, slot->period_ms);
+	}
+	return periodic_work_start();
+}
+
+esp_err_t sensor_registry_set_period(const char *name, uint32_t period_ms)
+{
+	if (!sensor_registry_period_valid(period_ms))
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+	sensor_slot_t *slot = sensor_registry_find(name);
+	if (slot == NULL)
+	{
+		return ESP_ERR_NOT_FOUND;
+	}
+
+	taskENTER_CRITICAL(&sensor_lock);
+	slot->period_ms = period_ms;
+	taskEXIT_CRITICAL(&sensor_lock);
+
+	// Run once right away, the new period starts from there
+	if (sensors_scheduled)
+	{
+		periodic_work_schedule(&slot->job, 0, period_ms);
+	}
+
+	ESP_LOGI(TAG, "%s every %"PRIu32" ms", name, period_ms);
+	return app_nvs_save_sensor_period(slot->sensor.desc->name, period_ms);
+}
+
+int sensor_registry_count(void)
+{
+	return sensor_count;
+}
+
+// Appends to buf, false once it no longer fits
+static bool sensor_registry_append(char *buf, size_t size, size_t *len, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	int n = vsnprintf(buf + *len, size - *len, fmt, args);
+	va_end(args);
+
+	if (n < 0 || (size_t)n >= size - *len)
+	{
+		return false;
+	}
+	*len += n;
+	return true;
+}
+
+size_t sensor_registry_format_json(char *buf, size_t size)
+{
+	size_t len = 0;
+	int64_t now = sntp_time_sync_monotonic_us();
+
+	if (size == 0 || !sensor_registry_append(buf, size, &len, "{\"sensors\":["))
+	{
+		return 0;
+	}
+
+	for (int i = 0; i < sensor_count; i++)
+	{
+		const sensor_slot_t *slot = &sensor_slots[i];
+		const sensor_descriptor_t *desc = slot->sensor.desc;
+		const sensor_driver_t *driver = desc->driver;
+		sensor_slot_t copy;
+
+		taskENTER_CRITICAL(&sensor_lock);
+		copy = *slot;
+		taskEXIT_CRITICAL(&sensor_lock);
+
+		bool ok = sensor_registry_append(buf, size, &len,
+			"%s{\"name\":\"%s\",\"type\":\"%s\",\"period_ms\":%"PRIu32",\"status\":\"%s\","
+			"\"samples\":%"PRIu32",\"errors\":%"PRIu32",\"overruns\":%"PRIu32",",
+			i ? "," : "", desc->name, driver->type, copy.period_ms, esp_err_to_name(copy.status),
+			copy.samples, copy.errors, copy.job.overruns);
+
+		if (copy.timestamp_us == 0)
+		{
+			ok = ok && sensor_registry_append(buf, size, &len, "\"age_ms\":null,\"values\":null");
+		}
+		else
+		{
+			ok = ok && sensor_registry_append(buf, size, &len, "\"age_ms\":%"PRIi64",\"values\":{",
+											  (now - copy.timestamp_us) / 1000);
+			for (int f = 0; f < driver->field_count; f++)
+			{
+				const sensor_field_t *field = &driver->fields[f];
+				if (isnan(copy.values[f]))
+				{
+					ok = ok && sensor_registry_append(buf, size, &len, "%s\"%s\":null", f ? "," : "", field->name);
+				}
+				else
+				{
+					ok = ok && sensor_registry_append(buf, size, &len, "%s\"%s\":%.*f", f ? "," : "",
+													  field->name, field->decimals, copy.values[f]);
+				}
+			}
+			ok = ok && sensor_registry_append(buf, size, &len, "}");
+		}
+
+		ok = ok && sensor_registry_append(buf, size, &len, ",\"units\":{");
+		for (int f = 0; f < driver->field_count; f++)
+		{
+			ok = ok && sensor_registry_append(buf, size, &len, "%s\"%s\":\"%s\"", f ? "," : "",
+											  driver->fields[f].name, driver->fields[f].unit);
+		}
+		ok = ok && sensor_registry_append(buf, size, &len, "}}");
+
+		if (!ok)
+		{
+			return 0;
+		}
+	}
+
+	return sensor_registry_append(buf, size, &len, "]}") ? len : 0;
+}
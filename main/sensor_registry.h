@@ -0,0 +1,98 @@
+/*
+ * sensor_registry.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef MAIN_SENSOR_REGISTRY_H_
+#define MAIN_SENSOR_REGISTRY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+// Registered sensor instances and values per instance
+#define SENSOR_REGISTRY_MAX_SENSORS     CONFIG_SENSOR_REGISTRY_MAX_SENSORS
+#define SENSOR_REGISTRY_MAX_FIELDS      6
+
+// Buffer size that fits sensor_registry_format_json() for a full table
+#define SENSOR_REGISTRY_JSON_SIZE       (32 + SENSOR_REGISTRY_MAX_SENSORS * 512)
+
+// Shortest and longest accepted sampling period, periods are rounded up to FreeRTOS ticks
+#define SENSOR_REGISTRY_MIN_PERIOD_MS   10
+#define SENSOR_REGISTRY_MAX_PERIOD_MS   3600000
+
+typedef struct sensor_s sensor_t;
+
+// One value reported by a driver, drives the generic JSON output
+typedef struct {
+    const char *name;           // JSON key
+    const char *unit;
+    uint8_t decimals;           // digits printed after the point
+} sensor_field_t;
+
+/*
+* Driver interface, all callbacks run in the periodic work task.
+* start:   one time hardware set up, may set sensor->ctx
+* measure: runs one measurement, may sleep for conversions. Runs once per period
+* decode:  turns the last successful measurement into field_count values and hands it to the
+*          driver's own consumers (e.g. the sensor store). Return false if there is nothing new
+*/
+typedef struct {
+    const char *type;
+    const sensor_field_t *fields;
+    uint8_t field_count;
+    esp_err_t (*start)(sensor_t *sensor);
+    esp_err_t (*measure)(sensor_t *sensor);
+    bool (*decode)(sensor_t *sensor, float *values);
+} sensor_driver_t;
+
+// Static description of one sensor instance
+typedef struct {
+    const char *name;           // unique, JSON name and NVS key (at most 15 characters)
+    const sensor_driver_t *driver;
+    uint32_t period_ms;         // default sampling period, a value saved in NVS takes precedence
+    const void *config;         // driver specific configuration, e.g. pins
+} sensor_descriptor_t;
+
+// Instance handed to the driver callbacks
+struct sensor_s {
+    const sensor_descriptor_t *desc;
+    void *ctx;                  // driver state
+};
+
+/*
+* Adds a sensor instance. Call during start up, before sensor_registry_start()
+* The descriptor must stay valid for good
+@return ESP_OK, ESP_ERR_NO_MEM if the table is full, ESP_ERR_INVALID_ARG for a bad descriptor
+*/
+esp_err_t sensor_registry_add(const sensor_descriptor_t *desc);
+
+/*
+* Schedules every registered sensor as a periodic work job and starts the periodic work task.
+* The first run of a job starts the driver, a sensor whose start fails stays listed with its error
+@return ESP_OK if the periodic work task runs
+*/
+esp_err_t sensor_registry_start(void);
+
+/*
+* Changes the sampling period of a sensor and saves it to NVS
+@return ESP_OK, ESP_ERR_NOT_FOUND for an unknown name, ESP_ERR_INVALID_ARG for a period out of range
+*/
+esp_err_t sensor_registry_set_period(const char *name, uint32_t period_ms);
+
+/*
+* Writes {"sensors":[...]} with the latest values of every sensor, described by the driver fields
+@return length written, or 0 if the buffer is too small
+*/
+size_t sensor_registry_format_json(char *buf, size_t size);
+
+/*
+* Number of registered sensors
+*/
+int sensor_registry_count(void);
+
+#endif /* MAIN_SENSOR_REGISTRY_H_ */
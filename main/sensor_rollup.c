@@ -0,0 +1,242 @@
+/*
+ * sensor_rollup.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+#include <inttypes.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+#include "sensor_store.h"
+#include "sensor_history.h"
+#include "sensor_rollup.h"
+
+static const char TAG[] = "sensor_rollup";
+
+// Running sums of the bucket being filled
+typedef struct {
+	int16_t min;
+	int16_t max;
+	int32_t sum;
+	uint16_t count;
+} rollup_accum_t;
+
+typedef struct {
+	uint32_t period;
+	uint32_t capacity;
+	uint32_t head;
+	sensor_rollup_bucket_t *ring;
+	uint32_t open_start;
+	rollup_accum_t open[SENSOR_ROLLUP_METRIC_COUNT];
+} rollup_tier_t;
+
+static rollup_tier_t tiers[SENSOR_ROLLUP_TIER_COUNT] = {
+	[SENSOR_ROLLUP_TIER_1MIN]  = { .period = 60,   .capacity = CONFIG_SENSOR_ROLLUP_1MIN_BUCKETS },
+	[SENSOR_ROLLUP_TIER_15MIN] = { .period = 900,  .capacity = CONFIG_SENSOR_ROLLUP_15MIN_BUCKETS },
+	[SENSOR_ROLLUP_TIER_1HOUR] = { .period = 3600, .capacity = CONFIG_SENSOR_ROLLUP_1HOUR_BUCKETS },
+};
+
+// Protects the tiers, both sensor tasks write and the HTTP server reads
+static portMUX_TYPE rollup_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static void rollup_finish_stats(const rollup_accum_t *accum, sensor_rollup_stat_t *stat)
+{
+	for (int m = 0; m < SENSOR_ROLLUP_METRIC_COUNT; m++)
+	{
+		stat[m].count = accum[m].count;
+		stat[m].min = accum[m].count ? accum[m].min : 0;
+		stat[m].max = accum[m].count ? accum[m].max : 0;
+		stat[m].mean = accum[m].count ? (int16_t)(accum[m].sum / accum[m].count) : 0;
+	}
+}
+
+// Moves the open bucket into the ring if it has samples and starts a new one
+static void rollup_close_bucket(rollup_tier_t *tier, uint32_t new_start)
+{
+	bool has_samples = false;
+	for (int m = 0; m < SENSOR_ROLLUP_METRIC_COUNT; m++)
+	{
+		has_samples |= (tier->open[m].count != 0);
+	}
+
+	if (has_samples)
+	{
+		sensor_rollup_bucket_t *bucket = &tier->ring[tier->head % tier->capacity];
+		bucket->start = tier->open_start;
+		rollup_finish_stats(tier->open, bucket->stat);
+		tier->head++;
+	}
+
+	memset(tier->open, 0, sizeof(tier->open));
+	tier->open_start = new_start;
+}
+
+static void rollup_accumulate(rollup_accum_t *accum, int16_t value)
+{
+	if (accum->count == 0 || value < accum->min) accum->min = value;
+	if (accum->count == 0 || value > accum->max) accum->max = value;
+
+	// A full bucket keeps its min and max going, the mean stays that of the first UINT16_MAX samples.
+	// That many int16 values still fit the int32 sum
+	if (accum->count < UINT16_MAX)
+	{
+		accum->sum += value;
+		accum->count++;
+	}
+}
+
+/*
+* Store listener, O(1) per sample per tier.
+* Temperature follows the BMP180 and falls back to the DHT22 while the BMP180 has no valid reading
+*/
+static void sensor_rollup_on_publish(sensor_source_e source, void *arg)
+{
+	int16_t values[SENSOR_ROLLUP_METRIC_COUNT];
+	bool present[SENSOR_ROLLUP_METRIC_COUNT] = { false };
+	sensor_dht22_sample_t dht;
+	sensor_bmp180_sample_t bmp;
+
+	sensor_store_read_bmp180(&bmp);
+	if (source == SENSOR_SOURCE_DHT22)
+	{
+		sensor_store_read_dht22(&dht);
+		values[SENSOR_ROLLUP_HUMIDITY] = sensor_history_encode_centi(dht.humidity);
+		present[SENSOR_ROLLUP_HUMIDITY] = true;
+		if (!bmp.readings.valid)
+		{
+			values[SENSOR_ROLLUP_TEMPERATURE] = sensor_history_encode_centi(dht.temperature);
+			present[SENSOR_ROLLUP_TEMPERATURE] = true;
+		}
+	}
+	else if (bmp.readings.valid)
+	{
+		values[SENSOR_ROLLUP_TEMPERATURE] = sensor_history_encode_centi(bmp.readings.temperature);
+		present[SENSOR_ROLLUP_TEMPERATURE] = true;
+		values[SENSOR_ROLLUP_PRESSURE] = sensor_history_encode_pressure(bmp.readings.pressure);
+		present[SENSOR_ROLLUP_PRESSURE] = true;
+		if (!isnan(bmp.readings.dew_point))
+		{
+			values[SENSOR_ROLLUP_DEW_POINT] = sensor_history_encode_centi(bmp.readings.dew_point);
+			present[SENSOR_ROLLUP_DEW_POINT] = true;
+		}
+		values[SENSOR_ROLLUP_AIR_DENSITY] = (int16_t)lroundf(bmp.readings.air_density * SENSOR_ROLLUP_AIR_DENSITY_SCALE);
+		present[SENSOR_ROLLUP_AIR_DENSITY] = true;
+	}
+	else
+	{
+		return;
+	}
+
+	uint32_t now = (uint32_t)time(NULL);
+
+	taskENTER_CRITICAL(&rollup_mux);
+	for (int t = 0; t < SENSOR_ROLLUP_TIER_COUNT; t++)
+	{
+		rollup_tier_t *tier = &tiers[t];
+		uint32_t start = now - (now % tier->period);
+		if (start != tier->open_start)
+		{
+			rollup_close_bucket(tier, start);
+		}
+		for (int m = 0; m < SENSOR_ROLLUP_METRIC_COUNT; m++)
+		{
+			if (present[m])
+			{
+				rollup_accumulate(&tier->open[m], values[m]);
+			}
+		}
+	}
+	taskEXIT_CRITICAL(&rollup_mux);
+}
+
+esp_err_t sensor_rollup_init(void)
+{
+	size_t total = 0;
+
+	for (int t = 0; t < SENSOR_ROLLUP_TIER_COUNT; t++)
+	{
+		rollup_tier_t *tier = &tiers[t];
+		if (tier->ring != NULL)
+		{
+			continue;
+		}
+#if CONFIG_SPIRAM
+		tier->ring = heap_caps_calloc(tier->capacity, sizeof(sensor_rollup_bucket_t), MALLOC_CAP_SPIRAM);
+#endif
+		if (tier->ring == NULL)
+		{
+			tier->ring = heap_caps_calloc(tier->capacity, sizeof(sensor_rollup_bucket_t), MALLOC_CAP_8BIT);
+		}
+		if (tier->ring == NULL)
+		{
+			ESP_LOGE(TAG, "Failed to allocate %"PRIu32" s tier", tier->period);
+			return ESP_ERR_NO_MEM;
+		}
+		total += tier->capacity * sizeof(sensor_rollup_bucket_t);
+	}
+
+	ESP_LOGI(TAG, "Rollup tiers allocated, %u bytes", (unsigned)total);
+
+	if (!sensor_store_add_listener(&sensor_rollup_on_publish, NULL))
+	{
+		ESP_LOGE(TAG, "No free sensor store listener");
+		return ESP_FAIL;
+	}
+	return ESP_OK;
+}
+
+uint32_t sensor_rollup_period(sensor_rollup_tier_e tier)
+{
+	return tiers[tier].period;
+}
+
+uint32_t sensor_rollup_head(sensor_rollup_tier_e tier)
+{
+	taskENTER_CRITICAL(&rollup_mux);
+	uint32_t head = tiers[tier].head;
+	taskEXIT_CRITICAL(&rollup_mux);
+	return head;
+}
+
+uint32_t sensor_rollup_tail(sensor_rollup_tier_e tier)
+{
+	uint32_t head = sensor_rollup_head(tier);
+	return (head > tiers[tier].capacity) ? head - tiers[tier].capacity : 0;
+}
+
+bool sensor_rollup_read(sensor_rollup_tier_e tier, uint32_t index, sensor_rollup_bucket_t *bucket)
+{
+	rollup_tier_t *t = &tiers[tier];
+	bool ok = false;
+
+	taskENTER_CRITICAL(&rollup_mux);
+	if (t->ring != NULL && index < t->head && t->head - index <= t->capacity)
+	{
+		*bucket = t->ring[index % t->capacity];
+		ok = true;
+	}
+	taskEXIT_CRITICAL(&rollup_mux);
+	return ok;
+}
+
+bool sensor_rollup_read_open(sensor_rollup_tier_e tier, sensor_rollup_bucket_t *bucket)
+{
+	rollup_tier_t *t = &tiers[tier];
+	bool has_samples = false;
+
+	taskENTER_CRITICAL(&rollup_mux);
+	bucket->start = t->open_start;
+	rollup_finish_stats(t->open, bucket->stat);
+	taskEXIT_CRITICAL(&rollup_mux);
+
+	for (int m = 0; m < SENSOR_ROLLUP_METRIC_COUNT; m++)
+	{
+		has_samples |= (bucket->stat[m].count != 0);
+	}
+	return has_samples;
+}
@@ -0,0 +1,82 @@
+/*
+ * sensor_rollup.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef MAIN_SENSOR_ROLLUP_H_
+#define MAIN_SENSOR_ROLLUP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+// Aggregation tiers
+typedef enum {
+    SENSOR_ROLLUP_TIER_1MIN = 0,
+    SENSOR_ROLLUP_TIER_15MIN,
+    SENSOR_ROLLUP_TIER_1HOUR,
+    SENSOR_ROLLUP_TIER_COUNT,
+} sensor_rollup_tier_e;
+
+// Aggregated metrics and their fixed point units
+typedef enum {
+    SENSOR_ROLLUP_TEMPERATURE = 0,      // 0.01 C
+    SENSOR_ROLLUP_HUMIDITY,             // 0.01 %RH
+    SENSOR_ROLLUP_PRESSURE,             // sensor_history pressure encoding (2 Pa steps)
+    SENSOR_ROLLUP_DEW_POINT,            // 0.01 C
+    SENSOR_ROLLUP_AIR_DENSITY,          // 0.0001 kg/m3
+    SENSOR_ROLLUP_METRIC_COUNT,
+} sensor_rollup_metric_e;
+
+#define SENSOR_ROLLUP_AIR_DENSITY_SCALE     10000
+
+// Statistics of one metric over one bucket
+typedef struct {
+    int16_t min;
+    int16_t max;
+    int16_t mean;
+    uint16_t count;                     // 0 = no samples in this bucket
+} sensor_rollup_stat_t;
+
+// One closed bucket
+typedef struct {
+    uint32_t start;                     // time() at the start of the bucket
+    sensor_rollup_stat_t stat[SENSOR_ROLLUP_METRIC_COUNT];
+} sensor_rollup_bucket_t;
+
+/*
+* Allocates the tier rings and subscribes to the sensor store
+@return ESP_OK if successful
+*/
+esp_err_t sensor_rollup_init(void);
+
+/*
+* Returns the bucket length of a tier in seconds
+*/
+uint32_t sensor_rollup_period(sensor_rollup_tier_e tier);
+
+/*
+* Returns the index the next closed bucket of the tier will get
+*/
+uint32_t sensor_rollup_head(sensor_rollup_tier_e tier);
+
+/*
+* Returns the oldest bucket index still held by the tier
+*/
+uint32_t sensor_rollup_tail(sensor_rollup_tier_e tier);
+
+/*
+* Copies a closed bucket
+@return false if the index is not held by the tier
+*/
+bool sensor_rollup_read(sensor_rollup_tier_e tier, uint32_t index, sensor_rollup_bucket_t *bucket);
+
+/*
+* Copies the bucket still being filled
+@return false if it has no samples yet
+*/
+bool sensor_rollup_read_open(sensor_rollup_tier_e tier, sensor_rollup_bucket_t *bucket);
+
+#endif /* MAIN_SENSOR_ROLLUP_H_ */
@@ -0,0 +1,240 @@
+/*
+ * sensor_sim.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#include "sdkconfig.h"
+
+#if CONFIG_SENSOR_SIM_ENABLED
+
+#include <inttypes.h>
+#include <math.h>
+#include "esp_log.h"
+#include "esp_random.h"
+#include "metrics.h"
+#include "sensor_filter.h"
+#include "sntp_time_sync.h"
+#include "sensor_sim.h"
+
+static const char TAG[] = "sensor_sim";
+
+// Centre and swing of each generated value
+#define SIM_TEMPERATURE_BASE        22.0f
+#define SIM_TEMPERATURE_SWING       5.0f
+#define SIM_HUMIDITY_BASE           50.0f
+#define SIM_HUMIDITY_SWING          20.0f
+#define SIM_BMP180_OFFSET           1.5f        // the BMP180 reads warm, as on the board
+#define SIM_PRESSURE_BASE           101325.0f
+#define SIM_PRESSURE_SWING          1500.0f
+
+// A spike adds this many swings, far enough out for the Hampel filter to replace it
+#define SIM_SPIKE_SWINGS            4.0f
+
+// Step of the random walk per sample, in swings
+#define SIM_NOISE_STEP              0.05f
+
+typedef struct {
+	const char *type;
+	bool started;
+	uint32_t rate_hz;
+	uint32_t interval_us;
+	uint32_t cycle;				// samples per waveform period
+	int64_t next_us;			// nominal time of the next sample
+	uint32_t index;				// samples generated, the waveform position
+	uint16_t batch;				// samples due in this run
+	float walk;					// random walk of the noise waveform, -1 to 1
+	metrics_counter_t samples;
+	metrics_counter_t late;
+} sensor_sim_t;
+
+static sensor_sim_t sim_dht22 = {
+	.type = "sim_dht22",
+	.samples = METRICS_COUNTER("sensor_sim_samples_total", "Samples the generators submitted", "source=\"dht22\""),
+	.late = METRICS_COUNTER("sensor_sim_late_samples_total", "Samples skipped because the generator ran late", "source=\"dht22\""),
+};
+
+static sensor_sim_t sim_bmp180 = {
+	.type = "sim_bmp180",
+	.samples = METRICS_COUNTER("sensor_sim_samples_total", "Samples the generators submitted", "source=\"bmp180\""),
+	.late = METRICS_COUNTER("sensor_sim_late_samples_total", "Samples skipped because the generator ran late", "source=\"bmp180\""),
+};
+
+/*
+* Waveform at the current sample from -1 to 1, shift is a fraction of the period so the values
+* of one source do not move in step. The noise waveform is one walk per source
+*/
+static float sensor_sim_wave(sensor_sim_t *sim, float shift)
+{
+#if CONFIG_SENSOR_SIM_WAVEFORM_NOISE
+	sim->walk += SIM_NOISE_STEP * ((float)(esp_random() & 0xFFFF) / 32768.0f - 1.0f);
+	sim->walk = fminf(1.0f, fmaxf(-1.0f, sim->walk));
+	return sim->walk;
+#else
+	float phase = (float)(sim->index % sim->cycle) / sim->cycle + shift;
+	phase -= floorf(phase);
+#if CONFIG_SENSOR_SIM_WAVEFORM_SINE
+	return sinf(2.0f * (float)M_PI * phase);
+#elif CONFIG_SENSOR_SIM_WAVEFORM_SAWTOOTH
+	return 2.0f * phase - 1.0f;
+#else
+	return (phase < 0.5f) ? 1.0f : -1.0f;
+#endif
+#endif
+}
+
+// SIM_SPIKE_SWINGS on every CONFIG_SENSOR_SIM_SPIKE_INTERVAL sample, 0 otherwise
+static float sensor_sim_spike(const sensor_sim_t *sim)
+{
+#if CONFIG_SENSOR_SIM_SPIKE_INTERVAL > 0
+	if (sim->index % CONFIG_SENSOR_SIM_SPIKE_INTERVAL == CONFIG_SENSOR_SIM_SPIKE_INTERVAL - 1)
+	{
+		return SIM_SPIKE_SWINGS;
+	}
+#endif
+	return 0.0f;
+}
+
+static esp_err_t sensor_sim_start(sensor_t *sensor, sensor_sim_t *sim)
+{
+	const sensor_sim_config_t *config = (const sensor_sim_config_t *)sensor->desc->config;
+
+	if (sim->started)
+	{
+		ESP_LOGE(TAG, "Only one %s instance is supported", sim->type);
+		return ESP_ERR_INVALID_STATE;
+	}
+	if (config == NULL || config->rate_hz == 0 || config->rate_hz > 1000000)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	sim->rate_hz = config->rate_hz;
+	sim->interval_us = 1000000 / config->rate_hz;
+	sim->cycle = (uint32_t)MIN((uint64_t)config->rate_hz * CONFIG_SENSOR_SIM_WAVE_PERIOD_S, UINT32_MAX);
+	sim->next_us = sntp_time_sync_monotonic_us();
+	sim->started = true;
+	metrics_register_counter(&sim->samples);
+	metrics_register_counter(&sim->late);
+	sensor->ctx = sim;
+	ESP_LOGW(TAG, "%s generating %"PRIu32" samples per second", sim->type, sim->rate_hz);
+	return ESP_OK;
+}
+
+static esp_err_t sensor_sim_dht22_start(sensor_t *sensor)
+{
+	return sensor_sim_start(sensor, &sim_dht22);
+}
+
+static esp_err_t sensor_sim_bmp180_start(sensor_t *sensor)
+{
+	return sensor_sim_start(sensor, &sim_bmp180);
+}
+
+// Works out the samples due since the last run, decode generates them
+static esp_err_t sensor_sim_measure(sensor_t *sensor)
+{
+	sensor_sim_t *sim = (sensor_sim_t *)sensor->ctx;
+	int64_t now = sntp_time_sync_monotonic_us();
+
+	sim->batch = 0;
+	if (now < sim->next_us)
+	{
+		return ESP_OK;
+	}
+
+	uint64_t due = (uint64_t)(now - sim->next_us) / sim->interval_us + 1;
+	if (due > SENSOR_SIM_MAX_BATCH)
+	{
+		// Far behind, the schedule restarts from now rather than bursting to catch up
+		metrics_counter_add(&sim->late, (uint32_t)MIN(due - SENSOR_SIM_MAX_BATCH, UINT32_MAX));
+		sim->batch = SENSOR_SIM_MAX_BATCH;
+		sim->next_us = now + sim->interval_us;
+	}
+	else
+	{
+		sim->batch = (uint16_t)due;
+		sim->next_us += (int64_t)due * sim->interval_us;
+	}
+	return ESP_OK;
+}
+
+static bool sensor_sim_dht22_decode(sensor_t *sensor, float *values)
+{
+	sensor_sim_t *sim = (sensor_sim_t *)sensor->ctx;
+	bool fresh = false;
+
+	for (int i = 0; i < sim->batch; i++, sim->index++)
+	{
+		float temperature = SIM_TEMPERATURE_BASE + SIM_TEMPERATURE_SWING * (sensor_sim_wave(sim, 0.0f) + sensor_sim_spike(sim));
+		float humidity = SIM_HUMIDITY_BASE + SIM_HUMIDITY_SWING * sensor_sim_wave(sim, 0.25f);
+
+		if (sensor_filter_submit_dht22(&temperature, &humidity))
+		{
+			values[0] = temperature;
+			values[1] = humidity;
+			fresh = true;
+		}
+	}
+	metrics_counter_add(&sim->samples, sim->batch);
+	return fresh;
+}
+
+static bool sensor_sim_bmp180_decode(sensor_t *sensor, float *values)
+{
+	sensor_sim_t *sim = (sensor_sim_t *)sensor->ctx;
+	bool fresh = false;
+
+	for (int i = 0; i < sim->batch; i++, sim->index++)
+	{
+		float pressure = SIM_PRESSURE_BASE + SIM_PRESSURE_SWING * sensor_sim_wave(sim, 0.5f);
+		bmp180_readings_t readings = {
+			.temperature = SIM_TEMPERATURE_BASE + SIM_BMP180_OFFSET + SIM_TEMPERATURE_SWING * (sensor_sim_wave(sim, 0.0f) + sensor_sim_spike(sim)),
+			.pressure = (uint32_t)lroundf(pressure),
+			.pressure_hPa = pressure / 100.0f,
+			.humidity = NAN,
+			.valid = true,
+		};
+
+		sensor_filter_submit_bmp180(&readings);
+		if (readings.valid)
+		{
+			values[0] = readings.temperature;
+			values[1] = readings.pressure_hPa;
+			fresh = true;
+		}
+	}
+	metrics_counter_add(&sim->samples, sim->batch);
+	return fresh;
+}
+
+static const sensor_field_t sensor_sim_dht22_fields[] = {
+	{ .name = "temperature", .unit = "C", .decimals = 1 },
+	{ .name = "humidity", .unit = "%RH", .decimals = 1 },
+};
+
+static const sensor_field_t sensor_sim_bmp180_fields[] = {
+	{ .name = "temperature", .unit = "C", .decimals = 2 },
+	{ .name = "pressure", .unit = "hPa", .decimals = 2 },
+};
+
+const sensor_driver_t sensor_sim_dht22_driver = {
+	.type = "sim_dht22",
+	.fields = sensor_sim_dht22_fields,
+	.field_count = sizeof(sensor_sim_dht22_fields) / sizeof(sensor_sim_dht22_fields[0]),
+	.start = sensor_sim_dht22_start,
+	.measure = sensor_sim_measure,
+	.decode = sensor_sim_dht22_decode,
+};
+
+const sensor_driver_t sensor_sim_bmp180_driver = {
+	.type = "sim_bmp180",
+	.fields = sensor_sim_bmp180_fields,
+	.field_count = sizeof(sensor_sim_bmp180_fields) / sizeof(sensor_sim_bmp180_fields[0]),
+	.start = sensor_sim_bmp180_start,
+	.measure = sensor_sim_measure,
+	.decode = sensor_sim_bmp180_decode,
+};
+
+#endif /* CONFIG_SENSOR_SIM_ENABLED */
@@ -0,0 +1,37 @@
+/*
+ * sensor_sim.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef MAIN_SENSOR_SIM_H_
+#define MAIN_SENSOR_SIM_H_
+
+#include <stdint.h>
+#include <sys/param.h>
+#include "sensor_registry.h"
+
+// Most samples generated in one run, a job running later than that counts the rest as late
+#define SENSOR_SIM_MAX_BATCH        256
+
+// Registry period of a generator, rates above 100 Hz are batched
+#define SENSOR_SIM_PERIOD_MS(rate_hz)   MAX(SENSOR_REGISTRY_MIN_PERIOD_MS, 1000 / (rate_hz))
+
+/*
+* Sensor registry configuration of a generator
+*/
+typedef struct {
+    uint32_t rate_hz;           // samples per second
+} sensor_sim_config_t;
+
+/*
+* Synthetic stand-ins for the DHT22 and the BMP180 (CONFIG_SENSOR_SIM_ENABLED). Every run
+* generates the samples due since the last one at the configured rate, shaped by
+* CONFIG_SENSOR_SIM_WAVEFORM, and submits them to sensor_filter one by one like the real
+* drivers do. Same fields as the drivers they replace, one instance each
+*/
+extern const sensor_driver_t sensor_sim_dht22_driver;
+extern const sensor_driver_t sensor_sim_bmp180_driver;
+
+#endif /* MAIN_SENSOR_SIM_H_ */
@@ -0,0 +1,176 @@
+/*
+ * sensor_store.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+#include <math.h>
+#include <stdatomic.h>
+#include <string.h>
+#include "sensor_store.h"
+#include "sntp_time_sync.h"
+
+/*
+* Each source owns a versioned double buffer (seqlock over two slots).
+* The version is odd while the writer fills the inactive slot. Readers copy the
+* slot published by the version they saw and only retry if the writer has since
+* started on that same slot again, which takes two more publications.
+*/
+typedef struct {
+	atomic_uint version;
+	sensor_dht22_sample_t slot[2];
+} dht22_channel_t;
+
+typedef struct {
+	atomic_uint version;
+	sensor_bmp180_sample_t slot[2];
+} bmp180_channel_t;
+
+static dht22_channel_t dht22_channel;
+static bmp180_channel_t bmp180_channel;
+
+// Store wide publication counter
+static atomic_uint store_seq;
+
+// Driver instance writing each channel, claimed by the driver start in the periodic work task
+static const void *channel_owner[SENSOR_SOURCE_COUNT];
+
+// Publication listeners
+static struct {
+	sensor_store_listener_t cb;
+	void *arg;
+} listeners[SENSOR_STORE_MAX_LISTENERS];
+static atomic_int listener_count;
+
+static void sensor_store_notify(sensor_source_e source)
+{
+	int count = atomic_load_explicit(&listener_count, memory_order_acquire);
+	for (int i = 0; i < count; i++)
+	{
+		listeners[i].cb(source, listeners[i].arg);
+	}
+}
+
+// Returns the slot index the writer should fill next and marks the write in progress
+static unsigned sensor_store_write_begin(atomic_uint *version)
+{
+	unsigned v = atomic_load_explicit(version, memory_order_relaxed);
+	atomic_store_explicit(version, v + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	return ((v >> 1) + 1) & 1;
+}
+
+static void sensor_store_write_end(atomic_uint *version)
+{
+	unsigned v = atomic_load_explicit(version, memory_order_relaxed);
+	atomic_store_explicit(version, v + 1, memory_order_release);
+}
+
+// Returns the slot holding the latest complete publication
+static unsigned sensor_store_read_begin(atomic_uint *version, unsigned *v1)
+{
+	*v1 = atomic_load_explicit(version, memory_order_acquire);
+	return (*v1 >> 1) & 1;
+}
+
+// True if the slot read since sensor_store_read_begin may have been overwritten
+static bool sensor_store_read_retry(atomic_uint *version, unsigned v1)
+{
+	atomic_thread_fence(memory_order_acquire);
+	unsigned v2 = atomic_load_explicit(version, memory_order_relaxed);
+	return (v2 - (v1 & ~1u)) >= 3;
+}
+
+void sensor_store_publish_dht22(float temperature, float humidity, float fused_temperature)
+{
+	unsigned idx = sensor_store_write_begin(&dht22_channel.version);
+	sensor_dht22_sample_t *sample = &dht22_channel.slot[idx];
+
+	sample->seq = atomic_fetch_add(&store_seq, 1) + 1;
+	sample->timestamp_us = sntp_time_sync_monotonic_us();
+	sample->temperature = temperature;
+	sample->humidity = humidity;
+	sample->fused_temperature = fused_temperature;
+
+	sensor_store_write_end(&dht22_channel.version);
+	sensor_store_notify(SENSOR_SOURCE_DHT22);
+}
+
+void sensor_store_publish_bmp180(const bmp180_readings_t *readings, float fused_temperature)
+{
+	unsigned idx = sensor_store_write_begin(&bmp180_channel.version);
+	sensor_bmp180_sample_t *sample = &bmp180_channel.slot[idx];
+
+	sample->seq = atomic_fetch_add(&store_seq, 1) + 1;
+	sample->timestamp_us = sntp_time_sync_monotonic_us();
+	sample->readings = *readings;
+	sample->fused_temperature = fused_temperature;
+
+	sensor_store_write_end(&bmp180_channel.version);
+	sensor_store_notify(SENSOR_SOURCE_BMP180);
+}
+
+bool sensor_store_claim(sensor_source_e source, const void *owner)
+{
+	if (source >= SENSOR_SOURCE_COUNT || owner == NULL ||
+		(channel_owner[source] != NULL && channel_owner[source] != owner))
+	{
+		return false;
+	}
+	channel_owner[source] = owner;
+	return true;
+}
+
+void sensor_store_read_dht22(sensor_dht22_sample_t *sample)
+{
+	unsigned v1, idx;
+	do
+	{
+		idx = sensor_store_read_begin(&dht22_channel.version, &v1);
+		memcpy(sample, &dht22_channel.slot[idx], sizeof(*sample));
+	} while (sensor_store_read_retry(&dht22_channel.version, v1));
+}
+
+void sensor_store_read_bmp180(sensor_bmp180_sample_t *sample)
+{
+	unsigned v1, idx;
+	do
+	{
+		idx = sensor_store_read_begin(&bmp180_channel.version, &v1);
+		memcpy(sample, &bmp180_channel.slot[idx], sizeof(*sample));
+	} while (sensor_store_read_retry(&bmp180_channel.version, v1));
+}
+
+void sensor_store_read(sensor_snapshot_t *snapshot)
+{
+	sensor_store_read_dht22(&snapshot->dht22);
+	sensor_store_read_bmp180(&snapshot->bmp180);
+	if (snapshot->dht22.seq > snapshot->bmp180.seq)
+	{
+		snapshot->seq = snapshot->dht22.seq;
+		snapshot->temperature = snapshot->dht22.fused_temperature;
+	}
+	else
+	{
+		snapshot->seq = snapshot->bmp180.seq;
+		snapshot->temperature = (snapshot->seq != 0) ? snapshot->bmp180.fused_temperature : NAN;
+	}
+}
+
+bool sensor_store_add_listener(sensor_store_listener_t listener, void *arg)
+{
+	int count = atomic_load_explicit(&listener_count, memory_order_relaxed);
+	if (listener == NULL || count >= SENSOR_STORE_MAX_LISTENERS)
+	{
+		return false;
+	}
+	listeners[count].cb = listener;
+	listeners[count].arg = arg;
+	atomic_store_explicit(&listener_count, count + 1, memory_order_release);
+	return true;
+}
+
+uint32_t sensor_store_get_seq(void)
+{
+	return atomic_load_explicit(&store_seq, memory_order_acquire);
+}
@@ -0,0 +1,98 @@
+/*
+ * sensor_store.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef MAIN_SENSOR_STORE_H_
+#define MAIN_SENSOR_STORE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bmp180.h"
+
+// Sources publishing into the store, each source has exactly one writer task
+typedef enum {
+    SENSOR_SOURCE_DHT22 = 0,
+    SENSOR_SOURCE_BMP180,
+    SENSOR_SOURCE_COUNT,
+} sensor_source_e;
+
+// Latest DHT22 reading
+typedef struct {
+    uint32_t seq;               // store wide publication number, 0 = never published
+    int64_t timestamp_us;       // capture time, microseconds since boot
+    float temperature;          // Celsius
+    float humidity;             // %RH
+    float fused_temperature;    // sensor_filter estimate after this sample
+} sensor_dht22_sample_t;
+
+// Latest BMP180 reading including the derived metrics
+typedef struct {
+    uint32_t seq;
+    int64_t timestamp_us;
+    bmp180_readings_t readings;
+    float fused_temperature;
+} sensor_bmp180_sample_t;
+
+// Maximum number of publication listeners
+#define SENSOR_STORE_MAX_LISTENERS  8
+
+// Called in the publishing task right after a new sample became visible
+typedef void (*sensor_store_listener_t)(sensor_source_e source, void *arg);
+
+// Consistent view of every source
+typedef struct {
+    uint32_t seq;               // highest seq of the samples below
+    float temperature;          // fused estimate of the newest sample, NAN before there is one
+    sensor_dht22_sample_t dht22;
+    sensor_bmp180_sample_t bmp180;
+} sensor_snapshot_t;
+
+/*
+* Publishes a new DHT22 reading. Only call from sensor_filter, the drivers submit their readings there
+*/
+void sensor_store_publish_dht22(float temperature, float humidity, float fused_temperature);
+
+/*
+* Publishes a new set of BMP180 readings. Only call from sensor_filter
+*/
+void sensor_store_publish_bmp180(const bmp180_readings_t *readings, float fused_temperature);
+
+/*
+* Reserves the store channel of a source for one driver instance, a source has a single channel.
+* Call from the driver start, other instances of the same driver report through the sensor registry
+@return false if another instance holds the channel
+*/
+bool sensor_store_claim(sensor_source_e source, const void *owner);
+
+/*
+* Copies the latest DHT22 sample, never blocks the writer and never returns torn data
+*/
+void sensor_store_read_dht22(sensor_dht22_sample_t *sample);
+
+/*
+* Copies the latest BMP180 sample, never blocks the writer and never returns torn data
+*/
+void sensor_store_read_bmp180(sensor_bmp180_sample_t *sample);
+
+/*
+* Copies the latest sample of every source
+*/
+void sensor_store_read(sensor_snapshot_t *snapshot);
+
+/*
+* Registers a callback run after every publication. Register during start up,
+* before the sensor registry starts. Listeners execute in the periodic work task and must be short
+@return false if the listener table is full
+*/
+bool sensor_store_add_listener(sensor_store_listener_t listener, void *arg);
+
+/*
+* Returns the sequence number of the most recent publication
+@return 0 if nothing has been published yet
+*/
+uint32_t sensor_store_get_seq(void);
+
+#endif /* MAIN_SENSOR_STORE_H_ */
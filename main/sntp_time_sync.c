@@ -5,129 +5,172 @@
  *      Author: Karthik
  */
 #include "esp_log.h"
+#include "esp_sntp.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "lwip/apps/sntp.h"
-#include "portmacro.h"
-#include "tasks_common.h"
 #include "http_server.h"
+#include "periodic_work.h"
+#include "sdkconfig.h"
 #include "sntp_time_sync.h"
-#include "wifi_app.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
 #include <time.h>
 
 static const char TAG[] = "sntp_time_sync";
 
-// SNTP operating mode set status
-static bool sntp_op_mode_set = false;
 // Track if we've already sent the initialization message
 static bool time_service_init_sent = false;
 
+// Sync watchdog, restarts the client once two sync intervals passed without a sync
+#define SNTP_TIME_SYNC_CHECK_INTERVAL_MS	60000
+static void sntp_time_sync_check(void *arg);
+static periodic_work_job_t sntp_check_job = PERIODIC_WORK_JOB("sntp_check", &sntp_time_sync_check, NULL);
+static volatile TickType_t last_sync_tick = 0;
+static volatile bool synced = false;
+
+// Formatted local time of one second, shared by all readers and guarded by time_cache_mux
+static struct {
+	time_t second;
+	char text[SNTP_TIME_SYNC_TIME_LEN];
+	size_t len;
+} time_cache = { .second = -1 };
+static portMUX_TYPE time_cache_mux = portMUX_INITIALIZER_UNLOCKED;
+
 /*
-* Initialize SNTP service using SNTP_OPMODE_POLL mode
+* Lets the http_server know that the local time is usable, only once
 */
-static void sntp_time_sync_init_sntp(void)
+static void sntp_time_sync_notify_http_server(void)
 {
-	ESP_LOGI(TAG, "Initializing the SNTP service");
-	if (!sntp_op_mode_set)
-	{
-		// Set the operating mode
-		sntp_setoperatingmode(SNTP_OPMODE_POLL);
-		sntp_op_mode_set = true;
-	}
-	sntp_setservername(0, "pool.ntp.org");
-	
-	// Initialize the servers
-	sntp_init();
-	
-	// Let the http_server know that service is initialized
-	// Only send this message once
 	if (!time_service_init_sent)
 	{
-		http_server_monitor_send_message(HTTP_MSG_TIME_SERVICE_INITIALIZED);
 		time_service_init_sent = true;
+		http_server_monitor_send_message(HTTP_MSG_TIME_SERVICE_INITIALIZED);
 		ESP_LOGI(TAG, "Sent HTTP_MSG_TIME_SERVICE_INITIALIZED message");
 	}
 }
 
 /*
-* Gets the current time and if the current time is not upto date, the sntp_time_sync_init_sntp function is called
+* Time sync notification, called from the lwIP task after every completed sync.
+* The first sync steps the clock, later ones are slewed with adjtime()
+@param tv the time received from the server
 */
-static void sntp_time_sync_obtain_time(void)
+static void sntp_time_sync_notification_cb(struct timeval *tv)
 {
-	time_t now = 0;
-	struct tm time_info = {0};
-	
-	time(&now);
-	localtime_r(&now, &time_info);
-	
-	ESP_LOGI(TAG, "Current time check - Year: %d (comparing with 2016)", time_info.tm_year + 1900);
-	
-	// Check the time, in case we need to initialize/reinitialize
-	if (time_info.tm_year < (2016 - 1900))
-	{
-		ESP_LOGI(TAG, "Time not set, initializing SNTP");
-		sntp_time_sync_init_sntp();
-		// Set the local time zone
-		setenv("TZ", "IST-5:30", 1);
-		tzset();
-	}
-	else
-	{
-		ESP_LOGI(TAG, "Time appears to be set correctly");
-		// Send the initialization message if we haven't already
-		if (!time_service_init_sent)
-		{
-			http_server_monitor_send_message(HTTP_MSG_TIME_SERVICE_INITIALIZED);
-			time_service_init_sent = true;
-			ESP_LOGI(TAG, "Sent HTTP_MSG_TIME_SERVICE_INITIALIZED message (time already set)");
-		}
-	}
+	ESP_LOGD(TAG, "Time synchronized (%lld)", (long long)tv->tv_sec);
+	last_sync_tick = xTaskGetTickCount();
+	synced = true;
+	sntp_time_sync_notify_http_server();
 }
 
 /*
-* The SNTP time synchronization task
-@param arg pvParam
+* Periodic work job. Before the first sync the client retries on its own
 */
-static void sntp_time_sync(void *pvParam)
+static void sntp_time_sync_check(void *arg)
 {
-	ESP_LOGI(TAG, "SNTP time sync task started");
-	while(1)
+	const TickType_t limit = (TickType_t)CONFIG_SNTP_TIME_SYNC_INTERVAL_S * 2 * configTICK_RATE_HZ;
+	TickType_t now = xTaskGetTickCount();
+
+	if (!synced || !esp_sntp_enabled() || now - last_sync_tick < limit)
 	{
-		sntp_time_sync_obtain_time();
-		vTaskDelay(10000 / portTICK_PERIOD_MS);
+		return;
 	}
-	
-	vTaskDelete(NULL);
+
+	ESP_LOGW(TAG, "No sync for %"PRIu32" s, restarting SNTP", (uint32_t)((now - last_sync_tick) / configTICK_RATE_HZ));
+	last_sync_tick = now;
+	sntp_restart();
 }
 
-char* sntp_time_sync_get_time(void)
+static bool sntp_time_sync_is_set(const struct tm *time_info)
+{
+	return time_info->tm_year >= (2016 - 1900);
+}
+
+static size_t sntp_time_sync_format(time_t now, char *buf, size_t size)
 {
-	static char time_buffer[100] = {0};
-	
-	time_t now = 0;
 	struct tm time_info = {0};
-	
-	time(&now);
+
 	localtime_r(&now, &time_info);
-	
-	ESP_LOGI(TAG, "sntp_time_sync_get_time called - Year: %d", time_info.tm_year + 1900);
-	
-	if (time_info.tm_year < (2016 - 1900))
+	if (!sntp_time_sync_is_set(&time_info))
+	{
+		return (size_t)snprintf(buf, size, "Time not synchronized");
+	}
+	return strftime(buf, size, "%d/%m/%Y , %H:%M:%S", &time_info);
+}
+
+size_t sntp_time_sync_get_time(char *buf, size_t size)
+{
+	time_t now = time(NULL);
+	char text[SNTP_TIME_SYNC_TIME_LEN];
+	size_t len = 0;
+	bool hit;
+
+	if (size < SNTP_TIME_SYNC_TIME_LEN)
 	{
-		ESP_LOGI(TAG, "Time is not set yet");
-		strcpy(time_buffer, "Time not synchronized");
+		return 0;
 	}
-	else 
+
+	taskENTER_CRITICAL(&time_cache_mux);
+	hit = (time_cache.second == now);
+	if (hit)
 	{
-		strftime(time_buffer, sizeof(time_buffer), "%d/%m/%Y , %H:%M:%S", &time_info);
-		ESP_LOGI(TAG, "Current time info: %s", time_buffer);
+		len = time_cache.len;
+		memcpy(buf, time_cache.text, len + 1);
 	}
-	return time_buffer;
+	taskEXIT_CRITICAL(&time_cache_mux);
+
+	if (hit)
+	{
+		return len;
+	}
+
+	// First reader in this second formats it, outside the lock
+	len = sntp_time_sync_format(now, text, sizeof(text));
+
+	taskENTER_CRITICAL(&time_cache_mux);
+	time_cache.second = now;
+	time_cache.len = len;
+	memcpy(time_cache.text, text, len + 1);
+	taskEXIT_CRITICAL(&time_cache_mux);
+
+	memcpy(buf, text, len + 1);
+	return len;
 }
 
-void sntp_time_sync_task_start(void)
+void sntp_time_sync_start(void)
 {
-	ESP_LOGI(TAG, "Starting SNTP time sync task");
-	xTaskCreatePinnedToCore(&sntp_time_sync, "sntp_time_sync", SNTP_TIME_SYNC_TASK_STACK_SIZE, NULL, SNTP_TIME_SYNC_TASK_PRIORITY, NULL, SNTP_TIME_SYNC_TASK_CORE_ID);	
-}
\ No newline at end of file
+	if (esp_sntp_enabled())
+	{
+		// Reconnected, ask for a fresh sample instead of waiting out the interval
+		sntp_restart();
+		return;
+	}
+
+	ESP_LOGI(TAG, "Initializing the SNTP service");
+
+	// Set the local time zone
+	setenv("TZ", CONFIG_SNTP_TIME_SYNC_TZ, 1);
+	tzset();
+
+	esp_sntp_setoperatingmode(ESP_SNTP_OPMODE_POLL);
+	esp_sntp_setservername(0, CONFIG_SNTP_TIME_SYNC_SERVER);
+	sntp_set_sync_mode(SNTP_SYNC_MODE_SMOOTH);
+	sntp_set_sync_interval(CONFIG_SNTP_TIME_SYNC_INTERVAL_S * 1000U);
+	sntp_set_time_sync_notification_cb(&sntp_time_sync_notification_cb);
+	esp_sntp_init();
+	periodic_work_schedule(&sntp_check_job, SNTP_TIME_SYNC_CHECK_INTERVAL_MS, SNTP_TIME_SYNC_CHECK_INTERVAL_MS);
+
+	// The RTC keeps the time across a software restart, no need to wait for the server then
+	time_t now = 0;
+	struct tm time_info = {0};
+	time(&now);
+	localtime_r(&now, &time_info);
+	if (sntp_time_sync_is_set(&time_info))
+	{
+		ESP_LOGI(TAG, "Time already set");
+		sntp_time_sync_notify_http_server();
+	}
+}
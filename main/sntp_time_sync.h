@@ -8,15 +8,33 @@
 #ifndef MAIN_SNTP_TIME_SYNC_H_
 #define MAIN_SNTP_TIME_SYNC_H_
 
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_timer.h"
+
+// Buffer size for sntp_time_sync_get_time(), "dd/mm/YYYY , HH:MM:SS" or "Time not synchronized"
+#define SNTP_TIME_SYNC_TIME_LEN     32
+
+/*
+* Sets the time zone and starts SNTP with smooth adjustment, resyncing every
+* CONFIG_SNTP_TIME_SYNC_INTERVAL_S. Called again after a reconnect it only requests a new sync
+*/
+void sntp_time_sync_start(void);
+
 /*
-* Starts the NTP server synchronization task
+* Copies the local time as text, formatted at most once per second and shared by all callers
+* buf must hold SNTP_TIME_SYNC_TIME_LEN bytes
+@return length of the text, 0 if buf is too small
 */
-void sntp_time_sync_task_start(void);
+size_t sntp_time_sync_get_time(char *buf, size_t size);
 
 /*
-* Returns local time if set
-@return local time buffer
+* Monotonic microseconds since boot, not affected by SNTP adjustments. Cheap enough to
+* timestamp every sample
 */
-char* sntp_time_sync_get_time(void);
+static inline int64_t sntp_time_sync_monotonic_us(void)
+{
+    return esp_timer_get_time();
+}
 
 #endif /* MAIN_SNTP_TIME_SYNC_H_ */
@@ -0,0 +1,166 @@
+/*
+ * system_report.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include "tasks_common.h"
+#include "periodic_work.h"
+#include "system_report.h"
+
+static const char TAG[] = "system_report";
+
+// Tasks with the stack size they are created with, names as stored (CONFIG_FREERTOS_MAX_TASK_NAME_LEN)
+static const struct {
+	const char *name;
+	uint32_t stack_size;
+} system_report_tasks[] = {
+	{ "main", CONFIG_ESP_MAIN_TASK_STACK_SIZE },
+	{ "wifi_app_task", WIFI_APP_TASK_STACK_SIZE },
+	{ "httpd", HTTP_SERVER_TASK_STACK_SIZE },
+	{ "http_server_mon", HTTP_SERVER_MONITOR_STACK_SIZE },
+	{ "periodic_work", PERIODIC_WORK_TASK_STACK_SIZE },
+	{ "sample_log", SAMPLE_LOG_TASK_STACK_SIZE },
+	{ "ota_writer", OTA_WRITER_TASK_STACK_SIZE },
+	{ "uplink", UPLINK_TASK_STACK_SIZE },
+	{ "mesh", MESH_TASK_STACK_SIZE },
+	{ "esp_timer", CONFIG_ESP_TIMER_TASK_STACK_SIZE },
+	{ "sys_evt", CONFIG_ESP_SYSTEM_EVENT_TASK_STACK_SIZE },
+	{ "tiT", CONFIG_LWIP_TCPIP_TASK_STACK_SIZE },
+	{ "Tmr Svc", CONFIG_FREERTOS_TIMER_TASK_STACK_DEPTH },
+	{ "ipc0", CONFIG_ESP_IPC_TASK_STACK_SIZE },
+	{ "ipc1", CONFIG_ESP_IPC_TASK_STACK_SIZE },
+};
+
+#define SYSTEM_REPORT_TASK_COUNT	(sizeof(system_report_tasks) / sizeof(system_report_tasks[0]))
+
+static void system_report_job(void *arg);
+static periodic_work_job_t system_report_log_job = PERIODIC_WORK_JOB("system_report", &system_report_job, NULL);
+
+// Smallest amount of stack the task ever had left, in bytes
+static bool system_report_stack(int index, uint32_t *min_free)
+{
+	TaskHandle_t handle = xTaskGetHandle(system_report_tasks[index].name);
+	if (handle == NULL)
+	{
+		return false;
+	}
+	*min_free = uxTaskGetStackHighWaterMark(handle) * sizeof(StackType_t);
+	return true;
+}
+
+static void system_report_log_job_entry(const periodic_work_job_t *job, void *arg)
+{
+	ESP_LOGI(TAG, "job %-18s every %6"PRIu32" ms, %"PRIu32" runs, %"PRIu32" overruns, longest %"PRIu32" us",
+		job->name, (uint32_t)(job->period * portTICK_PERIOD_MS), job->runs, job->overruns, job->max_run_us);
+}
+
+void system_report_log(void)
+{
+	ESP_LOGI(TAG, "heap: %u free, %u minimum, %u largest block, %u internal free",
+		(unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT), (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+		(unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT), (unsigned)heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+
+	for (int i = 0; i < SYSTEM_REPORT_TASK_COUNT; i++)
+	{
+		uint32_t min_free;
+		if (system_report_stack(i, &min_free))
+		{
+			ESP_LOGI(TAG, "task %-15s stack %5"PRIu32", used at most %5"PRIu32", %5"PRIu32" never touched",
+				system_report_tasks[i].name, system_report_tasks[i].stack_size,
+				system_report_tasks[i].stack_size - min_free, min_free);
+		}
+	}
+
+	periodic_work_for_each(&system_report_log_job_entry, NULL);
+}
+
+static void system_report_job(void *arg)
+{
+	system_report_log();
+}
+
+void system_report_init(void)
+{
+#if CONFIG_SYSTEM_REPORT_LOG_INTERVAL_S > 0
+	periodic_work_schedule(&system_report_log_job, CONFIG_SYSTEM_REPORT_LOG_INTERVAL_S * 1000U,
+		CONFIG_SYSTEM_REPORT_LOG_INTERVAL_S * 1000U);
+#endif
+}
+
+// JSON output state for the job walk
+typedef struct
+{
+	char *buf;
+	size_t size;
+	size_t len;
+	bool ok;
+	bool first;
+} system_report_json_t;
+
+static void system_report_append(system_report_json_t *out, const char *fmt, ...)
+{
+	if (!out->ok)
+	{
+		return;
+	}
+
+	va_list args;
+	va_start(args, fmt);
+	int n = vsnprintf(out->buf + out->len, out->size - out->len, fmt, args);
+	va_end(args);
+
+	if (n < 0 || (size_t)n >= out->size - out->len)
+	{
+		out->ok = false;
+		return;
+	}
+	out->len += n;
+}
+
+static void system_report_json_job_entry(const periodic_work_job_t *job, void *arg)
+{
+	system_report_json_t *out = (system_report_json_t *)arg;
+
+	system_report_append(out, "%s{\"name\":\"%s\",\"period_ms\":%"PRIu32",\"runs\":%"PRIu32",\"overruns\":%"PRIu32",\"max_run_us\":%"PRIu32"}",
+		out->first ? "" : ",", job->name, (uint32_t)(job->period * portTICK_PERIOD_MS), job->runs, job->overruns, job->max_run_us);
+	out->first = false;
+}
+
+size_t system_report_format_json(char *buf, size_t size)
+{
+	system_report_json_t out = { .buf = buf, .size = size, .len = 0, .ok = size > 0, .first = true };
+
+	system_report_append(&out, "{\"heap\":{\"free\":%u,\"min_free\":%u,\"largest_block\":%u,\"internal_free\":%u,\"internal_min_free\":%u},\"tasks\":[",
+		(unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT), (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+		(unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT), (unsigned)heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+		(unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
+
+	for (int i = 0; i < SYSTEM_REPORT_TASK_COUNT; i++)
+	{
+		uint32_t min_free;
+		if (system_report_stack(i, &min_free))
+		{
+			system_report_append(&out, "%s{\"name\":\"%s\",\"stack\":%"PRIu32",\"stack_min_free\":%"PRIu32"}",
+				out.first ? "" : ",", system_report_tasks[i].name, system_report_tasks[i].stack_size, min_free);
+			out.first = false;
+		}
+	}
+
+	system_report_append(&out, "],\"jobs\":[");
+	out.first = true;
+	periodic_work_for_each(&system_report_json_job_entry, &out);
+	system_report_append(&out, "]}");
+
+	return out.ok ? out.len : 0;
+}
@@ -0,0 +1,33 @@
+/*
+ * system_report.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef MAIN_SYSTEM_REPORT_H_
+#define MAIN_SYSTEM_REPORT_H_
+
+#include <stddef.h>
+
+// Buffer size that fits system_report_format_json()
+#define SYSTEM_REPORT_JSON_SIZE     2048
+
+/*
+* Schedules the periodic report on the log, see CONFIG_SYSTEM_REPORT_LOG_INTERVAL_S
+*/
+void system_report_init(void);
+
+/*
+* Logs the heap, the stack high water mark of every known task and the periodic work jobs
+*/
+void system_report_log(void);
+
+/*
+* Writes the same report as JSON: {"heap":{...},"tasks":[...],"jobs":[...]}
+* Stack figures are in bytes, a task that does not exist right now is left out
+@return length written, or 0 if the buffer is too small
+*/
+size_t system_report_format_json(char *buf, size_t size);
+
+#endif /* MAIN_SYSTEM_REPORT_H_ */
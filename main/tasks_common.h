@@ -23,25 +23,30 @@
 #define HTTP_SERVER_MONITOR_PRIORITY			3
 #define HTTP_SERVER_MONITOR_CORE_ID				0
 
-// Wifi Reset Button task
-#define WIFI_RESET_BUTTON_TASK_STACK_SIZE		2048
-#define WIFI_RESET_BUTTON_TASK_PRIORITY			6
-#define WIFI_RESET_BUTTON_TASK_CORE_ID			0
-
-// DHT22 Sensor task
-#define DHT22_TASK_STACK_SIZE					4096
-#define DHT22_TASK_PRIORITY						5
-#define DHT22_TASK_CORE_ID						1
-
-// BMP180 Sensor task
-#define BMP180_TASK_STACK_SIZE					4096
-#define BMP180_TASK_PRIORITY					5
-#define BMP180_TASK_CORE_ID						1
-
-// SNTP Time sync task
-#define SNTP_TIME_SYNC_TASK_STACK_SIZE			4096
-#define SNTP_TIME_SYNC_TASK_PRIORITY			4
-#define SNTP_TIME_SYNC_TASK_CORE_ID				1
+// Periodic work task: sensor sampling, time checks, the reset button and reports
+#define PERIODIC_WORK_TASK_STACK_SIZE			4096
+#define PERIODIC_WORK_TASK_PRIORITY				5
+#define PERIODIC_WORK_TASK_CORE_ID				1
+
+// Sample log flash writer task
+#define SAMPLE_LOG_TASK_STACK_SIZE				3072
+#define SAMPLE_LOG_TASK_PRIORITY				2
+#define SAMPLE_LOG_TASK_CORE_ID					1
+
+// OTA flash writer task, only exists while an update runs
+#define OTA_WRITER_TASK_STACK_SIZE				4096
+#define OTA_WRITER_TASK_PRIORITY				4
+#define OTA_WRITER_TASK_CORE_ID					1
+
+// MQTT uplink task, batches sample log rows for the broker
+#define UPLINK_TASK_STACK_SIZE					4096
+#define UPLINK_TASK_PRIORITY					2
+#define UPLINK_TASK_CORE_ID						0
+
+// ESP-NOW mesh task, gateway frame handling or leaf send cycles
+#define MESH_TASK_STACK_SIZE					4096
+#define MESH_TASK_PRIORITY						3
+#define MESH_TASK_CORE_ID						0
 
 
 #endif /* MAIN_TASKS_COMMON_H_ */
@@ -0,0 +1,273 @@
+/*
+ * telemetry_cache.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "sensor_store.h"
+#include "sensor_filter.h"
+#include "sntp_time_sync.h"
+#include "cbor_writer.h"
+#include "metrics.h"
+#include "telemetry_cache.h"
+
+static const char TAG[] = "telemetry_cache";
+
+#define TELEMETRY_WIFI_SIZE     160
+
+// Serialized body and the parts it is built from, guarded by cache_mutex
+static SemaphoreHandle_t cache_mutex = NULL;
+static char body[TELEMETRY_CACHE_SIZE];
+static size_t body_len = 0;
+static uint32_t body_seq = 0;
+static uint8_t cbor_body[TELEMETRY_CACHE_CBOR_SIZE];
+static size_t cbor_body_len = 0;
+static char wifi[TELEMETRY_WIFI_SIZE] = "null";
+
+static telemetry_cache_listener_t cache_listener = NULL;
+static metrics_counter_t cache_rebuilds = METRICS_COUNTER("telemetry_cache_rebuilds_total", "Telemetry bodies serialized", NULL);
+
+static int32_t telemetry_cache_scale(float value, float scale)
+{
+	float v = value * scale;
+	return (int32_t)(v < 0 ? v - 0.5f : v + 0.5f);
+}
+
+size_t telemetry_cache_encode_cbor(const sensor_snapshot_t *snapshot, uint8_t sources, uint8_t *buf, size_t size)
+{
+	cbor_writer_t w;
+	const bmp180_readings_t *r = &snapshot->bmp180.readings;
+	bool dht = (sources & TELEMETRY_CBOR_SOURCE_DHT22) && snapshot->dht22.seq != 0;
+	bool bmp = (sources & TELEMETRY_CBOR_SOURCE_BMP180) && r->valid;
+
+	bool dew = bmp && !isnan(r->dew_point);
+	bool fused = !isnan(snapshot->temperature);
+	uint8_t stale = sensor_filter_stale_sources(snapshot) & sources;
+
+	cbor_writer_init(&w, buf, size);
+	cbor_put_map(&w, 2 + (dht ? 2 : 0) + (bmp ? 5 : 0) + (dew ? 1 : 0) + (fused ? 1 : 0) + (stale ? 1 : 0));
+	cbor_put_uint(&w, TELEMETRY_CBOR_SEQ);
+	cbor_put_uint(&w, snapshot->seq);
+	cbor_put_uint(&w, TELEMETRY_CBOR_TIME);
+	cbor_put_uint(&w, (uint32_t)time(NULL));
+	if (fused)
+	{
+		cbor_put_uint(&w, TELEMETRY_CBOR_TEMPERATURE);
+		cbor_put_int(&w, telemetry_cache_scale(snapshot->temperature, 100.0f));
+	}
+	if (dht)
+	{
+		cbor_put_uint(&w, TELEMETRY_CBOR_DHT_TEMPERATURE);
+		cbor_put_int(&w, telemetry_cache_scale(snapshot->dht22.temperature, 100.0f));
+		cbor_put_uint(&w, TELEMETRY_CBOR_HUMIDITY);
+		cbor_put_int(&w, telemetry_cache_scale(snapshot->dht22.humidity, 100.0f));
+	}
+	if (bmp)
+	{
+		cbor_put_uint(&w, TELEMETRY_CBOR_BMP_TEMPERATURE);
+		cbor_put_int(&w, telemetry_cache_scale(r->temperature, 100.0f));
+		cbor_put_uint(&w, TELEMETRY_CBOR_PRESSURE);
+		cbor_put_uint(&w, r->pressure);
+		cbor_put_uint(&w, TELEMETRY_CBOR_SEA_LEVEL_PRESSURE);
+		cbor_put_uint(&w, (uint32_t)telemetry_cache_scale(r->sea_level_pressure, 1.0f));
+		cbor_put_uint(&w, TELEMETRY_CBOR_ALTITUDE);
+		cbor_put_int(&w, telemetry_cache_scale(r->altitude, 10.0f));
+		cbor_put_uint(&w, TELEMETRY_CBOR_AIR_DENSITY);
+		cbor_put_uint(&w, (uint32_t)telemetry_cache_scale(r->air_density, 1000.0f));
+	}
+	if (dew)
+	{
+		cbor_put_uint(&w, TELEMETRY_CBOR_DEW_POINT);
+		cbor_put_int(&w, telemetry_cache_scale(r->dew_point, 100.0f));
+	}
+	if (stale)
+	{
+		cbor_put_uint(&w, TELEMETRY_CBOR_STALE);
+		cbor_put_uint(&w, stale);
+	}
+	return cbor_writer_length(&w);
+}
+
+size_t telemetry_cache_format_json(const sensor_snapshot_t *snapshot, const char *wifi_json, char *buf, size_t size)
+{
+	char time_str[SNTP_TIME_SYNC_TIME_LEN];
+	const bmp180_readings_t *r = &snapshot->bmp180.readings;
+	uint8_t stale = sensor_filter_stale_sources(snapshot);
+
+	sntp_time_sync_get_time(time_str, sizeof(time_str));
+
+	int len = snprintf(buf, size, "{\"seq\":%"PRIu32",", snapshot->seq);
+	if (isnan(snapshot->temperature))
+	{
+		len += snprintf(buf + len, size - len, "\"temperature\":null,");
+	}
+	else
+	{
+		len += snprintf(buf + len, size - len, "\"temperature\":\"%.1f\",", snapshot->temperature);
+	}
+	len += snprintf(buf + len, size - len, "\"dht\":{\"temperature\":\"%.1f\",\"humidity\":\"%.1f\",\"stale\":%s},",
+		snapshot->dht22.temperature, snapshot->dht22.humidity, (stale & (1 << SENSOR_SOURCE_DHT22)) ? "true" : "false");
+	if (r->valid)
+	{
+		len += snprintf(buf + len, size - len,
+			"\"bmp180\":{\"temperature\":\"%.1f\",\"pressure\":\"%.2f\",\"sea_level_pressure\":\"%.2f\",\"altitude\":\"%.1f\",\"dew_point\":\"%.1f\",\"air_density\":\"%.3f\",\"stale\":%s},",
+			r->temperature, r->pressure_hPa, r->sea_level_pressure / 100.0f, r->altitude,
+			isnan(r->dew_point) ? 0.0f : r->dew_point, r->air_density, (stale & (1 << SENSOR_SOURCE_BMP180)) ? "true" : "false");
+	}
+	else
+	{
+		len += snprintf(buf + len, size - len, "\"bmp180\":null,");
+	}
+	len += snprintf(buf + len, size - len, "\"time\":\"%s\",\"wifi\":%s}", time_str, wifi_json);
+	return (len < size) ? len : 0;
+}
+
+/*
+* Serializes the body from the latest snapshot. Runs outside the mutex, only copying the
+* wifi object and the body are locked
+*/
+static void telemetry_cache_rebuild(void)
+{
+	char buf[TELEMETRY_CACHE_SIZE];
+	uint8_t cbor[TELEMETRY_CACHE_CBOR_SIZE];
+	char wifi_json[TELEMETRY_WIFI_SIZE];
+	sensor_snapshot_t snapshot;
+
+	sensor_store_read(&snapshot);
+	size_t cbor_len = telemetry_cache_encode_cbor(&snapshot, TELEMETRY_CBOR_SOURCE_ALL, cbor, sizeof(cbor));
+
+	xSemaphoreTake(cache_mutex, portMAX_DELAY);
+	memcpy(wifi_json, wifi, sizeof(wifi_json));
+	xSemaphoreGive(cache_mutex);
+
+	size_t len = telemetry_cache_format_json(&snapshot, wifi_json, buf, sizeof(buf));
+	metrics_counter_inc(&cache_rebuilds);
+	if (len == 0)
+	{
+		ESP_LOGE(TAG, "Body truncated");
+		return;
+	}
+
+	xSemaphoreTake(cache_mutex, portMAX_DELAY);
+	// Both sensor tasks rebuild, never let a preempted older snapshot replace a newer one
+	if ((int32_t)(snapshot.seq - body_seq) < 0)
+	{
+		xSemaphoreGive(cache_mutex);
+		return;
+	}
+	memcpy(body, buf, len + 1);
+	body_len = len;
+	body_seq = snapshot.seq;
+	memcpy(cbor_body, cbor, cbor_len);
+	cbor_body_len = cbor_len;
+	xSemaphoreGive(cache_mutex);
+
+	telemetry_cache_listener_t listener = cache_listener;
+	if (listener != NULL)
+	{
+		listener(snapshot.seq);
+	}
+}
+
+static void telemetry_cache_on_publish(sensor_source_e source, void *arg)
+{
+	telemetry_cache_rebuild();
+}
+
+esp_err_t telemetry_cache_init(void)
+{
+	if (cache_mutex != NULL)
+	{
+		return ESP_OK;
+	}
+
+	cache_mutex = xSemaphoreCreateMutex();
+	if (cache_mutex == NULL)
+	{
+		return ESP_ERR_NO_MEM;
+	}
+
+	if (!sensor_store_add_listener(&telemetry_cache_on_publish, NULL))
+	{
+		ESP_LOGE(TAG, "No free sensor store listener");
+		return ESP_FAIL;
+	}
+	metrics_register_counter(&cache_rebuilds);
+
+	// Serve a body before the first publication
+	telemetry_cache_rebuild();
+	return ESP_OK;
+}
+
+void telemetry_cache_set_wifi(const char *wifi_json)
+{
+	if (cache_mutex == NULL)
+	{
+		return;
+	}
+
+	xSemaphoreTake(cache_mutex, portMAX_DELAY);
+	snprintf(wifi, sizeof(wifi), "%s", wifi_json ? wifi_json : "null");
+	xSemaphoreGive(cache_mutex);
+
+	telemetry_cache_rebuild();
+}
+
+void telemetry_cache_set_listener(telemetry_cache_listener_t listener)
+{
+	cache_listener = listener;
+}
+
+size_t telemetry_cache_get(char *buf, size_t size, uint32_t *seq)
+{
+	size_t len = 0;
+
+	if (cache_mutex == NULL || size == 0)
+	{
+		return 0;
+	}
+
+	xSemaphoreTake(cache_mutex, portMAX_DELAY);
+	if (body_len < size)
+	{
+		memcpy(buf, body, body_len + 1);
+		len = body_len;
+	}
+	if (seq != NULL)
+	{
+		*seq = body_seq;
+	}
+	xSemaphoreGive(cache_mutex);
+	return len;
+}
+
+size_t telemetry_cache_get_cbor(uint8_t *buf, size_t size, uint32_t *seq)
+{
+	size_t len = 0;
+
+	if (cache_mutex == NULL)
+	{
+		return 0;
+	}
+
+	xSemaphoreTake(cache_mutex, portMAX_DELAY);
+	if (cbor_body_len <= size)
+	{
+		memcpy(buf, cbor_body, cbor_body_len);
+		len = cbor_body_len;
+	}
+	if (seq != NULL)
+	{
+		*seq = body_seq;
+	}
+	xSemaphoreGive(cache_mutex);
+	return len;
+}
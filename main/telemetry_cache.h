@@ -0,0 +1,90 @@
+/*
+ * telemetry_cache.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef MAIN_TELEMETRY_CACHE_H_
+#define MAIN_TELEMETRY_CACHE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "sensor_store.h"
+
+// Largest serialized body
+#define TELEMETRY_CACHE_SIZE        512
+#define TELEMETRY_CACHE_CBOR_SIZE   96
+
+/*
+* CBOR snapshot: one map with small integer keys and scaled integer values, about a seventh
+* of the JSON body. Keys of a source that has not published (or BMP180 readings that are not
+* valid) are left out, as is the dew point while there is no current humidity
+*/
+#define TELEMETRY_CBOR_SEQ                  0   // uint, sensor store publication number
+#define TELEMETRY_CBOR_TIME                 1   // uint, time() seconds
+#define TELEMETRY_CBOR_DHT_TEMPERATURE      2   // int, 0.01 C
+#define TELEMETRY_CBOR_HUMIDITY             3   // int, 0.01 %RH
+#define TELEMETRY_CBOR_BMP_TEMPERATURE      4   // int, 0.01 C
+#define TELEMETRY_CBOR_PRESSURE             5   // uint, Pa
+#define TELEMETRY_CBOR_SEA_LEVEL_PRESSURE   6   // uint, Pa
+#define TELEMETRY_CBOR_ALTITUDE             7   // int, 0.1 m
+#define TELEMETRY_CBOR_DEW_POINT            8   // int, 0.01 C
+#define TELEMETRY_CBOR_AIR_DENSITY          9   // uint, g/m3
+#define TELEMETRY_CBOR_TEMPERATURE          10  // int, 0.01 C, fused DHT22/BMP180 estimate
+#define TELEMETRY_CBOR_STALE                11  // uint, TELEMETRY_CBOR_SOURCE_* gone stale, left out if none
+
+// Sources for telemetry_cache_encode_cbor()
+#define TELEMETRY_CBOR_SOURCE_DHT22         (1 << SENSOR_SOURCE_DHT22)
+#define TELEMETRY_CBOR_SOURCE_BMP180        (1 << SENSOR_SOURCE_BMP180)
+#define TELEMETRY_CBOR_SOURCE_ALL           (TELEMETRY_CBOR_SOURCE_DHT22 | TELEMETRY_CBOR_SOURCE_BMP180)
+
+/*
+* Called after the cached body has been replaced, from the task that caused the update
+*/
+typedef void (*telemetry_cache_listener_t)(uint32_t seq);
+
+/*
+* Subscribes to the sensor store, the body is serialized once per publication
+@return ESP_OK if successful
+*/
+esp_err_t telemetry_cache_init(void);
+
+/*
+* Sets the "wifi" object of the body, NULL while the station is not connected
+*/
+void telemetry_cache_set_wifi(const char *wifi_json);
+
+/*
+* Sets the function told about every new body, only one is kept
+*/
+void telemetry_cache_set_listener(telemetry_cache_listener_t listener);
+
+/*
+* Copies the current body (NUL terminated) and its sensor store sequence number
+@return body length, 0 if nothing has been serialized yet
+*/
+size_t telemetry_cache_get(char *buf, size_t size, uint32_t *seq);
+
+/*
+* Copies the CBOR form of the current body, serialized along with the JSON one. It carries the
+* sensor values only, the wifi object stays JSON
+@return body length, 0 if nothing has been serialized yet
+*/
+size_t telemetry_cache_get_cbor(uint8_t *buf, size_t size, uint32_t *seq);
+
+/*
+* Encodes the given sources of a snapshot as a CBOR map, see TELEMETRY_CBOR_*
+@return length written, or 0 if the buffer is too small
+*/
+size_t telemetry_cache_encode_cbor(const sensor_snapshot_t *snapshot, uint8_t sources, uint8_t *buf, size_t size);
+
+/*
+* Serializes a snapshot as the JSON body with the given "wifi" object, buf holds at least
+* TELEMETRY_CACHE_SIZE bytes
+@return length written, or 0 if the body did not fit
+*/
+size_t telemetry_cache_format_json(const sensor_snapshot_t *snapshot, const char *wifi_json, char *buf, size_t size);
+
+#endif /* MAIN_TELEMETRY_CACHE_H_ */
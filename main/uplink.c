@@ -0,0 +1,486 @@
+/*
+ * uplink.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#include "sdkconfig.h"
+
+#if CONFIG_UPLINK_ENABLED
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
+#include "mqtt_client.h"
+#include "app_nvs.h"
+#include "cbor_writer.h"
+#include "mesh.h"
+#include "metrics.h"
+#include "sample_log.h"
+#include "sensor_alert.h"
+#include "tasks_common.h"
+#include "uplink.h"
+
+static const char TAG[] = "uplink";
+
+#define UPLINK_ACK_TIMEOUT_MS           10000
+#define UPLINK_FLUSH_POLL_MS            100
+#define UPLINK_CURSOR_SAVE_INTERVAL_US  (600 * 1000000LL)    // bounds the rows repeated after a reboot
+#if CONFIG_UPLINK_PAYLOAD_CBOR
+#define UPLINK_PAYLOAD_MAX_SIZE         (UPLINK_CBOR_HEADER_MAX_SIZE + CONFIG_UPLINK_BATCH_ROWS * UPLINK_CBOR_ROW_MAX_SIZE)
+#define UPLINK_TOPIC_SUFFIX             "samples/cbor"
+#else
+#define UPLINK_PAYLOAD_MAX_SIZE         (sizeof(uplink_batch_header_t) + CONFIG_UPLINK_BATCH_ROWS * sizeof(sensor_history_row_t))
+#define UPLINK_TOPIC_SUFFIX             "samples"
+#endif
+
+// Event group bits
+#define UPLINK_CONNECTED_BIT            BIT0    // broker session up
+#define UPLINK_DRAIN_BIT                BIT1    // send everything pending now
+#define UPLINK_PUBLISHED_BIT            BIT2    // the batch in flight was acknowledged
+#define UPLINK_LINK_LOST_BIT            BIT3    // ends a wait for an acknowledgement
+#define UPLINK_FLUSH_BIT                BIT4    // uplink_flush() waits, save the cursor right away
+#define UPLINK_DRAINED_BIT              BIT5    // the cursor reached the log head
+
+static esp_mqtt_client_handle_t uplink_client = NULL;
+static EventGroupHandle_t uplink_events = NULL;
+static bool uplink_running = false;
+
+/*
+* Acknowledgements of the batch in flight. Alerts and leaf rows are acknowledged through the same
+* event, only a match on the batch's message id ends the wait. The PUBACK can also arrive before
+* esp_mqtt_client_publish() returned the id, so the handler keeps the ids it saw in a ring that the
+* uplink task checks once the id is known
+*/
+#define UPLINK_NO_MSG_ID                -1
+#define UPLINK_ACKED_RING_SIZE          8
+static atomic_int uplink_batch_msg_id = UPLINK_NO_MSG_ID;
+static atomic_int uplink_acked_ring[UPLINK_ACKED_RING_SIZE];
+static atomic_uint uplink_acked_count;
+
+static char uplink_client_id[24];
+static char uplink_topic[64];
+static char uplink_alert_topic[64];
+static uint8_t uplink_mac[6];
+
+// Next log sequence number to send, only touched by the uplink task
+static uint32_t uplink_cursor = 0;
+static uint32_t uplink_saved_cursor = 0;
+static int64_t uplink_saved_at = 0;
+
+static struct {
+	uplink_batch_header_t header;
+	sensor_history_row_t rows[CONFIG_UPLINK_BATCH_ROWS];
+} __attribute__((packed)) uplink_batch;
+
+#if CONFIG_UPLINK_PAYLOAD_CBOR
+static uint8_t uplink_cbor[UPLINK_PAYLOAD_MAX_SIZE];
+#endif
+
+#if CONFIG_MESH_ROLE_GATEWAY
+// Leaf rows are forwarded as they arrive, one frame's worth at a time, only touched by the mesh task
+#if CONFIG_UPLINK_PAYLOAD_CBOR
+static uint8_t uplink_leaf_payload[UPLINK_CBOR_HEADER_MAX_SIZE + MESH_FRAME_MAX_ROWS * UPLINK_CBOR_ROW_MAX_SIZE];
+#else
+static uint8_t uplink_leaf_payload[sizeof(uplink_batch_header_t) + MESH_FRAME_MAX_ROWS * sizeof(sensor_history_row_t)];
+#endif
+#endif
+
+static metrics_counter_t uplink_batches = METRICS_COUNTER("uplink_batches_total", "Batches acknowledged by the broker", NULL);
+static metrics_counter_t uplink_rows = METRICS_COUNTER("uplink_rows_total", "Rows acknowledged by the broker", NULL);
+static metrics_counter_t uplink_rows_dropped = METRICS_COUNTER("uplink_rows_dropped_total", "Rows lost before they were sent (log wrapped or unreadable)", NULL);
+static metrics_counter_t uplink_failures = METRICS_COUNTER("uplink_publish_failures_total", "Batches that were not acknowledged in time", NULL);
+static metrics_gauge_t uplink_pending = METRICS_GAUGE("uplink_pending_rows", "Rows in the sample log not sent yet", NULL);
+#if CONFIG_MESH_ROLE_GATEWAY
+static metrics_counter_t uplink_leaf_rows_skipped = METRICS_COUNTER("uplink_leaf_rows_skipped_total", "Leaf rows not forwarded because the broker was not connected", NULL);
+#endif
+
+static void uplink_mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+	esp_mqtt_event_handle_t event = (esp_mqtt_event_handle_t)event_data;
+
+	switch ((esp_mqtt_event_id_t)event_id)
+	{
+		case MQTT_EVENT_CONNECTED:
+			ESP_LOGI(TAG, "Connected to %s", CONFIG_UPLINK_BROKER_URI);
+			xEventGroupClearBits(uplink_events, UPLINK_LINK_LOST_BIT);
+			xEventGroupSetBits(uplink_events, UPLINK_CONNECTED_BIT | UPLINK_DRAIN_BIT);
+			break;
+
+		case MQTT_EVENT_DISCONNECTED:
+			xEventGroupClearBits(uplink_events, UPLINK_CONNECTED_BIT);
+			xEventGroupSetBits(uplink_events, UPLINK_LINK_LOST_BIT);
+			break;
+
+		case MQTT_EVENT_PUBLISHED:
+		{
+			// Only this task writes the ring, the count is bumped after the slot is filled
+			unsigned count = atomic_load(&uplink_acked_count);
+			atomic_store(&uplink_acked_ring[count % UPLINK_ACKED_RING_SIZE], event->msg_id);
+			atomic_store(&uplink_acked_count, count + 1);
+			if (event->msg_id == atomic_load(&uplink_batch_msg_id))
+			{
+				xEventGroupSetBits(uplink_events, UPLINK_PUBLISHED_BIT);
+			}
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
+#if CONFIG_UPLINK_PAYLOAD_CBOR
+// Encodes consecutive rows of the node with the given MAC as one CBOR batch
+static size_t uplink_encode_cbor(uint8_t *buf, size_t size, const uint8_t mac[6], uint32_t first_seq,
+	const sensor_history_row_t *rows, uint16_t count)
+{
+	cbor_writer_t w;
+
+	cbor_writer_init(&w, buf, size);
+	cbor_put_map(&w, 3);
+	cbor_put_text(&w, "v");
+	cbor_put_uint(&w, UPLINK_PAYLOAD_VERSION);
+	cbor_put_text(&w, "mac");
+	cbor_put_bytes(&w, mac, 6);
+	cbor_put_text(&w, "rows");
+	cbor_put_array(&w, count);
+	for (uint16_t i = 0; i < count; i++)
+	{
+		sensor_history_put_cbor_row(&w, first_seq + i, &rows[i]);
+	}
+	return cbor_writer_length(&w);
+}
+#endif
+
+// Publishes the batch and waits for the broker to take it, QoS 0 counts as taken once sent
+static bool uplink_publish(const void *payload, size_t len)
+{
+	atomic_store(&uplink_batch_msg_id, UPLINK_NO_MSG_ID);
+	xEventGroupClearBits(uplink_events, UPLINK_PUBLISHED_BIT);
+	unsigned acked_before = atomic_load(&uplink_acked_count);
+
+	int msg_id = esp_mqtt_client_publish(uplink_client, uplink_topic, (const char *)payload, len, CONFIG_UPLINK_QOS, 0);
+	if (msg_id < 0)
+	{
+		return false;
+	}
+	if (CONFIG_UPLINK_QOS == 0)
+	{
+		return true;
+	}
+
+	// From here on the handler matches the id itself, before that only the ring has it
+	atomic_store(&uplink_batch_msg_id, msg_id);
+	unsigned acked_now = atomic_load(&uplink_acked_count);
+	if (acked_now - acked_before > UPLINK_ACKED_RING_SIZE)
+	{
+		acked_before = acked_now - UPLINK_ACKED_RING_SIZE;
+	}
+	for (unsigned i = acked_before; i != acked_now; i++)
+	{
+		if (atomic_load(&uplink_acked_ring[i % UPLINK_ACKED_RING_SIZE]) == msg_id)
+		{
+			return true;
+		}
+	}
+
+	// Only the batch's own acknowledgement sets the bit, a lost link ends the wait early
+	EventBits_t bits = xEventGroupWaitBits(uplink_events, UPLINK_PUBLISHED_BIT | UPLINK_LINK_LOST_BIT,
+		pdFALSE, pdFALSE, pdMS_TO_TICKS(UPLINK_ACK_TIMEOUT_MS));
+	return (bits & UPLINK_PUBLISHED_BIT) != 0;
+}
+
+/*
+* Alert listener, runs in the periodic work task. Alerts go out on their own topic with QoS 1
+* through the client outbox, so the sensor jobs never wait for the broker and alerts raised while
+* the link is down are sent after the reconnect
+*/
+static void uplink_on_alert(const sensor_alert_event_t *event, void *arg)
+{
+	char payload[SENSOR_ALERT_EVENT_JSON_SIZE];
+	size_t len = sensor_alert_format_event(event, payload, sizeof(payload));
+
+	if (len == 0)
+	{
+		return;
+	}
+	if (esp_mqtt_client_enqueue(uplink_client, uplink_alert_topic, payload, len, 1, 0, true) < 0)
+	{
+		ESP_LOGW(TAG, "Alert of rule %u not queued", event->id);
+	}
+}
+
+#if CONFIG_MESH_ROLE_GATEWAY
+/*
+* Mesh listener, runs in the mesh task. Leaf rows go out as a batch of the leaf's MAC on its own
+* topic with QoS 1 through the client outbox, like the alerts. Nothing sends or expires the outbox
+* while the link is down, so rows arriving then are left to the gateway history, a broker outage
+* would otherwise fill the heap
+*/
+static void uplink_on_leaf_rows(const uint8_t leaf[6], uint32_t first_seq, const sensor_history_row_t *rows, size_t count, void *arg)
+{
+	char topic[64];
+	size_t len;
+
+	if (!(xEventGroupGetBits(uplink_events) & UPLINK_CONNECTED_BIT))
+	{
+		metrics_counter_add(&uplink_leaf_rows_skipped, count);
+		return;
+	}
+	snprintf(topic, sizeof(topic), "%s/%02x%02x%02x%02x%02x%02x/" UPLINK_TOPIC_SUFFIX, CONFIG_UPLINK_TOPIC_PREFIX,
+		leaf[0], leaf[1], leaf[2], leaf[3], leaf[4], leaf[5]);
+#if CONFIG_UPLINK_PAYLOAD_CBOR
+	len = uplink_encode_cbor(uplink_leaf_payload, sizeof(uplink_leaf_payload), leaf, first_seq, rows, count);
+#else
+	uplink_batch_header_t header = {
+		.version = UPLINK_PAYLOAD_VERSION,
+		.row_size = sizeof(sensor_history_row_t),
+		.count = count,
+		.first_seq = first_seq,
+	};
+	memcpy(header.mac, leaf, sizeof(header.mac));
+	memcpy(uplink_leaf_payload, &header, sizeof(header));
+	memcpy(uplink_leaf_payload + sizeof(header), rows, count * sizeof(sensor_history_row_t));
+	len = sizeof(header) + count * sizeof(sensor_history_row_t);
+#endif
+	if (esp_mqtt_client_enqueue(uplink_client, topic, (const char *)uplink_leaf_payload, len, 1, 0, true) < 0)
+	{
+		ESP_LOGW(TAG, "Rows of leaf %s not queued", topic);
+	}
+}
+#endif
+
+static void uplink_save_cursor(bool force)
+{
+	int64_t now = esp_timer_get_time();
+
+	if (uplink_cursor != uplink_saved_cursor && (force || now - uplink_saved_at >= UPLINK_CURSOR_SAVE_INTERVAL_US))
+	{
+		if (app_nvs_save_uplink_cursor(uplink_cursor) == ESP_OK)
+		{
+			uplink_saved_cursor = uplink_cursor;
+			uplink_saved_at = now;
+		}
+	}
+}
+
+// Sends everything logged since the cursor, one batch of up to CONFIG_UPLINK_BATCH_ROWS at a time
+static void uplink_drain(void)
+{
+	uint32_t head = sample_log_head();
+	uint32_t tail = sample_log_tail();
+
+	// The log wrapped past unsent rows or was formatted
+	if (uplink_cursor < tail || uplink_cursor > head)
+	{
+		uint32_t lost = (uplink_cursor < tail) ? tail - uplink_cursor : 0;
+		ESP_LOGW(TAG, "Cursor %"PRIu32" outside the log (%"PRIu32"..%"PRIu32"), %"PRIu32" rows lost",
+			uplink_cursor, tail, head, lost);
+		metrics_counter_add(&uplink_rows_dropped, lost);
+		uplink_cursor = tail;
+	}
+
+	while (uplink_cursor < head && (xEventGroupGetBits(uplink_events) & UPLINK_CONNECTED_BIT))
+	{
+		uint32_t first = uplink_cursor;
+		uint16_t count = 0;
+
+		// Unreadable rows ahead of the batch are skipped, one inside it ends the batch
+		while (first + count < head && count < CONFIG_UPLINK_BATCH_ROWS)
+		{
+			if (sample_log_read(first + count, &uplink_batch.rows[count]))
+			{
+				count++;
+			}
+			else if (count == 0)
+			{
+				first++;
+				metrics_counter_inc(&uplink_rows_dropped);
+			}
+			else
+			{
+				break;
+			}
+		}
+		if (count == 0)
+		{
+			uplink_cursor = first;
+			break;
+		}
+
+		uplink_batch.header.count = count;
+		uplink_batch.header.first_seq = first;
+#if CONFIG_UPLINK_PAYLOAD_CBOR
+		bool sent = uplink_publish(uplink_cbor, uplink_encode_cbor(uplink_cbor, sizeof(uplink_cbor), uplink_mac,
+			first, uplink_batch.rows, count));
+#else
+		bool sent = uplink_publish(&uplink_batch, sizeof(uplink_batch.header) + count * sizeof(sensor_history_row_t));
+#endif
+		if (!sent)
+		{
+			ESP_LOGW(TAG, "Batch at %"PRIu32" not acknowledged, retrying later", first);
+			metrics_counter_inc(&uplink_failures);
+			break;
+		}
+
+		uplink_cursor = first + count;
+		metrics_counter_inc(&uplink_batches);
+		metrics_counter_add(&uplink_rows, count);
+		uplink_save_cursor(false);
+	}
+
+	metrics_gauge_set(&uplink_pending, head > uplink_cursor ? head - uplink_cursor : 0);
+	if (uplink_cursor >= head)
+	{
+		uplink_save_cursor(xEventGroupGetBits(uplink_events) & UPLINK_FLUSH_BIT);
+		xEventGroupSetBits(uplink_events, UPLINK_DRAINED_BIT);
+	}
+}
+
+static void uplink_task(void *pvParameters)
+{
+	for (;;)
+	{
+		// Rows pile up in the log between flushes, fewer and larger messages keep the radio idle
+		xEventGroupWaitBits(uplink_events, UPLINK_DRAIN_BIT, pdTRUE, pdFALSE,
+			pdMS_TO_TICKS(CONFIG_UPLINK_FLUSH_INTERVAL_S * 1000));
+
+		if (xEventGroupGetBits(uplink_events) & UPLINK_CONNECTED_BIT)
+		{
+			uplink_drain();
+		}
+	}
+}
+
+static esp_err_t uplink_create(void)
+{
+	ESP_ERROR_CHECK(esp_read_mac(uplink_mac, ESP_MAC_WIFI_STA));
+	snprintf(uplink_client_id, sizeof(uplink_client_id), "weather-%02x%02x%02x%02x%02x%02x",
+		uplink_mac[0], uplink_mac[1], uplink_mac[2], uplink_mac[3], uplink_mac[4], uplink_mac[5]);
+	snprintf(uplink_topic, sizeof(uplink_topic), "%s/%02x%02x%02x%02x%02x%02x/" UPLINK_TOPIC_SUFFIX, CONFIG_UPLINK_TOPIC_PREFIX,
+		uplink_mac[0], uplink_mac[1], uplink_mac[2], uplink_mac[3], uplink_mac[4], uplink_mac[5]);
+	snprintf(uplink_alert_topic, sizeof(uplink_alert_topic), "%s/%02x%02x%02x%02x%02x%02x/alerts", CONFIG_UPLINK_TOPIC_PREFIX,
+		uplink_mac[0], uplink_mac[1], uplink_mac[2], uplink_mac[3], uplink_mac[4], uplink_mac[5]);
+
+	uplink_batch.header.version = UPLINK_PAYLOAD_VERSION;
+	uplink_batch.header.row_size = sizeof(sensor_history_row_t);
+	memcpy(uplink_batch.header.mac, uplink_mac, sizeof(uplink_mac));
+
+	if (app_nvs_load_uplink_cursor(&uplink_cursor))
+	{
+		uplink_saved_cursor = uplink_cursor;
+	}
+	else
+	{
+		// First boot with the uplink, start with what the log holds
+		uplink_cursor = sample_log_tail();
+	}
+
+	metrics_register_counter(&uplink_batches);
+	metrics_register_counter(&uplink_rows);
+	metrics_register_counter(&uplink_rows_dropped);
+	metrics_register_counter(&uplink_failures);
+	metrics_register_gauge(&uplink_pending);
+#if CONFIG_MESH_ROLE_GATEWAY
+	metrics_register_counter(&uplink_leaf_rows_skipped);
+#endif
+
+	const esp_mqtt_client_config_t config = {
+		.broker.address.uri = CONFIG_UPLINK_BROKER_URI,
+		.credentials.client_id = uplink_client_id,
+		.buffer.out_size = UPLINK_PAYLOAD_MAX_SIZE + 128,
+	};
+
+	uplink_events = xEventGroupCreate();
+	uplink_client = esp_mqtt_client_init(&config);
+	if (uplink_events == NULL || uplink_client == NULL)
+	{
+		ESP_LOGE(TAG, "Failed to create the client");
+		return ESP_ERR_NO_MEM;
+	}
+	esp_mqtt_client_register_event(uplink_client, ESP_EVENT_ANY_ID, &uplink_mqtt_event_handler, NULL);
+	sensor_alert_add_listener(&uplink_on_alert, NULL);
+#if CONFIG_MESH_ROLE_GATEWAY
+	mesh_gateway_add_listener(&uplink_on_leaf_rows, NULL);
+#endif
+
+	if (xTaskCreatePinnedToCore(&uplink_task, "uplink", UPLINK_TASK_STACK_SIZE, NULL,
+								UPLINK_TASK_PRIORITY, NULL, UPLINK_TASK_CORE_ID) != pdPASS)
+	{
+		ESP_LOGE(TAG, "Failed to create the task");
+		return ESP_ERR_NO_MEM;
+	}
+
+	ESP_LOGI(TAG, "Publishing to %s, %d rows per batch every %d s, QoS %d, resuming at %"PRIu32,
+		uplink_topic, CONFIG_UPLINK_BATCH_ROWS, CONFIG_UPLINK_FLUSH_INTERVAL_S, CONFIG_UPLINK_QOS, uplink_cursor);
+	return ESP_OK;
+}
+
+esp_err_t uplink_start(void)
+{
+	if (uplink_client == NULL)
+	{
+		esp_err_t err = uplink_create();
+		if (err != ESP_OK)
+		{
+			return err;
+		}
+	}
+	if (uplink_running)
+	{
+		return ESP_OK;
+	}
+
+	esp_err_t err = esp_mqtt_client_start(uplink_client);
+	uplink_running = (err == ESP_OK);
+	return err;
+}
+
+void uplink_link_down(void)
+{
+	if (uplink_client == NULL || !uplink_running)
+	{
+		return;
+	}
+
+	esp_mqtt_client_stop(uplink_client);
+	uplink_running = false;
+	xEventGroupClearBits(uplink_events, UPLINK_CONNECTED_BIT);
+	xEventGroupSetBits(uplink_events, UPLINK_LINK_LOST_BIT);
+	ESP_LOGI(TAG, "Link down, rows stay in the sample log");
+}
+
+esp_err_t uplink_flush(uint32_t timeout_ms)
+{
+	TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(timeout_ms);
+
+	// Created by the first uplink_start(), after the station got an IP
+	while (uplink_events == NULL || uplink_client == NULL)
+	{
+		if ((int32_t)(deadline - xTaskGetTickCount()) <= 0)
+		{
+			return ESP_ERR_TIMEOUT;
+		}
+		vTaskDelay(pdMS_TO_TICKS(UPLINK_FLUSH_POLL_MS));
+	}
+
+	// The task drains on this request or, if the broker is not connected yet, once it is
+	xEventGroupClearBits(uplink_events, UPLINK_DRAINED_BIT);
+	xEventGroupSetBits(uplink_events, UPLINK_FLUSH_BIT | UPLINK_DRAIN_BIT);
+	TickType_t now = xTaskGetTickCount();
+	TickType_t wait = (int32_t)(deadline - now) > 0 ? deadline - now : 0;
+	EventBits_t bits = xEventGroupWaitBits(uplink_events, UPLINK_DRAINED_BIT, pdFALSE, pdFALSE, wait);
+	xEventGroupClearBits(uplink_events, UPLINK_FLUSH_BIT);
+	return (bits & UPLINK_DRAINED_BIT) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+#endif /* CONFIG_UPLINK_ENABLED */
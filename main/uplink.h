@@ -0,0 +1,70 @@
+/*
+ * uplink.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef MAIN_UPLINK_H_
+#define MAIN_UPLINK_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "sensor_history.h"
+
+#define UPLINK_PAYLOAD_VERSION      1
+
+// Largest CBOR batch: map head, "v", "mac" with 6 bytes, "rows" array head, then the rows
+#define UPLINK_CBOR_HEADER_MAX_SIZE 24
+#define UPLINK_CBOR_ROW_MAX_SIZE    31
+
+/*
+* Batch message published to <prefix>/<station MAC>/samples, little endian. The rows are
+* consecutive sample log records starting at first_seq, see sensor_history.h for the scaling.
+* Delivery is at least once, a batch may be repeated after a reboot or a lost acknowledgement
+* and receivers drop rows whose sequence number they already have
+*/
+typedef struct __attribute__((packed)) {
+    uint8_t version;            // UPLINK_PAYLOAD_VERSION
+    uint8_t row_size;           // sizeof(sensor_history_row_t)
+    uint16_t count;
+    uint32_t first_seq;
+    uint8_t mac[6];
+    uint8_t reserved[2];
+} uplink_batch_header_t;
+
+/*
+* With CONFIG_UPLINK_PAYLOAD_CBOR the same batch goes to <prefix>/<station MAC>/samples/cbor as
+* {"v": UPLINK_PAYLOAD_VERSION, "mac": bytes, "rows": [row, ...]} where each row is the array
+* written by sensor_history_put_cbor_row()
+*
+* Alerts raised or cleared on the device go to <prefix>/<station MAC>/alerts as the JSON object
+* of sensor_alert_format_event(), QoS 1. Alerts raised before the first connection are not sent
+*
+* A mesh gateway (CONFIG_MESH_ROLE_GATEWAY) also publishes the rows of its leaves as they arrive,
+* in the same batch format on <prefix>/<leaf MAC>/samples (or samples/cbor) with QoS 1, first_seq
+* numbering the leaf's own rows. The numbering restarts when a leaf reboots. Leaf rows received
+* while the broker is not connected are only kept on the gateway, see /nodeHistory.json
+*/
+
+/*
+* Call whenever the station got an IP. The first call creates the MQTT client and the uplink
+* task, later calls restart the client after uplink_link_down(). Rows logged while the link was
+* down are sent right after the broker accepted the connection
+@return ESP_OK if the client runs
+*/
+esp_err_t uplink_start(void);
+
+/*
+* Stops the MQTT client while the station has no link, unsent rows stay in the sample log
+*/
+void uplink_link_down(void);
+
+/*
+* Sends everything logged so far and saves the cursor, for a planned power down. Waits for the
+* broker connection if it is not up yet
+@return ESP_OK once the broker has every row, ESP_ERR_TIMEOUT otherwise
+*/
+esp_err_t uplink_flush(uint32_t timeout_ms);
+
+#endif /* MAIN_UPLINK_H_ */
@@ -10,6 +10,10 @@ class ESP32Controller {
     this.wifiConnectInterval = null;
     this.otaTimerVar = null;
     this.seconds = null;
+    this.eventSource = null;
+    this.streamConnected = false;
+    this.wifiConnectPending = false;
+    this.otaPending = false;
 
     this.init();
   }
@@ -20,7 +24,7 @@ class ESP32Controller {
   init() {
     document.addEventListener("DOMContentLoaded", () => {
       this.setupEventListeners();
-      this.startPeriodicUpdates();
+      this.startEventStream();
       this.setupFileUpload();
       this.getInitialData();
     });
@@ -100,12 +104,12 @@ class ESP32Controller {
       fileUploadArea.classList.remove("dragover");
 
       const files = e.dataTransfer.files;
-      if (files.length === 1 && files[0].name.endsWith(".bin")) {
+      if (files.length === 1 && /\.(bin|gz|delta)$/.test(files[0].name)) {
         fileInput.files = files;
         this.displayFileInfo(files[0]);
         updateBtn.disabled = false;
       } else {
-        this.showStatusMessage("Please select a valid .bin file", "error");
+        this.showStatusMessage("Please select a .bin, .bin.gz or .delta file", "error");
       }
     });
   }
@@ -121,8 +125,6 @@ class ESP32Controller {
         this.getUpdateStatus(),
         this.getSSID(),
         this.getConnectionInfo(),
-        this.getDHTSensorValues(), // Get DHT initial reading
-        this.getBMP180SensorValues(), // Get BMP180 initial reading
       ]);
 
       console.log("Initial data loaded successfully");
@@ -133,31 +135,97 @@ class ESP32Controller {
   }
 
   /**
-   * Start periodic data updates
+   * Subscribe to the /events push stream. The server sends a "sensors" event per new
+   * snapshot and a "status" event on WiFi / OTA changes, falling back to polling when
+   * the stream is unavailable (no EventSource support or all stream slots taken)
    */
-  startPeriodicUpdates() {
-    // DHT sensor readings every 5 seconds
-    this.intervals.set(
-      "dht",
-      setInterval(() => this.getDHTSensorValues(), 5000)
+  startEventStream() {
+    if (!window.EventSource) {
+      this.startPeriodicUpdates();
+      return;
+    }
+
+    this.eventSource = new EventSource("/events");
+
+    this.eventSource.addEventListener("open", () => {
+      console.log("Event stream connected");
+      this.streamConnected = true;
+      this.stopPeriodicUpdates();
+    });
+
+    this.eventSource.addEventListener("sensors", (e) =>
+      this.handleSensorEvent(JSON.parse(e.data))
     );
 
-    // BMP180 sensor readings every 5 seconds
-    this.intervals.set(
-      "bmp180",
-      setInterval(() => this.getBMP180SensorValues(), 5000)
+    this.eventSource.addEventListener("status", (e) =>
+      this.handleStatusEvent(JSON.parse(e.data))
     );
 
-    // Local time every 10 seconds
+    this.eventSource.addEventListener("error", () => {
+      this.streamConnected = false;
+
+      // CLOSED means the browser gave up, CONNECTING means it retries by itself
+      if (this.eventSource.readyState === EventSource.CLOSED) {
+        console.warn("Event stream unavailable, falling back to polling");
+        this.startPeriodicUpdates();
+        if (this.wifiConnectPending) this.startWifiStatusPolling();
+        if (this.otaPending) this.startOTAStatusPolling();
+      }
+    });
+  }
+
+  /**
+   * Handle a telemetry body, pushed or polled
+   */
+  handleSensorEvent(data) {
+    this.updateDHTReadings(data.dht);
+
+    if (data.bmp180 && this.validateSensorData(data.bmp180, "BMP180")) {
+      this.updateBMP180Readings(data.bmp180);
+    } else {
+      this.showBMP180Error();
+    }
+
+    const timeElement = document.getElementById("local_time");
+    if (timeElement) {
+      timeElement.textContent = data.time || "Time not available";
+    }
+  }
+
+  /**
+   * Handle a pushed WiFi / OTA status change
+   */
+  handleStatusEvent(data) {
+    if (this.wifiConnectPending) {
+      this.handleWifiStatus(data.wifi_connect_status);
+    }
+    if (this.otaPending) {
+      this.handleOTAStatus(data.ota_update_status);
+    }
+  }
+
+  /**
+   * Start periodic data updates, only used without the event stream
+   */
+  startPeriodicUpdates() {
+    if (this.intervals.size > 0) return;
+
+    // Sensors and time in one request every 5 seconds
     this.intervals.set(
-      "time",
-      setInterval(() => this.getLocalTime(), 10000)
+      "telemetry",
+      setInterval(() => this.getTelemetry(), 5000)
     );
 
     // Get initial readings immediately
-    this.getDHTSensorValues();
-    this.getBMP180SensorValues();
-    this.getLocalTime();
+    this.getTelemetry();
+  }
+
+  /**
+   * Stop periodic data updates once the event stream delivers them
+   */
+  stopPeriodicUpdates() {
+    this.intervals.forEach((interval) => clearInterval(interval));
+    this.intervals.clear();
   }
 
   /**
@@ -244,135 +312,125 @@ class ESP32Controller {
   }
 
   /**
-   * Get DHT11 sensor values
+   * Get sensor values and time from the combined endpoint
    */
-  async getDHTSensorValues() {
+  async getTelemetry() {
     try {
-      const data = await this.fetchJSON("/dhtSensor.json");
-
-      const tempElement = document.getElementById("temperature_reading");
-      const humidityElement = document.getElementById("humidity_reading");
-
-      if (tempElement) {
-        tempElement.textContent = data.temperature || "--";
-        this.animateValue(tempElement);
-      }
-
-      if (humidityElement) {
-        humidityElement.textContent = data.humidity || "--";
-        this.animateValue(humidityElement);
-      }
+      const data = await this.fetchJSON("/telemetry.json");
+      this.handleSensorEvent(data);
     } catch (error) {
-      console.error("Error getting DHT sensor values:", error);
+      console.error("Error getting telemetry:", error);
       document.getElementById("temperature_reading").textContent = "Error";
       document.getElementById("humidity_reading").textContent = "Error";
+      this.showBMP180Error();
+      document.getElementById("local_time").textContent = "Failed to get time";
     }
   }
 
   /**
-   * Get BMP180 sensor values
+   * Update the DHT readings
    */
-  async getBMP180SensorValues() {
-    try {
-      const data = await this.fetchJSON("/bmp180Sensor.json");
-
-      // Define all BMP180 element mappings
-      const elementMappings = [
-        {
-          id: "bmp180_temperature_reading",
-          value: data.temperature,
-          label: "BMP180 Temperature",
-        },
-        { id: "pressure_reading", value: data.pressure, label: "Pressure" },
-        { id: "altitude_reading", value: data.altitude, label: "Altitude" },
-        { id: "dew_point_reading", value: data.dew_point, label: "Dew Point" },
-        {
-          id: "air_density_reading",
-          value: data.air_density,
-          label: "Air Density",
-        },
-        {
-          id: "sea_level_pressure_reading",
-          value: data.sea_level_pressure,
-          label: "Sea Level Pressure",
-        },
-      ];
+  updateDHTReadings(data) {
+    const tempElement = document.getElementById("temperature_reading");
+    const humidityElement = document.getElementById("humidity_reading");
 
-      // Update each element
-      elementMappings.forEach((mapping) => {
-        const element = document.getElementById(mapping.id);
-        if (element) {
-          // Handle different types of values (including "Error" strings from server)
-          let displayValue = mapping.value;
-
-          if (
-            displayValue === "Error" ||
-            displayValue === undefined ||
-            displayValue === null
+    if (tempElement) {
+      tempElement.textContent = data.temperature || "--";
+      this.animateValue(tempElement);
+    }
+
+    if (humidityElement) {
+      humidityElement.textContent = data.humidity || "--";
+      this.animateValue(humidityElement);
+    }
+  }
+
+  /**
+   * Update the BMP180 readings
+   */
+  updateBMP180Readings(data) {
+    // Define all BMP180 element mappings
+    const elementMappings = [
+      {
+        id: "bmp180_temperature_reading",
+        value: data.temperature,
+        label: "BMP180 Temperature",
+      },
+      { id: "pressure_reading", value: data.pressure, label: "Pressure" },
+      { id: "altitude_reading", value: data.altitude, label: "Altitude" },
+      { id: "dew_point_reading", value: data.dew_point, label: "Dew Point" },
+      {
+        id: "air_density_reading",
+        value: data.air_density,
+        label: "Air Density",
+      },
+      {
+        id: "sea_level_pressure_reading",
+        value: data.sea_level_pressure,
+        label: "Sea Level Pressure",
+      },
+    ];
+
+    // Update each element
+    elementMappings.forEach((mapping) => {
+      const element = document.getElementById(mapping.id);
+      if (element) {
+        // Handle different types of values (including "Error" strings from server)
+        let displayValue = mapping.value;
+
+        if (
+          displayValue === "Error" ||
+          displayValue === undefined ||
+          displayValue === null
+        ) {
+          displayValue = "--";
+        } else if (typeof displayValue === "number") {
+          // Format numbers appropriately
+          if (mapping.id === "air_density_reading") {
+            displayValue = displayValue.toFixed(3);
+          } else if (
+            mapping.id === "pressure_reading" ||
+            mapping.id === "sea_level_pressure_reading"
           ) {
-            displayValue = "--";
-          } else if (typeof displayValue === "number") {
-            // Format numbers appropriately
-            if (mapping.id === "air_density_reading") {
-              displayValue = displayValue.toFixed(3);
-            } else if (
-              mapping.id === "pressure_reading" ||
-              mapping.id === "sea_level_pressure_reading"
-            ) {
-              displayValue = displayValue.toFixed(2);
-            } else {
-              displayValue = displayValue.toFixed(1);
-            }
+            displayValue = displayValue.toFixed(2);
+          } else {
+            displayValue = displayValue.toFixed(1);
           }
-
-          element.textContent = displayValue;
-          this.animateValue(element);
-        } else {
-          console.warn(`Element with ID '${mapping.id}' not found`);
         }
-      });
 
-      // Log successful update
-      console.log("BMP180 sensor values updated successfully");
-    } catch (error) {
-      console.error("Error getting BMP180 sensor values:", error);
-
-      // Set error text for all BMP180 elements
-      const errorElementIds = [
-        "bmp180_temperature_reading",
-        "pressure_reading",
-        "altitude_reading",
-        "dew_point_reading",
-        "air_density_reading",
-        "sea_level_pressure_reading",
-      ];
+        element.textContent = displayValue;
+        this.animateValue(element);
+      } else {
+        console.warn(`Element with ID '${mapping.id}' not found`);
+      }
+    });
 
-      errorElementIds.forEach((id) => {
-        const element = document.getElementById(id);
-        if (element) {
-          element.textContent = "Error";
-          element.style.color = "var(--error-color, #ff4444)";
-        }
-      });
-    }
+    // Log successful update
+    console.log("BMP180 sensor values updated successfully");
   }
+
   /**
-   * Get local time
+   * Show the error state on all BMP180 readings
    */
-  async getLocalTime() {
-    try {
-      const data = await this.fetchJSON("/localTime.json");
-      const timeElement = document.getElementById("local_time");
-
-      if (timeElement) {
-        timeElement.textContent = data.time || "Time not available";
+  showBMP180Error() {
+    // Set error text for all BMP180 elements
+    const errorElementIds = [
+      "bmp180_temperature_reading",
+      "pressure_reading",
+      "altitude_reading",
+      "dew_point_reading",
+      "air_density_reading",
+      "sea_level_pressure_reading",
+    ];
+
+    errorElementIds.forEach((id) => {
+      const element = document.getElementById(id);
+      if (element) {
+        element.textContent = "Error";
+        element.style.color = "var(--error-color, #ff4444)";
       }
-    } catch (error) {
-      console.error("Error getting local time:", error);
-      document.getElementById("local_time").textContent = "Failed to get time";
-    }
+    });
   }
-
   /**
    * Get ESP32 SSID
    */
@@ -408,19 +466,25 @@ class ESP32Controller {
           firmwareElement.textContent = `${data.compile_date} - ${data.compile_time}`;
         }
 
-        // Handle OTA status
-        if (data.ota_update_status === 1) {
-          this.handleOTASuccess();
-        } else if (data.ota_update_status === -1) {
-          this.showStatusMessage("Upload Error!", "error", "ota_update_status");
-          this.stopStatusPolling();
-        }
+        this.handleOTAStatus(data.ota_update_status);
       }
     } catch (error) {
       console.error("Error getting update status:", error);
     }
   }
 
+  /**
+   * Handle an OTA status code from polling or the event stream
+   */
+  handleOTAStatus(status) {
+    if (status === 1) {
+      this.handleOTASuccess();
+    } else if (status === -1) {
+      this.showStatusMessage("Upload Error!", "error", "ota_update_status");
+      this.stopStatusPolling();
+    }
+  }
+
   /**
    * Handle successful OTA update
    */
@@ -522,8 +586,9 @@ class ESP32Controller {
 
       await uploadPromise;
 
-      // Start polling for status
-      this.statusPollTimer = setInterval(() => this.getUpdateStatus(), 1000);
+      // Wait for the status, pushed by the event stream or polled
+      this.otaPending = true;
+      if (!this.streamConnected) this.startOTAStatusPolling();
     } catch (error) {
       console.error("Firmware update error:", error);
       this.showStatusMessage(
@@ -539,10 +604,19 @@ class ESP32Controller {
     }
   }
 
+  /**
+   * Start OTA status polling, only used without the event stream
+   */
+  startOTAStatusPolling() {
+    if (this.statusPollTimer) return;
+    this.statusPollTimer = setInterval(() => this.getUpdateStatus(), 1000);
+  }
+
   /**
    * Stop status polling
    */
   stopStatusPolling() {
+    this.otaPending = false;
     if (this.statusPollTimer) {
       clearInterval(this.statusPollTimer);
       this.statusPollTimer = null;
@@ -644,7 +718,10 @@ class ESP32Controller {
    * Start WiFi connection status polling
    */
   startWifiStatusPolling() {
-    this.wifiConnectInterval = setInterval(() => this.checkWifiStatus(), 2800);
+    this.wifiConnectPending = true;
+    if (!this.streamConnected && !this.wifiConnectInterval) {
+      this.wifiConnectInterval = setInterval(() => this.checkWifiStatus(), 2800);
+    }
     this.showStatusMessage("Connecting...", "info", "wifi_connect_status");
   }
 
@@ -660,58 +737,66 @@ class ESP32Controller {
 
       if (response.ok) {
         const data = await response.json();
-        const connectBtn = document.getElementById("connect_wifi");
-
-        if (data.wifi_connect_status === 2) {
-          // Connection failed
-          this.showStatusMessage(
-            "Failed to Connect. Please check your AP credentials and compatibility",
-            "error",
-            "wifi_connect_status"
-          );
-          this.stopWifiStatusPolling();
-
-          // Reset button
-          connectBtn.disabled = false;
-          connectBtn.innerHTML = '<i class="fas fa-plug"></i> Connect';
-        } else if (data.wifi_connect_status === 3) {
-          // Connection successful
-          console.log(
-            "WiFi connection successful, stopping polling and showing success message"
-          );
-
-          // Stop polling immediately to prevent further status checks
-          this.stopWifiStatusPolling();
-
-          // Show success message
-          this.showStatusMessage(
-            "Connection Success! Page will refresh automatically...",
-            "success",
-            "wifi_connect_status"
-          );
-
-          // Update button state
-          connectBtn.disabled = false;
-          connectBtn.innerHTML = '<i class="fas fa-check"></i> Connected';
-          connectBtn.style.background = "var(--success-color)";
-
-          // Force refresh after 6 seconds to ensure connection details are loaded
-          console.log("Setting up automatic page refresh in 6 seconds");
-          setTimeout(() => {
-            console.log("Refreshing page to show connection details");
-            window.location.reload();
-          }, 6000);
-        }
+        this.handleWifiStatus(data.wifi_connect_status);
       }
     } catch (error) {
       console.error("Error checking WiFi status:", error);
     }
   }
 
+  /**
+   * Handle a WiFi connect status code from polling or the event stream
+   */
+  handleWifiStatus(status) {
+    const connectBtn = document.getElementById("connect_wifi");
+
+    if (status === 2) {
+      // Connection failed
+      this.showStatusMessage(
+        "Failed to Connect. Please check your AP credentials and compatibility",
+        "error",
+        "wifi_connect_status"
+      );
+      this.stopWifiStatusPolling();
+
+      // Reset button
+      connectBtn.disabled = false;
+      connectBtn.innerHTML = '<i class="fas fa-plug"></i> Connect';
+    } else if (status === 3) {
+      // Connection successful
+      console.log(
+        "WiFi connection successful, stopping polling and showing success message"
+      );
+
+      // Stop polling immediately to prevent further status checks
+      this.stopWifiStatusPolling();
+
+      // Show success message
+      this.showStatusMessage(
+        "Connection Success! Page will refresh automatically...",
+        "success",
+        "wifi_connect_status"
+      );
+
+      // Update button state
+      connectBtn.disabled = false;
+      connectBtn.innerHTML = '<i class="fas fa-check"></i> Connected';
+      connectBtn.style.background = "var(--success-color)";
+
+      // Force refresh after 6 seconds to ensure connection details are loaded
+      console.log("Setting up automatic page refresh in 6 seconds");
+      setTimeout(() => {
+        console.log("Refreshing page to show connection details");
+        window.location.reload();
+      }, 6000);
+    }
+  }
+
   /**
    * Stop WiFi status polling
    */
   stopWifiStatusPolling() {
+    this.wifiConnectPending = false;
     if (this.wifiConnectInterval) {
       console.log("Stopping WiFi status polling");
       clearInterval(this.wifiConnectInterval);
@@ -881,8 +966,8 @@ class ESP32Controller {
    * Cleanup intervals on page unload
    */
   cleanup() {
-    this.intervals.forEach((interval) => clearInterval(interval));
-    this.intervals.clear();
+    this.stopPeriodicUpdates();
+    if (this.eventSource) this.eventSource.close();
 
     if (this.statusPollTimer) clearInterval(this.statusPollTimer);
     if (this.wifiConnectInterval) clearInterval(this.wifiConnectInterval);
@@ -6,28 +6,34 @@
  */
 #include "esp_event.h"
 #include "esp_netif.h"
+#include "esp_random.h"
 #include "esp_wifi_default.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
 #include "freertos/task.h"
-#include "freertos/semphr.h"
 #include "driver/gpio.h"
+#include "esp_sleep.h"
 #include "app_nvs.h"
 #include "esp_err.h"
 #include "esp_log.h"
 #include "esp_wifi.h"
 #include "http_server.h"
+#include "mesh.h"
+#include "periodic_work.h"
 #include "lwip/netdb.h"
 #include "rgb_led.h"
 #include "tasks_common.h"
 #include "wifi_app.h"
+#include <inttypes.h>
+#include <limits.h>
 #include <string.h>
 
 // Tag used for ESP Serial Communication
 static const char TAG[] = "wifi_app";
 
-// WiFi application callback
+// WiFi application callbacks
 static wifi_connected_event_callback_t wifi_connected_event_cb;
+static wifi_disconnected_event_callback_t wifi_disconnected_event_cb;
 
 // Used for returning the WiFi configuration
 static wifi_config_t *wifi_config = NULL;
@@ -35,17 +41,46 @@ static wifi_config_t *wifi_config = NULL;
 // Used to track the number of retries when a connection attempt fails
 static int g_retry_number;
 
+// Reconnect backoff, the delay doubles per failed attempt up to CONFIG_WIFI_STA_RECONNECT_MAX_BACKOFF_S
+#define WIFI_RECONNECT_BASE_MS			500
+static void wifi_reconnect_job(void *arg);
+static periodic_work_job_t wifi_reconnect = PERIODIC_WORK_JOB("wifi_reconnect", &wifi_reconnect_job, NULL);
+static bool wifi_reconnect_enabled = false;		// keep retrying past MAX_CONNECTION_RETRIES
+
+#if !CONFIG_POWER_PROFILE_PERFORMANCE
+// After a connect from the web page the soft AP stays up this long, the page polls the result over it
+#define WIFI_SOFT_AP_STOP_DELAY_MS		30000
+static void wifi_soft_ap_stop_job(void *arg);
+static periodic_work_job_t wifi_soft_ap_stop = PERIODIC_WORK_JOB("wifi_soft_ap_stop", &wifi_soft_ap_stop_job, NULL);
+#endif
+
+#if CONFIG_WIFI_STA_FAST_CONNECT
+// Last association, the connect after a reboot goes straight to this BSSID and channel
+static app_nvs_sta_cache_t wifi_sta_cache;
+static bool wifi_sta_cache_valid = false;
+static bool wifi_fast_connect = false;
+#endif
+
 // WiFi application event group handle and status bits
 static EventGroupHandle_t wifi_app_event_group;
 static const int WIFI_APP_CONNECTING_USING_SAVED_CREDS_BIT = BIT0;
 static const int WIFI_APP_CONNECTING_FROM_HTTP_SERVER_BIT = BIT1;
 static const int WIFI_APP_STA_CONNECTED_GOT_IP_BIT = BIT2;
+static const int WIFI_APP_USER_DISCONNECTED_BIT = BIT3;
 
 // Queue handle used to manipulate the main queue of events
 static QueueHandle_t wifi_app_queue_handle;
 
-// Reset button semaphore
-static SemaphoreHandle_t wifi_reset_semaphore = NULL;
+// Reset button, the ISR hands the press to a periodic work job
+#define WIFI_RESET_BUTTON_HOLDOFF_MS	2000
+#define WIFI_RESET_BUTTON_POLL_MS		100
+static void wifi_reset_button_job(void *arg);
+static periodic_work_job_t wifi_reset_job = PERIODIC_WORK_JOB("wifi_reset_button", &wifi_reset_button_job, NULL);
+static TickType_t wifi_reset_last_press = 0;
+static bool wifi_reset_pressed = false;
+#if CONFIG_PM_ENABLE
+static bool wifi_reset_held = false;
+#endif
 
 // netif objects for the station and access point
 esp_netif_t* esp_netif_sta = NULL;
@@ -53,48 +88,72 @@ esp_netif_t* esp_netif_ap = NULL;
 
 // Forward declarations
 static void wifi_app_task(void *pvParameters);
-static void wifi_reset_button_task(void *pvParam);
 
 /*
  * WiFi Reset Button Functions
  */
 void IRAM_ATTR wifi_reset_button_isr_handler(void *arg)
 {
-	xSemaphoreGiveFromISR(wifi_reset_semaphore, NULL);
+#if CONFIG_PM_ENABLE
+	// Level triggered, masked until the job saw the button released
+	gpio_intr_disable(WIFI_RESET_BUTTON);
+#endif
+	periodic_work_trigger_from_isr(&wifi_reset_job);
 }
 
-static void wifi_reset_button_task(void *pvParam)
+// Presses within the hold off time of the last one are ignored
+static void wifi_reset_button_job(void *arg)
 {
-	for(;;)
+	TickType_t now = xTaskGetTickCount();
+	
+#if CONFIG_PM_ENABLE
+	bool held = wifi_reset_held;
+	wifi_reset_held = (gpio_get_level(WIFI_RESET_BUTTON) == 0);
+	if (wifi_reset_held)
 	{
-		if (xSemaphoreTake(wifi_reset_semaphore, portMAX_DELAY) == pdTRUE)
-		{
-			ESP_LOGI(TAG, "WiFi Reset Button Pressed");
-			wifi_app_send_message(WIFI_APP_MSG_USER_REQUESTED_STA_DISCONNECT);
-			vTaskDelay(pdMS_TO_TICKS(2000));
-		}
+		periodic_work_schedule(&wifi_reset_job, WIFI_RESET_BUTTON_POLL_MS, 0);
+	}
+	else
+	{
+		gpio_intr_enable(WIFI_RESET_BUTTON);
+	}
+	if (held)
+	{
+		return;
+	}
+#endif
+	
+	if (wifi_reset_pressed && now - wifi_reset_last_press < pdMS_TO_TICKS(WIFI_RESET_BUTTON_HOLDOFF_MS))
+	{
+		return;
 	}
+	wifi_reset_pressed = true;
+	wifi_reset_last_press = now;
+	
+	ESP_LOGI(TAG, "WiFi Reset Button Pressed");
+	wifi_app_send_message(WIFI_APP_MSG_USER_REQUESTED_STA_DISCONNECT);
 }
 
 static void wifi_reset_button_config(void)
 {
-	// Create the binary semaphore
-	wifi_reset_semaphore = xSemaphoreCreateBinary();
-	
 	// Configure the button
 	gpio_config_t io_conf = {
 		.pin_bit_mask = (1ULL << WIFI_RESET_BUTTON),
 		.mode = GPIO_MODE_INPUT,
 		.pull_up_en = GPIO_PULLUP_ENABLE,
 		.pull_down_en = GPIO_PULLDOWN_DISABLE,
+#if CONFIG_PM_ENABLE
+		// Edges are not seen during light sleep, a low level wakes the chip
+		.intr_type = GPIO_INTR_LOW_LEVEL
+#else
 		.intr_type = GPIO_INTR_NEGEDGE
+#endif
 	};
 	gpio_config(&io_conf);
-	
-	// Create the wifi reset button task
-	xTaskCreatePinnedToCore(&wifi_reset_button_task, "wifi_reset_button", 
-		WIFI_RESET_BUTTON_TASK_STACK_SIZE, NULL, WIFI_RESET_BUTTON_TASK_PRIORITY, 
-		NULL, WIFI_RESET_BUTTON_TASK_CORE_ID);
+#if CONFIG_PM_ENABLE
+	gpio_wakeup_enable(WIFI_RESET_BUTTON, GPIO_INTR_LOW_LEVEL);
+	esp_sleep_enable_gpio_wakeup();
+#endif
 	
 	// Install gpio isr service
 	gpio_install_isr_service(ESP_INTR_FLAG_DEFAULT);
@@ -103,6 +162,143 @@ static void wifi_reset_button_config(void)
 	gpio_isr_handler_add(WIFI_RESET_BUTTON, wifi_reset_button_isr_handler, NULL);
 }
 
+/*
+ * Reconnect and fast connect
+ */
+static void wifi_reconnect_job(void *arg)
+{
+	esp_wifi_connect();
+}
+
+// Jittered exponential backoff, stations that lost the AP together do not retry together
+static void wifi_app_schedule_reconnect(int attempt)
+{
+	uint32_t max_ms = CONFIG_WIFI_STA_RECONNECT_MAX_BACKOFF_S * 1000;
+	uint32_t delay_ms = (attempt < 16) ? (WIFI_RECONNECT_BASE_MS << attempt) : max_ms;
+	
+	if (delay_ms > max_ms)
+	{
+		delay_ms = max_ms;
+	}
+	delay_ms = delay_ms / 2 + esp_random() % (delay_ms / 2 + 1);
+	
+	ESP_LOGI(TAG, "Reconnect attempt %d in %"PRIu32" ms", attempt + 1, delay_ms);
+	periodic_work_schedule(&wifi_reconnect, delay_ms, 0);
+}
+
+static void wifi_app_stop_reconnect(void)
+{
+	wifi_reconnect_enabled = false;
+	periodic_work_cancel(&wifi_reconnect);
+}
+
+#if !CONFIG_POWER_PROFILE_PERFORMANCE
+// Runs in the periodic work task, the mode change is left to the WiFi task
+static void wifi_soft_ap_stop_job(void *arg)
+{
+	wifi_app_send_message(WIFI_APP_MSG_STOP_SOFT_AP);
+}
+#endif
+
+#if CONFIG_WIFI_STA_FAST_CONNECT
+// Points the station at the cached AP so the connect skips the all channel scan
+static void wifi_app_fast_connect_start(void)
+{
+	wifi_config_t *config = wifi_app_get_wifi_config();
+	
+	wifi_sta_cache_valid = app_nvs_load_sta_cache(&wifi_sta_cache);
+	if (!wifi_sta_cache_valid || wifi_sta_cache.channel == 0)
+	{
+		return;
+	}
+	
+	memcpy(config->sta.bssid, wifi_sta_cache.bssid, sizeof(config->sta.bssid));
+	config->sta.bssid_set = true;
+	config->sta.channel = wifi_sta_cache.channel;
+	config->sta.scan_method = WIFI_FAST_SCAN;
+	
+#if CONFIG_WIFI_STA_REUSE_LEASE
+	if (wifi_sta_cache.ip != 0)
+	{
+		esp_netif_ip_info_t ip_info = {
+			.ip.addr = wifi_sta_cache.ip,
+			.netmask.addr = wifi_sta_cache.netmask,
+			.gw.addr = wifi_sta_cache.gateway,
+		};
+		esp_netif_dns_info_t dns_info = {
+			.ip.type = ESP_IPADDR_TYPE_V4,
+			.ip.u_addr.ip4.addr = wifi_sta_cache.dns,
+		};
+		
+		// Static until the first disconnect, GOT_IP follows the association
+		esp_netif_dhcpc_stop(esp_netif_sta);
+		esp_netif_set_ip_info(esp_netif_sta, &ip_info);
+		if (wifi_sta_cache.dns != 0)
+		{
+			esp_netif_set_dns_info(esp_netif_sta, ESP_NETIF_DNS_MAIN, &dns_info);
+		}
+	}
+#endif
+	
+	wifi_fast_connect = true;
+	ESP_LOGI(TAG, "Fast connect to %02x:%02x:%02x:%02x:%02x:%02x on channel %d",
+		wifi_sta_cache.bssid[0], wifi_sta_cache.bssid[1], wifi_sta_cache.bssid[2],
+		wifi_sta_cache.bssid[3], wifi_sta_cache.bssid[4], wifi_sta_cache.bssid[5], wifi_sta_cache.channel);
+}
+
+// Back to a full scan, and DHCP if the lease was reused
+static void wifi_app_fast_connect_stop(void)
+{
+	wifi_config_t *config = wifi_app_get_wifi_config();
+	
+	config->sta.bssid_set = false;
+	config->sta.channel = 0;
+	config->sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+	esp_wifi_set_config(ESP_IF_WIFI_STA, config);
+#if CONFIG_WIFI_STA_REUSE_LEASE
+	esp_netif_dhcpc_start(esp_netif_sta);
+#endif
+	wifi_fast_connect = false;
+}
+
+// Keeps the association for the next boot, NVS is only written when something changed
+static void wifi_app_save_sta_cache(void)
+{
+	app_nvs_sta_cache_t cache = {0};
+	wifi_ap_record_t ap_info;
+	esp_netif_ip_info_t ip_info;
+	esp_netif_dns_info_t dns_info;
+	
+	if (esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK)
+	{
+		return;
+	}
+	memcpy(cache.bssid, ap_info.bssid, sizeof(cache.bssid));
+	cache.channel = ap_info.primary;
+	
+	if (esp_netif_get_ip_info(esp_netif_sta, &ip_info) == ESP_OK)
+	{
+		cache.ip = ip_info.ip.addr;
+		cache.netmask = ip_info.netmask.addr;
+		cache.gateway = ip_info.gw.addr;
+	}
+	if (esp_netif_get_dns_info(esp_netif_sta, ESP_NETIF_DNS_MAIN, &dns_info) == ESP_OK)
+	{
+		cache.dns = dns_info.ip.u_addr.ip4.addr;
+	}
+	
+	if (wifi_sta_cache_valid && memcmp(&cache, &wifi_sta_cache, sizeof(cache)) == 0)
+	{
+		return;
+	}
+	if (app_nvs_save_sta_cache(&cache) == ESP_OK)
+	{
+		wifi_sta_cache = cache;
+		wifi_sta_cache_valid = true;
+	}
+}
+#endif
+
 /*
  * WiFi Event Handler
  */
@@ -142,15 +338,26 @@ static void wifi_app_event_handler(void *arg, esp_event_base_t event_base, int32
 				wifi_event_sta_disconnected_t *disconnect_event = (wifi_event_sta_disconnected_t*)event_data;
 				ESP_LOGI(TAG, "Disconnect reason: %d", disconnect_event->reason);
 				
-				if (g_retry_number < MAX_CONNECTION_RETRIES)
+#if CONFIG_WIFI_STA_FAST_CONNECT
+				// The cached AP did not take us, the retries scan all channels
+				if (wifi_fast_connect)
 				{
-					esp_wifi_connect();
-					g_retry_number++;
+					wifi_app_fast_connect_stop();
 				}
-				else
+#endif
+				// Reported once per outage, saved credentials keep retrying after that
+				if (g_retry_number == MAX_CONNECTION_RETRIES)
 				{
 					wifi_app_send_message(WIFI_APP_MSG_STA_DISCONNECTED);
 				}
+				if (g_retry_number < MAX_CONNECTION_RETRIES || wifi_reconnect_enabled)
+				{
+					wifi_app_schedule_reconnect(g_retry_number);
+				}
+				if (g_retry_number < INT_MAX)
+				{
+					g_retry_number++;
+				}
 				break;		
 		}		
 	}
@@ -236,6 +443,23 @@ static void handle_wifi_connected(void)
 	
 	xEventGroupSetBits(wifi_app_event_group, WIFI_APP_STA_CONNECTED_GOT_IP_BIT);
 	rgb_led_wifi_connected();
+	
+	// Credentials that worked once are retried for as long as it takes
+	g_retry_number = 0;
+	wifi_reconnect_enabled = true;
+	
+#if !CONFIG_POWER_PROFILE_PERFORMANCE
+	// Modem sleep only works without the soft AP, it comes back when the station is lost.
+	// A connect from the web page keeps it until the page had time to show the result
+	if (eventBits & WIFI_APP_CONNECTING_FROM_HTTP_SERVER_BIT)
+	{
+		periodic_work_schedule(&wifi_soft_ap_stop, WIFI_SOFT_AP_STOP_DELAY_MS, 0);
+	}
+	else
+	{
+		esp_wifi_set_mode(WIFI_MODE_STA);
+	}
+#endif
 	http_server_monitor_send_message(HTTP_MSG_WIFI_CONNECT_SUCCESS);
 	
 	// Save credentials only if connecting from HTTP server (not from saved creds)
@@ -247,6 +471,9 @@ static void handle_wifi_connected(void)
 	{
 		app_nvs_save_sta_creds();
 	}
+#if CONFIG_WIFI_STA_FAST_CONNECT
+	wifi_app_save_sta_cache();
+#endif
 	
 	if (eventBits & WIFI_APP_CONNECTING_FROM_HTTP_SERVER_BIT)
 	{
@@ -265,15 +492,24 @@ static void handle_wifi_disconnected(void)
 {
 	EventBits_t eventBits = xEventGroupGetBits(wifi_app_event_group);
 	
+	// The user disconnect already switched to AP only and told the callback
+	if (eventBits & WIFI_APP_USER_DISCONNECTED_BIT)
+	{
+		ESP_LOGI(TAG, "Disconnected by the user");
+		xEventGroupClearBits(wifi_app_event_group, WIFI_APP_USER_DISCONNECTED_BIT);
+		return;
+	}
+	
 	if (eventBits & WIFI_APP_CONNECTING_USING_SAVED_CREDS_BIT)
 	{
-		ESP_LOGI(TAG, "Failed to connect using saved credentials");
+		// Mostly the AP being down, the credentials stay until the user resets them
+		ESP_LOGI(TAG, "Failed to connect using saved credentials, retrying with backoff");
 		xEventGroupClearBits(wifi_app_event_group, WIFI_APP_CONNECTING_USING_SAVED_CREDS_BIT);
-		app_nvs_clear_sta_creds();
 	}
 	else if (eventBits & WIFI_APP_CONNECTING_FROM_HTTP_SERVER_BIT)
 	{
 		ESP_LOGI(TAG, "Failed to connect from HTTP server");
+		wifi_app_stop_reconnect();
 		xEventGroupClearBits(wifi_app_event_group, WIFI_APP_CONNECTING_FROM_HTTP_SERVER_BIT);
 		http_server_monitor_send_message(HTTP_MSG_WIFI_CONNECT_FAIL);
 	}
@@ -287,6 +523,17 @@ static void handle_wifi_disconnected(void)
 	{
 		xEventGroupClearBits(wifi_app_event_group, WIFI_APP_STA_CONNECTED_GOT_IP_BIT);
 	}
+	
+#if !CONFIG_POWER_PROFILE_PERFORMANCE
+	// A lost station brings the soft AP back
+	periodic_work_cancel(&wifi_soft_ap_stop);
+	esp_wifi_set_mode(WIFI_MODE_APSTA);
+#endif
+	
+	if (wifi_disconnected_event_cb)
+	{
+		wifi_disconnected_event_cb();
+	}
 }
 
 // Main WiFi application task
@@ -306,6 +553,14 @@ static void wifi_app_task(void *pvParameters)
 	// Start WiFi
 	ESP_ERROR_CHECK(esp_wifi_start());
 	
+#if CONFIG_MESH_ROLE_GATEWAY
+	// Leaf frames arrive on whichever channel the soft AP or the station is on
+	if (mesh_gateway_start() != ESP_OK)
+	{
+		ESP_LOGE(TAG, "Mesh gateway not started");
+	}
+#endif
+	
 	// Send first event message
 	wifi_app_send_message(WIFI_APP_MSG_LOAD_SAVED_CREDENTIALS);
 	
@@ -321,6 +576,10 @@ static void wifi_app_task(void *pvParameters)
 					if (app_nvs_load_sta_creds())
 					{
 						ESP_LOGI(TAG, "Loaded station configuration");
+						wifi_reconnect_enabled = true;
+#if CONFIG_WIFI_STA_FAST_CONNECT
+						wifi_app_fast_connect_start();
+#endif
 						wifi_app_connect_sta();
 						xEventGroupSetBits(wifi_app_event_group, WIFI_APP_CONNECTING_USING_SAVED_CREDS_BIT);
 					}
@@ -340,8 +599,19 @@ static void wifi_app_task(void *pvParameters)
 				case WIFI_APP_MSG_CONNECTING_FROM_HTTP_SERVER:
 					ESP_LOGI(TAG, "WIFI_APP_MSG_CONNECTING_FROM_HTTP_SERVER");
 					xEventGroupSetBits(wifi_app_event_group, WIFI_APP_CONNECTING_FROM_HTTP_SERVER_BIT);
-					wifi_app_connect_sta();
+					xEventGroupClearBits(wifi_app_event_group, WIFI_APP_USER_DISCONNECTED_BIT);
+					wifi_app_stop_reconnect();
+					// The station interface is gone after a user disconnect
+					ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_APSTA));
+#if CONFIG_WIFI_STA_FAST_CONNECT
+					// The new network is found by scanning
+					if (wifi_fast_connect)
+					{
+						wifi_app_fast_connect_stop();
+					}
+#endif
 					g_retry_number = 0;
+					wifi_app_connect_sta();
 					http_server_monitor_send_message(HTTP_MSG_WIFI_CONNECT_INIT);
 					break;
 					
@@ -356,12 +626,26 @@ static void wifi_app_task(void *pvParameters)
 					if (xEventGroupGetBits(wifi_app_event_group) & WIFI_APP_STA_CONNECTED_GOT_IP_BIT)
 					{
 						g_retry_number = MAX_CONNECTION_RETRIES; // Prevent auto-reconnect
+						wifi_app_stop_reconnect();
+#if !CONFIG_POWER_PROFILE_PERFORMANCE
+						periodic_work_cancel(&wifi_soft_ap_stop);
+#endif
+						// The disconnect event that follows must not bring the station back
+						xEventGroupSetBits(wifi_app_event_group, WIFI_APP_USER_DISCONNECTED_BIT);
 						ESP_ERROR_CHECK(esp_wifi_disconnect());
 						app_nvs_clear_sta_creds();
+#if CONFIG_WIFI_STA_FAST_CONNECT
+						wifi_sta_cache_valid = false;
+#endif
 						ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_AP));
 						rgb_led_http_server_started();
 						http_server_monitor_send_message(HTTP_MSG_WIFI_USER_DISCONNECT);
 						xEventGroupClearBits(wifi_app_event_group, WIFI_APP_STA_CONNECTED_GOT_IP_BIT);
+						
+						if (wifi_disconnected_event_cb)
+						{
+							wifi_disconnected_event_cb();
+						}
 					}
 					break;
 					
@@ -370,6 +654,16 @@ static void wifi_app_task(void *pvParameters)
 					handle_wifi_disconnected();
 					break;	
 
+#if !CONFIG_POWER_PROFILE_PERFORMANCE
+				case WIFI_APP_MSG_STOP_SOFT_AP:
+					ESP_LOGI(TAG, "WIFI_APP_MSG_STOP_SOFT_AP");
+					if (xEventGroupGetBits(wifi_app_event_group) & WIFI_APP_STA_CONNECTED_GOT_IP_BIT)
+					{
+						esp_wifi_set_mode(WIFI_MODE_STA);
+					}
+					break;
+#endif
+
 				default:
 					break;		 	
 			}
@@ -405,6 +699,11 @@ void wifi_app_call_callback(void)
 	}
 }
 
+void wifi_app_set_disconnected_callback(wifi_disconnected_event_callback_t cb)
+{
+	wifi_disconnected_event_cb = cb;
+}
+
 void wifi_app_start(void)
 {
 	ESP_LOGI(TAG, "Starting WiFi Application");
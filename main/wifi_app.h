@@ -12,9 +12,11 @@
 #include "esp_wifi_types.h"
 #include "portmacro.h"
 #include "http_server.h"
+#include "sdkconfig.h"
 
-// Callback typedef
+// Callback typedefs
 typedef void (*wifi_connected_event_callback_t)(void);
+typedef void (*wifi_disconnected_event_callback_t)(void);
 
 // WiFi application settings
 #define WIFI_AP_SSID 					"ESP32_AP"
@@ -27,7 +29,11 @@ typedef void (*wifi_connected_event_callback_t)(void);
 #define WIFI_AP_GATEWAY 				"192.168.0.3"
 #define WIFI_AP_NETMASK 				"255.255.255.0"
 #define WIFI_AP_BANDWIDTH 				WIFI_BW_HT20
-#define WIFI_STA_POWER_SAVE 			WIFI_PS_NONE
+#if CONFIG_POWER_PROFILE_PERFORMANCE || CONFIG_MESH_ROLE_GATEWAY
+#define WIFI_STA_POWER_SAVE 			WIFI_PS_NONE	// a mesh gateway must hear its leaves at any time
+#else
+#define WIFI_STA_POWER_SAVE 			WIFI_PS_MIN_MODEM	// radio sleeps between DTIM beacons
+#endif
 #define MAX_SSID_LENGTH 				32
 #define MAX_PASSWORD_LENGTH 			64
 #define MAX_CONNECTION_RETRIES 			5
@@ -49,6 +55,7 @@ typedef enum wifi_app_message
 	WIFI_APP_MSG_STA_DISCONNECTED,
 	WIFI_APP_MSG_USER_REQUESTED_STA_DISCONNECT,
 	WIFI_APP_MSG_LOAD_SAVED_CREDENTIALS,
+	WIFI_APP_MSG_STOP_SOFT_AP,
 } wifi_app_message_e;
 
 // Structure for the message queue
@@ -63,5 +70,6 @@ void wifi_app_start(void);
 wifi_config_t* wifi_app_get_wifi_config(void);
 void wifi_app_set_callback(wifi_connected_event_callback_t cb);
 void wifi_app_call_callback(void);
+void wifi_app_set_disconnected_callback(wifi_disconnected_event_callback_t cb);
 
 #endif /* MAIN_WIFI_APP_H_ */
\ No newline at end of file
@@ -0,0 +1,24 @@
+/*
+ * rmt_types.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef TEST_LINUX_HAL_RMT_TYPES_H_
+#define TEST_LINUX_HAL_RMT_TYPES_H_
+
+#include <stdint.h>
+
+// Host stand-in for the RMT symbol layout of hal/rmt_types.h, the linux target has no hal
+typedef union {
+    struct {
+        uint16_t duration0 : 15;
+        uint16_t level0 : 1;
+        uint16_t duration1 : 15;
+        uint16_t level1 : 1;
+    };
+    uint32_t val;
+} rmt_symbol_word_t;
+
+#endif /* TEST_LINUX_HAL_RMT_TYPES_H_ */
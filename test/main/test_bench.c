@@ -0,0 +1,65 @@
+/*
+ * test_bench.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/param.h>
+#include "sdkconfig.h"
+#include "unity.h"
+#include "test_bench.h"
+
+#if CONFIG_IDF_TARGET_LINUX
+#include <time.h>
+
+static uint32_t test_bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)(ts.tv_sec * 1000000000LL + ts.tv_nsec);
+}
+#define TEST_BENCH_UNIT             "ns"
+#else
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_cpu.h"
+
+static uint32_t test_bench_now(void)
+{
+	return esp_cpu_get_cycle_count();
+}
+#define TEST_BENCH_UNIT             "cycles"
+#endif
+
+void test_bench_run(const char *name, test_bench_fn_t fn, uint16_t iterations, uint32_t budget_cycles)
+{
+	uint32_t best = UINT32_MAX;
+	bool correct = true;
+
+	for (int round = 0; round < TEST_BENCH_ROUNDS; round++)
+	{
+		uint32_t start = test_bench_now();
+		for (int i = 0; i < iterations; i++)
+		{
+			correct &= fn();
+		}
+		best = MIN(best, (test_bench_now() - start) / iterations);
+#if !CONFIG_IDF_TARGET_LINUX
+		// Let the idle task run between rounds
+		vTaskDelay(1);
+#endif
+	}
+
+	TEST_ASSERT_TRUE_MESSAGE(correct, name);
+#if CONFIG_IDF_TARGET_LINUX
+	(void)budget_cycles;
+	printf("%-26s %8"PRIu32" "TEST_BENCH_UNIT" per call\n", name, best);
+#else
+	uint32_t budget = (uint32_t)((uint64_t)budget_cycles * CONFIG_TEST_BUDGET_PERCENT / 100);
+	printf("%-26s %8"PRIu32" "TEST_BENCH_UNIT" per call, budget %8"PRIu32"\n", name, best, budget);
+	TEST_ASSERT_LESS_OR_EQUAL_UINT32_MESSAGE(budget, best, name);
+#endif
+}
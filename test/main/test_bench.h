@@ -0,0 +1,28 @@
+/*
+ * test_bench.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#ifndef TEST_BENCH_H_
+#define TEST_BENCH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Every timed case runs this many rounds and the fastest one counts, interrupts and other
+// tasks only ever make a round slower
+#define TEST_BENCH_ROUNDS           5
+
+// One call of the timed code, false if its result is wrong
+typedef bool (*test_bench_fn_t)(void);
+
+/*
+* Times iterations calls of fn per round and fails the running test if a call returned false.
+* On the device it also fails if a call took more than budget_cycles, scaled by
+* CONFIG_TEST_BUDGET_PERCENT. The host build only reports the time per call
+*/
+void test_bench_run(const char *name, test_bench_fn_t fn, uint16_t iterations, uint32_t budget_cycles);
+
+#endif /* TEST_BENCH_H_ */
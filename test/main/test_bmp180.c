@@ -0,0 +1,152 @@
+/*
+ * test_bmp180.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include "unity.h"
+#include "bmp180_math.h"
+#include "test_bench.h"
+
+// Derived values are checked to 1 %, the fixed point and libm versions both pass
+#define TEST_BMP180_TOLERANCE       0.01f
+
+// Calibration words, raw conversions and results of the data sheet example (oss 0)
+static const t_bmp180_calibration_data datasheet_cal = {
+	.raw = { 408, (uint16_t)-72, (uint16_t)-14383, 32741, 32757, 23153, 6190, 4, (uint16_t)-32768, (uint16_t)-8711, 2868 },
+};
+#define DATASHEET_UT                27898
+#define DATASHEET_UP                23843
+#define DATASHEET_T                 150         // 0.1 C
+#define DATASHEET_P                 69964       // Pa
+
+/*
+* Largest difference of the derivations to double precision references of the same formulas over
+* 300..1100 hPa, -40..85 C, 1..100 %RH and -500..9000 m, as stated in bmp180_math.c. The sweep
+* below measures it for whichever of the fixed point and float versions is built
+*/
+#define SWEEP_ALTITUDE_M            0.007
+#define SWEEP_SEA_LEVEL_PRESSURE_PA 0.34
+#define SWEEP_DEW_POINT_C           0.0011
+#define SWEEP_AIR_DENSITY_KG_M3     1.1e-6
+
+static double reference_altitude(double p, double p0)
+{
+	return 44330.0 * (1.0 - pow(p / p0, 0.1903));
+}
+
+static double reference_sea_level_pressure(double p, double h, double t)
+{
+	return p * exp(GRAVITY_ACCEL * MOLAR_MASS_DRY_AIR * h / (UNIVERSAL_GAS_CONSTANT * (t + 273.15)));
+}
+
+static double reference_dew_point(double t, double rh)
+{
+	double alpha = 17.27 * t / (237.7 + t) + log(rh / 100.0);
+	return 237.7 * alpha / (17.27 - alpha);
+}
+
+static double reference_air_density(double p, double t, double rh)
+{
+	double e = rh / 100.0 * 0.6108 * exp(17.27 * t / (t + 237.3));
+	return ((p / 1000.0 - e) * 28.9644 + e * 18.0153) / (8.31432 * (t + 273.15));
+}
+
+static bool test_bmp180_close(float value, float expected)
+{
+	return fabsf(value - expected) <= TEST_BMP180_TOLERANCE * fabsf(expected);
+}
+
+static bool bench_compensate(void)
+{
+	int32_t t, p;
+
+	bmp180_compensate(&datasheet_cal, 0, DATASHEET_UT, DATASHEET_UP, &t, &p);
+	return t == DATASHEET_T && p == DATASHEET_P;
+}
+
+static bool bench_altitude(void)
+{
+	return test_bmp180_close(bmp180_calculate_altitude(DATASHEET_P, SEA_LEVEL_PRESSURE_PA), 3016.7f);
+}
+
+static bool bench_sea_level_pressure(void)
+{
+	return test_bmp180_close(bmp180_calculate_sea_level_pressure(DATASHEET_P, 3016.7f, 15.0f), 100047.0f);
+}
+
+static bool bench_dew_point(void)
+{
+	return test_bmp180_close(bmp180_calculate_dew_point(20.0f, 50.0f), 9.254f);
+}
+
+static bool bench_air_density(void)
+{
+	return test_bmp180_close(bmp180_calculate_air_density(101325, 15.0f, 50.0f), 1.2211f);
+}
+
+TEST_CASE("compensation matches the data sheet example", "[bmp180]")
+{
+	int32_t t, p;
+
+	bmp180_compensate(&datasheet_cal, 0, DATASHEET_UT, DATASHEET_UP, &t, &p);
+	TEST_ASSERT_EQUAL_INT32(DATASHEET_T, t);
+	TEST_ASSERT_EQUAL_INT32(DATASHEET_P, p);
+
+	// A temperature only conversion leaves the pressure alone
+	p = -1;
+	bmp180_compensate(&datasheet_cal, 0, DATASHEET_UT, DATASHEET_UP, &t, NULL);
+	TEST_ASSERT_EQUAL_INT32(DATASHEET_T, t);
+	TEST_ASSERT_EQUAL_INT32(-1, p);
+}
+
+TEST_CASE("compensation timing", "[bmp180][timing]")
+{
+	test_bench_run("bmp180_compensate", bench_compensate, 1000, 1000);
+}
+
+TEST_CASE("derivations match the reference values", "[bmp180][timing]")
+{
+	test_bench_run("bmp180_altitude", bench_altitude, 1000, 6000);
+	test_bench_run("bmp180_sea_level_pressure", bench_sea_level_pressure, 1000, 6000);
+	test_bench_run("bmp180_dew_point", bench_dew_point, 1000, 6000);
+	test_bench_run("bmp180_air_density", bench_air_density, 1000, 6000);
+}
+
+TEST_CASE("derivations stay within the stated bounds", "[bmp180]")
+{
+	double altitude = 0, sea_level = 0, dew_point = 0, density = 0;
+
+	for (uint32_t p = 30000; p <= 110000; p += 250)
+	{
+		altitude = fmax(altitude, fabs(bmp180_calculate_altitude(p, SEA_LEVEL_PRESSURE_PA) - reference_altitude(p, SEA_LEVEL_PRESSURE_PA)));
+		for (int t = -40; t <= 85; t += 5)
+		{
+			for (int h = -500; h <= 9000; h += 250)
+			{
+				sea_level = fmax(sea_level, fabs(bmp180_calculate_sea_level_pressure(p, h, t) - reference_sea_level_pressure(p, h, t)));
+			}
+			for (int rh = 1; rh <= 100; rh += 3)
+			{
+				density = fmax(density, fabs(bmp180_calculate_air_density(p, t, rh) - reference_air_density(p, t, rh)));
+			}
+		}
+	}
+	for (int t = -40; t <= 85; t++)
+	{
+		for (int rh = 1; rh <= 100; rh++)
+		{
+			dew_point = fmax(dew_point, fabs(bmp180_calculate_dew_point(t, rh) - reference_dew_point(t, rh)));
+		}
+	}
+
+	printf("largest difference: altitude %.4f m, sea level pressure %.4f Pa, dew point %.7f C, air density %.2e kg/m3\n",
+		altitude, sea_level, dew_point, density);
+	TEST_ASSERT_LESS_OR_EQUAL_FLOAT(SWEEP_ALTITUDE_M, altitude);
+	TEST_ASSERT_LESS_OR_EQUAL_FLOAT(SWEEP_SEA_LEVEL_PRESSURE_PA, sea_level);
+	TEST_ASSERT_LESS_OR_EQUAL_FLOAT(SWEEP_DEW_POINT_C, dew_point);
+	TEST_ASSERT_LESS_OR_EQUAL_FLOAT(SWEEP_AIR_DENSITY_KG_M3, density);
+}
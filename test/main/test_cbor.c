@@ -0,0 +1,60 @@
+/*
+ * test_cbor.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#include "unity.h"
+#include "cbor_writer.h"
+
+TEST_CASE("integers take the shortest form", "[cbor]")
+{
+	static const uint8_t expected[] = {
+		0x17,                           // 23
+		0x18, 0x18,                     // 24
+		0x19, 0x01, 0x00,               // 256
+		0x1A, 0x00, 0x01, 0x00, 0x00,   // 65536
+		0x20,                           // -1
+		0x39, 0x01, 0xF3,               // -500
+	};
+	uint8_t buf[32];
+	cbor_writer_t w;
+
+	cbor_writer_init(&w, buf, sizeof(buf));
+	cbor_put_uint(&w, 23);
+	cbor_put_uint(&w, 24);
+	cbor_put_uint(&w, 256);
+	cbor_put_uint(&w, 65536);
+	cbor_put_int(&w, -1);
+	cbor_put_int(&w, -500);
+	TEST_ASSERT_EQUAL_size_t(sizeof(expected), cbor_writer_length(&w));
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, buf, sizeof(expected));
+}
+
+TEST_CASE("containers and text", "[cbor]")
+{
+	static const uint8_t expected[] = { 0xA1, 0x62, 'i', 'd', 0x9F, 0xF6, 0xFF };
+	uint8_t buf[16];
+	cbor_writer_t w;
+
+	cbor_writer_init(&w, buf, sizeof(buf));
+	cbor_put_map(&w, 1);
+	cbor_put_text(&w, "id");
+	cbor_put_array_indefinite(&w);
+	cbor_put_null(&w);
+	cbor_put_break(&w);
+	TEST_ASSERT_EQUAL_size_t(sizeof(expected), cbor_writer_length(&w));
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, buf, sizeof(expected));
+}
+
+TEST_CASE("output that does not fit has no length", "[cbor]")
+{
+	uint8_t buf[4];
+	cbor_writer_t w;
+
+	cbor_writer_init(&w, buf, sizeof(buf));
+	cbor_put_text(&w, "too long");
+	TEST_ASSERT_FALSE(w.ok);
+	TEST_ASSERT_EQUAL_size_t(0, cbor_writer_length(&w));
+}
@@ -0,0 +1,171 @@
+/*
+ * test_dht22.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#include <string.h>
+#include "unity.h"
+#include "dht22_frame.h"
+#include "test_bench.h"
+
+// One RMT symbol in the layout CONFIG_DHT22_CAPTURE_DUMP logs, so a logged capture pastes in as is
+#define DHT22_SYMBOL(l0, d0, l1, d1) \
+	{ .level0 = (l0), .duration0 = (d0), .level1 = (l1), .duration1 = (d1) }
+
+#define DHT22_TRACE_SYMBOLS         42          // response, 40 bits, trailer
+
+// Frame of the traces below, 65.2 %RH and 35.1 C
+static const uint8_t trace_frame[5] = { 0x02, 0x8C, 0x01, 0x5F, 0xEE };
+
+/*
+* Pulse train of trace_frame synthesized from the nominal data sheet widths (response 80/80 us,
+* bit low 50 us, '0' high 26 us, '1' high 70 us). No hardware capture is recorded yet, replace
+* it with one logged by CONFIG_DHT22_CAPTURE_DUMP
+*/
+static const rmt_symbol_word_t nominal_trace[DHT22_TRACE_SYMBOLS] = {
+	DHT22_SYMBOL(0, 80, 1, 80),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 70),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 70),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 70),
+	DHT22_SYMBOL(0, 50, 1, 70),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 70),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 70),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 70),
+	DHT22_SYMBOL(0, 50, 1, 70),
+	DHT22_SYMBOL(0, 50, 1, 70),
+	DHT22_SYMBOL(0, 50, 1, 70),
+	DHT22_SYMBOL(0, 50, 1, 70),
+	DHT22_SYMBOL(0, 50, 1, 70),
+	DHT22_SYMBOL(0, 50, 1, 70),
+	DHT22_SYMBOL(0, 50, 1, 70),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 70),
+	DHT22_SYMBOL(0, 50, 1, 70),
+	DHT22_SYMBOL(0, 50, 1, 70),
+	DHT22_SYMBOL(0, 50, 1, 26),
+	DHT22_SYMBOL(0, 50, 1, 0),
+};
+
+// Pulse widths of a generated trace, in us
+typedef struct {
+	uint16_t low;
+	uint16_t zero;
+	uint16_t one;
+} dht22_timing_t;
+
+// The data sheet tolerance limits of the bit timing
+static const dht22_timing_t tolerance_limits[] = {
+	{ .low = 48, .zero = 22, .one = 68 },
+	{ .low = 55, .zero = 30, .one = 68 },
+	{ .low = 48, .zero = 22, .one = 75 },
+	{ .low = 55, .zero = 30, .one = 75 },
+};
+
+static void test_dht22_build_trace(rmt_symbol_word_t *trace, const uint8_t frame[5], const dht22_timing_t *timing)
+{
+	trace[0] = (rmt_symbol_word_t)DHT22_SYMBOL(0, 80, 1, 80);
+	for (int bit = 0; bit < 40; bit++)
+	{
+		bool one = frame[bit / 8] & (1 << (7 - (bit % 8)));
+		trace[1 + bit] = (rmt_symbol_word_t)DHT22_SYMBOL(0, timing->low, 1, one ? timing->one : timing->zero);
+	}
+	trace[DHT22_TRACE_SYMBOLS - 1] = (rmt_symbol_word_t)DHT22_SYMBOL(0, timing->low, 1, 0);
+}
+
+static bool bench_decode(void)
+{
+	uint8_t data[5];
+	dht22_t dht22 = { 0 };
+
+	if (dht22_decode_symbols(nominal_trace, DHT22_TRACE_SYMBOLS, data) != DHT_OK ||
+		dht22_decode_frame(&dht22, data) != DHT_OK)
+	{
+		return false;
+	}
+	return dht22.humidity > 65.15f && dht22.humidity < 65.25f &&
+		dht22.temperature > 35.05f && dht22.temperature < 35.15f;
+}
+
+TEST_CASE("nominal trace decodes", "[dht22]")
+{
+	uint8_t data[5];
+	dht22_t dht22 = { 0 };
+
+	TEST_ASSERT_EQUAL_INT(DHT_OK, dht22_decode_symbols(nominal_trace, DHT22_TRACE_SYMBOLS, data));
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(trace_frame, data, 5);
+	TEST_ASSERT_EQUAL_INT(DHT_OK, dht22_decode_frame(&dht22, data));
+	TEST_ASSERT_FLOAT_WITHIN(0.01f, 65.2f, dht22.humidity);
+	TEST_ASSERT_FLOAT_WITHIN(0.01f, 35.1f, dht22.temperature);
+}
+
+TEST_CASE("traces at the timing tolerance limits decode", "[dht22]")
+{
+	rmt_symbol_word_t trace[DHT22_TRACE_SYMBOLS];
+	uint8_t data[5];
+
+	for (int i = 0; i < sizeof(tolerance_limits) / sizeof(tolerance_limits[0]); i++)
+	{
+		test_dht22_build_trace(trace, trace_frame, &tolerance_limits[i]);
+		TEST_ASSERT_EQUAL_INT(DHT_OK, dht22_decode_symbols(trace, DHT22_TRACE_SYMBOLS, data));
+		TEST_ASSERT_EQUAL_HEX8_ARRAY(trace_frame, data, 5);
+	}
+}
+
+TEST_CASE("capture without the response preamble decodes", "[dht22]")
+{
+	uint8_t data[5];
+
+	TEST_ASSERT_EQUAL_INT(DHT_OK, dht22_decode_symbols(&nominal_trace[1], DHT22_TRACE_SYMBOLS - 1, data));
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(trace_frame, data, 5);
+}
+
+TEST_CASE("short capture is a timeout", "[dht22]")
+{
+	uint8_t data[5];
+
+	TEST_ASSERT_EQUAL_INT(DHT_TIMEOUT_ERROR, dht22_decode_symbols(nominal_trace, 20, data));
+}
+
+TEST_CASE("frame checksum and sign", "[dht22]")
+{
+	// 50.0 %RH and -10.1 C, the sign is the MSB of the temperature
+	const uint8_t negative[5] = { 0x01, 0xF4, 0x80, 0x65, 0xDA };
+	uint8_t corrupt[5];
+	dht22_t dht22 = { 0 };
+
+	TEST_ASSERT_EQUAL_INT(DHT_OK, dht22_decode_frame(&dht22, negative));
+	TEST_ASSERT_FLOAT_WITHIN(0.01f, 50.0f, dht22.humidity);
+	TEST_ASSERT_FLOAT_WITHIN(0.01f, -10.1f, dht22.temperature);
+
+	memcpy(corrupt, trace_frame, sizeof(corrupt));
+	corrupt[4] ^= 0x01;
+	TEST_ASSERT_EQUAL_INT(DHT_CHECKSUM_ERROR, dht22_decode_frame(&dht22, corrupt));
+}
+
+TEST_CASE("decode timing", "[dht22][timing]")
+{
+	test_bench_run("dht22_decode", bench_decode, 1000, 12000);
+}
@@ -0,0 +1,24 @@
+/*
+ * test_main.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#include <stdlib.h>
+#include "sdkconfig.h"
+#include "unity.h"
+
+void app_main(void)
+{
+	UNITY_BEGIN();
+	unity_run_all_tests();
+	int failures = UNITY_END();
+
+#if CONFIG_IDF_TARGET_LINUX
+	// The exit status tells a CI run that a case failed
+	exit(failures != 0);
+#else
+	(void)failures;
+#endif
+}
@@ -0,0 +1,22 @@
+/*
+ * test_stubs.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#include <string.h>
+#include "sntp_time_sync.h"
+
+// The telemetry body carries the local time, a fixed text keeps the output comparable
+size_t sntp_time_sync_get_time(char *buf, size_t size)
+{
+	static const char text[] = "14/10/2026 , 12:00:00";
+
+	if (size < sizeof(text))
+	{
+		return 0;
+	}
+	memcpy(buf, text, sizeof(text));
+	return sizeof(text) - 1;
+}
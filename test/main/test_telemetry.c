@@ -0,0 +1,119 @@
+/*
+ * test_telemetry.c
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: karthik
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include "unity.h"
+#include "bmp180.h"
+#include "metrics.h"
+#include "sntp_time_sync.h"
+#include "system_report.h"
+#include "telemetry_cache.h"
+#include "test_bench.h"
+
+// /sensors.json and /alerts.json are left out, their modules pull in NVS and the Wi-Fi application.
+// /dhtSensor.json is a single format string over the store sample
+
+#define TEST_TELEMETRY_BUFFER_SIZE  MAX(TELEMETRY_CACHE_SIZE, SYSTEM_REPORT_JSON_SIZE)
+
+static sensor_snapshot_t snapshot;
+static char *scratch = NULL;
+
+// Both sources current, as the bodies look in normal operation
+static void test_telemetry_setup(void)
+{
+	int64_t now = sntp_time_sync_monotonic_us();
+
+	memset(&snapshot, 0, sizeof(snapshot));
+	snapshot.seq = 2;
+	snapshot.temperature = 21.4f;
+	snapshot.dht22 = (sensor_dht22_sample_t){
+		.seq = 1, .timestamp_us = now, .temperature = 21.5f, .humidity = 48.2f, .fused_temperature = 21.5f,
+	};
+	snapshot.bmp180.seq = 2;
+	snapshot.bmp180.timestamp_us = now;
+	snapshot.bmp180.fused_temperature = 21.4f;
+	snapshot.bmp180.readings = (bmp180_readings_t){
+		.temperature = 22.1f, .pressure = 100912, .pressure_hPa = 1009.12f, .humidity = 48.2f, .valid = true,
+	};
+	bmp180_derive(&snapshot.bmp180.readings, BMP180_DERIVE_ALL);
+
+	scratch = malloc(TEST_TELEMETRY_BUFFER_SIZE);
+	TEST_ASSERT_NOT_NULL(scratch);
+}
+
+static void test_telemetry_teardown(void)
+{
+	free(scratch);
+	scratch = NULL;
+}
+
+static bool bench_telemetry_json(void)
+{
+	return telemetry_cache_format_json(&snapshot, "null", scratch, TELEMETRY_CACHE_SIZE) != 0;
+}
+
+static bool bench_telemetry_cbor(void)
+{
+	return telemetry_cache_encode_cbor(&snapshot, TELEMETRY_CBOR_SOURCE_ALL, (uint8_t *)scratch, TELEMETRY_CACHE_CBOR_SIZE) != 0;
+}
+
+static bool bench_system_json(void)
+{
+	return system_report_format_json(scratch, SYSTEM_REPORT_JSON_SIZE) != 0;
+}
+
+static bool test_telemetry_count_bytes(const char *data, size_t len, void *ctx)
+{
+	*(size_t *)ctx += len;
+	return true;
+}
+
+static bool bench_metrics(void)
+{
+	size_t len = 0;
+	return metrics_write(&test_telemetry_count_bytes, &len) == ESP_OK && len != 0;
+}
+
+TEST_CASE("telemetry JSON body", "[telemetry]")
+{
+	test_telemetry_setup();
+	size_t len = telemetry_cache_format_json(&snapshot, "null", scratch, TELEMETRY_CACHE_SIZE);
+	TEST_ASSERT_NOT_EQUAL(0, len);
+	TEST_ASSERT_EQUAL_size_t(strlen(scratch), len);
+	TEST_ASSERT_NOT_NULL(strstr(scratch, "\"wifi\":null"));
+	test_telemetry_teardown();
+}
+
+TEST_CASE("BMP180 JSON body", "[telemetry]")
+{
+	test_telemetry_setup();
+	size_t len = bmp180_format_json(&snapshot.bmp180.readings, scratch, BMP180_JSON_SIZE);
+	TEST_ASSERT_NOT_EQUAL(0, len);
+	TEST_ASSERT_EQUAL_size_t(strlen(scratch), len);
+	TEST_ASSERT_NOT_NULL(strstr(scratch, "\"pressure\":\"1009.12\""));
+
+	// A body that does not fit is reported, never sent cut short
+	TEST_ASSERT_EQUAL_size_t(0, bmp180_format_json(&snapshot.bmp180.readings, scratch, len));
+
+	snapshot.bmp180.readings.valid = false;
+	len = bmp180_format_json(&snapshot.bmp180.readings, scratch, BMP180_JSON_SIZE);
+	TEST_ASSERT_NOT_EQUAL(0, len);
+	TEST_ASSERT_NOT_NULL(strstr(scratch, "\"temperature\":\"Error\""));
+	test_telemetry_teardown();
+}
+
+TEST_CASE("serialization timing", "[telemetry][timing]")
+{
+	test_telemetry_setup();
+	test_bench_run("telemetry_json", bench_telemetry_json, 20, 400000);
+	test_bench_run("telemetry_cbor", bench_telemetry_cbor, 200, 40000);
+	test_bench_run("system_json", bench_system_json, 5, 1000000);
+	test_bench_run("metrics", bench_metrics, 5, 3000000);
+	test_telemetry_teardown();
+}
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""Load test for the device web server.
+
+  http_load.py <host> [--clients 8] [--duration 30] [--endpoint /telemetry.json ...]
+
+Every client is a thread with its own persistent HTTP/1.1 connection (keep-alive, reopened
+after an error) that requests the endpoints round robin as fast as the device answers. At the
+end the sustained requests per second and the latency percentiles are printed per endpoint,
+along with errors and connections that had to be reopened. Run it once per server profile,
+e.g. with as many clients as the AP takes (WIFI_AP_MAX_CONNECTIONS) plus station side viewers.
+"""
+
+import argparse
+import http.client
+import threading
+import time
+
+DEFAULT_ENDPOINTS = [
+    "/telemetry.json",
+    "/dhtSensor.json",
+    "/bmp180Sensor.json",
+    "/sensors.json",
+    "/localTime.json",
+    "/history.json?step=30",
+    "/metrics",
+    "/app.js",
+]
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.latency = {}       # endpoint -> list of seconds
+        self.errors = {}
+        self.reconnects = 0
+
+    def add(self, endpoint, seconds):
+        with self.lock:
+            self.latency.setdefault(endpoint, []).append(seconds)
+
+    def error(self, endpoint):
+        with self.lock:
+            self.errors[endpoint] = self.errors.get(endpoint, 0) + 1
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return 0.0
+    k = min(len(sorted_values) - 1, int(round(p / 100.0 * (len(sorted_values) - 1))))
+    return sorted_values[k]
+
+
+def client(host, port, endpoints, offset, deadline, timeout, stats):
+    conn = None
+    i = offset
+    while time.monotonic() < deadline:
+        endpoint = endpoints[i % len(endpoints)]
+        i += 1
+        if conn is None:
+            conn = http.client.HTTPConnection(host, port, timeout=timeout)
+        start = time.monotonic()
+        try:
+            conn.request("GET", endpoint, headers={"Accept-Encoding": "gzip"})
+            resp = conn.getresponse()
+            resp.read()
+            if resp.status != 200:
+                stats.error(endpoint)
+            else:
+                stats.add(endpoint, time.monotonic() - start)
+            if resp.will_close:
+                conn.close()
+                conn = None
+        except (OSError, http.client.HTTPException):
+            stats.error(endpoint)
+            conn.close()
+            conn = None
+            with stats.lock:
+                stats.reconnects += 1
+            time.sleep(0.1)
+    if conn is not None:
+        conn.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("host", help="device address, e.g. 192.168.0.1")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--clients", type=int, default=8, help="concurrent connections")
+    parser.add_argument("--duration", type=float, default=30.0, help="seconds of load")
+    parser.add_argument("--timeout", type=float, default=10.0, help="per request timeout in seconds")
+    parser.add_argument("--endpoint", action="append", dest="endpoints", help="path to request, repeatable")
+    args = parser.parse_args()
+
+    endpoints = args.endpoints or DEFAULT_ENDPOINTS
+    stats = Stats()
+    deadline = time.monotonic() + args.duration
+    threads = [threading.Thread(target=client, daemon=True,
+                                args=(args.host, args.port, endpoints, n, deadline, args.timeout, stats))
+               for n in range(args.clients)]
+    start = time.monotonic()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    elapsed = time.monotonic() - start
+
+    print("%d clients for %.1f s against %s:%d" % (args.clients, elapsed, args.host, args.port))
+    print("%-28s %8s %8s %8s %9s %9s %9s" % ("endpoint", "ok", "errors", "req/s", "p50 ms", "p99 ms", "max ms"))
+    total = 0
+    for endpoint in endpoints:
+        values = sorted(stats.latency.get(endpoint, []))
+        total += len(values)
+        print("%-28s %8d %8d %8.1f %9.1f %9.1f %9.1f" % (
+            endpoint, len(values), stats.errors.get(endpoint, 0), len(values) / elapsed,
+            1000 * percentile(values, 50), 1000 * percentile(values, 99), 1000 * (values[-1] if values else 0)))
+    print("total %.1f req/s, %d errors, %d reconnects" % (total / elapsed, sum(stats.errors.values()), stats.reconnects))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""Prepares smaller OTA uploads for the /OTAupdate endpoint.
+
+  compress <new.bin> <out.bin.gz>
+      gzip the application image, the device inflates it while flashing.
+
+  delta <running.bin> <new.bin> <out.delta> [--no-compress]
+      binary diff against the image the device is running now, gzip compressed
+      unless --no-compress. The device checks the SHA-256 of its running image
+      against the one recorded here before applying it.
+
+Delta format (little endian), see main/ota_update.c:
+  header  "ESPD", version 1, 3 reserved bytes, source size (u32), source SHA-256
+  ops     0x01 COPY src_offset(u32) len(u32)
+          0x02 INSERT len(u32) followed by len bytes
+          0x00 END
+"""
+
+import argparse
+import gzip
+import hashlib
+import struct
+import sys
+
+DELTA_MAGIC = b"ESPD"
+DELTA_VERSION = 1
+OP_END = 0x00
+OP_COPY = 0x01
+OP_INSERT = 0x02
+
+MATCH_LEN = 32      # shortest copy worth a 9 byte op
+INDEX_STEP = 4      # source positions indexed, any match of MATCH_LEN + 3 is still found
+
+
+def make_delta(old, new):
+    index = {}
+    for pos in range(0, len(old) - MATCH_LEN + 1, INDEX_STEP):
+        index.setdefault(old[pos:pos + MATCH_LEN], pos)
+
+    out = bytearray()
+    out += DELTA_MAGIC + bytes([DELTA_VERSION, 0, 0, 0])
+    out += struct.pack("<I", len(old)) + hashlib.sha256(old).digest()
+
+    def insert(data):
+        if data:
+            out.extend(struct.pack("<BI", OP_INSERT, len(data)) + data)
+
+    pos = literal = 0
+    while pos + MATCH_LEN <= len(new):
+        src = index.get(new[pos:pos + MATCH_LEN])
+        if src is None:
+            pos += 1
+            continue
+        # Grow the match backwards into pending literals, then forwards
+        while pos > literal and src > 0 and new[pos - 1] == old[src - 1]:
+            pos -= 1
+            src -= 1
+        length = MATCH_LEN
+        while pos + length < len(new) and src + length < len(old) and new[pos + length] == old[src + length]:
+            length += 1
+
+        insert(new[literal:pos])
+        out += struct.pack("<BII", OP_COPY, src, length)
+        pos += length
+        literal = pos
+
+    insert(new[literal:])
+    out.append(OP_END)
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("compress", help="gzip an application image")
+    p.add_argument("image")
+    p.add_argument("output")
+
+    p = sub.add_parser("delta", help="diff an image against the running one")
+    p.add_argument("running")
+    p.add_argument("image")
+    p.add_argument("output")
+    p.add_argument("--no-compress", action="store_true", help="write the delta without gzip")
+
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    if not image or image[0] != 0xE9:
+        sys.exit("%s is not an application image" % args.image)
+
+    if args.command == "compress":
+        payload = gzip.compress(image, compresslevel=9, mtime=0)
+    else:
+        with open(args.running, "rb") as f:
+            payload = make_delta(f.read(), image)
+        if not args.no_compress:
+            payload = gzip.compress(payload, compresslevel=9, mtime=0)
+
+    with open(args.output, "wb") as f:
+        f.write(payload)
+    print("%s: %d bytes (%.1f%% of %d)" % (args.output, len(payload), 100.0 * len(payload) / len(image), len(image)))
+
+
+if __name__ == "__main__":
+    main()